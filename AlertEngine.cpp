@@ -0,0 +1,396 @@
+#include "AlertEngine.h"
+#include "PerfLog.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSoundEffect>
+#include <QStandardPaths>
+#include <QUrl>
+#include <QtEndian>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+constexpr int SampleRate = 22050;
+constexpr int MaxAlertedTracks = 64;
+
+struct Tone
+{
+    double frequencyHz;    // 0 for silence
+    int milliseconds;
+};
+
+void putU32(QByteArray &out, quint32 value)
+{
+    char bytes[4];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 4);
+}
+
+void putU16(QByteArray &out, quint16 value)
+{
+    char bytes[2];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 2);
+}
+
+// 16-bit mono PCM; every tone fades in and out over 5 ms so it does not click
+bool writeTones(const QString &path, std::initializer_list<Tone> tones)
+{
+    QByteArray samples;
+    for (const Tone &tone : tones) {
+        const int count = SampleRate * tone.milliseconds / 1000;
+        const int fade = SampleRate * 5 / 1000;
+        for (int i = 0; i < count; ++i) {
+            double value = 0.0;
+            if (tone.frequencyHz > 0.0) {
+                const double envelope = std::min({ 1.0, double(i) / fade, double(count - 1 - i) / fade });
+                value = 0.7 * envelope * std::sin(2.0 * M_PI * tone.frequencyHz * i / SampleRate);
+            }
+            putU16(samples, quint16(qint16(value * 32767.0)));
+        }
+    }
+
+    QByteArray wav;
+    wav.append("RIFF", 4);
+    putU32(wav, quint32(36 + samples.size()));
+    wav.append("WAVEfmt ", 8);
+    putU32(wav, 16);
+    putU16(wav, 1);                    // PCM
+    putU16(wav, 1);                    // Channels
+    putU32(wav, SampleRate);
+    putU32(wav, SampleRate * 2);       // Bytes per second
+    putU16(wav, 2);                    // Block align
+    putU16(wav, 16);
+    wav.append("data", 4);
+    putU32(wav, quint32(samples.size()));
+    wav.append(samples);
+
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(wav) == wav.size() && file.commit();
+}
+
+} // namespace
+
+qint64 AlertEngine::clockNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+AlertEngine::AlertEngine(QObject *parent)
+    : QObject(parent)
+    , m_workerContext(new QObject)
+{
+    if (qEnvironmentVariable("NEURODRIVE_ALERTS") == "off") {
+        m_enabled = false;
+    }
+
+    m_clearTimer.setSingleShot(true);
+    connect(&m_clearTimer, &QTimer::timeout, this, &AlertEngine::clearDrowsiness);
+
+    m_thread.setObjectName("AlertEngine");
+    m_workerContext->moveToThread(&m_thread);
+}
+
+AlertEngine::~AlertEngine()
+{
+    // The effects own audio sinks of the alert thread
+    if (m_thread.isRunning()) {
+        QMetaObject::invokeMethod(m_workerContext, [this]() {
+            qDeleteAll(m_effects);
+            m_effects.clear();
+            m_pending.clear();
+        }, Qt::BlockingQueuedConnection);
+    }
+    m_thread.quit();
+    m_thread.wait();
+    delete m_workerContext;
+}
+
+void AlertEngine::setPolicy(const Policy &policy)
+{
+    m_policy = policy;
+}
+
+void AlertEngine::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled) {
+        return;
+    }
+    m_enabled = enabled;
+    if (!enabled) {
+        clearDrowsiness();
+        QMetaObject::invokeMethod(m_workerContext, [this]() {
+            for (QSoundEffect *effect : std::as_const(m_effects)) {
+                effect->stop();
+            }
+            m_pending.clear();
+        });
+    }
+    emit enabledChanged();
+}
+
+QString AlertEngine::soundKey(const QString &name)
+{
+    QString key = name.trimmed().toLower();
+    for (QChar &c : key) {
+        if (!c.isLetterOrNumber()) {
+            c = '_';
+        }
+    }
+    return key;
+}
+
+void AlertEngine::start()
+{
+    if (!m_thread.isRunning()) {
+        // Above the model threads; an alert is only a queued call away
+        m_thread.start(QThread::HighPriority);
+    }
+}
+
+void AlertEngine::loadSounds(const QStringList &directories)
+{
+    start();
+    QHash<QString, QString> files;
+    for (const QString &directory : directories) {
+        const QFileInfoList entries = QDir(directory).entryInfoList(QStringList() << "*.wav", QDir::Files);
+        for (const QFileInfo &entry : entries) {
+            const QString key = soundKey(entry.completeBaseName());
+            if (!files.contains(key)) {
+                files.insert(key, entry.absoluteFilePath());
+            }
+        }
+    }
+
+    // The drowsiness sounds must exist; generated once into the cache
+    const QString cache = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/alerts";
+    if (!files.contains("drowsy") || !files.contains("alarm")) {
+        QDir().mkpath(cache);
+    }
+    if (!files.contains("drowsy")) {
+        const QString path = cache + "/drowsy.wav";
+        if (QFileInfo::exists(path) || writeTones(path, { { 880.0, 150 }, { 0.0, 80 }, { 880.0, 150 } })) {
+            files.insert("drowsy", path);
+        }
+    }
+    if (!files.contains("alarm")) {
+        const QString path = cache + "/alarm.wav";
+        if (QFileInfo::exists(path) || writeTones(path, { { 1400.0, 180 }, { 1000.0, 180 }, { 1400.0, 180 }, { 1000.0, 180 } })) {
+            files.insert("alarm", path);
+        }
+    }
+    if (!files.contains("drowsy") || !files.contains("alarm")) {
+        qWarning() << "AlertEngine: cannot write the fallback alert tones to" << cache;
+    }
+
+    m_files = files;
+    qDebug() << "AlertEngine: loading" << files.size() << "alert sounds";
+    QMetaObject::invokeMethod(m_workerContext, [this, files]() { createEffects(files); });
+}
+
+void AlertEngine::reset()
+{
+    m_alertedTracks.clear();
+    m_lastSignNs.clear();
+}
+
+void AlertEngine::setLevel(Level level)
+{
+    if (m_level != level) {
+        m_level = level;
+        emit levelChanged();
+    }
+}
+
+void AlertEngine::handleDrowsiness(double value, qint64 eventNs)
+{
+    if (!m_enabled) {
+        return;
+    }
+    if (value <= 0.0) {
+        // Not confirmed yet, it starts over; an alert clears on the timer
+        if (m_level == Clear) {
+            m_drowsySinceNs = -1;
+        }
+        return;
+    }
+
+    m_clearTimer.start(m_policy.clearMs);
+    if (m_drowsySinceNs < 0) {
+        m_drowsySinceNs = eventNs;
+    }
+    const qint64 msNs = 1000000;
+    switch (m_level) {
+    case Clear:
+        if (eventNs - m_drowsySinceNs >= m_policy.confirmMs * msNs) {
+            setLevel(Warning);
+            m_alertStartNs = eventNs;
+            m_lastChimeNs = eventNs;
+            play("drowsy", m_policy.warningVolume, false, eventNs);
+        }
+        break;
+    case Warning:
+        if (eventNs - m_alertStartNs >= m_policy.escalateAfterMs * msNs) {
+            setLevel(Alarm);
+            play("alarm", m_policy.alarmVolume, true, eventNs);
+        } else if (eventNs - m_lastChimeNs >= m_policy.repeatMs * msNs) {
+            m_lastChimeNs = eventNs;
+            play("drowsy", m_policy.warningVolume, false, eventNs);
+        }
+        break;
+    case Alarm:
+        break;  // Loops until cleared
+    }
+}
+
+void AlertEngine::clearDrowsiness()
+{
+    m_clearTimer.stop();
+    m_drowsySinceNs = -1;
+    m_alertStartNs = -1;
+    m_lastChimeNs = -1;
+    if (m_level == Alarm) {
+        stop("alarm");
+    }
+    setLevel(Clear);
+}
+
+void AlertEngine::handleDetections(const QList<Detection> &detections, const QStringList &labels, qint64 eventNs)
+{
+    if (!m_enabled || m_level != Clear) {
+        return;
+    }
+    for (int i = 0; i < detections.size(); ++i) {
+        const Detection &detection = detections.at(i);
+        if (detection.confidence < m_policy.minSignConfidence
+            || (detection.trackId >= 0 && m_alertedTracks.contains(detection.trackId))) {
+            continue;
+        }
+        QString key = soundKey(labels.value(i));
+        if (key.isEmpty() || !m_files.contains(key)) {
+            key = QString::number(detection.classId);
+        }
+        if (!m_files.contains(key) || key == "drowsy" || key == "alarm") {
+            continue;
+        }
+        // A track seen again after its class's cooldown is not a new sign
+        if (detection.trackId >= 0) {
+            m_alertedTracks.append(detection.trackId);
+            if (m_alertedTracks.size() > MaxAlertedTracks) {
+                m_alertedTracks.removeFirst();
+            }
+        }
+        const auto last = m_lastSignNs.constFind(key);
+        if (last != m_lastSignNs.constEnd() && eventNs - *last < m_policy.signCooldownMs * qint64(1000000)) {
+            continue;
+        }
+        m_lastSignNs.insert(key, eventNs);
+        play(key, m_policy.signVolume, false, eventNs);
+        return;  // One sign at a time
+    }
+}
+
+void AlertEngine::play(const QString &sound, double volume, bool loop, qint64 eventNs)
+{
+    const int level = m_level;
+    emit alertRaised(sound, level, eventNs);
+    QMetaObject::invokeMethod(m_workerContext, [this, sound, volume, loop, eventNs, level]() {
+        startEffect(sound, volume, loop, eventNs, level);
+    });
+}
+
+void AlertEngine::stop(const QString &sound)
+{
+    QMetaObject::invokeMethod(m_workerContext, [this, sound]() {
+        if (QSoundEffect *effect = m_effects.value(sound)) {
+            effect->stop();
+            m_pending.remove(effect);
+        }
+    });
+}
+
+void AlertEngine::recordLatency(const QString &sound, int level, double latencyMs)
+{
+    m_lastLatencyMs = latencyMs;
+    m_maxLatencyMs = qMax(m_maxLatencyMs, latencyMs);
+    QVariantMap tags;
+    tags.insert("alert", sound);
+    tags.insert("level", level);
+    PerfLog::record("alert.latency", latencyMs, "ms", tags);
+    if (latencyMs > m_policy.latencyBudgetMs) {
+        ++m_overBudget;
+        qWarning() << "AlertEngine:" << sound << "started" << latencyMs << "ms after its event";
+    }
+    emit latencyChanged();
+    emit alertPlayed(sound, level, latencyMs);
+}
+
+void AlertEngine::createEffects(const QHash<QString, QString> &files)
+{
+    qDeleteAll(m_effects);
+    m_effects.clear();
+    m_pending.clear();
+    for (auto it = files.constBegin(); it != files.constEnd(); ++it) {
+        QSoundEffect *effect = new QSoundEffect(m_workerContext);
+        connect(effect, &QSoundEffect::playingChanged, m_workerContext, [this, effect]() {
+            effectPlayingChanged(effect);
+        });
+        // Once decoded, played muted so the audio device is open before the first alert
+        connect(effect, &QSoundEffect::statusChanged, m_workerContext, [effect, path = it.value()]() {
+            if (effect->status() == QSoundEffect::Ready && !effect->isPlaying()) {
+                effect->setMuted(true);
+                effect->play();
+            } else if (effect->status() == QSoundEffect::Error) {
+                qWarning() << "AlertEngine: cannot decode" << path;
+            }
+        });
+        effect->setSource(QUrl::fromLocalFile(it.value()));
+        m_effects.insert(it.key(), effect);
+    }
+}
+
+void AlertEngine::startEffect(const QString &sound, double volume, bool loop, qint64 eventNs, int level)
+{
+    QSoundEffect *effect = m_effects.value(sound);
+    if (!effect || effect->status() != QSoundEffect::Ready) {
+        qWarning() << "AlertEngine:" << sound << "is not loaded";
+        return;
+    }
+    // The newest alert wins; drowsiness never shares the speaker with a sign
+    for (QSoundEffect *other : std::as_const(m_effects)) {
+        if (other->isPlaying()) {
+            other->stop();
+        }
+    }
+    m_pending.clear();
+    effect->setMuted(false);
+    effect->setVolume(volume);
+    effect->setLoopCount(loop ? int(QSoundEffect::Infinite) : 1);
+    m_pending.insert(effect, { sound, eventNs, level });
+    effect->play();
+    // Some backends start synchronously, others report it later
+    effectPlayingChanged(effect);
+}
+
+void AlertEngine::effectPlayingChanged(QSoundEffect *effect)
+{
+    if (!effect->isPlaying()) {
+        effect->setMuted(false);
+        return;
+    }
+    const auto pending = m_pending.constFind(effect);
+    if (pending == m_pending.constEnd()) {
+        return;
+    }
+    const double latencyMs = double(clockNs() - pending->eventNs) / 1e6;
+    const QString sound = pending->sound;
+    const int level = pending->level;
+    m_pending.erase(pending);
+    QMetaObject::invokeMethod(this, [this, sound, level, latencyMs]() { recordLatency(sound, level, latencyMs); });
+}
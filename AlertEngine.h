@@ -0,0 +1,148 @@
+#ifndef ALERTENGINE_H
+#define ALERTENGINE_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include "WorkerChannel.h"
+
+class QSoundEffect;
+
+// Plays the driver alerts in the dashboard itself; the scripts only serve
+// class_audio over HTTP. ProcessManager hands drowsiness states and traffic
+// sign detections over as soon as they are parsed, and every sound is
+// decoded into memory at start-up by a QSoundEffect on the alert thread, so
+// neither a busy GUI thread nor a first decode holds an alert up.
+//
+// Drowsiness: a drowsy state held for Policy::confirmMs alerts at once and
+// repeats every Policy::repeatMs. After Policy::escalateAfterMs the chime
+// becomes the looping alarm at full volume. The alert clears
+// Policy::clearMs after the last drowsy state.
+//
+// Traffic signs: a sign whose class has a sound alerts once per track, at
+// most once per Policy::signCooldownMs per class, and never over a
+// drowsiness alert, which also cuts a sign short.
+//
+// The time from the event to QSoundEffect starting the sound is reported
+// through alertPlayed() and PerfLog "alert.latency"; the audio device's own
+// buffer comes on top.
+class AlertEngine : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(int level READ level NOTIFY levelChanged)
+    Q_PROPERTY(double lastLatencyMs READ lastLatencyMs NOTIFY latencyChanged)
+    Q_PROPERTY(double maxLatencyMs READ maxLatencyMs NOTIFY latencyChanged)
+    Q_PROPERTY(int overBudget READ overBudget NOTIFY latencyChanged)
+
+public:
+    enum Level {
+        Clear = 0,
+        Warning,     // Drowsy: the chime, repeating
+        Alarm        // Still drowsy: the looping alarm
+    };
+    Q_ENUM(Level)
+
+    struct Policy
+    {
+        int confirmMs = 0;            // DrowsinessAnalyzer already tells blinks apart
+        int repeatMs = 3000;
+        int escalateAfterMs = 6000;   // From the first chime
+        int clearMs = 1500;
+        int signCooldownMs = 10000;
+        float minSignConfidence = 0.5f;
+        double warningVolume = 0.8;
+        double alarmVolume = 1.0;
+        double signVolume = 0.6;
+        double latencyBudgetMs = 50.0;
+    };
+
+    // Monotonic nanoseconds, the time base of eventNs
+    static qint64 clockNs();
+
+    explicit AlertEngine(QObject *parent = nullptr);
+    ~AlertEngine();
+
+    Policy policy() const { return m_policy; }
+    void setPolicy(const Policy &policy);
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+    int level() const { return m_level; }
+    double lastLatencyMs() const { return m_lastLatencyMs; }
+    double maxLatencyMs() const { return m_maxLatencyMs; }
+    int overBudget() const { return m_overBudget; }
+
+    // Starts the alert thread, at the latest from loadSounds(); alerts before
+    // wait for it
+    void start();
+
+    // Loads every .wav in the directories, earlier ones first: signs play
+    // <label>.wav (lower case, other characters as '_') or <class id>.wav,
+    // drowsiness drowsy.wav and alarm.wav, generated tones when missing
+    void loadSounds(const QStringList &directories);
+
+    // eventNs is clockNs() when the event arrived
+    void handleDrowsiness(double value, qint64 eventNs);
+    void handleDetections(const QList<Detection> &detections, const QStringList &labels, qint64 eventNs);
+    // Forgets the tracks alerted on, e.g. when a run starts
+    void reset();
+
+signals:
+    void enabledChanged();
+    void levelChanged();
+    void latencyChanged();
+    // An alert decided on for the event at eventNs, before its sound is started
+    void alertRaised(const QString &sound, int level, qint64 eventNs);
+    // Instrumentation hook: a sound started latencyMs after its event
+    void alertPlayed(const QString &sound, int level, double latencyMs);
+
+private:
+    static QString soundKey(const QString &name);
+    void setLevel(Level level);
+    void clearDrowsiness();
+    void play(const QString &sound, double volume, bool loop, qint64 eventNs);
+    void stop(const QString &sound);
+    void recordLatency(const QString &sound, int level, double latencyMs);
+
+    // Alert thread only
+    void createEffects(const QHash<QString, QString> &files);
+    void startEffect(const QString &sound, double volume, bool loop, qint64 eventNs, int level);
+    void effectPlayingChanged(QSoundEffect *effect);
+
+    Policy m_policy;
+    bool m_enabled = true;
+    Level m_level = Clear;
+
+    // Drowsiness, on clockNs()
+    qint64 m_drowsySinceNs = -1;    // Start of the drowsy states being confirmed
+    qint64 m_alertStartNs = -1;
+    qint64 m_lastChimeNs = -1;
+    QTimer m_clearTimer;
+
+    // Traffic signs
+    QHash<QString, QString> m_files;        // Sound key to file, GUI thread copy
+    QHash<QString, qint64> m_lastSignNs;    // Sound key to its last alert
+    QList<int> m_alertedTracks;             // The most recent ones
+
+    double m_lastLatencyMs = -1.0;
+    double m_maxLatencyMs = 0.0;
+    int m_overBudget = 0;
+
+    QThread m_thread;
+    QObject *m_workerContext;
+    // Alert thread only
+    QHash<QString, QSoundEffect*> m_effects;
+    struct Pending
+    {
+        QString sound;
+        qint64 eventNs = -1;
+        int level = Clear;
+    };
+    QHash<QSoundEffect*, Pending> m_pending;
+};
+
+#endif // ALERTENGINE_H
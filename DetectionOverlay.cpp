@@ -0,0 +1,250 @@
+#include "DetectionOverlay.h"
+#include <QFontMetricsF>
+#include <QLineF>
+#include <QQuickWindow>
+#include <QSGGeometryNode>
+#include <QSGTextNode>
+#include <QSGVertexColorMaterial>
+#include <QTextLayout>
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using Vertex = QSGGeometry::ColoredPoint2D;
+
+// Outline and label colour of a class; workers without classes get lane.py's green
+QColor classColor(int classId)
+{
+    if (classId < 0) {
+        return QColor(0, 255, 0);
+    }
+    return QColor::fromHsv((classId * 67) % 360, 220, 255);
+}
+
+// QSGVertexColorMaterial expects premultiplied colours
+Vertex vertex(const QPointF &point, const QColor &color)
+{
+    const int alpha = color.alpha();
+    Vertex v;
+    v.set(float(point.x()), float(point.y()),
+          uchar(color.red() * alpha / 255), uchar(color.green() * alpha / 255),
+          uchar(color.blue() * alpha / 255), uchar(alpha));
+    return v;
+}
+
+// a, b, c, d go around the quad
+void appendQuad(std::vector<Vertex> &vertices, const QPointF &a, const QPointF &b,
+                const QPointF &c, const QPointF &d, const QColor &color)
+{
+    vertices.push_back(vertex(a, color));
+    vertices.push_back(vertex(b, color));
+    vertices.push_back(vertex(c, color));
+    vertices.push_back(vertex(a, color));
+    vertices.push_back(vertex(c, color));
+    vertices.push_back(vertex(d, color));
+}
+
+void appendRect(std::vector<Vertex> &vertices, const QRectF &rect, const QColor &color)
+{
+    appendQuad(vertices, rect.topLeft(), rect.topRight(), rect.bottomRight(), rect.bottomLeft(), color);
+}
+
+void appendLine(std::vector<Vertex> &vertices, const QPointF &from, const QPointF &to,
+                float width, const QColor &color)
+{
+    const QLineF line(from, to);
+    if (line.length() <= 0.0) {
+        return;
+    }
+    const QPointF normal = QPointF(-line.dy(), line.dx()) * (width / 2.0 / line.length());
+    appendQuad(vertices, from + normal, to + normal, to - normal, from - normal, color);
+}
+
+void appendOutline(std::vector<Vertex> &vertices, const QRectF &rect, float width, const QColor &color)
+{
+    const qreal w = qMin<qreal>(width, qMin(rect.width(), rect.height()) / 2.0);
+    appendRect(vertices, QRectF(rect.left(), rect.top(), rect.width(), w), color);
+    appendRect(vertices, QRectF(rect.left(), rect.bottom() - w, rect.width(), w), color);
+    appendRect(vertices, QRectF(rect.left(), rect.top() + w, w, rect.height() - 2 * w), color);
+    appendRect(vertices, QRectF(rect.right() - w, rect.top() + w, w, rect.height() - 2 * w), color);
+}
+
+void addText(QSGTextNode *node, const QString &text, const QFont &font, const QPointF &position, qreal width)
+{
+    QTextLayout layout(text, font);
+    layout.beginLayout();
+    QTextLine line = layout.createLine();
+    line.setLineWidth(width);
+    layout.endLayout();
+    node->addTextLayout(position, &layout);
+}
+
+} // namespace
+
+DetectionOverlay::DetectionOverlay(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents);
+}
+
+void DetectionOverlay::setStream(FrameStream *stream)
+{
+    if (m_stream == stream) {
+        return;
+    }
+    if (m_stream) {
+        m_stream->disconnect(this);
+    }
+    m_stream = stream;
+    if (m_stream) {
+        connect(m_stream, &FrameStream::annotationsChanged, this, &QQuickItem::update);
+        connect(m_stream, &FrameStream::frameSizeChanged, this, &QQuickItem::update);
+    }
+    emit streamChanged();
+    update();
+}
+
+void DetectionOverlay::setContentRect(const QRectF &rect)
+{
+    if (m_contentRect != rect) {
+        m_contentRect = rect;
+        emit contentRectChanged();
+        update();
+    }
+}
+
+void DetectionOverlay::setShowBoxes(bool show)
+{
+    if (m_showBoxes != show) {
+        m_showBoxes = show;
+        emit showBoxesChanged();
+        update();
+    }
+}
+
+void DetectionOverlay::setShowLabels(bool show)
+{
+    if (m_showLabels != show) {
+        m_showLabels = show;
+        emit showLabelsChanged();
+        update();
+    }
+}
+
+void DetectionOverlay::setShowLanes(bool show)
+{
+    if (m_showLanes != show) {
+        m_showLanes = show;
+        emit showLanesChanged();
+        update();
+    }
+}
+
+QSGNode *DetectionOverlay::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    QSGNode *root = oldNode;
+    QSGGeometryNode *shapes = nullptr;
+    QSGTextNode *text = nullptr;
+    if (!root) {
+        root = new QSGNode;
+
+        shapes = new QSGGeometryNode;
+        QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), 0);
+        geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        shapes->setGeometry(geometry);
+        shapes->setFlag(QSGNode::OwnsGeometry);
+        shapes->setMaterial(new QSGVertexColorMaterial);
+        shapes->setFlag(QSGNode::OwnsMaterial);
+        root->appendChildNode(shapes);
+
+        text = window()->createTextNode();
+        text->setColor(Qt::white);
+        root->appendChildNode(text);
+    } else {
+        shapes = static_cast<QSGGeometryNode *>(root->firstChild());
+        text = static_cast<QSGTextNode *>(root->lastChild());
+    }
+
+    std::vector<Vertex> vertices;
+    text->clear();
+
+    const QSize frameSize = m_stream ? m_stream->frameSize() : QSize();
+    if (!frameSize.isEmpty()) {
+        // Frame pixels to item coordinates
+        const QRectF target = m_contentRect.isEmpty() ? boundingRect() : m_contentRect;
+        const qreal scaleX = target.width() / frameSize.width();
+        const qreal scaleY = target.height() / frameSize.height();
+        auto map = [&](const QPointF &point) {
+            return QPointF(target.left() + point.x() * scaleX, target.top() + point.y() * scaleY);
+        };
+
+        if (m_showLanes) {
+            const QList<QPolygonF> &lanes = m_stream->lanes();
+            // lane.py fills the lane between a left and a right boundary
+            if (lanes.size() == 2) {
+                appendQuad(vertices, map(lanes[0].first()), map(lanes[0].last()),
+                           map(lanes[1].last()), map(lanes[1].first()), QColor(60, 200, 60, 77));
+            }
+            for (const QPolygonF &lane : lanes) {
+                for (qsizetype i = 1; i < lane.size(); ++i) {
+                    appendLine(vertices, map(lane[i - 1]), map(lane[i]), LaneLineWidth, QColor(0, 255, 0));
+                }
+            }
+        }
+
+        QFont labelFont;
+        labelFont.setPixelSize(12);
+        const QFontMetricsF labelMetrics(labelFont);
+        const QList<Detection> &detections = m_stream->detections();
+        const QStringList &labels = m_stream->detectionLabels();
+        for (qsizetype i = 0; i < detections.size(); ++i) {
+            const Detection &detection = detections[i];
+            const QRectF box(map(detection.box.topLeft()), map(detection.box.bottomRight()));
+            const QColor color = classColor(detection.classId);
+            if (m_showBoxes) {
+                appendOutline(vertices, box, BoxLineWidth, color);
+            }
+            if (m_showLabels) {
+                const QString name = i < labels.size() && !labels[i].isEmpty()
+                        ? labels[i] : QString::number(detection.classId);
+                // Tracked boxes carry their id, so one sign reads the same across frames
+                const QString label = detection.trackId >= 0
+                        ? QString("%1 #%2: %3").arg(name).arg(detection.trackId).arg(detection.confidence, 0, 'f', 2)
+                        : QString("%1: %2").arg(name).arg(detection.confidence, 0, 'f', 2);
+                const qreal width = labelMetrics.horizontalAdvance(label) + 1;
+                const qreal height = labelMetrics.height();
+                // Above the box, or just inside it at the top of the view
+                QRectF labelRect(box.left(), box.top() - height - 2, width + 6, height + 2);
+                if (labelRect.top() < target.top()) {
+                    labelRect.moveTop(box.top());
+                }
+                QColor background = color.darker(200);
+                background.setAlpha(200);
+                appendRect(vertices, labelRect, background);
+                addText(text, label, labelFont, labelRect.topLeft() + QPointF(3, 1), width);
+            }
+        }
+
+        const QString alert = m_stream->alertText();
+        if (!alert.isEmpty()) {
+            QFont alertFont;
+            alertFont.setPixelSize(32);
+            alertFont.setBold(true);
+            const QFontMetricsF alertMetrics(alertFont);
+            const qreal width = alertMetrics.horizontalAdvance(alert) + 1;
+            const QRectF alertRect(target.left() + 16, target.top() + 16, width + 24, alertMetrics.height() + 8);
+            appendRect(vertices, alertRect, QColor(200, 0, 0, 220));
+            addText(text, alert, alertFont, alertRect.topLeft() + QPointF(12, 4), width);
+        }
+    }
+
+    QSGGeometry *geometry = shapes->geometry();
+    geometry->allocate(int(vertices.size()));
+    if (!vertices.empty()) {
+        std::memcpy(geometry->vertexDataAsColoredPoint2D(), vertices.data(), vertices.size() * sizeof(Vertex));
+    }
+    shapes->markDirty(QSGNode::DirtyGeometry);
+    return root;
+}
@@ -0,0 +1,61 @@
+#ifndef DETECTIONOVERLAY_H
+#define DETECTIONOVERLAY_H
+
+#include <QQuickItem>
+#include <QPointer>
+#include <QRectF>
+#include <QtQml/qqmlregistration.h>
+#include "FrameStream.h"
+
+// Draws a FrameStream's detections, lanes and alert text over its video.
+// All boxes, lanes and label backgrounds go into one vertex-coloured geometry
+// node and all text into one text node, so an overlay costs two draw calls
+// however many detections there are. Changing what is shown only rebuilds
+// the nodes; nothing is sent back to the workers.
+class DetectionOverlay : public QQuickItem
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_PROPERTY(FrameStream *stream READ stream WRITE setStream NOTIFY streamChanged)
+    // Area of the item the video is drawn in, e.g. VideoOutput.contentRect
+    Q_PROPERTY(QRectF contentRect READ contentRect WRITE setContentRect NOTIFY contentRectChanged)
+    Q_PROPERTY(bool showBoxes READ showBoxes WRITE setShowBoxes NOTIFY showBoxesChanged)
+    Q_PROPERTY(bool showLabels READ showLabels WRITE setShowLabels NOTIFY showLabelsChanged)
+    Q_PROPERTY(bool showLanes READ showLanes WRITE setShowLanes NOTIFY showLanesChanged)
+
+public:
+    explicit DetectionOverlay(QQuickItem *parent = nullptr);
+
+    static constexpr float BoxLineWidth = 2.0f;
+    static constexpr float LaneLineWidth = 5.0f;
+
+    FrameStream *stream() const { return m_stream; }
+    void setStream(FrameStream *stream);
+    QRectF contentRect() const { return m_contentRect; }
+    void setContentRect(const QRectF &rect);
+    bool showBoxes() const { return m_showBoxes; }
+    void setShowBoxes(bool show);
+    bool showLabels() const { return m_showLabels; }
+    void setShowLabels(bool show);
+    bool showLanes() const { return m_showLanes; }
+    void setShowLanes(bool show);
+
+signals:
+    void streamChanged();
+    void contentRectChanged();
+    void showBoxesChanged();
+    void showLabelsChanged();
+    void showLanesChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+
+private:
+    QPointer<FrameStream> m_stream;
+    QRectF m_contentRect;
+    bool m_showBoxes = true;
+    bool m_showLabels = true;
+    bool m_showLanes = true;
+};
+
+#endif // DETECTIONOVERLAY_H
@@ -0,0 +1,501 @@
+#include "DetectionSidecar.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr qint64 InitialBlocks = 16;  // 1.4 MB, doubled as needed
+
+quint16 toPixel(qreal value)
+{
+    return quint16(qBound<qreal>(0.0, value, 65535.0));
+}
+
+QString classKey(int model, const QString &name)
+{
+    return QString::number(model) + ":" + name;
+}
+
+} // namespace
+
+DetectionSidecar::DetectionSidecar(const QString &directory, QObject *parent)
+    : QObject(parent)
+    , m_directory(directory)
+{
+}
+
+DetectionSidecar::~DetectionSidecar()
+{
+    finish();
+    unmap();
+}
+
+qint64 DetectionSidecar::durationMs() const
+{
+    return m_writable ? m_clock.elapsed() : m_durationMs;
+}
+
+QVariantList DetectionSidecar::classes() const
+{
+    QVariantList classes;
+    for (int id = 0; id < m_classes.size(); ++id) {
+        classes.append(QVariantMap {
+            {"id", id},
+            {"name", m_classes.at(id).name},
+            {"model", m_classes.at(id).model},
+            {"count", m_rowsByClass.value(id).size()}
+        });
+    }
+    return classes;
+}
+
+void DetectionSidecar::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled) {
+        return;
+    }
+    m_enabled = enabled;
+    if (!m_enabled) {
+        finish();
+    }
+    emit enabledChanged();
+}
+
+bool DetectionSidecar::create(qint64 startMs)
+{
+    finish();
+    if (!m_enabled) {
+        return false;
+    }
+    unmap();
+    if (!QDir().mkpath(m_directory)) {
+        qWarning() << "DetectionSidecar: cannot create" << m_directory;
+        return false;
+    }
+    pruneRuns();
+
+    const QString name = "run-" + QDateTime::fromMSecsSinceEpoch(startMs).toString("yyyyMMdd-HHmmss") + ".ndds";
+    m_classes.clear();
+    m_classIds.clear();
+    m_rowsByClass.clear();
+    m_stateActive.clear();
+    m_rowCount = 0;
+    m_startMs = startMs;
+    m_durationMs = 0;
+
+    if (!map(QDir(m_directory).filePath(name), true, InitialBlocks)) {
+        return false;
+    }
+    Header *fileHeader = header();
+    std::memset(fileHeader, 0, sizeof(Header));
+    fileHeader->version = Version;
+    fileHeader->rowsPerBlock = RowsPerBlock;
+    fileHeader->startMs = startMs;
+    // Readers check the magic last
+    __atomic_store_n(&fileHeader->magic, Magic, __ATOMIC_RELEASE);
+
+    m_writable = true;
+    m_clock.start();
+    writeClasses();
+    emit opened();
+    emit classesChanged();
+    emit rowsAppended();
+    return true;
+}
+
+void DetectionSidecar::finish()
+{
+    if (!m_writable) {
+        return;
+    }
+    m_durationMs = m_clock.elapsed();
+    m_writable = false;
+    writeClasses();
+
+    // Only the blocks in use stay on disk
+    const quint64 blocks = (m_rowCount + RowsPerBlock - 1) / RowsPerBlock;
+    const QString path = m_path;
+    unmap();
+    if (::truncate(QFile::encodeName(path).constData(), off_t(sizeof(Header) + blocks * sizeof(Block))) != 0) {
+        qWarning() << "DetectionSidecar: could not truncate" << path << ":" << strerror(errno);
+    }
+    qDebug() << "DetectionSidecar:" << path << m_rowCount << "rows," << m_classes.size() << "classes";
+    open(path);
+}
+
+bool DetectionSidecar::open(const QString &path)
+{
+    if (m_writable && path == m_path) {
+        return true;
+    }
+    finish();
+    unmap();
+
+    QElapsedTimer timer;
+    timer.start();
+    m_classes.clear();
+    m_classIds.clear();
+    m_rowsByClass.clear();
+    m_rowCount = 0;
+    m_startMs = 0;
+    m_durationMs = 0;
+
+    if (!map(path, false, 0)) {
+        emit opened();
+        return false;
+    }
+    const Header *fileHeader = header();
+    if (m_size < sizeof(Header) || __atomic_load_n(&fileHeader->magic, __ATOMIC_ACQUIRE) != Magic
+            || fileHeader->version != Version || fileHeader->rowsPerBlock != RowsPerBlock) {
+        qWarning() << "DetectionSidecar:" << path << "is not a detection sidecar";
+        unmap();
+        emit opened();
+        return false;
+    }
+    // A run cut short by a crash has a count, but never more rows than blocks
+    const quint64 capacity = quint64((m_size - sizeof(Header)) / sizeof(Block)) * RowsPerBlock;
+    m_rowCount = qMin<quint64>(fileHeader->rowCount, capacity);
+    m_startMs = fileHeader->startMs;
+
+    // One pass over the class column, block by block
+    for (quint64 first = 0; first < m_rowCount; first += RowsPerBlock) {
+        const quint16 *classIds = block(first)->classId;
+        const quint32 rows = quint32(qMin<quint64>(RowsPerBlock, m_rowCount - first));
+        for (quint32 i = 0; i < rows; ++i) {
+            m_rowsByClass[classIds[i]].append(quint32(first + i));
+        }
+    }
+    loadClasses();
+    if (m_durationMs == 0 && m_rowCount > 0) {
+        m_durationMs = row(qint64(m_rowCount) - 1).timeMs;
+    }
+
+    qDebug() << "DetectionSidecar: opened" << path << "with" << m_rowCount << "rows in" << timer.elapsed() << "ms";
+    emit opened();
+    emit classesChanged();
+    emit rowsAppended();
+    return true;
+}
+
+QVariantList DetectionSidecar::runs() const
+{
+    QVariantList runs;
+    const QDir directory(m_directory);
+    const QStringList names = directory.entryList({"run-*.ndds"}, QDir::Files, QDir::Name | QDir::Reversed);
+    for (const QString &name : names) {
+        runs.append(QVariantMap {{"path", directory.filePath(name)}, {"name", name.chopped(5)}});
+    }
+    return runs;
+}
+
+void DetectionSidecar::appendDetections(int model, qint64 frameIndex, const QList<Detection> &detections,
+                                        const QStringList &labels)
+{
+    if (!m_writable || detections.isEmpty() || frameIndex < 0) {
+        return;
+    }
+    for (int i = 0; i < detections.size(); ++i) {
+        const Detection &detection = detections.at(i);
+        const QString label = labels.value(i);
+        const int classId = classFor(model, label.isEmpty() ? QString::number(detection.classId) : label);
+        append(model, frameIndex, classId, DetectionRow, detection.confidence, detection.box);
+    }
+    emit rowsAppended();
+}
+
+void DetectionSidecar::appendState(int model, qint64 frameIndex, const QByteArray &name, double value)
+{
+    // -1 is a result not tied to a frame of the run, e.g. from /detect,
+    // which the frame column cannot hold
+    if (!m_writable || frameIndex < 0) {
+        return;
+    }
+    const QString stateName = QString::fromUtf8(name);
+    const QString key = classKey(model, stateName);
+    const bool active = value > 0.0;
+    const bool wasActive = m_stateActive.value(key, false);
+    m_stateActive.insert(key, active);
+    if (active && !wasActive) {
+        append(model, frameIndex, classFor(model, stateName), StateRow, value, QRectF());
+        emit rowsAppended();
+    }
+}
+
+DetectionSidecar::Row DetectionSidecar::row(qint64 index) const
+{
+    Row result;
+    if (!m_base || index < 0 || quint64(index) >= m_rowCount) {
+        return result;
+    }
+    const Block *rows = block(quint64(index));
+    const quint32 i = quint32(quint64(index) % RowsPerBlock);
+    result.frameIndex = rows->frame[i];
+    result.timeMs = rows->timeMs[i];
+    result.classId = rows->classId[i];
+    result.model = rows->model[i];
+    result.kind = Kind(rows->kind[i]);
+    result.confidence = double(rows->confidence[i]) / 65535.0;
+    result.box = QRectF(QPointF(rows->x1[i], rows->y1[i]), QPointF(rows->x2[i], rows->y2[i]));
+    return result;
+}
+
+QVariantMap DetectionSidecar::nextEvent(int classId, qint64 timeMs) const
+{
+    if (classId >= 0 && !m_rowsByClass.contains(classId)) {
+        return {};
+    }
+    const QVector<quint32> *rows = classId >= 0 ? &*m_rowsByClass.constFind(classId) : nullptr;
+    const qint64 count = rows ? rows->size() : qint64(m_rowCount);
+    const qint64 position = lowerBound(rows, timeMs);
+    if (position >= count) {
+        return {};
+    }
+    return toVariant(rows ? rows->at(position) : position);
+}
+
+QVariantMap DetectionSidecar::previousEvent(int classId, qint64 timeMs) const
+{
+    if (classId >= 0 && !m_rowsByClass.contains(classId)) {
+        return {};
+    }
+    const QVector<quint32> *rows = classId >= 0 ? &*m_rowsByClass.constFind(classId) : nullptr;
+    const qint64 position = lowerBound(rows, timeMs) - 1;
+    if (position < 0) {
+        return {};
+    }
+    return toVariant(rows ? rows->at(position) : position);
+}
+
+QVariantList DetectionSidecar::events(int classId, int maxCount) const
+{
+    QVariantList events;
+    if (classId >= 0 && !m_rowsByClass.contains(classId)) {
+        return events;
+    }
+    const QVector<quint32> *rows = classId >= 0 ? &*m_rowsByClass.constFind(classId) : nullptr;
+    const qint64 count = rows ? rows->size() : qint64(m_rowCount);
+    const double step = maxCount > 0 && count > maxCount ? double(count) / double(maxCount) : 1.0;
+    for (double position = 0.0; position < double(count); position += step) {
+        const qint64 index = qint64(position);
+        events.append(toVariant(rows ? rows->at(index) : index));
+    }
+    return events;
+}
+
+bool DetectionSidecar::map(const QString &path, bool writable, qint64 capacityBlocks)
+{
+    const QByteArray name = QFile::encodeName(path);
+    m_fd = ::open(name.constData(), writable ? (O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC) : (O_RDONLY | O_CLOEXEC), 0644);
+    if (m_fd < 0) {
+        qWarning() << "DetectionSidecar: cannot open" << path << ":" << strerror(errno);
+        return false;
+    }
+
+    size_t size = sizeof(Header) + size_t(capacityBlocks) * sizeof(Block);
+    if (writable) {
+        if (ftruncate(m_fd, off_t(size)) != 0) {
+            qWarning() << "DetectionSidecar: cannot size" << path << ":" << strerror(errno);
+            unmap();
+            return false;
+        }
+    } else {
+        struct stat info {};
+        fstat(m_fd, &info);
+        size = size_t(info.st_size);
+        if (size < sizeof(Header)) {
+            qWarning() << "DetectionSidecar:" << path << "is truncated";
+            unmap();
+            return false;
+        }
+    }
+
+    void *base = mmap(nullptr, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, m_fd, 0);
+    if (base == MAP_FAILED) {
+        qWarning() << "DetectionSidecar: cannot map" << path << ":" << strerror(errno);
+        unmap();
+        return false;
+    }
+    m_base = static_cast<uchar *>(base);
+    m_size = size;
+    m_path = path;
+    return true;
+}
+
+void DetectionSidecar::unmap()
+{
+    if (m_base) {
+        munmap(m_base, m_size);
+        m_base = nullptr;
+        m_size = 0;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool DetectionSidecar::reserve(quint64 rows)
+{
+    const quint64 blocks = (rows + RowsPerBlock - 1) / RowsPerBlock;
+    const size_t needed = sizeof(Header) + size_t(blocks) * sizeof(Block);
+    if (needed <= m_size) {
+        return true;
+    }
+
+    // Grown by doubling; the mapping moves, which is why rows are kept by number
+    const size_t size = sizeof(Header) + (m_size - sizeof(Header)) * 2;
+    munmap(m_base, m_size);
+    m_base = nullptr;
+    void *base = MAP_FAILED;
+    if (ftruncate(m_fd, off_t(size)) == 0) {
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    }
+    if (base == MAP_FAILED) {
+        qWarning() << "DetectionSidecar: cannot grow" << m_path << ":" << strerror(errno);
+        m_writable = false;
+        unmap();
+        return false;
+    }
+    m_base = static_cast<uchar *>(base);
+    m_size = size;
+    return true;
+}
+
+void DetectionSidecar::append(int model, qint64 frameIndex, int classId, Kind kind, double confidence, const QRectF &box)
+{
+    if (!reserve(m_rowCount + 1)) {
+        return;
+    }
+    Block *rows = block(m_rowCount);
+    const quint32 i = quint32(m_rowCount % RowsPerBlock);
+    rows->frame[i] = quint32(frameIndex);
+    rows->timeMs[i] = quint32(m_clock.elapsed());
+    rows->classId[i] = quint16(classId);
+    rows->confidence[i] = quint16(qBound(0.0, confidence, 1.0) * 65535.0);
+    rows->x1[i] = toPixel(box.left());
+    rows->y1[i] = toPixel(box.top());
+    rows->x2[i] = toPixel(box.right());
+    rows->y2[i] = toPixel(box.bottom());
+    rows->model[i] = quint8(model);
+    rows->kind[i] = quint8(kind);
+
+    m_rowsByClass[classId].append(quint32(m_rowCount));
+    ++m_rowCount;
+    // A reader of the live file never sees a count ahead of the columns
+    __atomic_store_n(&header()->rowCount, m_rowCount, __ATOMIC_RELEASE);
+}
+
+int DetectionSidecar::classFor(int model, const QString &name)
+{
+    const QString key = classKey(model, name);
+    const auto it = m_classIds.constFind(key);
+    if (it != m_classIds.constEnd()) {
+        return it.value();
+    }
+    const int id = int(m_classes.size());
+    m_classes.append({model, name});
+    m_classIds.insert(key, id);
+    writeClasses();
+    emit classesChanged();
+    return id;
+}
+
+QString DetectionSidecar::classesPath() const
+{
+    return m_path.chopped(5) + ".json";
+}
+
+void DetectionSidecar::loadClasses()
+{
+    QFile file(classesPath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QJsonObject document = QJsonDocument::fromJson(file.readAll()).object();
+    m_durationMs = document.value("durationMs").toInteger();
+    for (const QJsonValue &value : document.value("classes").toArray()) {
+        const QJsonObject entry = value.toObject();
+        const int model = entry.value("model").toInt();
+        const QString name = entry.value("name").toString();
+        m_classIds.insert(classKey(model, name), int(m_classes.size()));
+        m_classes.append({model, name});
+    }
+}
+
+void DetectionSidecar::writeClasses() const
+{
+    QJsonArray classes;
+    for (const ClassInfo &info : m_classes) {
+        classes.append(QJsonObject {{"model", info.model}, {"name", info.name}});
+    }
+    const QJsonObject document {
+        {"startMs", m_startMs},
+        {"durationMs", m_writable ? 0 : m_durationMs},
+        {"classes", classes}
+    };
+
+    QSaveFile file(classesPath());
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(document).toJson(QJsonDocument::Compact)) < 0
+            || !file.commit()) {
+        qWarning() << "DetectionSidecar: could not write" << classesPath() << ":" << file.errorString();
+    }
+}
+
+void DetectionSidecar::pruneRuns() const
+{
+    QDir directory(m_directory);
+    QStringList names = directory.entryList({"run-*.ndds"}, QDir::Files, QDir::Name);
+    while (names.size() >= MaxRuns) {
+        const QString name = names.takeFirst();
+        directory.remove(name);
+        directory.remove(name.chopped(5) + ".json");
+    }
+}
+
+qint64 DetectionSidecar::lowerBound(const QVector<quint32> *rows, qint64 timeMs) const
+{
+    // Time never goes backwards within a run, so positions and times sort alike
+    qint64 low = 0;
+    qint64 high = rows ? rows->size() : qint64(m_rowCount);
+    while (low < high) {
+        const qint64 middle = low + (high - low) / 2;
+        const quint64 index = rows ? rows->at(middle) : quint64(middle);
+        if (qint64(block(index)->timeMs[index % RowsPerBlock]) < timeMs) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+QVariantMap DetectionSidecar::toVariant(qint64 index) const
+{
+    const Row entry = row(index);
+    const ClassInfo info = entry.classId >= 0 && entry.classId < m_classes.size()
+            ? m_classes.at(entry.classId) : ClassInfo {entry.model, QString::number(entry.classId)};
+    return {
+        {"row", index},
+        {"timeMs", entry.timeMs},
+        {"frame", entry.frameIndex},
+        {"classId", entry.classId},
+        {"name", info.name},
+        {"model", entry.model},
+        {"confidence", entry.confidence},
+        {"box", entry.box}
+    };
+}
@@ -0,0 +1,175 @@
+#ifndef DETECTIONSIDECAR_H
+#define DETECTIONSIDECAR_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QRectF>
+#include <QStringList>
+#include <QVariantList>
+#include <QVector>
+
+#include "WorkerChannel.h"
+
+// Per-run record of every detection the workers report, next to the
+// recordings, so a drive can be searched ("where were the stop signs")
+// without reprocessing it. The file is columnar: rows go into blocks of
+// RowsPerBlock, and within a block each field is one contiguous array, so a
+// scan of one field (class, time) touches only its own pages:
+//
+//   [Header 64 bytes][Block][Block]...
+//
+// The file is memory-mapped for writing and reading alike. Opening a run
+// scans the class column once to build the per-class row lists; rows are in
+// time order, so time lookups are binary searches. Class names live in a
+// JSON file of the same name. Drowsiness is stored as a "drowsy" row at each
+// onset. A disabled sidecar records nothing and creates no files, but still
+// opens past runs.
+class DetectionSidecar : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(QString path READ path NOTIFY opened)
+    Q_PROPERTY(bool recording READ isRecording NOTIFY opened)
+    Q_PROPERTY(qint64 startMs READ startMs NOTIFY opened)
+    Q_PROPERTY(qint64 durationMs READ durationMs NOTIFY rowsAppended)
+    Q_PROPERTY(int rowCount READ rowCount NOTIFY rowsAppended)
+    Q_PROPERTY(QVariantList classes READ classes NOTIFY classesChanged)
+
+public:
+    static constexpr quint32 Magic = 0x5344444E;  // "NDDS"
+    static constexpr quint32 Version = 1;
+    static constexpr quint32 RowsPerBlock = 4096;
+    static constexpr int MaxRuns = 100;
+
+    enum Kind {
+        DetectionRow = 0,
+        StateRow = 1
+    };
+
+    struct Header
+    {
+        quint32 magic;
+        quint32 version;
+        quint32 rowsPerBlock;
+        quint32 reserved;
+        qint64 startMs;      // Wall clock at the start of the run, since the epoch
+        quint64 rowCount;    // Published after the row's columns
+        quint8 padding[32];
+    };
+
+    struct Block
+    {
+        quint32 frame[RowsPerBlock];
+        quint32 timeMs[RowsPerBlock];       // Since Header::startMs
+        quint16 classId[RowsPerBlock];      // Into the run's class table
+        quint16 confidence[RowsPerBlock];   // 0..65535 for 0..1
+        quint16 x1[RowsPerBlock];           // Box in frame pixels
+        quint16 y1[RowsPerBlock];
+        quint16 x2[RowsPerBlock];
+        quint16 y2[RowsPerBlock];
+        quint8 model[RowsPerBlock];
+        quint8 kind[RowsPerBlock];
+    };
+
+    static_assert(sizeof(Header) == 64, "Header layout is part of the file format");
+    static_assert(sizeof(Block) == RowsPerBlock * 22, "Block columns must not be padded");
+
+    struct Row
+    {
+        qint64 frameIndex = -1;
+        qint64 timeMs = 0;
+        int classId = -1;
+        int model = 0;
+        Kind kind = DetectionRow;
+        double confidence = 0.0;
+        QRectF box;
+    };
+
+    explicit DetectionSidecar(const QString &directory, QObject *parent = nullptr);
+    ~DetectionSidecar();
+
+    QString directory() const { return m_directory; }
+    QString path() const { return m_path; }
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+    bool isRecording() const { return m_writable; }
+    qint64 startMs() const { return m_startMs; }
+    qint64 durationMs() const;
+    int rowCount() const { return int(m_rowCount); }
+    QVariantList classes() const;
+
+    // Starts a new run; the previous one is finished first. False when disabled
+    bool create(qint64 startMs);
+    // Ends the run being recorded, which stays open for searching
+    void finish();
+    // Opens a past run read-only
+    Q_INVOKABLE bool open(const QString &path);
+    // Recorded runs, newest first: {path, name}
+    Q_INVOKABLE QVariantList runs() const;
+
+    // labels holds the class name of each detection. Rows without a frame
+    // of the run (frameIndex -1, as EventLog records them) are not stored.
+    void appendDetections(int model, qint64 frameIndex, const QList<Detection> &detections, const QStringList &labels);
+    void appendState(int model, qint64 frameIndex, const QByteArray &name, double value);
+
+    Row row(qint64 index) const;
+
+    // Events of a class (-1 for any) at or after / before a time since the
+    // start of the run: {row, timeMs, frame, classId, name, model, confidence}, empty if none
+    Q_INVOKABLE QVariantMap nextEvent(int classId, qint64 timeMs) const;
+    Q_INVOKABLE QVariantMap previousEvent(int classId, qint64 timeMs) const;
+    // At most maxCount events of a class, thinned evenly, for the timeline ticks
+    Q_INVOKABLE QVariantList events(int classId, int maxCount = 300) const;
+
+signals:
+    void enabledChanged();
+    void opened();
+    void rowsAppended();
+    void classesChanged();
+
+private:
+    struct ClassInfo
+    {
+        int model;
+        QString name;
+    };
+
+    bool map(const QString &path, bool writable, qint64 capacityBlocks);
+    void unmap();
+    bool reserve(quint64 rows);
+    void append(int model, qint64 frameIndex, int classId, Kind kind, double confidence, const QRectF &box);
+    int classFor(int model, const QString &name);
+    QString classesPath() const;
+    void loadClasses();
+    void writeClasses() const;
+    void pruneRuns() const;
+    qint64 lowerBound(const QVector<quint32> *rows, qint64 timeMs) const;
+    QVariantMap toVariant(qint64 index) const;
+
+    Header *header() const { return reinterpret_cast<Header *>(m_base); }
+    Block *block(quint64 row) const
+    {
+        return reinterpret_cast<Block *>(m_base + sizeof(Header) + (row / RowsPerBlock) * sizeof(Block));
+    }
+
+    QString m_directory;
+    QString m_path;
+    uchar *m_base = nullptr;
+    size_t m_size = 0;
+    int m_fd = -1;
+    bool m_enabled = true;
+    bool m_writable = false;
+    qint64 m_startMs = 0;
+    qint64 m_durationMs = 0;                 // Of a finished run, from its class file
+    quint64 m_rowCount = 0;
+    QElapsedTimer m_clock;
+
+    QList<ClassInfo> m_classes;
+    QHash<QString, int> m_classIds;          // "<model>:<name>"
+    QHash<int, QVector<quint32>> m_rowsByClass;
+    QHash<QString, bool> m_stateActive;      // "<model>:<name>", for onsets
+};
+
+#endif // DETECTIONSIDECAR_H
@@ -0,0 +1,211 @@
+#include "DrowsinessAnalyzer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+// Plausible open-eye EAR; a calibration outside it keeps the default
+constexpr float MinOpenEar = 0.15f;
+constexpr float MaxOpenEar = 0.45f;
+constexpr float MaxHistogramEar = 0.5f;
+
+class CostTimer
+{
+public:
+    explicit CostTimer(std::int64_t *total)
+        : m_total(total)
+        , m_start(std::chrono::steady_clock::now())
+    {
+    }
+    ~CostTimer()
+    {
+        *m_total += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    std::int64_t *m_total;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace
+
+DrowsinessAnalyzer::DrowsinessAnalyzer()
+    : DrowsinessAnalyzer(Policy())
+{
+}
+
+DrowsinessAnalyzer::DrowsinessAnalyzer(const Policy &policy)
+    : m_policy(policy)
+    , m_samples(SampleCapacity)
+    , m_blinks(BlinkCapacity)
+{
+    reset();
+}
+
+void DrowsinessAnalyzer::reset()
+{
+    m_result = Result();
+    m_result.threshold = m_policy.defaultThreshold;
+    m_sampleHead = 0;
+    m_sampleCount = 0;
+    m_windowMs = 0;
+    m_closedMs = 0;
+    m_blinkHead = 0;
+    m_blinkCount = 0;
+    m_histogram.fill(0);
+    m_calibratedMs = 0;
+    m_lastTimeMs = -1;
+    m_closedSinceMs = -1;
+    m_perclosDrowsy = false;
+    m_calls = 0;
+    m_costNs = 0;
+}
+
+float DrowsinessAnalyzer::eyeAspectRatio(const float *points)
+{
+    // The vertical pairs p2-p6 and p3-p5 and the horizontal p1-p4 of both
+    // eyes as six lanes, which the compiler vectorises
+    static constexpr int From[6] = { 1, 2, 0, 7, 8, 6 };
+    static constexpr int To[6] = { 5, 4, 3, 11, 10, 9 };
+    float dx[6];
+    float dy[6];
+    for (int i = 0; i < 6; ++i) {
+        dx[i] = points[2 * From[i]] - points[2 * To[i]];
+        dy[i] = points[2 * From[i] + 1] - points[2 * To[i] + 1];
+    }
+    float distance[6];
+    for (int i = 0; i < 6; ++i) {
+        distance[i] = std::sqrt(dx[i] * dx[i] + dy[i] * dy[i]);
+    }
+    const float left = (distance[0] + distance[1]) / (2.0f * std::max(distance[2], 1e-3f));
+    const float right = (distance[3] + distance[4]) / (2.0f * std::max(distance[5], 1e-3f));
+    return (left + right) * 0.5f;
+}
+
+const DrowsinessAnalyzer::Result &DrowsinessAnalyzer::update(std::int64_t timeMs, const float *points)
+{
+    CostTimer timer(&m_costNs);
+    ++m_calls;
+
+    // A seek or a restarted clip starts a new window; the calibration stays
+    if (timeMs < m_lastTimeMs) {
+        m_sampleCount = 0;
+        m_windowMs = 0;
+        m_closedMs = 0;
+        m_blinkCount = 0;
+        m_closedSinceMs = -1;
+        m_perclosDrowsy = false;
+        m_lastTimeMs = -1;
+    }
+    const int durationMs = m_lastTimeMs < 0
+            ? 0 : int(std::min<std::int64_t>(timeMs - m_lastTimeMs, m_policy.maxGapMs));
+    m_lastTimeMs = timeMs;
+
+    m_result.face = points != nullptr;
+    if (!points) {
+        // A closure the face was lost in is neither a blink nor long
+        m_result.closed = false;
+        m_closedSinceMs = -1;
+    } else {
+        const float ear = eyeAspectRatio(points);
+        m_result.ear = ear;
+        if (!m_result.calibrated) {
+            calibrate(ear, durationMs);
+        }
+        const float threshold = m_result.threshold;
+        const bool closed = m_result.closed ? ear < threshold * m_policy.reopenRatio : ear < threshold;
+        if (closed && !m_result.closed) {
+            m_closedSinceMs = timeMs;
+        } else if (!closed && m_result.closed && m_closedSinceMs >= 0) {
+            if (timeMs - m_closedSinceMs <= m_policy.maxBlinkMs) {
+                const int slot = (m_blinkHead + m_blinkCount) % BlinkCapacity;
+                m_blinks[slot] = timeMs;
+                if (m_blinkCount < BlinkCapacity) {
+                    ++m_blinkCount;
+                } else {
+                    m_blinkHead = (m_blinkHead + 1) % BlinkCapacity;
+                }
+            }
+            m_closedSinceMs = -1;
+        }
+        m_result.closed = closed;
+
+        if (m_sampleCount == SampleCapacity) {
+            const Sample &oldest = m_samples[m_sampleHead];
+            m_windowMs -= oldest.durationMs;
+            m_closedMs -= oldest.closed ? oldest.durationMs : 0;
+            m_sampleHead = (m_sampleHead + 1) % SampleCapacity;
+            --m_sampleCount;
+        }
+        Sample &sample = m_samples[(m_sampleHead + m_sampleCount) % SampleCapacity];
+        sample.timeMs = timeMs;
+        sample.durationMs = durationMs;
+        sample.closed = closed;
+        ++m_sampleCount;
+        m_windowMs += durationMs;
+        m_closedMs += closed ? durationMs : 0;
+    }
+    evict(timeMs);
+
+    m_result.closureMs = m_closedSinceMs >= 0 ? int(timeMs - m_closedSinceMs) : 0;
+    m_result.longClosure = m_result.closureMs >= m_policy.longClosureMs;
+
+    // Judged only once the window holds enough of the driver
+    if (m_windowMs >= m_policy.minWindowMs) {
+        m_result.perclos = float(m_closedMs) / float(m_windowMs);
+        const std::int64_t spanMs = m_sampleCount > 0 ? timeMs - m_samples[m_sampleHead].timeMs : 0;
+        m_result.blinksPerMinute = spanMs > 0 ? float(m_blinkCount) * 60000.0f / float(spanMs) : 0.0f;
+        if (m_result.perclos >= m_policy.perclosDrowsy) {
+            m_perclosDrowsy = true;
+        } else if (m_result.perclos < m_policy.perclosAwake) {
+            m_perclosDrowsy = false;
+        }
+    } else {
+        m_result.perclos = 0.0f;
+        m_result.blinksPerMinute = 0.0f;
+        m_perclosDrowsy = false;
+    }
+    m_result.drowsy = m_result.longClosure || m_perclosDrowsy;
+    return m_result;
+}
+
+void DrowsinessAnalyzer::calibrate(float ear, int durationMs)
+{
+    const int bin = std::clamp(int(ear / MaxHistogramEar * HistogramBins), 0, HistogramBins - 1);
+    m_histogram[bin] += durationMs;
+    m_calibratedMs += durationMs;
+    if (m_calibratedMs < m_policy.calibrationMs) {
+        return;
+    }
+
+    // The median: the eyes are open most of the time
+    std::int64_t seen = 0;
+    int median = 0;
+    while (median < HistogramBins - 1 && (seen += m_histogram[median]) * 2 < m_calibratedMs) {
+        ++median;
+    }
+    const float openEar = (float(median) + 0.5f) * MaxHistogramEar / HistogramBins;
+    m_result.calibrated = true;
+    if (openEar >= MinOpenEar && openEar <= MaxOpenEar) {
+        m_result.openEar = openEar;
+        m_result.threshold = openEar * m_policy.thresholdRatio;
+    }
+}
+
+void DrowsinessAnalyzer::evict(std::int64_t timeMs)
+{
+    const std::int64_t startMs = timeMs - m_policy.windowMs;
+    while (m_sampleCount > 0 && m_samples[m_sampleHead].timeMs < startMs) {
+        const Sample &oldest = m_samples[m_sampleHead];
+        m_windowMs -= oldest.durationMs;
+        m_closedMs -= oldest.closed ? oldest.durationMs : 0;
+        m_sampleHead = (m_sampleHead + 1) % SampleCapacity;
+        --m_sampleCount;
+    }
+    while (m_blinkCount > 0 && m_blinks[m_blinkHead] < startMs) {
+        m_blinkHead = (m_blinkHead + 1) % BlinkCapacity;
+        --m_blinkCount;
+    }
+}
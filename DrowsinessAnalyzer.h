@@ -0,0 +1,122 @@
+#ifndef DROWSINESSANALYZER_H
+#define DROWSINESSANALYZER_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Decides whether the driver is drowsy from the eye landmarks drowsiness.py
+// reports, over time rather than from one frame against a fixed threshold.
+//
+// Each frame's eye aspect ratio (EAR) is compared with a per-driver
+// threshold: Policy::thresholdRatio of the driver's open-eye EAR, the
+// median over the first Policy::calibrationMs of frames with a face, and
+// drowsiness.py's 0.23 until then. Eyes count as closed below the threshold
+// and as open again above it by Policy::reopenRatio.
+//
+// A ring of the frames of the last Policy::windowMs gives PERCLOS, the
+// share of that time the eyes were closed, and a ring of closure ends the
+// blink rate. Closures up to Policy::maxBlinkMs are blinks and do not
+// alert by themselves. The driver is drowsy during a closure of
+// Policy::longClosureMs or more, and while PERCLOS is above
+// Policy::perclosDrowsy until it falls below Policy::perclosAwake.
+//
+// Frames are timed by the video, not by arrival, so a clip processed faster
+// than real time is judged as if watched. Nothing is allocated after
+// construction.
+class DrowsinessAnalyzer
+{
+public:
+    // Per eye, left then right: outer corner, two upper lid points, inner
+    // corner, two lower lid points, as x, y pairs in pixels
+    static constexpr int PointCount = 12;
+
+    struct Policy
+    {
+        float defaultThreshold = 0.23f;   // drowsiness.py's EYE_AR_THRESH
+        int calibrationMs = 20000;        // Of frames with a face
+        float thresholdRatio = 0.75f;     // 0.23 of a typical open 0.30
+        float reopenRatio = 1.1f;
+        int windowMs = 60000;
+        int minWindowMs = 15000;          // Before PERCLOS and the blink rate count
+        float perclosDrowsy = 0.15f;
+        float perclosAwake = 0.10f;
+        int maxBlinkMs = 500;
+        int longClosureMs = 1000;
+        int maxGapMs = 200;               // A longer gap between frames counts as this
+    };
+
+    struct Result
+    {
+        bool face = false;
+        float ear = 0.0f;
+        bool closed = false;
+        int closureMs = 0;                // Of the closure in progress
+        bool longClosure = false;
+        float perclos = 0.0f;
+        float blinksPerMinute = 0.0f;
+        bool calibrated = false;
+        float openEar = 0.0f;             // The driver's, once calibrated
+        float threshold = 0.0f;
+        bool drowsy = false;
+    };
+
+    DrowsinessAnalyzer();
+    explicit DrowsinessAnalyzer(const Policy &policy);
+
+    const Policy &policy() const { return m_policy; }
+    // Forgets the driver, calibration included
+    void reset();
+
+    // Mean EAR of both eyes
+    static float eyeAspectRatio(const float *points);
+
+    // One frame at timeMs into the video; points is null when no face was found
+    const Result &update(std::int64_t timeMs, const float *points);
+    const Result &result() const { return m_result; }
+
+    std::int64_t calls() const { return m_calls; }
+    double averageCostUs() const { return m_calls > 0 ? double(m_costNs) / double(m_calls) / 1000.0 : 0.0; }
+
+private:
+    struct Sample
+    {
+        std::int64_t timeMs = 0;
+        std::int32_t durationMs = 0;
+        bool closed = false;
+    };
+
+    // Sixty seconds at 60 fps
+    static constexpr int SampleCapacity = 4096;
+    static constexpr int BlinkCapacity = 256;
+    // EAR from 0 to 0.5 in steps of 1/256
+    static constexpr int HistogramBins = 128;
+
+    void calibrate(float ear, int durationMs);
+    void evict(std::int64_t timeMs);
+
+    Policy m_policy;
+    Result m_result;
+
+    std::vector<Sample> m_samples;
+    int m_sampleHead = 0;          // Oldest
+    int m_sampleCount = 0;
+    std::int64_t m_windowMs = 0;   // Sum of the samples' durations
+    std::int64_t m_closedMs = 0;
+
+    std::vector<std::int64_t> m_blinks;
+    int m_blinkHead = 0;
+    int m_blinkCount = 0;
+
+    std::array<std::int32_t, HistogramBins> m_histogram {};
+    std::int64_t m_calibratedMs = 0;
+
+    std::int64_t m_lastTimeMs = -1;
+    std::int64_t m_closedSinceMs = -1;
+    bool m_perclosDrowsy = false;
+
+    std::int64_t m_calls = 0;
+    std::int64_t m_costNs = 0;
+};
+
+#endif // DROWSINESSANALYZER_H
@@ -0,0 +1,461 @@
+#include "EventLog.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+struct EventLog::Segment
+{
+    QString path;
+    uchar *base = nullptr;
+    size_t size = 0;
+    quint32 count = 0;  // Mirrors header()->count on the GUI thread
+
+    ~Segment()
+    {
+        if (base) {
+            munmap(base, size);
+        }
+    }
+
+    SegmentHeader *header() const { return reinterpret_cast<SegmentHeader*>(base); }
+    Record *records() const { return reinterpret_cast<Record*>(base + sizeof(SegmentHeader)); }
+
+    // Records [from, to) first, then the header with the count, so a crash in
+    // between leaves records the next open recovers rather than a count that
+    // points past them
+    void sync(quint32 from, quint32 to) const
+    {
+        const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+        const size_t begin = (sizeof(SegmentHeader) + size_t(from) * sizeof(Record)) & ~(pageSize - 1);
+        const size_t end = sizeof(SegmentHeader) + size_t(to) * sizeof(Record);
+        if (end > begin && msync(base + begin, end - begin, MS_SYNC) != 0) {
+            qWarning() << "EventLog: msync failed for" << path << ":" << strerror(errno);
+        }
+        msync(base, pageSize, MS_SYNC);
+    }
+};
+
+EventLog::EventLog(const QString &directory, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_directory(directory)
+    , m_workerContext(new QObject)
+{
+    m_thread.setObjectName("EventLogSync");
+    m_workerContext->moveToThread(&m_thread);
+
+    m_flushTimer.setSingleShot(true);
+    connect(&m_flushTimer, &QTimer::timeout, this, &EventLog::flush);
+}
+
+EventLog::~EventLog()
+{
+    flush();
+    m_thread.quit();
+    m_thread.wait();  // Until the last sync is on disk
+    delete m_workerContext;
+}
+
+void EventLog::open()
+{
+    if (m_thread.isRunning()) {
+        return;
+    }
+    m_thread.start();
+
+    beginResetModel();
+    openDirectory();
+    endResetModel();
+    if (m_count > 0) {
+        emit countChanged();
+    }
+}
+
+void EventLog::openDirectory()
+{
+    if (!QDir().mkpath(m_directory)) {
+        m_errorString = "Could not create " + m_directory;
+        qWarning() << "EventLog:" << m_errorString;
+        return;
+    }
+
+    // Names carry the zero-padded first sequence, so they sort in log order
+    const QStringList files = QDir(m_directory).entryList({ "segment-*.ndev" }, QDir::Files, QDir::Name);
+    for (const QString &file : files) {
+        QSharedPointer<Segment> segment = mapSegment(QDir(m_directory).filePath(file), 0, false);
+        if (!segment) {
+            continue;
+        }
+        m_segmentStarts.append(m_count);
+        m_segments.append(segment);
+        m_count += segment->count;
+        m_nextSequence = segment->header()->firstSequence + segment->count;
+        if (segment->count > 0) {
+            m_lastTimestampMs = qMax(m_lastTimestampMs, segment->records()[segment->count - 1].timestampMs);
+        }
+    }
+    while (m_segments.size() > MaxSegments) {
+        dropOldestSegment();
+    }
+
+    m_open = true;
+    if (m_segments.isEmpty() || m_segments.last()->count == RecordsPerSegment) {
+        m_open = rotate();
+    }
+    if (m_open) {
+        m_flushedCount = m_segments.last()->count;
+        qDebug() << "EventLog:" << m_count << "records in" << m_segments.size() << "segments at" << m_directory;
+    }
+}
+
+QSharedPointer<EventLog::Segment> EventLog::mapSegment(const QString &path, quint64 firstSequence, bool create)
+{
+    const QByteArray nativePath = QFile::encodeName(path);
+    const int fd = open(nativePath.constData(), create ? (O_CREAT | O_EXCL | O_RDWR) : O_RDWR, 0644);
+    if (fd < 0) {
+        m_errorString = QString("Could not open %1: %2").arg(path, QString::fromLocal8Bit(strerror(errno)));
+        qWarning() << "EventLog:" << m_errorString;
+        return {};
+    }
+
+    const size_t size = sizeof(SegmentHeader) + size_t(RecordsPerSegment) * sizeof(Record);
+    if (create && ftruncate(fd, off_t(size)) != 0) {
+        m_errorString = QString("Could not size %1: %2").arg(path, QString::fromLocal8Bit(strerror(errno)));
+        qWarning() << "EventLog:" << m_errorString;
+        close(fd);
+        unlink(nativePath.constData());
+        return {};
+    }
+    if (!create && lseek(fd, 0, SEEK_END) != off_t(size)) {
+        qWarning() << "EventLog: skipping" << path << "with an unexpected size";
+        close(fd);
+        return {};
+    }
+
+    void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        m_errorString = QString("Could not map %1: %2").arg(path, QString::fromLocal8Bit(strerror(errno)));
+        qWarning() << "EventLog:" << m_errorString;
+        return {};
+    }
+
+    QSharedPointer<Segment> segment(new Segment);
+    segment->path = path;
+    segment->base = static_cast<uchar*>(base);
+    segment->size = size;
+
+    SegmentHeader *header = segment->header();
+    if (create) {
+        header->version = Version;
+        header->recordSize = sizeof(Record);
+        header->capacity = RecordsPerSegment;
+        header->firstSequence = firstSequence;
+        header->count = 0;
+        __atomic_store_n(&header->magic, Magic, __ATOMIC_RELEASE);
+        return segment;
+    }
+
+    if (header->magic != Magic || header->version != Version
+            || header->recordSize != sizeof(Record) || header->capacity != RecordsPerSegment) {
+        qWarning() << "EventLog: skipping" << path << "with an unknown header";
+        return {};
+    }
+
+    // The count may have reached the disk before or after the records it
+    // covers; trust the checksums instead
+    quint32 count = qMin(header->count, RecordsPerSegment);
+    while (count > 0 && checksum(segment->records()[count - 1]) != segment->records()[count - 1].checksum) {
+        --count;
+    }
+    while (count < RecordsPerSegment && segment->records()[count].timestampMs != 0
+           && checksum(segment->records()[count]) == segment->records()[count].checksum) {
+        ++count;
+    }
+    if (count != header->count) {
+        qWarning() << "EventLog: recovered" << path << "with" << count << "records, header said" << header->count;
+        header->count = count;
+    }
+    segment->count = count;
+    return segment;
+}
+
+bool EventLog::rotate()
+{
+    // The full segment's tail goes to disk before appending moves on
+    flush();
+
+    const QString name = QString("segment-%1.ndev").arg(m_nextSequence, 20, 10, QChar('0'));
+    QSharedPointer<Segment> segment = mapSegment(QDir(m_directory).filePath(name), m_nextSequence, true);
+    if (!segment) {
+        return false;
+    }
+    m_segmentStarts.append(m_count);
+    m_segments.append(segment);
+    m_flushedCount = 0;
+
+    while (m_segments.size() > MaxSegments) {
+        dropOldestSegment();
+    }
+    return true;
+}
+
+void EventLog::dropOldestSegment()
+{
+    const QSharedPointer<Segment> oldest = m_segments.first();
+    const qint64 removed = oldest->count;
+
+    // Newest first, so the oldest records are the last rows
+    if (removed > 0) {
+        beginRemoveRows(QModelIndex(), int(m_count - removed), int(m_count - 1));
+    }
+    m_segments.removeFirst();
+    m_segmentStarts.removeFirst();
+    for (qint64 &start : m_segmentStarts) {
+        start -= removed;
+    }
+    m_count -= removed;
+    if (removed > 0) {
+        endRemoveRows();
+        emit countChanged();
+    }
+
+    // A sync still queued for the segment holds its own reference
+    QFile::remove(oldest->path);
+}
+
+void EventLog::setFlushPolicy(const FlushPolicy &policy)
+{
+    m_flushPolicy = policy;
+    if (m_pending >= m_flushPolicy.maxPendingRecords) {
+        flush();
+    }
+}
+
+bool EventLog::append(EventType type, int model, double value, qint64 frameIndex)
+{
+    if (!m_open) {
+        return false;
+    }
+    if (m_segments.last()->count == RecordsPerSegment && !rotate()) {
+        return false;
+    }
+
+    Segment *segment = m_segments.last().data();
+    beginInsertRows(QModelIndex(), 0, 0);
+
+    Record &record = segment->records()[segment->count];
+    // Clamped so a wall-clock step back never unsorts the log
+    m_lastTimestampMs = qMax(QDateTime::currentMSecsSinceEpoch(), m_lastTimestampMs);
+    record.timestampMs = m_lastTimestampMs;
+    record.frameIndex = frameIndex;
+    record.value = value;
+    record.type = quint16(type);
+    record.model = quint16(model);
+    record.checksum = checksum(record);
+
+    // Workers reading the log see the record once the count covers it
+    ++segment->count;
+    __atomic_store_n(&segment->header()->count, segment->count, __ATOMIC_RELEASE);
+    ++m_count;
+    ++m_nextSequence;
+
+    endInsertRows();
+    emit countChanged();
+
+    if (++m_pending >= m_flushPolicy.maxPendingRecords) {
+        flush();
+    } else if (!m_flushTimer.isActive()) {
+        m_flushTimer.start(m_flushPolicy.maxDelayMs);
+    }
+    return true;
+}
+
+void EventLog::flush()
+{
+    m_flushTimer.stop();
+    if (m_segments.isEmpty() || m_pending == 0) {
+        return;
+    }
+    m_pending = 0;
+
+    const QSharedPointer<Segment> segment = m_segments.last();
+    const quint32 from = m_flushedCount;
+    const quint32 to = segment->count;
+    m_flushedCount = to;
+    QMetaObject::invokeMethod(m_workerContext, [segment, from, to]() {
+        segment->sync(from, to);
+    });
+}
+
+const EventLog::Segment *EventLog::segmentFor(qint64 index, quint32 *offset) const
+{
+    if (index < 0 || index >= m_count) {
+        return nullptr;
+    }
+    const auto it = std::upper_bound(m_segmentStarts.cbegin(), m_segmentStarts.cend(), index) - 1;
+    const qsizetype segmentIndex = it - m_segmentStarts.cbegin();
+    *offset = quint32(index - *it);
+    return m_segments.at(segmentIndex).data();
+}
+
+EventLog::Record EventLog::record(qint64 index) const
+{
+    quint32 offset = 0;
+    const Segment *segment = segmentFor(index, &offset);
+    return segment ? segment->records()[offset] : Record{};
+}
+
+QList<EventLog::Record> EventLog::tail(int count) const
+{
+    QList<Record> records;
+    const qint64 first = qMax<qint64>(0, m_count - count);
+    records.reserve(int(m_count - first));
+    for (qint64 index = first; index < m_count; ++index) {
+        records.append(record(index));
+    }
+    return records;
+}
+
+qint64 EventLog::lowerBound(qint64 timestampMs) const
+{
+    // Over the segments by their last record, then within the segment
+    qsizetype lo = 0;
+    qsizetype hi = m_segments.size();
+    while (lo < hi) {
+        const qsizetype mid = (lo + hi) / 2;
+        const Segment *segment = m_segments.at(mid).data();
+        if (segment->count == 0 || segment->records()[segment->count - 1].timestampMs < timestampMs) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    const qsizetype segmentIndex = lo;
+    if (segmentIndex == m_segments.size()) {
+        return m_count;
+    }
+
+    const Segment *segment = m_segments.at(segmentIndex).data();
+    const Record *begin = segment->records();
+    const Record *found = std::lower_bound(begin, begin + segment->count, timestampMs,
+                                           [](const Record &record, qint64 value) {
+        return record.timestampMs < value;
+    });
+    return m_segmentStarts.at(segmentIndex) + (found - begin);
+}
+
+QList<EventLog::Record> EventLog::range(qint64 fromMs, qint64 toMs, int limit) const
+{
+    QList<Record> records;
+    for (qint64 index = lowerBound(fromMs); index < m_count && records.size() < limit; ++index) {
+        const Record found = record(index);
+        if (found.timestampMs >= toMs) {
+            break;
+        }
+        records.append(found);
+    }
+    return records;
+}
+
+QVariantList EventLog::lastRecords(int count) const
+{
+    QVariantList list;
+    for (const Record &found : tail(count)) {
+        list.append(toVariant(found));
+    }
+    return list;
+}
+
+QVariantList EventLog::recordsBetween(const QDateTime &from, const QDateTime &to, int limit) const
+{
+    QVariantList list;
+    for (const Record &found : range(from.toMSecsSinceEpoch(), to.toMSecsSinceEpoch(), limit)) {
+        list.append(toVariant(found));
+    }
+    return list;
+}
+
+int EventLog::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(m_count);
+}
+
+QVariant EventLog::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_count) {
+        return QVariant();
+    }
+
+    const Record found = record(m_count - 1 - index.row());
+    const QDateTime timestamp = QDateTime::fromMSecsSinceEpoch(found.timestampMs);
+    switch (role) {
+        case TimestampRole: return timestamp;
+        case DateRole: return timestamp.toString("yyyy-MM-dd");
+        case TimeRole: return timestamp.toString("HH:mm:ss");
+        case TypeRole: return int(found.type);
+        case ModelRole: return int(found.model);
+        case ValueRole: return found.value;
+        case FrameIndexRole: return found.frameIndex;
+        case Qt::DisplayRole:
+        case StatusRole: return statusText(found);
+        default: return QVariant();
+    }
+}
+
+QHash<int, QByteArray> EventLog::roleNames() const
+{
+    return {
+        { TimestampRole, "timestamp" },
+        { DateRole, "date" },
+        { TimeRole, "time" },
+        { TypeRole, "type" },
+        { ModelRole, "model" },
+        { ValueRole, "value" },
+        { FrameIndexRole, "frameIndex" },
+        { StatusRole, "status" }
+    };
+}
+
+QVariantMap EventLog::toVariant(const Record &record) const
+{
+    const QDateTime timestamp = QDateTime::fromMSecsSinceEpoch(record.timestampMs);
+    return {
+        { "date", timestamp.toString("yyyy-MM-dd") },
+        { "time", timestamp.toString("HH:mm:ss") },
+        { "status", statusText(record) },
+        { "type", int(record.type) },
+        { "model", int(record.model) },
+        { "value", record.value },
+        { "frameIndex", record.frameIndex }
+    };
+}
+
+quint32 EventLog::checksum(const Record &record)
+{
+    const uchar *bytes = reinterpret_cast<const uchar*>(&record);
+    quint32 hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(Record, checksum); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+QString EventLog::statusText(const Record &record)
+{
+    // drowsiness_log.csv wrote Yes/No
+    if (record.type == DrowsinessState) {
+        return record.value != 0.0 ? "Yes" : "No";
+    }
+    if (record.type == LongClosure) {
+        return QString("Eyes closed %1 s").arg(record.value / 1000.0, 0, 'f', 1);
+    }
+    return QString::number(record.value);
+}
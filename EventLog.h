@@ -0,0 +1,152 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <QAbstractListModel>
+#include <QDateTime>
+#include <QList>
+#include <QSharedPointer>
+#include <QThread>
+#include <QTimer>
+#include <QVariantList>
+
+// Append-only log of driver events, replacing drowsiness_log.csv. Records
+// are fixed-size and go into memory-mapped segment files of RecordsPerSegment
+// records each; a full segment is closed and a new one started, and the
+// oldest segments are deleted beyond MaxSegments. Appending is a memory
+// write; the dirty range is synced to disk on a thread of its own once
+// FlushPolicy allows. The layout is mirrored in worker_ipc.py:
+//
+//   [SegmentHeader 64 bytes][Record 32 bytes]...
+//
+// Timestamps never go backwards, so time lookups are binary searches. As a
+// list model the log is newest first, for the cabin page history.
+class EventLog : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(QString directory READ directory CONSTANT)
+
+public:
+    static constexpr quint32 Magic = 0x4C45444E;  // "NDEL"
+    static constexpr quint32 Version = 1;
+    static constexpr quint32 RecordsPerSegment = 65536;  // 2 MiB per segment
+    static constexpr int MaxSegments = 32;
+
+    enum EventType {
+        DrowsinessState = 1,  // value is 1 when drowsy, 0 otherwise
+        LongClosure = 2       // value is the length of an eye closure of 1 s or more, in ms
+    };
+    Q_ENUM(EventType)
+
+    enum Roles {
+        TimestampRole = Qt::UserRole + 1,
+        DateRole,
+        TimeRole,
+        TypeRole,
+        ModelRole,
+        ValueRole,
+        FrameIndexRole,
+        StatusRole
+    };
+
+    struct SegmentHeader {
+        quint32 magic;
+        quint32 version;
+        quint32 recordSize;
+        quint32 capacity;
+        quint64 firstSequence;
+        quint32 count;
+        quint8 reserved[36];
+    };
+
+    struct Record {
+        qint64 timestampMs;  // Since the epoch, UTC
+        qint64 frameIndex;   // -1 when not tied to a video frame
+        double value;
+        quint16 type;
+        quint16 model;
+        quint32 checksum;    // FNV-1a of the fields above
+    };
+
+    static_assert(sizeof(SegmentHeader) == 64, "SegmentHeader layout is shared with worker_ipc.py");
+    static_assert(sizeof(Record) == 32, "Record layout is shared with worker_ipc.py");
+
+    // Dirty records are synced once either limit is reached
+    struct FlushPolicy
+    {
+        int maxPendingRecords = 256;
+        int maxDelayMs = 2000;
+    };
+
+    explicit EventLog(const QString &directory, QObject *parent = nullptr);
+    ~EventLog();
+
+    // Maps the segments and starts the sync thread; nothing is read or
+    // appended before, so construction costs no I/O
+    void open();
+
+    bool isOpen() const { return m_open; }
+    QString directory() const { return m_directory; }
+    QString errorString() const { return m_errorString; }
+    int count() const { return int(m_count); }
+
+    FlushPolicy flushPolicy() const { return m_flushPolicy; }
+    void setFlushPolicy(const FlushPolicy &policy);
+
+    bool append(EventType type, int model, double value, qint64 frameIndex = -1);
+
+    // Retained records in time order, index 0 being the oldest
+    Record record(qint64 index) const;
+    QList<Record> tail(int count) const;
+    // Index of the first record at or after timestampMs, count() if none
+    qint64 lowerBound(qint64 timestampMs) const;
+    QList<Record> range(qint64 fromMs, qint64 toMs, int limit) const;
+
+    // Same fields as drowsiness.py's /last_records: date, time, status
+    Q_INVOKABLE QVariantList lastRecords(int count) const;
+    Q_INVOKABLE QVariantList recordsBetween(const QDateTime &from, const QDateTime &to, int limit = 1000) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+public slots:
+    // Queues a sync of everything appended so far
+    void flush();
+
+signals:
+    void countChanged();
+
+private:
+    struct Segment;
+
+    void openDirectory();
+    QSharedPointer<Segment> mapSegment(const QString &path, quint64 firstSequence, bool create);
+    bool rotate();
+    void dropOldestSegment();
+    const Segment *segmentFor(qint64 index, quint32 *offset) const;
+    QVariantMap toVariant(const Record &record) const;
+    static quint32 checksum(const Record &record);
+    static QString statusText(const Record &record);
+
+    QString m_directory;
+    QString m_errorString;
+    bool m_open = false;
+
+    // Oldest first; only the last one is appended to
+    QList<QSharedPointer<Segment>> m_segments;
+    QList<qint64> m_segmentStarts;  // Index of each segment's first record
+    qint64 m_count = 0;
+    quint64 m_nextSequence = 0;
+    qint64 m_lastTimestampMs = 0;
+
+    FlushPolicy m_flushPolicy;
+    QTimer m_flushTimer;
+    int m_pending = 0;
+    quint32 m_flushedCount = 0;  // Records of the last segment already queued for sync
+
+    QThread m_thread;
+    QObject *m_workerContext;
+};
+
+#endif // EVENTLOG_H
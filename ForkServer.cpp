@@ -0,0 +1,311 @@
+#include "ForkServer.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTimer>
+
+#include <csignal>
+#include <sys/types.h>
+
+ForkedWorker::ForkedWorker(int spawnId, const QString &model, QObject *parent)
+    : QObject(parent)
+    , m_spawnId(spawnId)
+    , m_model(model)
+{
+}
+
+QIODevice *ForkedWorker::output() const
+{
+    return m_output;
+}
+
+void ForkedWorker::terminate()
+{
+    if (isRunning()) {
+        ::kill(pid_t(m_pid), SIGTERM);
+    } else if (!m_exited) {
+        // Not forked yet; deliver it as soon as the zygote reports the pid
+        m_terminateRequested = true;
+    }
+}
+
+void ForkedWorker::kill()
+{
+    if (isRunning()) {
+        ::kill(pid_t(m_pid), SIGKILL);
+    }
+}
+
+void ForkedWorker::setProcessId(qint64 pid)
+{
+    m_pid = pid;
+    emit started();
+    if (m_terminateRequested) {
+        terminate();
+    }
+}
+
+void ForkedWorker::setOutput(QLocalSocket *socket)
+{
+    socket->setParent(this);
+    m_output = socket;
+    connect(socket, &QLocalSocket::disconnected, this, &ForkedWorker::finishIfComplete);
+    emit outputReady(socket);
+}
+
+void ForkedWorker::setExited(int exitCode, int signal)
+{
+    m_exited = true;
+    m_exitCode = exitCode;
+    m_signal = signal;
+
+    // A grandchild that inherited the socket could keep it open forever
+    QTimer::singleShot(1000, this, [this]() {
+        if (m_output && m_output->state() != QLocalSocket::UnconnectedState) {
+            m_output->abort();
+        }
+        finishIfComplete();
+    });
+    finishIfComplete();
+}
+
+void ForkedWorker::finishIfComplete()
+{
+    if (m_finished || !m_exited) {
+        return;
+    }
+    // Wait for the output to drain so the last protocol lines are not lost
+    if (m_output && m_output->state() != QLocalSocket::UnconnectedState) {
+        return;
+    }
+    m_finished = true;
+    emit finished(m_signal ? 128 + m_signal : m_exitCode,
+                  m_signal ? QProcess::CrashExit : QProcess::NormalExit);
+}
+
+ForkServer::ForkServer(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ForkServer::~ForkServer()
+{
+    stop();
+}
+
+void ForkServer::start(const QString &pythonExecutable, const QString &zygotePath, const Preloads &preloads)
+{
+    stop();
+
+    m_pythonExecutable = pythonExecutable;
+    m_zygotePath = zygotePath;
+    m_preloads = preloads;
+
+    m_server = new QLocalServer(this);
+    const QString serverName = QString("neurodrive-zygote-%1").arg(QCoreApplication::applicationPid());
+    QLocalServer::removeServer(serverName);
+    if (!m_server->listen(serverName)) {
+        qWarning() << "Fork server could not listen on" << serverName << m_server->errorString();
+        delete m_server;
+        m_server = nullptr;
+        return;
+    }
+    connect(m_server, &QLocalServer::newConnection, this, &ForkServer::handleNewConnection);
+
+    QStringList arguments;
+    arguments << zygotePath << "--connect" << m_server->fullServerName();
+    for (auto it = preloads.constBegin(); it != preloads.constEnd(); ++it) {
+        arguments << "--preload" << it.key() + "=" + it.value();
+    }
+
+    m_process = new QProcess(this);
+    m_process->setProcessChannelMode(QProcess::MergedChannels);
+    connect(m_process, &QProcess::readyReadStandardOutput, this, &ForkServer::handleZygoteOutput);
+    connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &ForkServer::handleZygoteFinished);
+
+    m_startTimer.start();
+    m_process->start(pythonExecutable, arguments);
+    qDebug() << "Fork server starting:" << pythonExecutable << arguments;
+}
+
+void ForkServer::stop()
+{
+    m_ready = false;
+    m_preloaded.clear();
+
+    // Closing the control connection makes the zygote stop its workers and exit
+    if (m_control) {
+        m_control->disconnect(this);
+        m_control->disconnectFromServer();
+        m_control->deleteLater();
+        m_control = nullptr;
+    }
+    if (m_process) {
+        m_process->disconnect(this);
+        if (m_process->state() != QProcess::NotRunning) {
+            m_process->terminate();
+            // Reap it in the background rather than waiting here
+            connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                    m_process, &QObject::deleteLater);
+            QTimer::singleShot(3000, m_process, &QProcess::kill);
+            m_process->setParent(nullptr);
+        } else {
+            m_process->deleteLater();
+        }
+        m_process = nullptr;
+    }
+    if (m_server) {
+        m_server->close();
+        m_server->deleteLater();
+        m_server = nullptr;
+    }
+}
+
+ForkedWorker *ForkServer::spawn(const QString &model, const QString &workingDirectory,
+                                const QProcessEnvironment &environment)
+{
+    if (!hasPreloaded(model) || !m_control) {
+        return nullptr;
+    }
+
+    // Only send what differs from the zygote's own environment
+    const QProcessEnvironment base = QProcessEnvironment::systemEnvironment();
+    QJsonObject env;
+    const QStringList keys = environment.keys();
+    for (const QString &key : keys) {
+        const QString value = environment.value(key);
+        if (!base.contains(key) || base.value(key) != value) {
+            env.insert(key, value);
+        }
+    }
+
+    const int spawnId = m_nextSpawnId++;
+    QJsonObject command;
+    command["cmd"] = "spawn";
+    command["id"] = spawnId;
+    command["model"] = model;
+    command["cwd"] = workingDirectory;
+    command["env"] = env;
+    m_control->write(QJsonDocument(command).toJson(QJsonDocument::Compact) + '\n');
+
+    ForkedWorker *worker = new ForkedWorker(spawnId, model, this);
+    m_workers.insert(spawnId, worker);
+    return worker;
+}
+
+void ForkServer::handleNewConnection()
+{
+    while (m_server && m_server->hasPendingConnections()) {
+        QLocalSocket *socket = m_server->nextPendingConnection();
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            identifyConnection(socket);
+        });
+        identifyConnection(socket);
+    }
+}
+
+void ForkServer::identifyConnection(QLocalSocket *socket)
+{
+    if (!socket->canReadLine()) {
+        return;
+    }
+
+    const QByteArray hello = socket->readLine().trimmed();
+    socket->disconnect(this);
+
+    if (hello == "zygote") {
+        m_control = socket;
+        connect(socket, &QLocalSocket::readyRead, this, &ForkServer::handleControlData);
+        handleControlData();
+        return;
+    }
+
+    if (hello.startsWith("worker ")) {
+        const int spawnId = hello.mid(7).toInt();
+        ForkedWorker *worker = m_workers.value(spawnId);
+        if (worker) {
+            worker->setOutput(socket);
+            return;
+        }
+    }
+
+    qWarning() << "Fork server: unexpected connection" << hello;
+    socket->abort();
+    socket->deleteLater();
+}
+
+void ForkServer::handleControlData()
+{
+    while (m_control && m_control->canReadLine()) {
+        const QByteArray line = m_control->readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        const QJsonDocument doc = QJsonDocument::fromJson(line);
+        if (!doc.isObject()) {
+            qWarning() << "Fork server: malformed message" << line;
+            continue;
+        }
+        handleControlMessage(doc.object());
+    }
+}
+
+void ForkServer::handleControlMessage(const QJsonObject &message)
+{
+    const QString event = message["event"].toString();
+
+    if (event == "spawned" || event == "exited") {
+        const int spawnId = message["id"].toInt();
+        ForkedWorker *worker = m_workers.value(spawnId);
+        if (!worker) {
+            return;
+        }
+        if (event == "spawned") {
+            worker->setProcessId(qint64(message["pid"].toDouble()));
+        } else {
+            m_workers.remove(spawnId);
+            worker->setExited(message["code"].toInt(), message["signal"].toInt());
+        }
+    } else if (event == "preloaded") {
+        const QString model = message["model"].toString();
+        m_preloaded.insert(model);
+        emit preloadFinished(model, true, message["ms"].toDouble());
+    } else if (event == "preload_failed") {
+        const QString model = message["model"].toString();
+        qWarning() << "Fork server could not preload" << model << ":" << message["error"].toString();
+        emit preloadFinished(model, false, 0.0);
+    } else if (event == "ready") {
+        m_ready = true;
+        qDebug() << "Fork server ready after" << m_startTimer.elapsed() << "ms with" << m_preloaded.values();
+        emit ready();
+    }
+}
+
+void ForkServer::handleZygoteOutput()
+{
+    while (m_process && m_process->canReadLine()) {
+        qDebug().noquote() << m_process->readLine().trimmed();
+    }
+}
+
+void ForkServer::handleZygoteFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    qWarning() << "Fork server exited with code" << exitCode
+               << (exitStatus == QProcess::CrashExit ? "(crashed)" : "");
+    m_ready = false;
+    m_preloaded.clear();
+
+    // The zygote stops its workers when it goes away
+    for (const QPointer<ForkedWorker> &worker : std::as_const(m_workers)) {
+        if (worker) {
+            worker->kill();
+            worker->setExited(0, SIGKILL);
+        }
+    }
+    m_workers.clear();
+    emit stopped();
+}
@@ -0,0 +1,117 @@
+#ifndef FORKSERVER_H
+#define FORKSERVER_H
+
+#include <QObject>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+
+class QJsonObject;
+class QLocalServer;
+class QLocalSocket;
+
+// A model worker forked from the zygote. Mirrors the parts of QProcess that
+// ProcessManager needs: its output arrives on a local socket and its exit
+// status is reported by the zygote, which is the worker's real parent.
+class ForkedWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ForkedWorker(int spawnId, const QString &model, QObject *parent = nullptr);
+
+    int spawnId() const { return m_spawnId; }
+    QString model() const { return m_model; }
+    qint64 processId() const { return m_pid; }
+    QIODevice *output() const;
+    bool isRunning() const { return m_pid > 0 && !m_exited; }
+
+    void terminate();
+    void kill();
+
+signals:
+    void started();
+    void outputReady(QIODevice *device);
+    void finished(int exitCode, QProcess::ExitStatus exitStatus);
+
+private:
+    friend class ForkServer;
+
+    void setProcessId(qint64 pid);
+    void setOutput(QLocalSocket *socket);
+    void setExited(int exitCode, int signal);
+    void finishIfComplete();
+
+    int m_spawnId;
+    QString m_model;
+    qint64 m_pid = 0;
+    QPointer<QLocalSocket> m_output;
+    bool m_exited = false;
+    bool m_terminateRequested = false;
+    bool m_finished = false;
+    int m_exitCode = 0;
+    int m_signal = 0;
+};
+
+// Persistent Python process (zygote.py) that has already imported the heavy
+// modules and model weights of every worker script and forks a ready worker
+// on request, so starting a model does not pay the interpreter and model
+// load cold start.
+class ForkServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ForkServer(QObject *parent = nullptr);
+    ~ForkServer();
+
+    // Worker name -> script path to preload
+    using Preloads = QMap<QString, QString>;
+
+    void start(const QString &pythonExecutable, const QString &zygotePath, const Preloads &preloads);
+    void stop();
+
+    bool isReady() const { return m_ready; }
+    bool isRunning() const { return m_process && m_process->state() != QProcess::NotRunning; }
+    bool hasPreloaded(const QString &model) const { return m_ready && m_preloaded.contains(model); }
+    const Preloads &preloads() const { return m_preloads; }
+    QString pythonExecutable() const { return m_pythonExecutable; }
+    QString zygotePath() const { return m_zygotePath; }
+
+    // Asks the zygote to fork a worker. Returns nullptr if the model was not preloaded.
+    ForkedWorker *spawn(const QString &model, const QString &workingDirectory,
+                        const QProcessEnvironment &environment);
+
+signals:
+    void ready();
+    void stopped();
+    void preloadFinished(const QString &model, bool ok, double milliseconds);
+
+private slots:
+    void handleNewConnection();
+    void handleControlData();
+    void handleZygoteOutput();
+    void handleZygoteFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
+private:
+    void identifyConnection(QLocalSocket *socket);
+    void handleControlMessage(const QJsonObject &message);
+
+    QProcess *m_process = nullptr;
+    QLocalServer *m_server = nullptr;
+    QPointer<QLocalSocket> m_control;
+    QString m_pythonExecutable;
+    QString m_zygotePath;
+    Preloads m_preloads;
+    QSet<QString> m_preloaded;
+    QHash<int, QPointer<ForkedWorker>> m_workers;
+    QElapsedTimer m_startTimer;
+    int m_nextSpawnId = 1;
+    bool m_ready = false;
+};
+
+#endif // FORKSERVER_H
@@ -0,0 +1,175 @@
+#include "FramePool.h"
+#include <QPainter>
+#include <QVideoFrameFormat>
+
+#include <algorithm>
+#include <cstring>
+
+FramePool &FramePool::instance()
+{
+    // Never destroyed, so images released during shutdown still find it
+    static FramePool *pool = new FramePool;
+    return *pool;
+}
+
+FramePool::FramePool()
+{
+    bool ok = false;
+    const int budgetMb = qEnvironmentVariableIntValue("NEURODRIVE_FRAME_POOL_MB", &ok);
+    if (ok && budgetMb > 0) {
+        m_policy.budgetBytes = qint64(budgetMb) * 1024 * 1024;
+    }
+}
+
+FramePool::Policy FramePool::policy() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_policy;
+}
+
+void FramePool::setPolicy(const Policy &policy)
+{
+    QMutexLocker locker(&m_mutex);
+    m_policy = policy;
+    // Slabs in use stay; a smaller budget takes effect as they come back
+    freeIdleSlabs(0);
+}
+
+QImage FramePool::acquire(const QSize &size, QImage::Format format)
+{
+    if (size.isEmpty() || format == QImage::Format_Invalid) {
+        return QImage();
+    }
+    ++m_acquired;
+
+    QMutexLocker locker(&m_mutex);
+    Slab *found = nullptr;
+    for (const std::unique_ptr<Slab> &slab : m_slabs) {
+        if (!slab->inUse && slab->size == size && slab->format == format) {
+            found = slab.get();
+            break;
+        }
+    }
+
+    if (!found) {
+        // Scan lines padded to 32 bytes, so every row starts aligned for SIMD
+        const int depth = QImage::toPixelFormat(format).bitsPerPixel();
+        const qsizetype bytesPerLine = (qsizetype(size.width()) * depth / 8 + 31) & ~qsizetype(31);
+        const qsizetype bytes = bytesPerLine * size.height();
+        if (m_allocatedBytes + bytes > m_policy.budgetBytes && !freeIdleSlabs(bytes)) {
+            ++m_exhausted;
+            return QImage();
+        }
+        auto slab = std::make_unique<Slab>();
+        slab->pool = this;
+        slab->size = size;
+        slab->format = format;
+        slab->bytesPerLine = bytesPerLine;
+        slab->bytes = bytes;
+        slab->data.reset(new uchar[std::size_t(bytes)]);
+        m_allocatedBytes += bytes;
+        found = slab.get();
+        m_slabs.push_back(std::move(slab));
+    }
+
+    found->inUse = true;
+    m_inUseBytes += found->bytes;
+    m_peakInUseBytes = std::max(m_peakInUseBytes, m_inUseBytes);
+    ++m_slabsInUse;
+    return QImage(found->data.get(), size.width(), size.height(), found->bytesPerLine, format,
+                  &FramePool::release, found);
+}
+
+void FramePool::release(void *info)
+{
+    Slab *slab = static_cast<Slab *>(info);
+    FramePool *pool = slab->pool;
+    QMutexLocker locker(&pool->m_mutex);
+    slab->inUse = false;
+    pool->m_inUseBytes -= slab->bytes;
+    --pool->m_slabsInUse;
+    if (pool->m_allocatedBytes > pool->m_policy.budgetBytes) {
+        pool->freeIdleSlabs(0);
+    }
+}
+
+bool FramePool::freeIdleSlabs(qint64 needed)
+{
+    // Called with the mutex held
+    for (auto it = m_slabs.begin(); it != m_slabs.end() && m_allocatedBytes + needed > m_policy.budgetBytes;) {
+        if ((*it)->inUse) {
+            ++it;
+            continue;
+        }
+        m_allocatedBytes -= (*it)->bytes;
+        it = m_slabs.erase(it);
+    }
+    return m_allocatedBytes + needed <= m_policy.budgetBytes;
+}
+
+QImage FramePool::convert(const QVideoFrame &frame, const QSize &size, QImage::Format format)
+{
+    if (!frame.isValid()) {
+        return QImage();
+    }
+
+    // Packed RGB frames, e.g. from the decoder's software path, are read in
+    // place; toImage() would allocate a full copy first
+    QVideoFrame mapped(frame);
+    const QImage::Format frameFormat = QVideoFrameFormat::imageFormatFromPixelFormat(mapped.pixelFormat());
+    if (frameFormat != QImage::Format_Invalid && mapped.rotation() == QtVideo::Rotation::None && !mapped.mirrored()
+        && mapped.surfaceFormat().scanLineDirection() == QVideoFrameFormat::TopToBottom
+        && mapped.map(QVideoFrame::ReadOnly)) {
+        const QImage view(static_cast<const uchar *>(mapped.bits(0)), mapped.width(), mapped.height(),
+                          mapped.bytesPerLine(0), frameFormat);
+        QImage result = convert(view, size, format);
+        mapped.unmap();
+        return result;
+    }
+    return convert(mapped.toImage(), size, format);
+}
+
+QImage FramePool::convert(const QImage &image, const QSize &size, QImage::Format format)
+{
+    if (image.isNull()) {
+        return QImage();
+    }
+    const QSize target = size.isEmpty() ? image.size() : size;
+    QImage result = acquire(target, format);
+    if (result.isNull()) {
+        return result;
+    }
+
+    if (target == image.size() && image.format() == format) {
+        const qsizetype rowBytes = std::min(image.bytesPerLine(), result.bytesPerLine());
+        for (int y = 0; y < target.height(); ++y) {
+            std::memcpy(result.scanLine(y), image.constScanLine(y), std::size_t(rowBytes));
+        }
+        return result;
+    }
+
+    // Bilinear like the scripts' cv2.resize(), written straight into the slab
+    QPainter painter(&result);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    if (target != image.size()) {
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    }
+    painter.drawImage(QRect(QPoint(0, 0), target), image);
+    painter.end();
+    return result;
+}
+
+FramePool::Stats FramePool::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    Stats stats;
+    stats.budgetBytes = m_policy.budgetBytes;
+    stats.allocatedBytes = m_allocatedBytes;
+    stats.inUseBytes = m_inUseBytes;
+    stats.peakInUseBytes = m_peakInUseBytes;
+    stats.slabs = int(m_slabs.size());
+    stats.slabsInUse = m_slabsInUse;
+    stats.acquired = m_acquired;
+    stats.exhausted = m_exhausted;
+    return stats;
+}
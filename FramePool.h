@@ -0,0 +1,88 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+#include <QVideoFrame>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Process-wide pool of frame buffers for the C++ pipeline. Every stage that
+// converts or scales a frame (the fan-out to the workers, the native engines,
+// the recorder) draws into a pooled image instead of allocating one per
+// frame, so the heap no longer churns through a few MB per frame on every
+// thread and memory stays flat over a long shift.
+//
+// Buffers come in fixed-size slabs, one class per size and format, and are
+// allocated on first use up to a global budget (NEURODRIVE_FRAME_POOL_MB).
+// A slab returns to its class when the last QImage sharing it is released. At
+// the budget, idle slabs of other classes are freed first, e.g. after the
+// rate governor changed the width; when every slab is in use the request
+// fails and the stage drops the frame.
+class FramePool
+{
+public:
+    struct Policy
+    {
+        qint64 budgetBytes = 96 * 1024 * 1024;  // A Pi 4 with 2 GB runs Combined mode within it
+    };
+
+    struct Stats
+    {
+        qint64 budgetBytes = 0;
+        qint64 allocatedBytes = 0;   // Slabs in the pool, free or not
+        qint64 inUseBytes = 0;
+        qint64 peakInUseBytes = 0;
+        int slabs = 0;
+        int slabsInUse = 0;
+        quint64 acquired = 0;
+        quint64 exhausted = 0;       // Requests that found the budget spent
+    };
+
+    static FramePool &instance();
+
+    Policy policy() const;
+    void setPolicy(const Policy &policy);
+
+    // An uninitialised pooled image, or a null image when the budget is spent
+    QImage acquire(const QSize &size, QImage::Format format);
+    // The frame converted to format and scaled to size (its own size when
+    // empty) in a pooled image; null when the budget is spent or the frame
+    // cannot be read. Frames in a QImage format are read in place, others
+    // through QVideoFrame::toImage().
+    QImage convert(const QVideoFrame &frame, const QSize &size, QImage::Format format);
+    QImage convert(const QImage &image, const QSize &size, QImage::Format format);
+
+    Stats stats() const;
+
+private:
+    struct Slab
+    {
+        FramePool *pool = nullptr;
+        QSize size;
+        QImage::Format format = QImage::Format_Invalid;
+        qsizetype bytesPerLine = 0;
+        qsizetype bytes = 0;
+        std::unique_ptr<uchar[]> data;
+        bool inUse = false;
+    };
+
+    FramePool();
+    static void release(void *info);
+    bool freeIdleSlabs(qint64 needed);
+
+    mutable QMutex m_mutex;
+    Policy m_policy;
+    // Slabs are never moved, so images may point into them
+    std::vector<std::unique_ptr<Slab>> m_slabs;
+    qint64 m_allocatedBytes = 0;
+    qint64 m_inUseBytes = 0;
+    qint64 m_peakInUseBytes = 0;
+    int m_slabsInUse = 0;
+    std::atomic<quint64> m_acquired { 0 };
+    std::atomic<quint64> m_exhausted { 0 };
+};
+
+#endif // FRAMEPOOL_H
@@ -0,0 +1,122 @@
+#include "FrameQueue.h"
+#include <QDebug>
+#include <QStringList>
+
+namespace {
+
+// Live queues, for allStats(); queues come and go with their stages
+QMutex registryMutex;
+QList<FrameQueueBase *> registry;
+
+} // namespace
+
+FrameQueueBase::FrameQueueBase(const QString &name)
+    : m_name(name)
+{
+    QMutexLocker locker(&registryMutex);
+    registry.append(this);
+}
+
+FrameQueueBase::~FrameQueueBase()
+{
+    QMutexLocker locker(&registryMutex);
+    registry.removeOne(this);
+}
+
+QString FrameQueueBase::backPressureName(BackPressure backPressure)
+{
+    switch (backPressure) {
+    case DropOldest:
+        return "drop-oldest";
+    case Block:
+        return "block";
+    case DropNewest:
+        break;
+    }
+    return "drop-newest";
+}
+
+bool FrameQueueBase::parsePolicy(const QString &text, Policy *policy)
+{
+    const QStringList parts = text.trimmed().split(':');
+    Policy parsed = *policy;
+    const QString name = parts.first().trimmed().toLower();
+    if (name == "drop-newest") {
+        parsed.backPressure = DropNewest;
+        parsed.depth = 1;
+    } else if (name == "drop-oldest") {
+        parsed.backPressure = DropOldest;
+        parsed.depth = 2;
+    } else if (name == "block") {
+        parsed.backPressure = Block;
+        parsed.depth = 1;
+    } else {
+        return false;
+    }
+    if (parts.size() > 1) {
+        bool ok = false;
+        parsed.depth = parts.at(1).toInt(&ok);
+        if (!ok || parsed.depth < 1) {
+            return false;
+        }
+    }
+    *policy = parsed;
+    return true;
+}
+
+FrameQueueBase::Policy FrameQueueBase::configuredPolicy(const QString &stage)
+{
+    Policy policy;
+    const QStringList entries = qEnvironmentVariable("NEURODRIVE_BACKPRESSURE").split(',', Qt::SkipEmptyParts);
+    for (const QString &entry : entries) {
+        const qsizetype separator = entry.indexOf('=');
+        if (separator < 0 || entry.left(separator).trimmed() != stage) {
+            continue;
+        }
+        if (!parsePolicy(entry.mid(separator + 1), &policy)) {
+            qWarning() << "FrameQueue: ignoring back-pressure policy" << entry;
+        }
+    }
+    return policy;
+}
+
+QList<FrameQueueBase::Stats> FrameQueueBase::allStats()
+{
+    QMutexLocker locker(&registryMutex);
+    QList<Stats> stats;
+    stats.reserve(registry.size());
+    for (const FrameQueueBase *queue : std::as_const(registry)) {
+        stats.append(queue->stats());
+    }
+    return stats;
+}
+
+FrameQueueBase::Policy FrameQueueBase::policy() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_policy;
+}
+
+void FrameQueueBase::setPolicy(const Policy &policy)
+{
+    QMutexLocker locker(&m_mutex);
+    m_policy = policy;
+    // A producer blocked on the old depth re-checks the new one
+    m_room.wakeAll();
+}
+
+FrameQueueBase::Stats FrameQueueBase::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    Stats stats;
+    stats.name = m_name;
+    stats.depth = m_policy.depth;
+    stats.queued = m_queued;
+    stats.backPressure = m_policy.backPressure;
+    stats.pushed = m_pushed;
+    stats.droppedNewest = m_droppedNewest;
+    stats.droppedOldest = m_droppedOldest;
+    stats.blockTimeouts = m_blockTimeouts;
+    stats.blockedMs = m_blockedMs;
+    return stats;
+}
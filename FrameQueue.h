@@ -0,0 +1,188 @@
+#ifndef FRAMEQUEUE_H
+#define FRAMEQUEUE_H
+
+#include <QDeadlineTimer>
+#include <QList>
+#include <QMetaObject>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include <functional>
+
+// Bounded hand-off of frames from the thread producing them to a pipeline
+// stage's worker thread. The depth counts the frames the stage holds, the
+// one being processed included. When the stage falls behind, its
+// back-pressure policy decides what gives:
+//
+//   DropNewest  the incoming frame is dropped; at depth 1 this is the
+//               stages' old "skip while busy"
+//   DropOldest  the longest waiting frame is dropped, so the stage always
+//               goes on with the newest; it needs a depth of 2 to differ
+//   Block       the producer waits up to blockTimeoutMs for room, then drops
+//               the incoming frame; for clips every frame of which must be
+//               processed. It holds up the producing thread, usually the GUI's
+//
+// Queued frames keep their decoded buffers alive, camera buffers included,
+// so the depth is part of the memory budget. Every live queue reports its
+// counters through FrameQueueBase::allStats() for the metrics export.
+class FrameQueueBase
+{
+public:
+    enum BackPressure {
+        DropNewest,
+        DropOldest,
+        Block
+    };
+
+    struct Policy
+    {
+        int depth = 1;
+        BackPressure backPressure = DropNewest;
+        int blockTimeoutMs = 200;
+    };
+
+    struct Stats
+    {
+        QString name;
+        int depth = 0;
+        int queued = 0;
+        BackPressure backPressure = DropNewest;
+        quint64 pushed = 0;
+        quint64 droppedNewest = 0;
+        quint64 droppedOldest = 0;
+        quint64 blockTimeouts = 0;   // Counted in droppedNewest too
+        quint64 blockedMs = 0;
+    };
+
+    static QString backPressureName(BackPressure backPressure);
+    // "drop-newest", "drop-oldest" or "block", optionally followed by ":<depth>"
+    static bool parsePolicy(const QString &text, Policy *policy);
+    // The policy NEURODRIVE_BACKPRESSURE sets for a stage, e.g.
+    // "fanout=drop-newest,lane=drop-oldest:2,traffic=block"; DropNewest at
+    // depth 1 otherwise
+    static Policy configuredPolicy(const QString &stage);
+    // Counters of every live queue, in creation order
+    static QList<Stats> allStats();
+
+    QString name() const { return m_name; }
+    Policy policy() const;
+    void setPolicy(const Policy &policy);
+    Stats stats() const;
+
+protected:
+    explicit FrameQueueBase(const QString &name);
+    ~FrameQueueBase();
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_room;
+    Policy m_policy;
+    int m_queued = 0;
+    std::atomic<quint64> m_pushed { 0 };
+    std::atomic<quint64> m_droppedNewest { 0 };
+    std::atomic<quint64> m_droppedOldest { 0 };
+    std::atomic<quint64> m_blockTimeouts { 0 };
+    std::atomic<quint64> m_blockedMs { 0 };
+
+private:
+    QString m_name;
+};
+
+// Items are handed to the consumer one at a time on the context's thread
+template <typename Item>
+class FrameQueue : public FrameQueueBase
+{
+public:
+    FrameQueue(const QString &name, QObject *context, std::function<void(Item &)> consumer)
+        : FrameQueueBase(name)
+        , m_context(context)
+        , m_consumer(std::move(consumer))
+    {
+    }
+
+    // False when the item was dropped
+    bool push(Item item)
+    {
+        QMutexLocker locker(&m_mutex);
+        ++m_pushed;
+        const int depth = qMax(1, m_policy.depth);
+        if (held() >= depth) {
+            if (m_policy.backPressure == DropOldest && !m_items.empty()) {
+                m_items.pop_front();
+                ++m_droppedOldest;
+            } else if (m_policy.backPressure == Block) {
+                QDeadlineTimer deadline(m_policy.blockTimeoutMs);
+                const qint64 start = deadline.remainingTime();
+                while (held() >= depth && !deadline.hasExpired()) {
+                    m_room.wait(&m_mutex, deadline);
+                }
+                m_blockedMs += quint64(qMax<qint64>(0, start - qMax<qint64>(0, deadline.remainingTime())));
+                if (held() >= depth) {
+                    ++m_blockTimeouts;
+                    ++m_droppedNewest;
+                    return false;
+                }
+            } else {
+                ++m_droppedNewest;
+                return false;
+            }
+        }
+        m_items.push_back(std::move(item));
+        m_queued = held();
+        if (!m_draining) {
+            m_draining = true;
+            QMetaObject::invokeMethod(m_context, [this]() { drain(); });
+        }
+        return true;
+    }
+
+    // Drops whatever is waiting, e.g. when the stage stops; not counted
+    void clear()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_items.clear();
+        m_queued = held();
+        m_room.wakeAll();
+    }
+
+    bool isIdle() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return !m_draining;
+    }
+
+private:
+    int held() const { return int(m_items.size()) + (m_processing ? 1 : 0); }
+
+    void drain()
+    {
+        for (;;) {
+            Item item;
+            {
+                QMutexLocker locker(&m_mutex);
+                m_processing = false;
+                m_room.wakeOne();
+                if (m_items.empty()) {
+                    m_queued = 0;
+                    m_draining = false;
+                    return;
+                }
+                item = std::move(m_items.front());
+                m_items.pop_front();
+                m_processing = true;
+                m_queued = held();
+            }
+            m_consumer(item);
+        }
+    }
+
+    QObject *m_context;
+    std::function<void(Item &)> m_consumer;
+    std::deque<Item> m_items;
+    bool m_draining = false;      // A drain() is queued or running on the context
+    bool m_processing = false;    // The consumer holds an item
+};
+
+#endif // FRAMEQUEUE_H
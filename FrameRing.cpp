@@ -0,0 +1,255 @@
+#include "FrameRing.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct FrameRing::Mapping
+{
+    uchar *base = nullptr;
+    size_t size = 0;
+
+    ~Mapping()
+    {
+        if (base) {
+            munmap(base, size);
+        }
+    }
+
+    RingHeader *header() const { return reinterpret_cast<RingHeader*>(base); }
+
+    size_t slotStride() const
+    {
+        return sizeof(SlotHeader) + header()->slotCapacity;
+    }
+
+    SlotHeader *slot(quint32 index) const
+    {
+        return reinterpret_cast<SlotHeader*>(base + sizeof(RingHeader) + index * slotStride());
+    }
+};
+
+// Keeps the mapping alive for as long as Qt holds on to a frame and unpins the
+// slot once the last reference goes away.
+struct FrameRing::SlotPin
+{
+    QSharedPointer<Mapping> mapping;
+    quint32 bit;
+};
+
+void FrameRing::releaseSlotPin(void *info)
+{
+    SlotPin *pin = static_cast<SlotPin*>(info);
+    __atomic_fetch_and(&pin->mapping->header()->pinnedMask, ~pin->bit, __ATOMIC_SEQ_CST);
+    delete pin;
+}
+
+FrameRing::~FrameRing()
+{
+    destroy();
+}
+
+bool FrameRing::create(const QString &name, int slotCount, quint32 slotCapacity)
+{
+    destroy();
+
+    if (slotCount < 2 || slotCount > MaxSlots) {
+        m_errorString = QString("Invalid slot count %1").arg(slotCount);
+        return false;
+    }
+
+    // Round the pixel area up so every slot header stays 64-byte aligned
+    slotCapacity = (slotCapacity + 63u) & ~63u;
+
+    QByteArray shmName = name.toUtf8();
+    if (!shmName.startsWith('/')) {
+        shmName.prepend('/');
+    }
+
+    // A stale object from a previous run would keep its old geometry
+    shm_unlink(shmName.constData());
+
+    int fd = shm_open(shmName.constData(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        m_errorString = QString("shm_open failed: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+
+    const size_t size = sizeof(RingHeader) + size_t(slotCount) * (sizeof(SlotHeader) + slotCapacity);
+    if (ftruncate(fd, off_t(size)) != 0) {
+        m_errorString = QString("ftruncate failed: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        close(fd);
+        shm_unlink(shmName.constData());
+        return false;
+    }
+
+    void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        m_errorString = QString("mmap failed: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        shm_unlink(shmName.constData());
+        return false;
+    }
+
+    QSharedPointer<Mapping> mapping(new Mapping);
+    mapping->base = static_cast<uchar*>(base);
+    mapping->size = size;
+
+    RingHeader *header = mapping->header();
+    header->version = Version;
+    header->slotCount = quint32(slotCount);
+    header->slotCapacity = slotCapacity;
+    header->publishedCount = 0;
+    header->pinnedMask = 0;
+    header->workerPinnedMask = 0;
+    header->writerPid = 0;
+    header->latestSlot = 0;
+    // Publish the magic last so a worker never sees a half-initialised header
+    __atomic_store_n(&header->magic, Magic, __ATOMIC_RELEASE);
+
+    m_name = QString::fromUtf8(shmName);
+    m_errorString.clear();
+    m_mapping = mapping;
+    m_nextSlot = 0;
+    return true;
+}
+
+void FrameRing::destroy()
+{
+    // Frames still referenced by the scene graph keep their own reference to
+    // the mapping, so only the name goes away here.
+    if (!m_name.isEmpty()) {
+        shm_unlink(m_name.toUtf8().constData());
+    }
+    m_mapping.reset();
+    m_name.clear();
+}
+
+quint64 FrameRing::publishedCount() const
+{
+    if (!m_mapping) {
+        return 0;
+    }
+    return __atomic_load_n(&m_mapping->header()->publishedCount, __ATOMIC_ACQUIRE);
+}
+
+QImage FrameRing::acquireLatest(quint64 *frameIndex, quint64 *timestampNs)
+{
+    if (!m_mapping) {
+        return QImage();
+    }
+
+    RingHeader *header = m_mapping->header();
+    const quint32 slotIndex = __atomic_load_n(&header->latestSlot, __ATOMIC_ACQUIRE);
+    if (slotIndex >= header->slotCount) {
+        return QImage();
+    }
+
+    // Pin first, then validate: the worker marks a slot odd before checking the
+    // mask, so either it sees our pin or we see its odd sequence.
+    const quint32 bit = 1u << slotIndex;
+    __atomic_fetch_or(&header->pinnedMask, bit, __ATOMIC_SEQ_CST);
+
+    SlotHeader *slot = m_mapping->slot(slotIndex);
+    const quint64 sequence = __atomic_load_n(&slot->sequence, __ATOMIC_SEQ_CST);
+    const bool stable = (sequence & 1u) == 0 && sequence != 0
+            && slot->format == BGRX8888
+            && slot->width > 0 && slot->height > 0
+            && quint64(slot->stride) * slot->height <= header->slotCapacity
+            && __atomic_load_n(&slot->sequence, __ATOMIC_SEQ_CST) == sequence;
+    if (!stable) {
+        __atomic_fetch_and(&header->pinnedMask, ~bit, __ATOMIC_SEQ_CST);
+        return QImage();
+    }
+
+    if (frameIndex) {
+        *frameIndex = slot->frameIndex;
+    }
+    if (timestampNs) {
+        *timestampNs = slot->timestampNs;
+    }
+
+    uchar *pixels = reinterpret_cast<uchar*>(slot) + sizeof(SlotHeader);
+    return QImage(pixels, int(slot->width), int(slot->height), qsizetype(slot->stride),
+                  QImage::Format_RGB32, releaseSlotPin, new SlotPin{m_mapping, bit});
+}
+
+bool FrameRing::publish(const QImage &image, quint64 frameIndex, quint64 timestampNs)
+{
+    if (!m_mapping || image.format() != QImage::Format_RGB32) {
+        return false;
+    }
+
+    RingHeader *header = m_mapping->header();
+    const quint32 stride = quint32(image.width()) * 4u;
+    if (quint64(stride) * quint64(image.height()) > header->slotCapacity) {
+        return false;
+    }
+
+    for (quint32 attempt = 0; attempt < header->slotCount; ++attempt) {
+        const quint32 slotIndex = m_nextSlot;
+        m_nextSlot = (m_nextSlot + 1) % header->slotCount;
+        SlotHeader *slot = m_mapping->slot(slotIndex);
+
+        // Mark the slot odd before looking at the pins (see acquireLatest)
+        const quint64 sequence = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) | 1u;
+        __atomic_store_n(&slot->sequence, sequence, __ATOMIC_SEQ_CST);
+        const quint32 pinned = __atomic_load_n(&header->pinnedMask, __ATOMIC_SEQ_CST)
+                | __atomic_load_n(&header->workerPinnedMask, __ATOMIC_SEQ_CST);
+        if (pinned & (1u << slotIndex)) {
+            __atomic_store_n(&slot->sequence, sequence - 1, __ATOMIC_SEQ_CST);
+            continue;
+        }
+
+        uchar *pixels = reinterpret_cast<uchar*>(slot) + sizeof(SlotHeader);
+        for (int y = 0; y < image.height(); ++y) {
+            std::memcpy(pixels + size_t(y) * stride, image.constScanLine(y), stride);
+        }
+        slot->frameIndex = frameIndex;
+        slot->timestampNs = timestampNs;
+        slot->width = quint32(image.width());
+        slot->height = quint32(image.height());
+        slot->stride = stride;
+        slot->format = BGRX8888;
+        __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELEASE);
+
+        // Commit: point readers at the slot, then bump the published counter
+        __atomic_store_n(&header->latestSlot, slotIndex, __ATOMIC_RELEASE);
+        __atomic_fetch_add(&header->publishedCount, 1, __ATOMIC_RELEASE);
+        return true;
+    }
+    return false;
+}
+
+void FrameRing::setStreamInfo(quint32 expectedFrames, double fps, const QSize &frameSize)
+{
+    if (!m_mapping) {
+        return;
+    }
+    RingHeader *header = m_mapping->header();
+    header->expectedFrames = expectedFrames;
+    header->frameWidth = quint32(qMax(0, frameSize.width()));
+    header->frameHeight = quint32(qMax(0, frameSize.height()));
+    // Readers wait for a non-zero frame rate, so it goes last
+    __atomic_store_n(&header->fpsMilli, quint32(qMax(1.0, fps * 1000.0)), __ATOMIC_RELEASE);
+}
+
+void FrameRing::setEndOfStream()
+{
+    if (m_mapping) {
+        __atomic_fetch_or(&m_mapping->header()->flags, quint32(EndOfStream), __ATOMIC_RELEASE);
+    }
+}
+
+bool FrameRing::hasReader() const
+{
+    return m_mapping && __atomic_load_n(&m_mapping->header()->readerPid, __ATOMIC_ACQUIRE) != 0;
+}
+
+quint32 FrameRing::slotCapacity() const
+{
+    return m_mapping ? m_mapping->header()->slotCapacity : 0;
+}
@@ -0,0 +1,112 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <QString>
+#include <QImage>
+#include <QSize>
+#include <QSharedPointer>
+
+// Shared-memory ring of frames between the dashboard and a model worker.
+// Output rings carry processed frames from the worker to the dashboard; input
+// rings carry decoded frames from FrameSource to the worker. The layout is
+// mirrored in worker_ipc.py:
+//
+//   [RingHeader 64 bytes][SlotHeader 64 bytes][pixels]...[SlotHeader][pixels]
+//
+// A slot's sequence is odd while the writer is filling it. The reader pins a
+// slot while it uses a frame and the writer skips pinned slots, so frames can
+// be handed to Qt without copying. Each side pins in a mask word of its own:
+// the dashboard updates pinnedMask atomically, a worker_ipc.py reader, which
+// has no atomic read-modify-write, owns workerPinnedMask alone, and writers
+// skip a slot pinned in either.
+class FrameRing
+{
+public:
+    static constexpr quint32 Magic = 0x5246444E;  // "NDFR"
+    static constexpr quint32 Version = 2;
+    static constexpr int MaxSlots = 32;
+
+    enum PixelFormat : quint32 {
+        BGRX8888 = 1
+    };
+
+    enum StreamFlag : quint32 {
+        EndOfStream = 1  // The writer will publish no more frames
+    };
+
+    struct RingHeader {
+        quint32 magic;
+        quint32 version;
+        quint32 slotCount;
+        quint32 slotCapacity;
+        quint64 publishedCount;
+        quint32 pinnedMask;
+        quint32 writerPid;
+        quint32 latestSlot;
+        quint32 flags;
+        quint32 readerPid;
+        // Stream info of input rings, zero until the source knows it
+        quint32 expectedFrames;
+        quint32 fpsMilli;
+        quint32 frameWidth;
+        quint32 frameHeight;
+        quint32 workerPinnedMask;
+    };
+
+    struct SlotHeader {
+        quint64 sequence;
+        quint64 frameIndex;
+        quint64 timestampNs;
+        quint32 width;
+        quint32 height;
+        quint32 stride;
+        quint32 format;
+        quint8 reserved[24];
+    };
+
+    static_assert(sizeof(RingHeader) == 64, "RingHeader layout is shared with worker_ipc.py");
+    static_assert(sizeof(SlotHeader) == 64, "SlotHeader layout is shared with worker_ipc.py");
+
+    FrameRing() = default;
+    ~FrameRing();
+
+    FrameRing(const FrameRing &) = delete;
+    FrameRing &operator=(const FrameRing &) = delete;
+
+    // Creates (or recreates) the POSIX shared-memory object and initialises the header
+    bool create(const QString &name, int slotCount, quint32 slotCapacity);
+    void destroy();
+
+    bool isValid() const { return !m_mapping.isNull(); }
+    QString name() const { return m_name; }
+    QString errorString() const { return m_errorString; }
+
+    // Number of frames the worker has committed so far
+    quint64 publishedCount() const;
+
+    // Returns the most recently committed frame as a QImage that points straight
+    // into shared memory. The slot stays pinned until the last copy of the image
+    // is released. Returns a null image if no stable frame is available.
+    QImage acquireLatest(quint64 *frameIndex = nullptr, quint64 *timestampNs = nullptr);
+
+    // Writer side, for input rings. image must be Format_RGB32 and fit a slot.
+    // Returns false if every slot is pinned and the frame was dropped.
+    bool publish(const QImage &image, quint64 frameIndex, quint64 timestampNs);
+    void setStreamInfo(quint32 expectedFrames, double fps, const QSize &frameSize);
+    void setEndOfStream();
+    // True once a worker has opened the ring for reading
+    bool hasReader() const;
+    quint32 slotCapacity() const;
+
+private:
+    struct Mapping;
+    struct SlotPin;
+    static void releaseSlotPin(void *info);
+
+    QString m_name;
+    QString m_errorString;
+    QSharedPointer<Mapping> m_mapping;
+    quint32 m_nextSlot = 0;
+};
+
+#endif // FRAMERING_H
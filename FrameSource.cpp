@@ -0,0 +1,369 @@
+#include "FrameSource.h"
+#include "FramePool.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFileInfo>
+#include <QImage>
+#include <QMediaMetaData>
+#include <QMediaPlayer>
+#include <QStringList>
+#include <QUrl>
+#include <QVideoSink>
+
+#include <cmath>
+#include <utility>
+
+FrameSource::FrameSource(const QString &videoPath, QObject *parent)
+    : QObject(parent)
+    , m_videoPath(videoPath)
+    , m_workerContext(new QObject)
+    , m_queue("fanout " + QFileInfo(videoPath).fileName(), m_workerContext,
+              [this](PendingFrame &pending) { fanOut(pending.frame, pending.frameIndex); })
+{
+    m_queue.setPolicy(FrameQueueBase::configuredPolicy("fanout"));
+    m_thread.setObjectName("FrameSource");
+    m_workerContext->moveToThread(&m_thread);
+    m_thread.start();
+
+    if (V4L2Capture::isCaptureDevice(videoPath)) {
+        m_capture = new V4L2Capture(videoPath, this);
+        // Queued from the capture thread; frames waiting in the queue count as in flight
+        connect(m_capture, &V4L2Capture::frameCaptured, this, &FrameSource::handleVideoFrame);
+        connect(m_capture, &V4L2Capture::errorOccurred, this, [this](const QString &message) {
+            if (m_running) {
+                stop();
+                emit errorOccurred(message);
+            }
+        });
+    } else {
+        m_player = new QMediaPlayer(this);
+        m_sink = new QVideoSink(this);
+        m_player->setVideoSink(m_sink);
+        connect(m_sink, &QVideoSink::videoFrameChanged, this, &FrameSource::handleVideoFrame);
+
+        connect(m_player, &QMediaPlayer::mediaStatusChanged, this, [this](QMediaPlayer::MediaStatus status) {
+            if (!m_running) {
+                return;
+            }
+            if (status == QMediaPlayer::LoadedMedia || status == QMediaPlayer::BufferedMedia) {
+                handleMediaLoaded();
+            } else if (status == QMediaPlayer::EndOfMedia) {
+                finish();
+            } else if (status == QMediaPlayer::InvalidMedia) {
+                stop();
+                emit errorOccurred("Could not open video source " + m_videoPath + ": " + m_player->errorString());
+            }
+        });
+        connect(m_player, &QMediaPlayer::errorOccurred, this, [this](QMediaPlayer::Error, const QString &message) {
+            if (m_running) {
+                stop();
+                emit errorOccurred(message);
+            }
+        });
+    }
+
+    m_attachTimer.setInterval(20);
+    connect(&m_attachTimer, &QTimer::timeout, this, &FrameSource::waitForSubscribers);
+}
+
+FrameSource::~FrameSource()
+{
+    stop();
+    m_thread.quit();
+    m_thread.wait();  // At most the frame being fanned out
+    delete m_workerContext;
+}
+
+QString FrameSource::subscribe(const QString &subscriber, const Policy &policy)
+{
+    // A worker that is started again after a failed spawn reuses its ring, and
+    // so does one restarted after a crash, joining the stream where it is now;
+    // the policy is left alone while frames are being fanned out
+    for (Subscription &subscription : m_subscriptions) {
+        if (subscription.name == subscriber) {
+            if (!m_running) {
+                QMutexLocker locker(&m_subscriptionsMutex);
+                subscription.policy = policy;
+            }
+            return subscription.ring->name();
+        }
+    }
+
+    if (m_running) {
+        qWarning() << "FrameSource: cannot subscribe" << subscriber << "while" << m_videoPath << "is playing";
+        return QString();
+    }
+
+    const quint32 capacity = policy.size.isEmpty()
+            ? DefaultSlotCapacity
+            : quint32(policy.size.width()) * quint32(policy.size.height()) * 4u;
+    // Unique per source, so a source being deleted never unlinks its successor's ring
+    static quint32 serial = 0;
+    const QString name = QString("/neurodrive-%1-in%2-%3")
+            .arg(QCoreApplication::applicationPid()).arg(++serial).arg(subscriber);
+
+    auto ring = std::make_shared<FrameRing>();
+    if (!ring->create(name, SlotCount, capacity)) {
+        qWarning() << "FrameSource: could not create input ring for" << subscriber << ":" << ring->errorString();
+        return QString();
+    }
+
+    Subscription subscription;
+    subscription.name = subscriber;
+    subscription.policy = policy;
+    subscription.ring = ring;
+    QMutexLocker locker(&m_subscriptionsMutex);
+    m_subscriptions.push_back(subscription);
+    return ring->name();
+}
+
+void FrameSource::start()
+{
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    m_loaded = false;
+    m_playing = false;
+    m_streamInfoWritten = false;
+    m_framesDecoded = 0;
+    m_framesSkipped = 0;
+
+    if (m_capture) {
+        startCapture();
+        return;
+    }
+    // Loading does not start playback; that waits for the subscribers
+    m_player->setSource(QUrl::fromLocalFile(m_videoPath));
+}
+
+void FrameSource::stop()
+{
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+    m_playing = false;
+    m_attachTimer.stop();
+    m_queue.clear();
+    if (m_capture) {
+        m_capture->close();
+    } else {
+        m_player->stop();
+    }
+
+    // Workers still reading see the end of the stream instead of waiting forever
+    for (const Subscription &subscription : m_subscriptions) {
+        subscription.ring->setEndOfStream();
+    }
+}
+
+void FrameSource::handleMediaLoaded()
+{
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+
+    m_fps = m_player->metaData().value(QMediaMetaData::VideoFrameRate).toDouble();
+    if (m_fps <= 0.0) {
+        m_fps = 30.0;
+    }
+    m_expectedFrames = qint64(double(m_player->duration()) * m_fps / 1000.0);
+
+    // Without a resolution in the metadata the first frame provides it
+    const QSize resolution = m_player->metaData().value(QMediaMetaData::Resolution).toSize();
+    if (resolution.isValid()) {
+        writeStreamInfo(resolution);
+    }
+
+    m_attachClock.start();
+    waitForSubscribers();
+    if (!m_playing) {
+        m_attachTimer.start();
+    }
+}
+
+void FrameSource::startCapture()
+{
+    // Negotiated again on every start, so a replugged camera comes back
+    if (!m_capture->open(m_captureFormat)) {
+        const QString message = "Could not open camera " + m_capture->errorString();
+        stop();
+        emit errorOccurred(message);
+        return;
+    }
+    m_loaded = true;
+    m_fps = m_capture->fps() > 0.0 ? m_capture->fps() : 30.0;
+    m_expectedFrames = 0;  // Live
+    writeStreamInfo(m_capture->size());
+
+    m_attachClock.start();
+    waitForSubscribers();
+    if (!m_playing) {
+        m_attachTimer.start();
+    }
+}
+
+void FrameSource::waitForSubscribers()
+{
+    // Frames published before a worker has opened its ring would be lost
+    QStringList waiting;
+    for (const Subscription &subscription : m_subscriptions) {
+        if (!subscription.ring->hasReader()) {
+            waiting.append(subscription.name);
+        }
+    }
+    if (!waiting.isEmpty() && m_attachClock.elapsed() < AttachTimeoutMs) {
+        return;
+    }
+    if (!waiting.isEmpty()) {
+        qWarning() << "FrameSource: starting" << m_videoPath << "without" << waiting;
+    }
+
+    m_attachTimer.stop();
+    m_playing = true;
+    if (m_capture) {
+        if (!m_capture->start()) {
+            const QString message = "Could not start camera " + m_capture->errorString();
+            stop();
+            emit errorOccurred(message);
+            return;
+        }
+    } else {
+        m_player->play();
+    }
+    emit started(m_expectedFrames, m_fps);
+}
+
+void FrameSource::handleVideoFrame(const QVideoFrame &frame)
+{
+    if (!m_playing || !frame.isValid()) {
+        return;
+    }
+
+    const qint64 frameIndex = m_framesDecoded++;
+    if (!m_streamInfoWritten) {
+        writeStreamInfo(frame.size());
+    }
+    emit frameDecoded(frame, frameIndex);
+
+    if (m_subscriptions.empty()) {
+        return;
+    }
+    // Workers only ever read the latest frame, so by default a frame the
+    // fan-out thread has no time for is skipped rather than queued
+    if (!m_queue.push({ frame, frameIndex })) {
+        ++m_framesSkipped;
+    }
+}
+
+void FrameSource::fanOut(const QVideoFrame &frame, qint64 frameIndex)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const qint64 timeUs = frame.startTime() >= 0 ? frame.startTime() : qint64(double(frameIndex) * 1e6 / m_fps);
+
+    // Decoded and converted once; each distinct target size is scaled once,
+    // all into pooled buffers that go back to the pool with this frame
+    QImage image;
+    QList<QImage> scaledImages;
+
+    QMutexLocker locker(&m_subscriptionsMutex);
+    for (Subscription &subscription : m_subscriptions) {
+        if (subscription.policy.maxFps > 0.0) {
+            const qint64 intervalUs = qint64(1e6 / subscription.policy.maxFps);
+            // A quarter interval of slack keeps rounded timestamps from halving the rate
+            if (subscription.lastPublishedUs >= 0 && timeUs + intervalUs / 4 < subscription.lastPublishedUs + intervalUs) {
+                continue;
+            }
+        }
+
+        if (image.isNull()) {
+            image = FramePool::instance().convert(frame, QSize(), QImage::Format_RGB32);
+            if (image.isNull()) {
+                return;  // Over the pool's budget
+            }
+        }
+
+        QSize size = targetSize(subscription.policy, image.size());
+        const quint32 capacity = subscription.ring->slotCapacity();
+        if (quint64(size.width()) * quint64(size.height()) * 4u > capacity) {
+            const double scale = std::sqrt(double(capacity) / (double(size.width()) * double(size.height()) * 4.0));
+            size = QSize(qMax(1, int(size.width() * scale)), qMax(1, int(size.height() * scale)));
+        }
+
+        const QImage *scaled = nullptr;
+        for (const QImage &candidate : std::as_const(scaledImages)) {
+            if (candidate.size() == size) {
+                scaled = &candidate;
+                break;
+            }
+        }
+        if (!scaled) {
+            QImage converted = size == image.size()
+                    ? image : FramePool::instance().convert(image, size, QImage::Format_RGB32);
+            if (converted.isNull()) {
+                continue;
+            }
+            scaledImages.append(converted);
+            scaled = &scaledImages.last();
+        }
+
+        if (subscription.ring->publish(*scaled, quint64(frameIndex), quint64(timeUs) * 1000u)) {
+            subscription.lastPublishedUs = timeUs;
+            ++subscription.framesPublished;
+        }
+    }
+
+    m_fanOutMs += double(timer.nsecsElapsed()) / 1e6;
+    ++m_framesFannedOut;
+}
+
+void FrameSource::writeStreamInfo(const QSize &sourceSize)
+{
+    m_streamInfoWritten = true;
+    for (const Subscription &subscription : m_subscriptions) {
+        const double maxFps = subscription.policy.maxFps;
+        const double fps = maxFps > 0.0 ? qMin(maxFps, m_fps) : m_fps;
+        const quint32 expected = quint32(double(m_expectedFrames) * fps / m_fps);
+        subscription.ring->setStreamInfo(expected, fps, targetSize(subscription.policy, sourceSize));
+    }
+}
+
+QSize FrameSource::targetSize(const Policy &policy, const QSize &sourceSize) const
+{
+    if (policy.size.isEmpty()) {
+        return sourceSize;
+    }
+    if (policy.aspectMode == Qt::IgnoreAspectRatio) {
+        return policy.size;
+    }
+    if (sourceSize.width() <= policy.size.width() && sourceSize.height() <= policy.size.height()) {
+        return sourceSize;
+    }
+    return sourceSize.scaled(policy.size, policy.aspectMode);
+}
+
+void FrameSource::finish()
+{
+    // Queue behind the frame being fanned out so it reaches the workers first
+    QMetaObject::invokeMethod(m_workerContext, [this]() {
+        QMetaObject::invokeMethod(this, [this]() {
+            if (!m_running) {
+                return;
+            }
+            stop();
+
+            QStringList published;
+            for (const Subscription &subscription : m_subscriptions) {
+                published.append(QString("%1: %2").arg(subscription.name).arg(subscription.framesPublished));
+            }
+            qDebug() << "FrameSource:" << m_videoPath << "decoded" << m_framesDecoded << "frames once,"
+                     << (m_framesFannedOut > 0 ? m_fanOutMs / double(m_framesFannedOut) : 0.0)
+                     << "ms/frame fan-out," << m_framesSkipped << "skipped;" << published.join(", ");
+            emit finished(m_framesDecoded);
+        });
+    });
+}
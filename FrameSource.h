@@ -0,0 +1,132 @@
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QSize>
+#include <QThread>
+#include <QTimer>
+#include <QVideoFrame>
+#include <memory>
+#include <vector>
+#include "FrameQueue.h"
+#include "FrameRing.h"
+#include "V4L2Capture.h"
+
+class QMediaPlayer;
+class QVideoSink;
+
+// Decodes one video once and fans the frames out to every model that uses it.
+// A /dev/videoN path streams that camera through V4L2Capture instead; its
+// frames are the driver's own buffers and the stream runs until stopped.
+// In-process consumers (LaneDetectionEngine) get the decoded QVideoFrame
+// itself, which is reference counted; each worker process subscribes with its
+// own frame-rate and resolution policy and gets an input FrameRing it reads
+// through worker_ipc.open_video(). Scaling and copying into the rings happens
+// on a thread of its own, in FramePool buffers, behind the "fanout" queue.
+class FrameSource : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Policy
+    {
+        double maxFps = 0.0;     // 0 keeps every decoded frame
+        QSize size;              // Empty keeps the decoded size
+        Qt::AspectRatioMode aspectMode = Qt::KeepAspectRatio;  // KeepAspectRatio only ever shrinks
+    };
+
+    explicit FrameSource(const QString &videoPath, QObject *parent = nullptr);
+    ~FrameSource();
+
+    static constexpr int SlotCount = 4;
+    // Frames of unknown size are shrunk to fit a 1920x1080 BGRX slot
+    static constexpr quint32 DefaultSlotCapacity = 1920 * 1080 * 4;
+    // Playback starts without subscribers that have not attached by then
+    static constexpr int AttachTimeoutMs = 15000;
+
+    QString videoPath() const { return m_videoPath; }
+    bool isCamera() const { return m_capture != nullptr; }
+    bool isRunning() const { return m_running; }
+    qint64 expectedFrames() const { return m_expectedFrames; }
+    double fps() const { return m_fps; }
+    qint64 framesDecoded() const { return m_framesDecoded; }
+
+    // Creates an input ring for a worker process and returns its name for
+    // NEURODRIVE_INPUT_SHM, or an empty string on failure. While playing,
+    // only a subscriber that already has a ring gets it back.
+    QString subscribe(const QString &subscriber, const Policy &policy);
+
+    // Format requested from a camera the next time it starts
+    void setCaptureFormat(const V4L2Capture::Format &format) { m_captureFormat = format; }
+    // Back-pressure of the hand-off to the fan-out thread
+    void setQueuePolicy(const FrameQueueBase::Policy &policy) { m_queue.setPolicy(policy); }
+
+    // Loads the video and starts playing once every subscribed worker has
+    // opened its ring
+    void start();
+    void stop();
+
+signals:
+    void started(qint64 expectedFrames, double fps);
+    void frameDecoded(const QVideoFrame &frame, qint64 frameIndex);
+    void finished(qint64 framesDecoded);
+    void errorOccurred(const QString &message);
+
+private:
+    struct PendingFrame
+    {
+        QVideoFrame frame;
+        qint64 frameIndex = 0;
+    };
+
+    struct Subscription
+    {
+        QString name;
+        Policy policy;
+        std::shared_ptr<FrameRing> ring;
+        qint64 lastPublishedUs = -1;
+        qint64 framesPublished = 0;
+    };
+
+    void handleMediaLoaded();
+    void startCapture();
+    void waitForSubscribers();
+    void handleVideoFrame(const QVideoFrame &frame);
+    void fanOut(const QVideoFrame &frame, qint64 frameIndex);
+    void writeStreamInfo(const QSize &sourceSize);
+    QSize targetSize(const Policy &policy, const QSize &sourceSize) const;
+    void finish();
+
+    QString m_videoPath;
+    QMediaPlayer *m_player = nullptr;
+    QVideoSink *m_sink = nullptr;
+    V4L2Capture *m_capture = nullptr;
+    V4L2Capture::Format m_captureFormat;
+    QThread m_thread;
+    QObject *m_workerContext;
+    FrameQueue<PendingFrame> m_queue;
+    QTimer m_attachTimer;
+    QElapsedTimer m_attachClock;
+
+    // Only changed on this thread, under the mutex, which the fan-out thread
+    // holds while it publishes: a fan-out queued before stop() may still be
+    // running when the next subscribe() comes in
+    std::vector<Subscription> m_subscriptions;
+    QMutex m_subscriptionsMutex;
+
+    bool m_running = false;
+    bool m_loaded = false;
+    bool m_playing = false;
+    bool m_streamInfoWritten = false;
+    qint64 m_expectedFrames = 0;
+    double m_fps = 0.0;
+    qint64 m_framesDecoded = 0;
+    qint64 m_framesSkipped = 0;
+    double m_fanOutMs = 0.0;  // Only touched on the fan-out thread until finish()
+    qint64 m_framesFannedOut = 0;
+};
+
+#endif // FRAMESOURCE_H
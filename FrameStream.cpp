@@ -0,0 +1,178 @@
+#include "FrameStream.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QImage>
+
+FrameStream::FrameStream(const QString &channel, QObject *parent)
+    : QObject(parent)
+    , m_channel(channel)
+{
+    // Checking the published counter is a single atomic load, so a short
+    // precise interval keeps frame latency low without measurable cost.
+    m_pollTimer.setTimerType(Qt::PreciseTimer);
+    m_pollTimer.setInterval(4);
+    connect(&m_pollTimer, &QTimer::timeout, this, &FrameStream::poll);
+}
+
+FrameStream::~FrameStream()
+{
+    close();
+}
+
+void FrameStream::setVideoSink(QVideoSink *sink)
+{
+    if (m_videoSink == sink) {
+        return;
+    }
+
+    m_videoSink = sink;
+    emit videoSinkChanged();
+
+    // A page that is pushed again should show the latest frame right away
+    if (m_videoSink && m_currentFrame.isValid()) {
+        m_videoSink->setVideoFrame(m_currentFrame);
+    }
+}
+
+bool FrameStream::open()
+{
+    close();
+
+    const QString name = QString("/neurodrive-%1-%2")
+            .arg(QCoreApplication::applicationPid())
+            .arg(m_channel);
+    if (!m_ring.create(name, SlotCount, SlotCapacity)) {
+        qWarning() << "FrameStream" << m_channel << "could not create ring:" << m_ring.errorString();
+        emit streamError(m_ring.errorString());
+        return false;
+    }
+
+    m_lastPublished = 0;
+    if (m_framesReceived != 0) {
+        m_framesReceived = 0;
+        emit framesReceivedChanged(m_framesReceived);
+    }
+
+    m_pollTimer.start();
+    setActive(true);
+    return true;
+}
+
+void FrameStream::close()
+{
+    m_pollTimer.stop();
+    m_ring.destroy();
+    setActive(false);
+}
+
+void FrameStream::clear()
+{
+    if (!m_currentFrame.isValid()) {
+        return;
+    }
+
+    m_currentFrame = QVideoFrame();
+    if (m_videoSink) {
+        m_videoSink->setVideoFrame(QVideoFrame());
+    }
+    emit hasFrameChanged(false);
+    clearAnnotations();
+}
+
+void FrameStream::setDetections(const QList<Detection> &detections, const QStringList &labels)
+{
+    // Workers report every frame, mostly with nothing in it
+    if (detections.isEmpty() && m_detections.isEmpty()) {
+        return;
+    }
+    m_detections = detections;
+    m_detectionLabels = labels;
+    emit annotationsChanged();
+}
+
+void FrameStream::setLanes(const QList<QPolygonF> &lanes)
+{
+    if (lanes.isEmpty() && m_lanes.isEmpty()) {
+        return;
+    }
+    m_lanes = lanes;
+    emit annotationsChanged();
+}
+
+void FrameStream::setAlertText(const QString &text)
+{
+    if (m_alertText != text) {
+        m_alertText = text;
+        emit annotationsChanged();
+    }
+}
+
+void FrameStream::clearAnnotations()
+{
+    if (m_detections.isEmpty() && m_lanes.isEmpty() && m_alertText.isEmpty()) {
+        return;
+    }
+    m_detections.clear();
+    m_detectionLabels.clear();
+    m_lanes.clear();
+    m_alertText.clear();
+    emit annotationsChanged();
+}
+
+void FrameStream::poll()
+{
+    const quint64 published = m_ring.publishedCount();
+    if (published == m_lastPublished) {
+        return;
+    }
+
+    quint64 frameIndex = 0;
+    quint64 timestampNs = 0;
+    QImage image = m_ring.acquireLatest(&frameIndex, &timestampNs);
+    if (image.isNull()) {
+        // The worker is mid-write on the newest slot; pick it up next tick
+        return;
+    }
+    m_lastPublished = published;
+
+    // The QImage wraps the shared-memory slot, so this hands the pixels to the
+    // sink without copying them; the slot is unpinned once Qt lets go of it.
+    QVideoFrame frame(image);
+    frame.setStartTime(qint64(timestampNs / 1000));
+    showFrame(frame, qint64(frameIndex));
+}
+
+void FrameStream::present(const QVideoFrame &frame, qint64 frameIndex)
+{
+    if (frame.isValid()) {
+        showFrame(frame, frameIndex);
+    }
+}
+
+void FrameStream::showFrame(const QVideoFrame &frame, qint64 frameIndex)
+{
+    const bool hadFrame = m_currentFrame.isValid();
+    m_currentFrame = frame;
+    if (m_currentFrame.size() != m_frameSize) {
+        m_frameSize = m_currentFrame.size();
+        emit frameSizeChanged();
+    }
+    if (m_videoSink) {
+        m_videoSink->setVideoFrame(m_currentFrame);
+    }
+
+    ++m_framesReceived;
+    emit framesReceivedChanged(m_framesReceived);
+    emit frameReceived(frameIndex);
+    if (!hadFrame) {
+        emit hasFrameChanged(true);
+    }
+}
+
+void FrameStream::setActive(bool active)
+{
+    if (m_active != active) {
+        m_active = active;
+        emit activeChanged(m_active);
+    }
+}
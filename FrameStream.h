@@ -0,0 +1,105 @@
+#ifndef FRAMESTREAM_H
+#define FRAMESTREAM_H
+
+#include <QObject>
+#include <QPointer>
+#include <QPolygonF>
+#include <QSize>
+#include <QStringList>
+#include <QTimer>
+#include <QVideoFrame>
+#include <QVideoSink>
+#include <QtQml/qqmlregistration.h>
+#include "FrameRing.h"
+#include "WorkerChannel.h"
+
+// Live view of one camera channel. Owns the shared-memory ring a worker
+// publishes into and forwards each new frame to the VideoOutput sink set from QML.
+// The detections and lanes reported for the channel are kept here as data and
+// drawn over the video by DetectionOverlay.
+class FrameStream : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("FrameStream instances are owned by ProcessManager")
+    Q_PROPERTY(QVideoSink *videoSink READ videoSink WRITE setVideoSink NOTIFY videoSinkChanged)
+    Q_PROPERTY(bool active READ isActive NOTIFY activeChanged)
+    Q_PROPERTY(bool hasFrame READ hasFrame NOTIFY hasFrameChanged)
+    Q_PROPERTY(int framesReceived READ framesReceived NOTIFY framesReceivedChanged)
+    Q_PROPERTY(QSize frameSize READ frameSize NOTIFY frameSizeChanged)
+    Q_PROPERTY(QString alertText READ alertText NOTIFY annotationsChanged)
+
+public:
+    explicit FrameStream(const QString &channel, QObject *parent = nullptr);
+    ~FrameStream();
+
+    // Ring geometry; large enough for a 1280x720 BGRX frame per slot
+    static constexpr int SlotCount = 4;
+    static constexpr quint32 SlotCapacity = 1280 * 720 * 4;
+
+    QVideoSink *videoSink() const { return m_videoSink; }
+    void setVideoSink(QVideoSink *sink);
+
+    bool isActive() const { return m_active; }
+    bool hasFrame() const { return m_currentFrame.isValid(); }
+    QVideoFrame currentFrame() const { return m_currentFrame; }
+    int framesReceived() const { return m_framesReceived; }
+    QSize frameSize() const { return m_frameSize; }
+
+    QString channel() const { return m_channel; }
+    QString ringName() const { return m_ring.name(); }
+
+    // Creates a fresh ring and starts watching it for frames
+    bool open();
+    // Stops watching and releases the ring; the last frame stays on screen
+    void close();
+    // Drops the last frame so the view goes blank
+    void clear();
+    // Shows a frame produced in-process rather than by a worker
+    void present(const QVideoFrame &frame, qint64 frameIndex);
+
+    // Annotations of the latest processed frame, in frame pixel coordinates
+    const QList<Detection> &detections() const { return m_detections; }
+    const QStringList &detectionLabels() const { return m_detectionLabels; }
+    const QList<QPolygonF> &lanes() const { return m_lanes; }
+    QString alertText() const { return m_alertText; }
+    // labels holds the class name of each detection
+    void setDetections(const QList<Detection> &detections, const QStringList &labels);
+    void setLanes(const QList<QPolygonF> &lanes);
+    void setAlertText(const QString &text);
+    void clearAnnotations();
+
+signals:
+    void videoSinkChanged();
+    void activeChanged(bool active);
+    void hasFrameChanged(bool hasFrame);
+    void framesReceivedChanged(int count);
+    void frameSizeChanged();
+    void annotationsChanged();
+    void frameReceived(qint64 frameIndex);
+    void streamError(const QString &error);
+
+private slots:
+    void poll();
+
+private:
+    void setActive(bool active);
+    void showFrame(const QVideoFrame &frame, qint64 frameIndex);
+
+    QString m_channel;
+    FrameRing m_ring;
+    QTimer m_pollTimer;
+    QPointer<QVideoSink> m_videoSink;
+    QVideoFrame m_currentFrame;
+    quint64 m_lastPublished = 0;
+    int m_framesReceived = 0;
+    QSize m_frameSize;
+
+    QList<Detection> m_detections;
+    QStringList m_detectionLabels;
+    QList<QPolygonF> m_lanes;
+    QString m_alertText;
+    bool m_active = false;
+};
+
+#endif // FRAMESTREAM_H
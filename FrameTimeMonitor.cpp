@@ -0,0 +1,70 @@
+#include "FrameTimeMonitor.h"
+#include "PerfLog.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <QQuickWindow>
+#include <QScreen>
+
+#include <algorithm>
+#include <utility>
+
+FrameTimeMonitor::FrameTimeMonitor(QQuickWindow *window, QObject *parent)
+    : QObject(parent)
+    , m_window(window)
+{
+    m_clock.start();
+    m_intervalsMs.reserve(1024);
+
+    // Direct, so the interval is measured where the frame is presented
+    connect(window, &QQuickWindow::frameSwapped, this, &FrameTimeMonitor::frameSwapped, Qt::DirectConnection);
+
+    m_reportTimer.setInterval(ReportIntervalMs);
+    connect(&m_reportTimer, &QTimer::timeout, this, &FrameTimeMonitor::report);
+    m_reportTimer.start();
+}
+
+void FrameTimeMonitor::mark(const QString &note)
+{
+    QMutexLocker locker(&m_mutex);
+    m_notes.append(note);
+}
+
+void FrameTimeMonitor::frameSwapped()
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    QMutexLocker locker(&m_mutex);
+    const double intervalMs = double(now - m_lastSwapNs) / 1e6;
+    if (m_lastSwapNs >= 0 && intervalMs < IdleGapMs) {
+        m_intervalsMs.append(float(intervalMs));
+    }
+    m_lastSwapNs = now;
+}
+
+void FrameTimeMonitor::report()
+{
+    QVector<float> intervals;
+    QStringList notes;
+    {
+        QMutexLocker locker(&m_mutex);
+        intervals = std::exchange(m_intervalsMs, {});
+        m_intervalsMs.reserve(intervals.size());
+        notes = std::exchange(m_notes, {});
+    }
+    if (intervals.size() < 2) {
+        return;
+    }
+
+    std::sort(intervals.begin(), intervals.end());
+    const float p50 = intervals[intervals.size() / 2];
+    const float p95 = intervals[qMin(intervals.size() - 1, qsizetype(double(intervals.size()) * 0.95))];
+    const float worst = intervals.last();
+
+    const double refreshRate = m_window && m_window->screen() ? m_window->screen()->refreshRate() : 60.0;
+    const double budgetMs = 1000.0 / (refreshRate > 0.0 ? refreshRate : 60.0);
+    const qsizetype janky = intervals.end() - std::upper_bound(intervals.begin(), intervals.end(), float(2.0 * budgetMs));
+
+    qDebug().nospace() << "FrameTimeMonitor: " << intervals.size() << " frames, p50 " << p50 << " ms, p95 " << p95
+                       << " ms, max " << worst << " ms, " << janky << " over " << 2.0 * budgetMs << " ms"
+                       << (notes.isEmpty() ? QString() : " after " + notes.join("; "));
+    PerfLog::record("ui.frame_interval_p95", p95, "ms", {{"p50", p50}, {"max", worst}, {"janky", janky}});
+}
@@ -0,0 +1,45 @@
+#ifndef FRAMETIMEMONITOR_H
+#define FRAMETIMEMONITOR_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+class QQuickWindow;
+
+// Logs the window's frame intervals once per report period (p50, p95, max
+// and the frames over twice the display interval), so the effect of worker
+// load and resource policies on the dashboard's smoothness shows in the log.
+// Intervals are taken on the render thread at each frameSwapped.
+class FrameTimeMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int ReportIntervalMs = 10000;
+    // Longer gaps are a scene with nothing to redraw, not a slow frame
+    static constexpr double IdleGapMs = 250.0;
+
+    explicit FrameTimeMonitor(QQuickWindow *window, QObject *parent = nullptr);
+
+    // Tags the next report, e.g. with the resource policy just applied
+    void mark(const QString &note);
+
+private:
+    void frameSwapped();
+    void report();
+
+    QPointer<QQuickWindow> m_window;
+    QMutex m_mutex;
+    QElapsedTimer m_clock;
+    qint64 m_lastSwapNs = -1;
+    QVector<float> m_intervalsMs;  // Since the last report
+    QStringList m_notes;
+    QTimer m_reportTimer;
+};
+
+#endif // FRAMETIMEMONITOR_H
@@ -0,0 +1,175 @@
+#include "LaneDetectionEngine.h"
+#include "FramePool.h"
+#include "FrameSource.h"
+#include <QDebug>
+#include <QImage>
+
+namespace {
+
+// Maps a lane from the detector's 600x600 frame back onto the decoded frame
+QPolygonF toPolygon(const LaneDetector::Lane &lane, double scaleX, double scaleY)
+{
+    return QPolygonF({ QPointF(lane.line.x1 * scaleX, lane.line.y1 * scaleY),
+                       QPointF(lane.line.x2 * scaleX, lane.line.y2 * scaleY) });
+}
+
+} // namespace
+
+LaneDetectionEngine::LaneDetectionEngine(QObject *parent)
+    : QObject(parent)
+    , m_workerContext(new QObject)
+    , m_queue("lane", m_workerContext, [this](PendingFrame &pending) { processFrame(pending); })
+{
+    m_queue.setPolicy(FrameQueueBase::configuredPolicy("lane"));
+    m_thread.setObjectName("LaneDetection");
+    m_workerContext->moveToThread(&m_thread);
+    m_thread.start();
+}
+
+LaneDetectionEngine::~LaneDetectionEngine()
+{
+    ++m_generation;
+    m_thread.quit();
+    m_thread.wait();  // At most the frame in flight
+    delete m_workerContext;
+}
+
+double LaneDetectionEngine::averageLatencyMs() const
+{
+    return m_framesProcessed > 0 ? m_totalLatencyMs / double(m_framesProcessed) : 0.0;
+}
+
+void LaneDetectionEngine::start(FrameSource *source)
+{
+    stop();
+
+    ++m_generation;
+    m_running = true;
+    m_startReported = false;
+    m_framesReceived = 0;
+    m_framesProcessed = 0;
+    m_framesDropped = 0;
+    m_expectedFrames = 0;
+    m_fps = 0.0;
+    m_totalLatencyMs = 0.0;
+    m_lastFrameTimer.invalidate();
+
+    QMetaObject::invokeMethod(m_workerContext, [this]() { m_detector.reset(); });
+
+    m_source = source;
+    connect(source, &FrameSource::started, this, [this](qint64 expectedFrames, double fps) {
+        m_expectedFrames = expectedFrames;
+        if (!m_startReported) {
+            m_startReported = true;
+            emit started(expectedFrames, fps);
+        }
+    });
+    connect(source, &FrameSource::frameDecoded, this, &LaneDetectionEngine::handleVideoFrame);
+    connect(source, &FrameSource::finished, this, &LaneDetectionEngine::finishWhenIdle);
+    connect(source, &FrameSource::errorOccurred, this, [this](const QString &message) {
+        if (m_running) {
+            stop();
+            emit errorOccurred(message);
+        }
+    });
+}
+
+void LaneDetectionEngine::stop()
+{
+    if (!m_running) {
+        return;
+    }
+    // Results still in flight belong to the old generation and are dropped
+    ++m_generation;
+    m_running = false;
+    m_queue.clear();
+    // The source is shared with the other models, so it is left running
+    if (m_source) {
+        m_source->disconnect(this);
+    }
+    m_source = nullptr;
+}
+
+void LaneDetectionEngine::handleVideoFrame(const QVideoFrame &frame, qint64 frameIndex)
+{
+    if (!m_running || !frame.isValid()) {
+        return;
+    }
+
+    ++m_framesReceived;
+    emit frameDecoded(frame, frameIndex);
+    if (!m_queue.push({ frame, frameIndex, m_generation })) {
+        ++m_framesDropped;
+    }
+}
+
+void LaneDetectionEngine::processFrame(const PendingFrame &pending)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // lane.py resizes every frame to 600x600 before processing
+    const QImage image = FramePool::instance().convert(
+                pending.frame, QSize(LaneDetector::FrameWidth, LaneDetector::FrameHeight), QImage::Format_RGB32);
+    if (image.isNull()) {
+        return;  // Over the pool's budget; the frame is dropped
+    }
+
+    const LaneDetector::Result &result = m_detector.detect(
+                reinterpret_cast<const std::uint32_t *>(image.constBits()), int(image.bytesPerLine()));
+    const double scaleX = double(pending.frame.width()) / LaneDetector::FrameWidth;
+    const double scaleY = double(pending.frame.height()) / LaneDetector::FrameHeight;
+    QList<QPolygonF> lanes;
+    for (const LaneDetector::Lane *lane : { &result.left, &result.right }) {
+        if (lane->valid) {
+            lanes.append(toPolygon(*lane, scaleX, scaleY));
+        }
+    }
+    const double latencyMs = double(timer.nsecsElapsed()) / 1e6;
+
+    const quint64 generation = pending.generation;
+    const qint64 frameIndex = pending.frameIndex;
+    QMetaObject::invokeMethod(this, [this, generation, frameIndex, latencyMs, lanes]() {
+        handleResult(generation, frameIndex, latencyMs, lanes);
+    });
+}
+
+void LaneDetectionEngine::handleResult(quint64 generation, qint64 frameIndex, double latencyMs,
+                                       const QList<QPolygonF> &lanes)
+{
+    if (generation != m_generation) {
+        return;
+    }
+
+    // Same EWMA as WorkerEvents.frame() in worker_ipc.py
+    if (m_lastFrameTimer.isValid()) {
+        const qint64 elapsed = m_lastFrameTimer.nsecsElapsed();
+        if (elapsed > 0) {
+            const double instant = 1e9 / double(elapsed);
+            m_fps = m_fps == 0.0 ? instant : 0.9 * m_fps + 0.1 * instant;
+        }
+    }
+    m_lastFrameTimer.start();
+
+    ++m_framesProcessed;
+    m_totalLatencyMs += latencyMs;
+    emit lanesDetected(frameIndex, lanes);
+    emit frameProcessed(frameIndex, m_fps, latencyMs);
+}
+
+void LaneDetectionEngine::finishWhenIdle()
+{
+    // Queue behind the frame in flight, if any, so its result arrives first
+    const quint64 generation = m_generation;
+    QMetaObject::invokeMethod(m_workerContext, [this, generation]() {
+        QMetaObject::invokeMethod(this, [this, generation]() {
+            if (generation != m_generation || !m_running) {
+                return;
+            }
+            m_running = false;
+            qDebug() << "LaneDetectionEngine:" << m_framesProcessed << "frames," << averageLatencyMs()
+                     << "ms/frame," << m_framesDropped << "dropped";
+            emit finished(m_framesProcessed);
+        });
+    });
+}
@@ -0,0 +1,86 @@
+#ifndef LANEDETECTIONENGINE_H
+#define LANEDETECTIONENGINE_H
+
+#include <QObject>
+#include <QPointer>
+#include <QPolygonF>
+#include <QThread>
+#include <QVideoFrame>
+#include <QElapsedTimer>
+#include "FrameQueue.h"
+#include "LaneDetector.h"
+
+class FrameSource;
+
+// Runs LaneDetector in-process in place of lane.py. Frames come from a shared
+// FrameSource at the video's native frame rate and every frame is shown as is;
+// a frame is also handed to a worker thread for detection through the "lane"
+// FrameQueue, by default only once the previous one is done. Lanes are
+// reported as data for the overlay.
+class LaneDetectionEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LaneDetectionEngine(QObject *parent = nullptr);
+    ~LaneDetectionEngine();
+
+    bool isRunning() const { return m_running; }
+    qint64 framesDecoded() const { return m_framesReceived; }
+    qint64 framesProcessed() const { return m_framesProcessed; }
+    qint64 expectedFrames() const { return m_expectedFrames; }
+    qint64 framesDropped() const { return m_framesDropped; }
+    double fps() const { return m_fps; }
+    double averageLatencyMs() const;
+    // Back-pressure of the hand-off to the worker thread
+    void setQueuePolicy(const FrameQueueBase::Policy &policy) { m_queue.setPolicy(policy); }
+
+public slots:
+    // The caller starts the source once every consumer is attached
+    void start(FrameSource *source);
+    void stop();
+
+signals:
+    void started(qint64 expectedFrames, double fps);
+    // Every decoded frame, whether or not it is processed
+    void frameDecoded(const QVideoFrame &frame, qint64 frameIndex);
+    void frameProcessed(qint64 frameIndex, double fps, double latencyMs);
+    // Lane polylines in the decoded frame's pixel coordinates, left lane first
+    void lanesDetected(qint64 frameIndex, const QList<QPolygonF> &lanes);
+    void finished(qint64 framesProcessed);
+    void errorOccurred(const QString &message);
+
+private:
+    struct PendingFrame
+    {
+        QVideoFrame frame;
+        qint64 frameIndex = 0;
+        quint64 generation = 0;
+    };
+
+    void handleVideoFrame(const QVideoFrame &frame, qint64 frameIndex);
+    void processFrame(const PendingFrame &pending);
+    void handleResult(quint64 generation, qint64 frameIndex, double latencyMs, const QList<QPolygonF> &lanes);
+    void finishWhenIdle();
+
+    QPointer<FrameSource> m_source;
+    QThread m_thread;
+    QObject *m_workerContext;
+    FrameQueue<PendingFrame> m_queue;
+
+    // Only touched on the worker thread
+    LaneDetector m_detector;
+
+    quint64 m_generation = 0;
+    bool m_running = false;
+    bool m_startReported = false;
+    qint64 m_framesReceived = 0;
+    qint64 m_framesProcessed = 0;
+    qint64 m_framesDropped = 0;
+    qint64 m_expectedFrames = 0;
+    double m_fps = 0.0;
+    double m_totalLatencyMs = 0.0;
+    QElapsedTimer m_lastFrameTimer;
+};
+
+#endif // LANEDETECTIONENGINE_H
@@ -0,0 +1,502 @@
+#include "LaneDetector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// OpenCV's BORDER_REFLECT_101, used by GaussianBlur
+inline int reflect101(int index, int size)
+{
+    if (index < 0) {
+        return -index;
+    }
+    if (index >= size) {
+        return 2 * size - 2 - index;
+    }
+    return index;
+}
+
+// cv::RNG with its default seed, so HoughLinesP visits points in the same order
+class HoughRng
+{
+public:
+    std::uint32_t next()
+    {
+        m_state = std::uint64_t(std::uint32_t(m_state)) * 4164903690U + std::uint32_t(m_state >> 32);
+        return std::uint32_t(m_state);
+    }
+
+    int uniform(int count) { return int(next() % std::uint32_t(count)); }
+
+private:
+    std::uint64_t m_state = ~std::uint64_t(0);
+};
+
+// tan(22.5 degrees) in Q15, as in cv::Canny
+constexpr int CannyShift = 15;
+constexpr int Tan22 = 13573;
+
+} // namespace
+
+LaneDetector::LaneDetector(int width, int height)
+    : m_width(width)
+    , m_height(height)
+    , m_roiTop(height / 2 + 50)
+{
+    const size_t pixels = size_t(width) * size_t(height);
+    const size_t paddedPixels = size_t(width + 2) * size_t(height + 2);
+    m_gray.resize(pixels);
+    m_rowSums.resize(pixels);
+    m_blur.resize(pixels);
+    m_padded.resize(paddedPixels);
+    m_dx.resize(pixels);
+    m_dy.resize(pixels);
+    m_magnitude.resize(paddedPixels);
+    m_edgeMap.resize(paddedPixels);
+    m_edges.resize(pixels);
+    m_houghMask.resize(pixels);
+    m_stack.reserve(pixels / 8);
+    m_points.reserve(pixels / 16);
+
+    // rho = 1 px, theta = 1 degree; theta is a float inside HoughLinesP
+    const float theta = float(M_PI / 180.0);
+    const int angles = int(std::lrint(M_PI / theta));
+    m_trig.resize(size_t(angles) * 2);
+    for (int n = 0; n < angles; ++n) {
+        m_trig[size_t(n) * 2] = float(std::cos(double(n) * theta));
+        m_trig[size_t(n) * 2 + 1] = float(std::sin(double(n) * theta));
+    }
+    const int rhos = int(std::lrint(double((width + height) * 2 + 1)));
+    m_accumulator.resize(size_t(angles) * size_t(rhos));
+
+    m_result.roiTop = m_roiTop;
+    m_result.segments.reserve(64);
+}
+
+void LaneDetector::reset()
+{
+    m_leftFits.clear();
+    m_rightFits.clear();
+    m_result = Result();
+    m_result.roiTop = m_roiTop;
+}
+
+const LaneDetector::Result &LaneDetector::detect(const std::uint32_t *pixels, int bytesPerLine)
+{
+    toGray(pixels, bytesPerLine);
+    gaussianBlur();
+    canny();
+    maskRegionOfInterest();
+    houghLinesP();
+    fitLanes();
+    return m_result;
+}
+
+void LaneDetector::toGray(const std::uint32_t *pixels, int bytesPerLine)
+{
+    // cv::COLOR_BGR2GRAY fixed point: 0.299 R + 0.587 G + 0.114 B in Q15
+    for (int y = 0; y < m_height; ++y) {
+        const std::uint32_t *row = reinterpret_cast<const std::uint32_t *>(
+                    reinterpret_cast<const std::uint8_t *>(pixels) + size_t(y) * size_t(bytesPerLine));
+        std::uint8_t *out = m_gray.data() + size_t(y) * size_t(m_width);
+        for (int x = 0; x < m_width; ++x) {
+            const std::uint32_t p = row[x];
+            const std::uint32_t r = (p >> 16) & 0xff;
+            const std::uint32_t g = (p >> 8) & 0xff;
+            const std::uint32_t b = p & 0xff;
+            out[x] = std::uint8_t((r * 9798 + g * 19235 + b * 3735 + 16384) >> 15);
+        }
+    }
+}
+
+void LaneDetector::gaussianBlur()
+{
+    // 5x5 with sigma 0 is OpenCV's fixed [1 4 6 4 1] / 16 kernel, applied separably
+    const int w = m_width;
+    const int h = m_height;
+
+    for (int y = 0; y < h; ++y) {
+        const std::uint8_t *src = m_gray.data() + size_t(y) * size_t(w);
+        std::uint16_t *sums = m_rowSums.data() + size_t(y) * size_t(w);
+
+        for (int x = 0; x < std::min(2, w); ++x) {
+            sums[x] = std::uint16_t(src[reflect101(x - 2, w)] + 4 * src[reflect101(x - 1, w)] + 6 * src[x]
+                                    + 4 * src[reflect101(x + 1, w)] + src[reflect101(x + 2, w)]);
+        }
+        for (int x = 2; x < w - 2; ++x) {
+            sums[x] = std::uint16_t(src[x - 2] + 4 * src[x - 1] + 6 * src[x] + 4 * src[x + 1] + src[x + 2]);
+        }
+        for (int x = std::max(2, w - 2); x < w; ++x) {
+            sums[x] = std::uint16_t(src[reflect101(x - 2, w)] + 4 * src[reflect101(x - 1, w)] + 6 * src[x]
+                                    + 4 * src[reflect101(x + 1, w)] + src[reflect101(x + 2, w)]);
+        }
+    }
+
+    for (int y = 0; y < h; ++y) {
+        const std::uint16_t *r0 = m_rowSums.data() + size_t(reflect101(y - 2, h)) * size_t(w);
+        const std::uint16_t *r1 = m_rowSums.data() + size_t(reflect101(y - 1, h)) * size_t(w);
+        const std::uint16_t *r2 = m_rowSums.data() + size_t(y) * size_t(w);
+        const std::uint16_t *r3 = m_rowSums.data() + size_t(reflect101(y + 1, h)) * size_t(w);
+        const std::uint16_t *r4 = m_rowSums.data() + size_t(reflect101(y + 2, h)) * size_t(w);
+        std::uint8_t *out = m_blur.data() + size_t(y) * size_t(w);
+        for (int x = 0; x < w; ++x) {
+            const std::uint32_t sum = std::uint32_t(r0[x]) + 4u * r1[x] + 6u * r2[x] + 4u * r3[x] + r4[x];
+            out[x] = std::uint8_t((sum + 128) >> 8);
+        }
+    }
+}
+
+void LaneDetector::canny()
+{
+    const int w = m_width;
+    const int h = m_height;
+    const int pw = w + 2;
+
+    // Sobel 3x3 with BORDER_REPLICATE; padding once keeps the inner loops branch free
+    for (int y = 0; y < h + 2; ++y) {
+        const std::uint8_t *src = m_blur.data() + size_t(std::clamp(y - 1, 0, h - 1)) * size_t(w);
+        std::uint8_t *dst = m_padded.data() + size_t(y) * size_t(pw);
+        dst[0] = src[0];
+        std::memcpy(dst + 1, src, size_t(w));
+        dst[w + 1] = src[w - 1];
+    }
+
+    for (int y = 0; y < h; ++y) {
+        const std::uint8_t *above = m_padded.data() + size_t(y) * size_t(pw);
+        const std::uint8_t *row = above + pw;
+        const std::uint8_t *below = row + pw;
+        std::int16_t *dx = m_dx.data() + size_t(y) * size_t(w);
+        std::int16_t *dy = m_dy.data() + size_t(y) * size_t(w);
+        std::int32_t *magnitude = m_magnitude.data() + size_t(y + 1) * size_t(pw) + 1;
+        for (int x = 0; x < w; ++x) {
+            const int gx = (above[x + 2] + 2 * row[x + 2] + below[x + 2]) - (above[x] + 2 * row[x] + below[x]);
+            const int gy = (below[x] + 2 * below[x + 1] + below[x + 2]) - (above[x] + 2 * above[x + 1] + above[x + 2]);
+            dx[x] = std::int16_t(gx);
+            dy[x] = std::int16_t(gy);
+            magnitude[x] = std::abs(gx) + std::abs(gy);  // L1 gradient, cv::Canny's default
+        }
+    }
+
+    // Zero magnitude around the image and a "not an edge" border in the map
+    std::fill_n(m_magnitude.data(), pw, 0);
+    std::fill_n(m_magnitude.data() + size_t(h + 1) * size_t(pw), pw, 0);
+    for (int y = 1; y <= h; ++y) {
+        m_magnitude[size_t(y) * size_t(pw)] = 0;
+        m_magnitude[size_t(y) * size_t(pw) + size_t(w + 1)] = 0;
+    }
+    std::fill(m_edgeMap.begin(), m_edgeMap.end(), std::uint8_t(1));
+
+    // Non-maximum suppression. Map values: 0 maybe an edge, 1 not an edge, 2 edge
+    m_stack.clear();
+    for (int y = 0; y < h; ++y) {
+        const std::int32_t *magAbove = m_magnitude.data() + size_t(y) * size_t(pw) + 1;
+        const std::int32_t *mag = magAbove + pw;
+        const std::int32_t *magBelow = mag + pw;
+        const std::int16_t *dx = m_dx.data() + size_t(y) * size_t(w);
+        const std::int16_t *dy = m_dy.data() + size_t(y) * size_t(w);
+        std::uint8_t *map = m_edgeMap.data() + size_t(y + 1) * size_t(pw) + 1;
+
+        for (int x = 0; x < w; ++x) {
+            const int m = mag[x];
+            if (m <= CannyLow) {
+                continue;
+            }
+
+            const int xs = dx[x];
+            const int ys = dy[x];
+            const int ax = std::abs(xs);
+            const int ay = std::abs(ys) << CannyShift;
+            const int tg22x = ax * Tan22;
+            bool isMaximum;
+            if (ay < tg22x) {
+                isMaximum = m > mag[x - 1] && m >= mag[x + 1];
+            } else {
+                const int tg67x = tg22x + (ax << (CannyShift + 1));
+                if (ay > tg67x) {
+                    isMaximum = m > magAbove[x] && m >= magBelow[x];
+                } else {
+                    const int s = (xs ^ ys) < 0 ? -1 : 1;
+                    isMaximum = m > magAbove[x - s] && m > magBelow[x + s];
+                }
+            }
+
+            if (!isMaximum) {
+                continue;
+            }
+            if (m > CannyHigh) {
+                map[x] = 2;
+                m_stack.push_back(std::int32_t((y + 1) * pw + x + 1));
+            } else {
+                map[x] = 0;
+            }
+        }
+    }
+
+    // Hysteresis: grow strong edges through connected weak ones
+    const std::int32_t offsets[8] = { -pw - 1, -pw, -pw + 1, -1, 1, pw - 1, pw, pw + 1 };
+    while (!m_stack.empty()) {
+        const std::int32_t index = m_stack.back();
+        m_stack.pop_back();
+        for (std::int32_t offset : offsets) {
+            std::uint8_t &neighbour = m_edgeMap[size_t(index + offset)];
+            if (neighbour == 0) {
+                neighbour = 2;
+                m_stack.push_back(index + offset);
+            }
+        }
+    }
+
+    for (int y = 0; y < h; ++y) {
+        const std::uint8_t *map = m_edgeMap.data() + size_t(y + 1) * size_t(pw) + 1;
+        std::uint8_t *out = m_edges.data() + size_t(y) * size_t(w);
+        for (int x = 0; x < w; ++x) {
+            out[x] = map[x] == 2 ? 255 : 0;
+        }
+    }
+}
+
+void LaneDetector::maskRegionOfInterest()
+{
+    // Trapezoid (0, h), (w/2 - 50, roiTop), (w/2 + 50, roiTop), (w, h)
+    const int w = m_width;
+    const int h = m_height;
+    const double leftTopX = w / 2 - 50;
+    const double rightTopX = w / 2 + 50;
+    const double span = double(h - m_roiTop);
+
+    std::fill_n(m_edges.data(), size_t(std::max(0, m_roiTop)) * size_t(w), std::uint8_t(0));
+    for (int y = std::max(0, m_roiTop); y < h; ++y) {
+        const double t = span > 0.0 ? double(h - y) / span : 0.0;
+        const int left = int(std::floor(leftTopX * t));
+        const int right = int(std::ceil(w - (w - rightTopX) * t));
+        std::uint8_t *row = m_edges.data() + size_t(y) * size_t(w);
+        if (left > 0) {
+            std::fill_n(row, size_t(std::min(left, w)), std::uint8_t(0));
+        }
+        if (right < w - 1) {
+            const int from = std::max(0, right + 1);
+            std::fill_n(row + from, size_t(w - from), std::uint8_t(0));
+        }
+    }
+}
+
+void LaneDetector::houghLinesP()
+{
+    // Same walk as cv::HoughLinesP(rho=1, theta=pi/180, threshold=30, minLineLength=40, maxLineGap=50)
+    const int w = m_width;
+    const int h = m_height;
+    const int angles = int(m_trig.size() / 2);
+    const int rhos = int(m_accumulator.size() / size_t(angles));
+    const int rhoOffset = (rhos - 1) / 2;
+    const int shift = 16;
+
+    std::fill(m_accumulator.begin(), m_accumulator.end(), 0);
+    m_points.clear();
+    for (int y = 0; y < h; ++y) {
+        const std::uint8_t *row = m_edges.data() + size_t(y) * size_t(w);
+        std::uint8_t *mask = m_houghMask.data() + size_t(y) * size_t(w);
+        for (int x = 0; x < w; ++x) {
+            mask[x] = row[x] ? 1 : 0;
+            if (row[x]) {
+                m_points.push_back(y * w + x);
+            }
+        }
+    }
+
+    auto vote = [this, angles, rhos, rhoOffset](int x, int y, int delta) {
+        std::int32_t *accumulator = m_accumulator.data();
+        for (int n = 0; n < angles; ++n, accumulator += rhos) {
+            const int r = int(std::lrint(float(x) * m_trig[size_t(n) * 2] + float(y) * m_trig[size_t(n) * 2 + 1]));
+            accumulator[r + rhoOffset] += delta;
+        }
+    };
+
+    m_result.segments.clear();
+    HoughRng rng;
+    for (int count = int(m_points.size()); count > 0; --count) {
+        const int pick = rng.uniform(count);
+        const int point = m_points[size_t(pick)];
+        m_points[size_t(pick)] = m_points[size_t(count - 1)];
+
+        const int px = point % w;
+        const int py = point / w;
+        if (!m_houghMask[size_t(point)]) {
+            continue;  // Already part of a line
+        }
+
+        // Vote and find the strongest line through this point
+        int maxVotes = HoughThreshold - 1;
+        int maxAngle = 0;
+        std::int32_t *accumulator = m_accumulator.data();
+        for (int n = 0; n < angles; ++n, accumulator += rhos) {
+            const int r = int(std::lrint(float(px) * m_trig[size_t(n) * 2] + float(py) * m_trig[size_t(n) * 2 + 1]));
+            const int votes = ++accumulator[r + rhoOffset];
+            if (maxVotes < votes) {
+                maxVotes = votes;
+                maxAngle = n;
+            }
+        }
+        if (maxVotes < HoughThreshold) {
+            continue;
+        }
+
+        // Walk both ways along the line in fixed point, tolerating gaps
+        const float a = -m_trig[size_t(maxAngle) * 2 + 1];
+        const float b = m_trig[size_t(maxAngle) * 2];
+        int x0 = px;
+        int y0 = py;
+        int dx0;
+        int dy0;
+        const bool xMajor = std::fabs(a) > std::fabs(b);
+        if (xMajor) {
+            dx0 = a > 0 ? 1 : -1;
+            dy0 = int(std::lrint(b * float(1 << shift) / std::fabs(a)));
+            y0 = (y0 << shift) + (1 << (shift - 1));
+        } else {
+            dy0 = b > 0 ? 1 : -1;
+            dx0 = int(std::lrint(a * float(1 << shift) / std::fabs(b)));
+            x0 = (x0 << shift) + (1 << (shift - 1));
+        }
+
+        int endX[2] = { px, px };
+        int endY[2] = { py, py };
+        for (int k = 0; k < 2; ++k) {
+            int gap = 0;
+            int x = x0;
+            int y = y0;
+            const int dx = k ? -dx0 : dx0;
+            const int dy = k ? -dy0 : dy0;
+            for (;; x += dx, y += dy) {
+                const int cx = xMajor ? x : x >> shift;
+                const int cy = xMajor ? y >> shift : y;
+                if (cx < 0 || cx >= w || cy < 0 || cy >= h) {
+                    break;
+                }
+                if (m_houghMask[size_t(cy) * size_t(w) + size_t(cx)]) {
+                    gap = 0;
+                    endX[k] = cx;
+                    endY[k] = cy;
+                } else if (++gap > HoughMaxLineGap) {
+                    break;
+                }
+            }
+        }
+
+        const bool goodLine = std::abs(endX[1] - endX[0]) >= HoughMinLineLength
+                || std::abs(endY[1] - endY[0]) >= HoughMinLineLength;
+
+        // Take the line's pixels out of play, and out of the accumulator if it is kept
+        for (int k = 0; k < 2; ++k) {
+            int x = x0;
+            int y = y0;
+            const int dx = k ? -dx0 : dx0;
+            const int dy = k ? -dy0 : dy0;
+            for (;; x += dx, y += dy) {
+                const int cx = xMajor ? x : x >> shift;
+                const int cy = xMajor ? y >> shift : y;
+                std::uint8_t &mask = m_houghMask[size_t(cy) * size_t(w) + size_t(cx)];
+                if (mask) {
+                    if (goodLine) {
+                        vote(cx, cy, -1);
+                    }
+                    mask = 0;
+                }
+                if (cy == endY[k] && cx == endX[k]) {
+                    break;
+                }
+            }
+        }
+
+        if (goodLine) {
+            m_result.segments.push_back({ endX[0], endY[0], endX[1], endY[1] });
+        }
+    }
+}
+
+bool LaneDetector::fitPoints(const std::vector<Segment> &segments, bool left, int midX, Fit *fit)
+{
+    // np.polyfit(y, x, 1) over both endpoints of every segment on this side
+    double n = 0.0;
+    double sumX = 0.0;
+    double sumY = 0.0;
+    double sumYY = 0.0;
+    double sumXY = 0.0;
+    for (const Segment &s : segments) {
+        const double slope = double(s.y2 - s.y1) / (double(s.x2 - s.x1) + 1e-6);
+        if (std::fabs(slope) < MinSlope) {
+            continue;
+        }
+        const bool isLeft = slope < 0 && s.x1 < midX && s.x2 < midX;
+        const bool isRight = slope > 0 && s.x1 > midX && s.x2 > midX;
+        if (left ? !isLeft : !isRight) {
+            continue;
+        }
+        for (int i = 0; i < 2; ++i) {
+            const double x = i ? s.x2 : s.x1;
+            const double y = i ? s.y2 : s.y1;
+            n += 1.0;
+            sumX += x;
+            sumY += y;
+            sumYY += y * y;
+            sumXY += x * y;
+        }
+    }
+
+    const double denominator = n * sumYY - sumY * sumY;
+    if (n < 2.0 || std::fabs(denominator) < 1e-9) {
+        return false;
+    }
+    fit->slope = (n * sumXY - sumY * sumX) / denominator;
+    fit->intercept = (sumX - fit->slope * sumY) / n;
+    return true;
+}
+
+bool LaneDetector::averageFits(std::vector<Fit> &history, const Fit *newFit, Fit *average)
+{
+    if (newFit) {
+        history.push_back(*newFit);
+    }
+    if (int(history.size()) > SmoothingFrames) {
+        history.erase(history.begin());
+    }
+    if (history.empty()) {
+        return false;
+    }
+
+    Fit sum;
+    for (const Fit &fit : history) {
+        sum.slope += fit.slope;
+        sum.intercept += fit.intercept;
+    }
+    average->slope = sum.slope / double(history.size());
+    average->intercept = sum.intercept / double(history.size());
+    return true;
+}
+
+LaneDetector::Lane LaneDetector::extrapolate(const Fit &fit) const
+{
+    Lane lane;
+    lane.valid = true;
+    lane.line.x1 = int(fit.slope * m_height + fit.intercept);
+    lane.line.y1 = m_height;
+    lane.line.x2 = int(fit.slope * m_roiTop + fit.intercept);
+    lane.line.y2 = m_roiTop;
+    return lane;
+}
+
+void LaneDetector::fitLanes()
+{
+    const int midX = m_width / 2;
+    Fit leftFit;
+    Fit rightFit;
+    const bool hasLeft = fitPoints(m_result.segments, true, midX, &leftFit);
+    const bool hasRight = fitPoints(m_result.segments, false, midX, &rightFit);
+
+    Fit smoothed;
+    m_result.left = averageFits(m_leftFits, hasLeft ? &leftFit : nullptr, &smoothed) ? extrapolate(smoothed) : Lane();
+    m_result.right = averageFits(m_rightFits, hasRight ? &rightFit : nullptr, &smoothed) ? extrapolate(smoothed) : Lane();
+    m_result.roiTop = m_roiTop;
+}
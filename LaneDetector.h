@@ -0,0 +1,108 @@
+#ifndef LANEDETECTOR_H
+#define LANEDETECTOR_H
+
+#include <cstdint>
+#include <vector>
+
+// Native port of lane.py's pipeline: grayscale, 5x5 Gaussian, Canny(50, 150),
+// trapezoid ROI, probabilistic Hough, slope split, least-squares fit and
+// 5-frame smoothing. Kernels follow OpenCV's integer arithmetic (and its
+// Hough RNG), so results match the script on the same frames.
+//
+// The detector is plain C++ with no Qt types so the hot loops stay simple
+// for the compiler to vectorize; LaneDetectionEngine runs it on a thread.
+class LaneDetector
+{
+public:
+    struct Segment
+    {
+        int x1 = 0;
+        int y1 = 0;
+        int x2 = 0;
+        int y2 = 0;
+    };
+
+    // A lane boundary from the bottom of the frame up to the ROI top
+    struct Lane
+    {
+        bool valid = false;
+        Segment line;
+    };
+
+    struct Result
+    {
+        Lane left;
+        Lane right;
+        std::vector<Segment> segments;  // Raw Hough segments, as lane.py's debug overlay
+        int roiTop = 0;
+    };
+
+    // lane.py's fixed parameters
+    static constexpr int FrameWidth = 600;
+    static constexpr int FrameHeight = 600;
+    static constexpr int SmoothingFrames = 5;
+    static constexpr int CannyLow = 50;
+    static constexpr int CannyHigh = 150;
+    static constexpr int HoughThreshold = 30;
+    static constexpr int HoughMinLineLength = 40;
+    static constexpr int HoughMaxLineGap = 50;
+    static constexpr double MinSlope = 0.5;
+
+    LaneDetector(int width = FrameWidth, int height = FrameHeight);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    // pixels are width x height 0xAARRGGBB words (QImage::Format_RGB32)
+    const Result &detect(const std::uint32_t *pixels, int bytesPerLine);
+
+    // Forgets the smoothing history, e.g. when a new video starts
+    void reset();
+
+    // Last Canny output (255 for edges), for debugging
+    const std::vector<std::uint8_t> &edges() const { return m_edges; }
+
+private:
+    struct Fit
+    {
+        double slope = 0.0;      // x = slope * y + intercept, as np.polyfit(y, x, 1)
+        double intercept = 0.0;
+    };
+
+    void toGray(const std::uint32_t *pixels, int bytesPerLine);
+    void gaussianBlur();
+    void canny();
+    void maskRegionOfInterest();
+    void houghLinesP();
+    void fitLanes();
+
+    static bool fitPoints(const std::vector<Segment> &segments, bool left, int midX, Fit *fit);
+    static bool averageFits(std::vector<Fit> &history, const Fit *newFit, Fit *average);
+    Lane extrapolate(const Fit &fit) const;
+
+    int m_width;
+    int m_height;
+    int m_roiTop;
+
+    // Working buffers, allocated once per detector
+    std::vector<std::uint8_t> m_gray;
+    std::vector<std::uint16_t> m_rowSums;
+    std::vector<std::uint8_t> m_blur;
+    std::vector<std::uint8_t> m_padded;
+    std::vector<std::int16_t> m_dx;
+    std::vector<std::int16_t> m_dy;
+    std::vector<std::int32_t> m_magnitude;
+    std::vector<std::uint8_t> m_edgeMap;
+    std::vector<std::int32_t> m_stack;
+    std::vector<std::uint8_t> m_edges;
+    std::vector<std::int32_t> m_accumulator;
+    std::vector<std::uint8_t> m_houghMask;
+    std::vector<std::int32_t> m_points;
+    std::vector<float> m_trig;
+
+    std::vector<Fit> m_leftFits;
+    std::vector<Fit> m_rightFits;
+    Result m_result;
+};
+
+#endif // LANEDETECTOR_H
@@ -3,6 +3,7 @@ import QtQuick.Controls
 import QtQuick.Layouts
 import QtQuick.Shapes
 import QtMultimedia
+import NeuroDrive_13_5_2025
 import "./qml/pages"
 
 // Import components with fully qualified name
@@ -18,6 +19,12 @@ ApplicationWindow {
     // Dark mode toggle property
     property bool darkMode: true  // Set to true for default dark mode
 
+    // Detection labels drawn over the camera views
+    property bool showDetectionLabels: true
+
+    // Per-model performance overlay fed by processManager.metrics
+    property bool showPerformanceHud: false
+
     // Global properties with dark mode support
     property color accentColor: "#0066CC"  // Darker blue
     property color secondaryColor: "#FF6B35"  // Warmer orange accent
@@ -41,6 +48,36 @@ ApplicationWindow {
         console.log("Lane Detection:", processManager.getLaneDetectionPath())
     }
 
+    // Only the login page is created with the window; the pages behind it are
+    // incubated between frames once it is interactive, so that pushing one
+    // later does not stall a frame. A page not ready by then is finished on
+    // the spot, and one that failed is created from its component as before.
+    property var preloadedPages: ({})
+
+    function preloadPages() {
+        var pages = {"dashboard": dashboardPage, "frontCamera": frontCameraPage, "cabinCamera": cabinCameraPage}
+        for (var name in pages) {
+            if (!preloadedPages[name]) {
+                preloadedPages[name] = pages[name].incubateObject(stackView, {"visible": false})
+            }
+        }
+    }
+
+    function pushPage(name, component) {
+        var incubator = preloadedPages[name]
+        if (incubator && incubator.status === Component.Loading) {
+            incubator.forceCompletion()
+        }
+        stackView.push(incubator && incubator.object ? incubator.object : component)
+    }
+
+    Connections {
+        target: startupTrace
+        function onInteractive() {
+            preloadPages()
+        }
+    }
+
     // Main window background
     Rectangle {
         anchors.fill: parent
@@ -106,12 +143,24 @@ ApplicationWindow {
         }
     }
 
+    // A driver let in from the verification cache was refused on revalidation
+    Connections {
+        target: networkService
+        function onVerificationRevoked(message) {
+            console.log("Verification revoked:", message)
+            if (processManager.isRunning) {
+                processManager.stopCurrentModel()
+            }
+            stackView.pop(null)
+        }
+    }
+
     // Login Page Component
     Component {
         id: loginPageComponent
         LoginPage {
             onLoginSuccessful: {
-                stackView.push(dashboardPage)
+                pushPage("dashboard", dashboardPage)
             }
             onLoginFailed: function(errorMessage) {
                 console.log("Login failed:", errorMessage)
@@ -269,14 +318,14 @@ ApplicationWindow {
                         Layout.fillWidth: true
                         buttonText: "Front Camera"
                         iconText: "🛣"
-                        onClicked: stackView.push(frontCameraPage)
+                        onClicked: pushPage("frontCamera", frontCameraPage)
                     }
 
                     DashboardButton {
                         Layout.fillWidth: true
                         buttonText: "Cabin Camera"
                         iconText: "👁"
-                        onClicked: stackView.push(cabinCameraPage)
+                        onClicked: pushPage("cabinCamera", cabinCameraPage)
                     }
 
                     DashboardButton {
@@ -396,182 +445,67 @@ ApplicationWindow {
                     }
                 }
 
-                Video {
+                // Live frames streamed from the model worker through shared memory
+                VideoOutput {
                     id: frontCameraVideo
                     anchors.fill: parent
                     anchors.margins: 10
-                    source: ""
-                    autoPlay: true
-                    loops: MediaPlayer.Infinite
                     fillMode: VideoOutput.PreserveAspectFit
 
-                    property int retryCount: 0
-                    property int maxRetries: 10
-                    property string videoPath: "/models/traffic_signs_detection_3/output.avi"
-                    property string videoPathAlt: "/models/drowsiness_detection_f3/output.mp4"
-
-                    Timer {
-                        id: delayedLoadTimer
-                        interval: 2000
-                        onTriggered: {
-                            console.log("Delayed reload attempt...")
-                            frontCameraVideo.source = ""
-                            frontCameraVideo.source = frontCameraVideo.videoPath
-                        }
-                    }
-
-                    // Reload video when process starts
-                    Connections {
-                        target: processManager
-                        function onIsRunningChanged() {
-                            if (processManager.isRunning && (processManager.activeModel === 1 || processManager.activeModel === 4)) {
-                                frontCameraVideo.retryCount = 0
-                                if (processManager.activeModel === 1) {
-                                    console.log("Traffic sign process started, waiting for video processing...")
-                                    frontCameraVideo.videoPath = "/models/traffic_signs_detection_3/output.avi"
-                                } else if (processManager.activeModel === 4) {
-                                    console.log("Lane detection process started, waiting for video processing...")
-                                    frontCameraVideo.videoPath = "/models/lane_detection_3/output.avi"
-                                    console.log("Looking for lane detection output at: " + frontCameraVideo.videoPath)
-                                }
-                                reloadTimer.start()
-                            } else if (processManager.activeModel === 0) {
-                                // Only clear the video if we're completely stopping (model = 0)
-                                frontCameraVideo.source = ""
-                                reloadTimer.stop()
-                                retryTimer.stop()
-                                delayedLoadTimer.stop()
-                            }
-                            // If process finished but model is still active, keep playing the video
-                        }
-
-                        function onStatusMessageChanged() {
-                            console.log("Process status:", processManager.statusMessage)
-                            // If the process indicates completion, try loading video sooner
-                            if (processManager.statusMessage.includes("complete") ||
-                                processManager.statusMessage.includes("finished") ||
-                                processManager.statusMessage.includes("Output saved") ||
-                                processManager.statusMessage.includes("Process finished successfully")) {
-                                console.log("Process seems complete, trying to load video now...")
-                                reloadTimer.stop()
-                                reloadTimer.start()
-                            }
-                        }
-                    }
-
-                    Timer {
-                        id: reloadTimer
-                        interval: 10000 // Increased wait time to 10 seconds for Raspberry Pi
-                        onTriggered: {
-                            console.log("Attempting to load video:", frontCameraVideo.videoPath)
-                            
-                            // Simple approach - just try to load the video directly
-                            // The file should exist since the process finished successfully
-                            console.log("Video file processing completed, attempting to load...")
-                            frontCameraVideo.source = ""
-                            frontCameraVideo.source = frontCameraVideo.videoPath
-                            fileProtocolTimer.start()
-                        }
-                    }
-
-                    Timer {
-                        id: fileProtocolTimer
-                        interval: 1000
-                        onTriggered: {
-                            if (!frontCameraVideo.hasVideo) {
-                                console.log("Direct path failed, trying file:// protocol...")
-                                frontCameraVideo.source = ""
-                                var filePath = "file://" + frontCameraVideo.videoPath
-                                console.log("Loading with file:// protocol:", filePath)
-                                frontCameraVideo.source = filePath
-                            } else {
-                                console.log("Direct path succeeded, video loaded")
-                            }
-                            // Start retry timer after attempt
-                            retryTimer.start()
-                        }
-                    }
-
-                    Timer {
-                        id: retryTimer
-                        interval: 3000 // Retry every 3 seconds for Raspberry Pi (less frequent)
-                        repeat: true
-                        onTriggered: {
-                            if (frontCameraVideo.retryCount < frontCameraVideo.maxRetries &&
-                                processManager.isRunning &&
-                                (processManager.activeModel === 1 || processManager.activeModel === 4)) {
-
-                                if (frontCameraVideo.hasVideo) {
-                                    console.log("Video loaded successfully on retry", frontCameraVideo.retryCount)
-                                    retryTimer.stop()
-                                    return
-                                }
-
-                                frontCameraVideo.retryCount++
-                                console.log("Retry", frontCameraVideo.retryCount, "loading video:", frontCameraVideo.videoPath)
-                                
-                                // Try alternating between direct path and file protocol
-                                frontCameraVideo.source = ""
-                                if (frontCameraVideo.retryCount % 2 === 0) {
-                                    frontCameraVideo.source = "file://" + frontCameraVideo.videoPath
-                                } else {
-                                    frontCameraVideo.source = frontCameraVideo.videoPath
-                                }
-                                console.log("Video hasVideo:", frontCameraVideo.hasVideo)
-                            } else if (frontCameraVideo.retryCount >= frontCameraVideo.maxRetries) {
-                                console.log("Max retries reached for video loading")
-                                retryTimer.stop()
-                            }
-                        }
-                    }
-
                     Component.onCompleted: {
-                        console.log("Front camera video component created")
+                        processManager.frontStream.videoSink = frontCameraVideo.videoSink
+                        console.log("Front camera view attached to live stream")
                     }
 
-                    // Fallback text if video doesn't load
+                    // Placeholder until the first frame arrives
                     Text {
                         anchors.centerIn: parent
                         text: {
-                            if (!processManager.isRunning || (processManager.activeModel !== 1 && processManager.activeModel !== 4)) {
+                            if (!processManager.isRunning || processManager.activeModel === 0 || processManager.activeModel === 2) {
                                 return "Start Traffic Sign Recognition or Lane Detection to view output"
-                            } else if (frontCameraVideo.retryCount >= frontCameraVideo.maxRetries) {
-                                return "Failed to load video after " + frontCameraVideo.maxRetries + " attempts"
-                            } else if (!frontCameraVideo.hasVideo) {
-                                return "Loading video... (attempt " + (frontCameraVideo.retryCount + 1) + ")"
                             } else {
-                                return ""
+                                return "Waiting for first frame..."
                             }
                         }
                         color: "#FFFFFF"
                         font.pixelSize: 18
-                        visible: !frontCameraVideo.hasVideo && ((processManager.activeModel === 1 || processManager.activeModel === 4))
+                        visible: !processManager.frontStream.hasFrame
                     }
 
-                    // Play controls overlay
-                    Rectangle {
-                        anchors.bottom: parent.bottom
-                        anchors.left: parent.left
-                        anchors.margins: 10
-                        width: 60
-                        height: 30
-                        color: "#B3000000"
-                        radius: 5
-                        visible: frontCameraVideo.hasVideo && !frontCameraVideo.playing
+                    // Detections reported by the worker, drawn over the raw frames
+                    DetectionOverlay {
+                        anchors.fill: parent
+                        stream: processManager.frontStream
+                        contentRect: frontCameraVideo.contentRect
+                        showLabels: showDetectionLabels
+                    }
+                }
 
-                        Text {
-                            anchors.centerIn: parent
-                            text: "▶"
-                            color: "white"
-                            font.pixelSize: 16
-                        }
+                // Progress reported by the worker, frame by frame
+                ProgressBar {
+                    id: frontProgressBar
+                    anchors.left: parent.left
+                    anchors.right: parent.right
+                    anchors.bottom: parent.bottom
+                    anchors.leftMargin: 20
+                    anchors.rightMargin: 20
+                    anchors.bottomMargin: 34
+                    from: 0
+                    to: 1
+                    value: processManager.progress
+                    visible: !complete && processManager.expectedFrames > 0 && (processManager.activeModel === 1 || processManager.activeModel === 3 || processManager.activeModel === 4)
 
-                        MouseArea {
-                            anchors.fill: parent
-                            onClicked: {
-                                console.log("Play button clicked")
-                                frontCameraVideo.play()
-                            }
+                    // Hidden once the worker reports the run is done
+                    property bool complete: false
+
+                    Connections {
+                        target: processManager
+                        function onModelStarted(modelType, expectedFrames) {
+                            frontProgressBar.complete = false
+                        }
+                        function onModelCompleted(modelType, framesProcessed) {
+                            console.log("Model", modelType, "completed after", framesProcessed, "frames")
+                            frontProgressBar.complete = true
                         }
                     }
                 }
@@ -629,6 +563,13 @@ ApplicationWindow {
                             processManager.startModel(3) // Combined
                         }
                     }
+
+                    Components.FeatureButton {
+                        buttonText: "Detection\nTimeline"
+                        bgColor: accentColor
+                        Layout.fillWidth: true
+                        onClicked: timelinePopup.open()
+                    }
                 }
             }
 
@@ -753,154 +694,67 @@ ApplicationWindow {
                     }
                 }
 
-                Video {
+                // Live frames streamed from the model worker through shared memory
+                VideoOutput {
                     id: cabinCameraVideo
                     anchors.fill: parent
                     anchors.margins: 10
-                    source: ""
-                    autoPlay: true
-                    loops: -1
                     fillMode: VideoOutput.PreserveAspectFit
 
-                    property int retryCount: 0
-                    property int maxRetries: 10
-                    property string videoPath: "/models/drowsiness_detection_f3/output.avi"
-
-                    // Reload video when process starts
-                    Connections {
-                        target: processManager
-                        function onIsRunningChanged() {
-                            if (processManager.isRunning && processManager.activeModel === 2) {
-                                cabinCameraVideo.retryCount = 0
-                                console.log("Drowsiness detection process started, waiting for video processing...")
-                                cabinReloadTimer.start()
-                            } else {
-                                cabinCameraVideo.source = ""
-                                cabinReloadTimer.stop()
-                                cabinRetryTimer.stop()
-                                cabinFileProtocolTimer.stop()
-                            }
-                        }
-
-                        function onStatusMessageChanged() {
-                            console.log("Process status:", processManager.statusMessage)
-                            // If the process indicates completion, try loading video sooner
-                            if (processManager.statusMessage.includes("complete") ||
-                                processManager.statusMessage.includes("finished") ||
-                                processManager.statusMessage.includes("Done")) {
-                                console.log("Process seems complete, trying to load video now...")
-                                cabinReloadTimer.stop()
-                                cabinReloadTimer.start()
-                            }
-                        }
-                    }
-
-                    Timer {
-                        id: cabinReloadTimer
-                        interval: 5000 // Wait 5 seconds for video processing to complete
-                        onTriggered: {
-                            console.log("Attempting to load cabin video:", cabinCameraVideo.videoPath)
-                            console.log("Trying multiple loading methods...")
-
-                            // Reset source
-                            cabinCameraVideo.source = ""
-
-                            // Method 1: Direct path
-                            cabinCameraVideo.source = cabinCameraVideo.videoPath
-
-                            // Give it a moment, then try file protocol if needed
-                            cabinFileProtocolTimer.start()
-                        }
-                    }
-
-                    Timer {
-                        id: cabinFileProtocolTimer
-                        interval: 1000
-                        onTriggered: {
-                            if (!cabinCameraVideo.hasVideo) {
-                                console.log("Direct path failed, trying file:// protocol...")
-                                cabinCameraVideo.source = ""
-                                cabinCameraVideo.source = "file://" + cabinCameraVideo.videoPath
-                            }
-                            // Start retry timer after both attempts
-                            cabinRetryTimer.start()
-                        }
-                    }
-
-                    Timer {
-                        id: cabinRetryTimer
-                        interval: 2000 // Retry every 2 seconds
-                        repeat: true
-                        onTriggered: {
-                            if (cabinCameraVideo.retryCount < cabinCameraVideo.maxRetries &&
-                                processManager.isRunning &&
-                                processManager.activeModel === 2) {
-
-                                if (cabinCameraVideo.hasVideo) {
-                                    console.log("Cabin video loaded successfully")
-                                    cabinRetryTimer.stop()
-                                    return
-                                }
-
-                                cabinCameraVideo.retryCount++
-                                console.log("Retry", cabinCameraVideo.retryCount, "loading cabin video:", cabinCameraVideo.videoPath)
-                                console.log("Cabin video hasVideo:", cabinCameraVideo.hasVideo)
-                                cabinCameraVideo.source = ""
-                                cabinCameraVideo.source = cabinCameraVideo.videoPath
-                            } else if (cabinCameraVideo.retryCount >= cabinCameraVideo.maxRetries) {
-                                console.log("Max retries reached for cabin video loading")
-                                cabinRetryTimer.stop()
-                            }
-                        }
-                    }
-
                     Component.onCompleted: {
-                        console.log("Cabin camera video component created")
+                        processManager.cabinStream.videoSink = cabinCameraVideo.videoSink
+                        console.log("Cabin camera view attached to live stream")
                     }
 
-                    // Fallback text if video doesn't load
+                    // Placeholder until the first frame arrives
                     Text {
                         anchors.centerIn: parent
                         text: {
                             if (!processManager.isRunning || processManager.activeModel !== 2) {
                                 return "Start Drowsiness Detection to view output"
-                            } else if (cabinCameraVideo.retryCount >= cabinCameraVideo.maxRetries) {
-                                return "Failed to load video after " + cabinCameraVideo.maxRetries + " attempts"
-                            } else if (!cabinCameraVideo.hasVideo) {
-                                return "Loading video... (attempt " + (cabinCameraVideo.retryCount + 1) + ")"
                             } else {
-                                return ""
+                                return "Waiting for first frame..."
                             }
                         }
                         color: "#FFFFFF"
                         font.pixelSize: 18
-                        visible: !cabinCameraVideo.hasVideo || (!processManager.isRunning || processManager.activeModel !== 2)
+                        visible: !processManager.cabinStream.hasFrame
                     }
 
-                    // Play controls overlay
-                    Rectangle {
-                        anchors.bottom: parent.bottom
-                        anchors.left: parent.left
-                        anchors.margins: 10
-                        width: 60
-                        height: 30
-                        color: "#B3000000"
-                        radius: 5
-                        visible: cabinCameraVideo.hasVideo && !cabinCameraVideo.playing
+                    // Detections reported by the worker, drawn over the raw frames
+                    DetectionOverlay {
+                        anchors.fill: parent
+                        stream: processManager.cabinStream
+                        contentRect: cabinCameraVideo.contentRect
+                        showLabels: showDetectionLabels
+                    }
+                }
 
-                        Text {
-                            anchors.centerIn: parent
-                            text: "▶"
-                            color: "white"
-                            font.pixelSize: 16
-                        }
+                // Progress reported by the worker, frame by frame
+                ProgressBar {
+                    id: cabinProgressBar
+                    anchors.left: parent.left
+                    anchors.right: parent.right
+                    anchors.bottom: parent.bottom
+                    anchors.leftMargin: 20
+                    anchors.rightMargin: 20
+                    anchors.bottomMargin: 34
+                    from: 0
+                    to: 1
+                    value: processManager.progress
+                    visible: !complete && processManager.expectedFrames > 0 && (processManager.activeModel === 2 || processManager.activeModel === 3)
 
-                        MouseArea {
-                            anchors.fill: parent
-                            onClicked: {
-                                console.log("Cabin play button clicked")
-                                cabinCameraVideo.play()
-                            }
+                    // Hidden once the worker reports the run is done
+                    property bool complete: false
+
+                    Connections {
+                        target: processManager
+                        function onModelStarted(modelType, expectedFrames) {
+                            cabinProgressBar.complete = false
+                        }
+                        function onModelCompleted(modelType, framesProcessed) {
+                            console.log("Model", modelType, "completed after", framesProcessed, "frames")
+                            cabinProgressBar.complete = true
                         }
                     }
                 }
@@ -946,6 +800,13 @@ ApplicationWindow {
                             processManager.startModel(2) // Drowsiness
                         }
                     }
+
+                    Components.FeatureButton {
+                        buttonText: "Drowsiness\nHistory"
+                        bgColor: accentColor
+                        Layout.fillWidth: true
+                        onClicked: historyPopup.open()
+                    }
                 }
             }
 
@@ -1019,62 +880,65 @@ ApplicationWindow {
     }
 
     // Speech Recognition Popup
-    Popup {
+    Components.LazyPopup {
         id: speechPopup
-        anchors.centerIn: parent
-        width: 300
-        height: 200
-        modal: true
-        closePolicy: Popup.CloseOnEscape | Popup.CloseOnPressOutside
-
-        background: Rectangle {
-            color: surfaceColor
-            radius: 15
-            border.color: accentColor
-            border.width: 2
-        }
-
-        Column {
+        sourceComponent: Popup {
+            id: speechDialog
             anchors.centerIn: parent
-            spacing: 20
+            width: 300
+            height: 200
+            modal: true
+            closePolicy: Popup.CloseOnEscape | Popup.CloseOnPressOutside
 
-            Text {
-                text: "🎤"
-                font.pixelSize: 48
-                anchors.horizontalCenter: parent.horizontalCenter
-                color: accentColor
+            background: Rectangle {
+                color: surfaceColor
+                radius: 15
+                border.color: accentColor
+                border.width: 2
             }
 
-            Text {
-                text: "Listening..."
-                color: textColor
-                font.pixelSize: 24
-                font.bold: true
-                anchors.horizontalCenter: parent.horizontalCenter
-            }
+            Column {
+                anchors.centerIn: parent
+                spacing: 20
 
-            Rectangle {
-                width: 200
-                height: 4
-                color: subtleColor
-                anchors.horizontalCenter: parent.horizontalCenter
+                Text {
+                    text: "🎤"
+                    font.pixelSize: 48
+                    anchors.horizontalCenter: parent.horizontalCenter
+                    color: accentColor
+                }
+
+                Text {
+                    text: "Listening..."
+                    color: textColor
+                    font.pixelSize: 24
+                    font.bold: true
+                    anchors.horizontalCenter: parent.horizontalCenter
+                }
 
                 Rectangle {
-                    property int position: 0
-                    id: animatedBar
-                    width: 50
-                    height: parent.height
-                    color: accentColor
+                    width: 200
+                    height: 4
+                    color: subtleColor
+                    anchors.horizontalCenter: parent.horizontalCenter
 
-                    NumberAnimation on position {
-                        from: 0
-                        to: 150
-                        duration: 2000
-                        loops: Animation.Infinite
-                        running: speechPopup.visible
-                    }
+                    Rectangle {
+                        property int position: 0
+                        id: animatedBar
+                        width: 50
+                        height: parent.height
+                        color: accentColor
+
+                        NumberAnimation on position {
+                            from: 0
+                            to: 150
+                            duration: 2000
+                            loops: Animation.Infinite
+                            running: speechDialog.visible
+                        }
 
-                    x: animatedBar.position
+                        x: animatedBar.position
+                    }
                 }
             }
         }
@@ -1166,161 +1030,702 @@ ApplicationWindow {
     }
 
     // Settings Popup
-    Popup {
+    Components.LazyPopup {
         id: settingsPopup
-        width: 300
-        height: 200
-        modal: true
-        anchors.centerIn: parent
-        closePolicy: Popup.CloseOnEscape | Popup.CloseOnPressOutside
-
-        background: Rectangle {
-            color: surfaceColor
-            radius: 10
-            border.color: accentColor
-            border.width: 2
-        }
-
-        ColumnLayout {
-            anchors.fill: parent
-            anchors.margins: 15
-            spacing: 10
-
-            Text {
-                text: "Settings"
-                font.pixelSize: 20
-                font.bold: true
-                color: textColor
-                Layout.alignment: Qt.AlignHCenter
-            }
+        sourceComponent: Popup {
+            id: settingsDialog
+            width: 300
+            height: 400
+            modal: true
+            anchors.centerIn: parent
+            closePolicy: Popup.CloseOnEscape | Popup.CloseOnPressOutside
 
-            Rectangle {
-                height: 1
-                color: subtleColor
-                Layout.fillWidth: true
+            background: Rectangle {
+                color: surfaceColor
+                radius: 10
+                border.color: accentColor
+                border.width: 2
             }
 
-            RowLayout {
-                Layout.fillWidth: true
+            ColumnLayout {
+                anchors.fill: parent
+                anchors.margins: 15
+                spacing: 10
 
                 Text {
-                    text: "Dark Mode"
+                    text: "Settings"
+                    font.pixelSize: 20
+                    font.bold: true
                     color: textColor
-                    font.pixelSize: 16
+                    Layout.alignment: Qt.AlignHCenter
                 }
 
-                Item { Layout.fillWidth: true }
+                Rectangle {
+                    height: 1
+                    color: subtleColor
+                    Layout.fillWidth: true
+                }
+
+                RowLayout {
+                    Layout.fillWidth: true
+
+                    Text {
+                        text: "Dark Mode"
+                        color: textColor
+                        font.pixelSize: 16
+                    }
+
+                    Item { Layout.fillWidth: true }
 
-                Switch {
-                    checked: darkMode
-                    onCheckedChanged: {
-                        darkMode = checked
+                    Switch {
+                        checked: darkMode
+                        onCheckedChanged: {
+                            darkMode = checked
+                        }
                     }
                 }
-            }
-        }
-    }
 
-    // Debug Popup
-    Popup {
-        id: debugPopup
-        width: 500
-        height: 400
-        modal: true
-        anchors.centerIn: parent
-        closePolicy: Popup.CloseOnEscape | Popup.CloseOnPressOutside
-
-        background: Rectangle {
-            color: surfaceColor
-            radius: 10
-            border.color: accentColor
-            border.width: 2
-        }
+                RowLayout {
+                    Layout.fillWidth: true
 
-        ColumnLayout {
-            anchors.fill: parent
-            anchors.margins: 15
-            spacing: 10
+                    Text {
+                        text: "Native Lane Detection"
+                        color: textColor
+                        font.pixelSize: 16
+                    }
 
-            Text {
-                text: "Debug Information"
-                font.pixelSize: 20
-                font.bold: true
-                color: textColor
-                Layout.alignment: Qt.AlignHCenter
-            }
+                    Item { Layout.fillWidth: true }
 
-            Rectangle {
-                height: 1
-                color: subtleColor
-                Layout.fillWidth: true
-            }
+                    Switch {
+                        checked: processManager.nativeLaneDetection
+                        onCheckedChanged: {
+                            processManager.nativeLaneDetection = checked
+                        }
+                    }
+                }
 
-            ScrollView {
-                Layout.fillWidth: true
-                Layout.fillHeight: true
+                RowLayout {
+                    Layout.fillWidth: true
 
-                Column {
-                    width: parent.width
-                    spacing: 10
+                    Text {
+                        text: "Native Traffic Signs"
+                        color: textColor
+                        font.pixelSize: 16
+                    }
+
+                    Item { Layout.fillWidth: true }
+
+                    Switch {
+                        checked: processManager.nativeTrafficSigns
+                        onCheckedChanged: {
+                            processManager.nativeTrafficSigns = checked
+                        }
+                    }
+                }
+
+                RowLayout {
+                    Layout.fillWidth: true
 
                     Text {
-                        text: "Python Executable: " + processManager.pythonExecutable
+                        text: "Audio Alerts"
                         color: textColor
-                        font.pixelSize: 12
-                        wrapMode: Text.Wrap
-                        width: parent.width
+                        font.pixelSize: 16
                     }
 
+                    Item { Layout.fillWidth: true }
+
+                    Switch {
+                        checked: processManager.alerts.enabled
+                        onCheckedChanged: {
+                            processManager.alerts.enabled = checked
+                        }
+                    }
+                }
+
+                RowLayout {
+                    Layout.fillWidth: true
+
                     Text {
-                        text: "Traffic Sign Path: " + processManager.getTrafficSignPath()
+                        text: "Shared Video Decode"
                         color: textColor
-                        font.pixelSize: 12
-                        wrapMode: Text.Wrap
-                        width: parent.width
+                        font.pixelSize: 16
                     }
 
+                    Item { Layout.fillWidth: true }
+
+                    Switch {
+                        checked: processManager.sharedDecode
+                        onCheckedChanged: {
+                            processManager.sharedDecode = checked
+                        }
+                    }
+                }
+
+                RowLayout {
+                    Layout.fillWidth: true
+
                     Text {
-                        text: "Drowsiness Path: " + processManager.getDrowsinessPath()
+                        text: "Detection Labels"
                         color: textColor
-                        font.pixelSize: 12
-                        wrapMode: Text.Wrap
-                        width: parent.width
+                        font.pixelSize: 16
                     }
 
+                    Item { Layout.fillWidth: true }
+
+                    Switch {
+                        checked: showDetectionLabels
+                        onCheckedChanged: {
+                            showDetectionLabels = checked
+                        }
+                    }
+                }
+
+                RowLayout {
+                    Layout.fillWidth: true
+
                     Text {
-                        text: "Status: " + processManager.statusMessage
+                        text: "Adaptive Rate"
                         color: textColor
-                        font.pixelSize: 12
-                        wrapMode: Text.Wrap
+                        font.pixelSize: 16
+                    }
+
+                    Item { Layout.fillWidth: true }
+
+                    Switch {
+                        checked: processManager.governor.enabled
+                        onCheckedChanged: {
+                            processManager.governor.enabled = checked
+                        }
+                    }
+                }
+
+                RowLayout {
+                    Layout.fillWidth: true
+
+                    Text {
+                        text: "Performance HUD"
+                        color: textColor
+                        font.pixelSize: 16
+                    }
+
+                    Item { Layout.fillWidth: true }
+
+                    Switch {
+                        checked: showPerformanceHud
+                        onCheckedChanged: {
+                            showPerformanceHud = checked
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Debug Popup
+    Components.LazyPopup {
+        id: debugPopup
+        sourceComponent: Popup {
+            id: debugDialog
+            width: 500
+            height: 400
+            modal: true
+            anchors.centerIn: parent
+            closePolicy: Popup.CloseOnEscape | Popup.CloseOnPressOutside
+
+            background: Rectangle {
+                color: surfaceColor
+                radius: 10
+                border.color: accentColor
+                border.width: 2
+            }
+
+            ColumnLayout {
+                anchors.fill: parent
+                anchors.margins: 15
+                spacing: 10
+
+                Text {
+                    text: "Debug Information"
+                    font.pixelSize: 20
+                    font.bold: true
+                    color: textColor
+                    Layout.alignment: Qt.AlignHCenter
+                }
+
+                Rectangle {
+                    height: 1
+                    color: subtleColor
+                    Layout.fillWidth: true
+                }
+
+                ScrollView {
+                    Layout.fillWidth: true
+                    Layout.fillHeight: true
+
+                    Column {
                         width: parent.width
+                        spacing: 10
+
+                        Text {
+                            text: "Python Executable: " + processManager.pythonExecutable
+                            color: textColor
+                            font.pixelSize: 12
+                            wrapMode: Text.Wrap
+                            width: parent.width
+                        }
+
+                        Text {
+                            text: "Traffic Sign Path: " + processManager.getTrafficSignPath()
+                            color: textColor
+                            font.pixelSize: 12
+                            wrapMode: Text.Wrap
+                            width: parent.width
+                        }
+
+                        Text {
+                            text: "Drowsiness Path: " + processManager.getDrowsinessPath()
+                            color: textColor
+                            font.pixelSize: 12
+                            wrapMode: Text.Wrap
+                            width: parent.width
+                        }
+
+                        Text {
+                            text: "Status: " + processManager.statusMessage
+                            color: textColor
+                            font.pixelSize: 12
+                            wrapMode: Text.Wrap
+                            width: parent.width
+                        }
+                    }
+                }
+
+                Rectangle {
+                    height: 1
+                    color: subtleColor
+                    Layout.fillWidth: true
+                }
+
+                RowLayout {
+                    Layout.fillWidth: true
+
+                    Components.FeatureButton {
+                        buttonText: "Test Python"
+                        Layout.fillWidth: true
+                        onClicked: {
+                            processManager.testPythonEnvironment()
+                        }
+                    }
+
+                    Components.FeatureButton {
+                        buttonText: "Close"
+                        Layout.fillWidth: true
+                        onClicked: debugDialog.close()
                     }
                 }
             }
+        }
+    }
 
-            Rectangle {
-                height: 1
-                color: subtleColor
-                Layout.fillWidth: true
+    // Drowsiness History Popup, newest first, straight from the event log
+    Components.LazyPopup {
+        id: historyPopup
+        sourceComponent: Popup {
+            id: historyDialog
+            width: 400
+            height: 400
+            modal: true
+            anchors.centerIn: parent
+            closePolicy: Popup.CloseOnEscape | Popup.CloseOnPressOutside
+
+            background: Rectangle {
+                color: surfaceColor
+                radius: 10
+                border.color: accentColor
+                border.width: 2
             }
 
-            RowLayout {
-                Layout.fillWidth: true
+            ColumnLayout {
+                anchors.fill: parent
+                anchors.margins: 15
+                spacing: 10
 
-                Components.FeatureButton {
-                    buttonText: "Test Python"
+                Text {
+                    text: "Drowsiness History (" + processManager.eventLog.count + ")"
+                    font.pixelSize: 20
+                    font.bold: true
+                    color: textColor
+                    Layout.alignment: Qt.AlignHCenter
+                }
+
+                Rectangle {
+                    height: 1
+                    color: subtleColor
                     Layout.fillWidth: true
-                    onClicked: {
-                        processManager.testPythonEnvironment()
+                }
+
+                ListView {
+                    id: historyList
+                    Layout.fillWidth: true
+                    Layout.fillHeight: true
+                    clip: true
+                    visible: count > 0
+                    model: processManager.eventLog
+                    ScrollBar.vertical: ScrollBar {}
+
+                    delegate: RowLayout {
+                        width: ListView.view.width
+                        height: 28
+
+                        Text {
+                            text: model.date + "  " + model.time
+                            color: textColor
+                            font.pixelSize: 14
+                            Layout.fillWidth: true
+                        }
+
+                        Text {
+                            // Long closures carry their own text
+                            text: model.status === "Yes" ? "Drowsy" : model.status === "No" ? "Alert" : model.status
+                            color: model.status === "Yes" ? secondaryColor : textColor
+                            font.pixelSize: 14
+                            font.bold: model.status === "Yes"
+                        }
                     }
                 }
 
+                Text {
+                    text: "No events recorded yet"
+                    color: textColor
+                    font.pixelSize: 14
+                    Layout.fillHeight: true
+                    Layout.alignment: Qt.AlignHCenter
+                    verticalAlignment: Text.AlignVCenter
+                    visible: historyList.count === 0
+                }
+
                 Components.FeatureButton {
                     buttonText: "Close"
                     Layout.fillWidth: true
-                    onClicked: debugPopup.close()
+                    onClicked: historyDialog.close()
                 }
             }
         }
     }
-}
\ No newline at end of file
+
+    // Detection Timeline Popup: the detections of a run by class and time,
+    // with the recorded camera view at the selected event
+    Components.LazyPopup {
+        id: timelinePopup
+        sourceComponent: Popup {
+            id: timelineDialog
+            width: 760
+            height: 440
+            modal: true
+            anchors.centerIn: parent
+            closePolicy: Popup.CloseOnEscape | Popup.CloseOnPressOutside
+
+            property var sidecar: processManager.detections
+            property int classId: -1
+            property var ticks: []
+            property var current: ({})
+            property int pendingSeek: -1
+
+            function refresh() {
+                ticks = sidecar.events(classId, 300)
+            }
+
+            function show(event) {
+                if (!event || event.timeMs === undefined) {
+                    return
+                }
+                current = event
+                // Drowsiness is seen by the cabin camera, everything else by the front one
+                var recording = event.model === 2 ? processManager.cabinRecording : processManager.frontRecording
+                var place = recording.locate(sidecar.startMs + event.timeMs)
+                if (place.source === undefined) {
+                    return
+                }
+                if (replayPlayer.source.toString() === place.source.toString()) {
+                    replayPlayer.position = place.positionMs
+                    replayPlayer.pause()
+                } else {
+                    pendingSeek = place.positionMs
+                    replayPlayer.source = place.source
+                }
+            }
+
+            onOpened: refresh()
+            onClosed: replayPlayer.stop()
+
+            Connections {
+                target: timelineDialog.sidecar
+                // Another run: its classes have other ids
+                function onOpened() {
+                    timelineDialog.current = ({})
+                    timelineDialog.classId = -1
+                    classBox.currentIndex = 0
+                    timelineDialog.refresh()
+                }
+            }
+
+            // Ticks follow a run that is still being recorded
+            Timer {
+                interval: 1000
+                repeat: true
+                running: timelineDialog.visible && timelineDialog.sidecar.recording
+                onTriggered: timelineDialog.refresh()
+            }
+
+            MediaPlayer {
+                id: replayPlayer
+                videoOutput: replayOutput
+                onMediaStatusChanged: {
+                    if (mediaStatus === MediaPlayer.LoadedMedia && timelineDialog.pendingSeek >= 0) {
+                        position = timelineDialog.pendingSeek
+                        timelineDialog.pendingSeek = -1
+                        pause()
+                    }
+                }
+            }
+
+            background: Rectangle {
+                color: surfaceColor
+                radius: 10
+                border.color: accentColor
+                border.width: 2
+            }
+
+            ColumnLayout {
+                anchors.fill: parent
+                anchors.margins: 12
+                spacing: 8
+
+                RowLayout {
+                    Layout.fillWidth: true
+                    spacing: 10
+
+                    Text {
+                        text: "Detection Timeline"
+                        font.pixelSize: 20
+                        font.bold: true
+                        color: textColor
+                        Layout.fillWidth: true
+                    }
+
+                    ComboBox {
+                        id: runBox
+                        Layout.preferredWidth: 220
+                        model: timelineDialog.visible ? timelineDialog.sidecar.runs() : []
+                        textRole: "name"
+                        onActivated: timelineDialog.sidecar.open(model[currentIndex].path)
+                    }
+
+                    ComboBox {
+                        id: classBox
+                        Layout.preferredWidth: 200
+                        model: [{"id": -1, "name": "All", "count": timelineDialog.sidecar.rowCount}].concat(timelineDialog.sidecar.classes)
+                        textRole: "name"
+                        displayText: currentIndex >= 0 && model[currentIndex]
+                                     ? model[currentIndex].name + " (" + model[currentIndex].count + ")" : ""
+                        onActivated: {
+                            timelineDialog.classId = model[currentIndex].id
+                            timelineDialog.refresh()
+                            timelineDialog.show(timelineDialog.sidecar.nextEvent(timelineDialog.classId, 0))
+                        }
+                    }
+                }
+
+                Rectangle {
+                    color: "#000000"
+                    radius: 6
+                    Layout.fillWidth: true
+                    Layout.fillHeight: true
+
+                    VideoOutput {
+                        id: replayOutput
+                        anchors.fill: parent
+                        anchors.margins: 4
+                        fillMode: VideoOutput.PreserveAspectFit
+                    }
+
+                    Text {
+                        anchors.centerIn: parent
+                        text: timelineDialog.current.timeMs === undefined ? "Pick an event on the timeline"
+                                                                         : "No recording at this time"
+                        color: "#FFFFFF"
+                        font.pixelSize: 16
+                        visible: !replayPlayer.hasVideo
+                    }
+                }
+
+                // One tick per event (thinned to 300), positioned by time in the run
+                Rectangle {
+                    id: scrubber
+                    Layout.fillWidth: true
+                    height: 36
+                    radius: 4
+                    color: Qt.darker(surfaceColor, 1.2)
+
+                    Repeater {
+                        model: timelineDialog.ticks
+
+                        Rectangle {
+                            x: modelData.timeMs / Math.max(1, timelineDialog.sidecar.durationMs) * (scrubber.width - width)
+                            width: 2
+                            height: scrubber.height
+                            color: modelData.name === "drowsy" ? secondaryColor : accentColor
+                            opacity: 0.4 + 0.6 * modelData.confidence
+                        }
+                    }
+
+                    Rectangle {
+                        x: (timelineDialog.current.timeMs || 0) / Math.max(1, timelineDialog.sidecar.durationMs) * (scrubber.width - width)
+                        width: 3
+                        height: scrubber.height
+                        color: textColor
+                        visible: timelineDialog.current.timeMs !== undefined
+                    }
+
+                    // Jumps to the first event at or after the point clicked
+                    MouseArea {
+                        anchors.fill: parent
+                        onClicked: (mouse) => {
+                            var timeMs = mouse.x / width * timelineDialog.sidecar.durationMs
+                            var event = timelineDialog.sidecar.nextEvent(timelineDialog.classId, timeMs)
+                            timelineDialog.show(event.timeMs !== undefined
+                                               ? event : timelineDialog.sidecar.previousEvent(timelineDialog.classId, timeMs))
+                        }
+                    }
+                }
+
+                RowLayout {
+                    Layout.fillWidth: true
+                    spacing: 10
+
+                    Components.FeatureButton {
+                        buttonText: "◀"
+                        bgColor: accentColor
+                        Layout.preferredWidth: 60
+                        onClicked: timelineDialog.show(timelineDialog.sidecar.previousEvent(timelineDialog.classId,
+                                                                                          timelineDialog.current.timeMs || 0))
+                    }
+
+                    Text {
+                        Layout.fillWidth: true
+                        horizontalAlignment: Text.AlignHCenter
+                        color: textColor
+                        font.pixelSize: 14
+                        text: {
+                            var event = timelineDialog.current
+                            if (event.timeMs === undefined) {
+                                return timelineDialog.sidecar.rowCount + " detections in "
+                                       + Math.round(timelineDialog.sidecar.durationMs / 1000) + " s"
+                            }
+                            var seconds = event.timeMs / 1000
+                            return event.name + " at " + Math.floor(seconds / 60) + ":" + ("0" + (seconds % 60).toFixed(1)).slice(-4)
+                                   + ", frame " + event.frame + ", " + Math.round(event.confidence * 100) + "%"
+                        }
+                    }
+
+                    Components.FeatureButton {
+                        buttonText: "▶"
+                        bgColor: accentColor
+                        Layout.preferredWidth: 60
+                        onClicked: timelineDialog.show(timelineDialog.sidecar.nextEvent(timelineDialog.classId,
+                                                                                      (timelineDialog.current.timeMs === undefined ? -1 : timelineDialog.current.timeMs) + 1))
+                    }
+
+                    Components.FeatureButton {
+                        buttonText: "Close"
+                        bgColor: accentColor
+                        Layout.preferredWidth: 100
+                        onClicked: timelineDialog.close()
+                    }
+                }
+            }
+        }
+    }
+
+    // Performance HUD, one line per model of the current run
+    Rectangle {
+        id: performanceHud
+        anchors.top: parent.top
+        anchors.right: parent.right
+        anchors.margins: 8
+        width: 330
+        height: hudColumn.implicitHeight + 12
+        radius: 6
+        color: "#CC000000"
+        visible: showPerformanceHud && processManager.metrics.count > 0
+        z: 100
+
+        Column {
+            id: hudColumn
+            anchors.fill: parent
+            anchors.margins: 6
+            spacing: 2
+
+            Repeater {
+                model: processManager.metrics
+
+                Text {
+                    width: hudColumn.width
+                    color: model.dropped > 0 ? secondaryColor : "#FFFFFF"
+                    font.pixelSize: 11
+                    font.family: "monospace"
+                    wrapMode: Text.Wrap
+                    text: model.name + ": " + model.fps.toFixed(1) + " fps, p50/p95/p99 "
+                          + model.p50.toFixed(1) + "/" + model.p95.toFixed(1) + "/" + model.p99.toFixed(1) + " ms\n"
+                          + "  start " + (model.spawnLatencyMs >= 0 ? model.spawnLatencyMs + " ms" : "-")
+                          + ", first frame " + (model.firstFrameMs >= 0 ? model.firstFrameMs + " ms" : "-")
+                          + ", dropped " + model.dropped + "\n"
+                          + "  CPU " + model.cpuPercent.toFixed(0) + "%, RSS " + model.rssMb.toFixed(0) + " MB"
+                          + (model.inProcess ? " (dashboard)" : "")
+                }
+            }
+
+            Text {
+                color: "#AAAAAA"
+                font.pixelSize: 11
+                font.family: "monospace"
+                text: "Total CPU " + processManager.metrics.totalCpuPercent.toFixed(0) + "%, RSS "
+                      + processManager.metrics.totalRssMb.toFixed(0) + " MB"
+            }
+
+            Text {
+                color: processManager.metrics.queueDrops > 0 ? secondaryColor : "#AAAAAA"
+                font.pixelSize: 11
+                font.family: "monospace"
+                text: "Frame pool " + processManager.metrics.framePoolInUseMb.toFixed(0) + "/"
+                      + processManager.metrics.framePoolAllocatedMb.toFixed(0) + " of "
+                      + processManager.metrics.framePoolBudgetMb.toFixed(0) + " MB, dropped "
+                      + processManager.metrics.queueDrops
+            }
+
+            Text {
+                visible: processManager.driverState.perclos !== undefined
+                color: processManager.driverState.drowsy ? secondaryColor : "#AAAAAA"
+                font.pixelSize: 11
+                font.family: "monospace"
+                text: visible ? "Driver PERCLOS " + (processManager.driverState.perclos * 100).toFixed(0)
+                                + "%, " + processManager.driverState.blinksPerMinute.toFixed(0) + " blinks/min, EAR "
+                                + processManager.driverState.ear.toFixed(2) + " < "
+                                + processManager.driverState.threshold.toFixed(2)
+                                + (processManager.driverState.calibrated ? "" : " (calibrating)")
+                              : ""
+            }
+
+            Text {
+                color: processManager.alerts.overBudget > 0 ? secondaryColor : "#AAAAAA"
+                font.pixelSize: 11
+                font.family: "monospace"
+                text: "Alert latency " + (processManager.alerts.lastLatencyMs >= 0
+                      ? processManager.alerts.lastLatencyMs.toFixed(1) + " ms, max "
+                        + processManager.alerts.maxLatencyMs.toFixed(1) + " ms, over 50 ms "
+                        + processManager.alerts.overBudget
+                      : "-")
+            }
+        }
+    }
+}
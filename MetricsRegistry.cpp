@@ -0,0 +1,528 @@
+#include "MetricsRegistry.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QSaveFile>
+
+#include <cmath>
+#include <utility>
+#include <unistd.h>
+
+MetricsRegistry::MetricsRegistry(QObject *parent)
+    : QAbstractListModel(parent)
+{
+    m_clock.start();
+
+    m_sampleTimer.setInterval(1000);
+    connect(&m_sampleTimer, &QTimer::timeout, this, &MetricsRegistry::sample);
+    m_sampleTimer.start();
+
+    m_exportPath = qEnvironmentVariable("NEURODRIVE_METRICS_FILE");
+
+    // A scrape is a connection: the client gets the current sample and the socket closes
+    const QString socketName = qEnvironmentVariable("NEURODRIVE_METRICS_SOCKET");
+    if (!socketName.isEmpty()) {
+        m_server = new QLocalServer(this);
+        QLocalServer::removeServer(socketName);
+        if (!m_server->listen(socketName)) {
+            qWarning() << "MetricsRegistry: could not listen on" << socketName << ":" << m_server->errorString();
+        }
+        connect(m_server, &QLocalServer::newConnection, this, [this]() {
+            while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+                connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+                socket->write(toPrometheus().toUtf8());
+                socket->disconnectFromServer();
+            }
+        });
+    }
+}
+
+MetricsRegistry::~MetricsRegistry()
+{
+    if (m_server) {
+        m_server->close();
+    }
+}
+
+void MetricsRegistry::setModelName(int model, const QString &name)
+{
+    if (validModel(model)) {
+        m_names[model] = name;
+    }
+}
+
+void MetricsRegistry::recordFrame(int model, qint64 frameIndex, double latencyMs)
+{
+    if (!validModel(model)) {
+        return;
+    }
+    Counters &counters = m_counters[model];
+
+    // Frame indices are the source's, so a gap is frames the model never saw
+    const qint64 previous = counters.lastFrameIndex.exchange(frameIndex, std::memory_order_relaxed);
+    if (previous >= 0 && frameIndex > previous + 1) {
+        counters.dropped.fetch_add(quint64(frameIndex - previous - 1), std::memory_order_relaxed);
+    }
+
+    if (counters.frames.fetch_add(1, std::memory_order_relaxed) == 0) {
+        qint64 unset = -1;
+        const qint64 sinceRun = (m_clock.nsecsElapsed() - m_runStartNs.load(std::memory_order_relaxed)) / 1000000;
+        counters.firstFrameMs.compare_exchange_strong(unset, sinceRun, std::memory_order_relaxed);
+    }
+    counters.latencySumUs.fetch_add(quint64(qMax(0.0, latencyMs) * 1000.0), std::memory_order_relaxed);
+    counters.buckets[bucketFor(latencyMs)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void MetricsRegistry::recordDropped(int model, quint64 frames)
+{
+    if (validModel(model)) {
+        m_counters[model].dropped.fetch_add(frames, std::memory_order_relaxed);
+    }
+}
+
+void MetricsRegistry::beginRun()
+{
+    for (Counters &counters : m_counters) {
+        counters.frames.store(0, std::memory_order_relaxed);
+        counters.dropped.store(0, std::memory_order_relaxed);
+        counters.lastFrameIndex.store(-1, std::memory_order_relaxed);
+        counters.latencySumUs.store(0, std::memory_order_relaxed);
+        counters.spawnLatencyMs.store(-1, std::memory_order_relaxed);
+        counters.firstFrameMs.store(-1, std::memory_order_relaxed);
+        for (std::atomic<quint64> &bucket : counters.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+    m_runStartNs.store(m_clock.nsecsElapsed(), std::memory_order_relaxed);
+
+    beginResetModel();
+    m_rows.clear();
+    endResetModel();
+    emit countChanged();
+}
+
+void MetricsRegistry::recordSpawnLatency(int model, qint64 milliseconds)
+{
+    if (validModel(model)) {
+        m_counters[model].spawnLatencyMs.store(milliseconds, std::memory_order_relaxed);
+    }
+}
+
+void MetricsRegistry::setProcessId(int model, qint64 pid, bool inProcess)
+{
+    if (validModel(model)) {
+        m_processes[model] = Process{pid, inProcess};
+    }
+}
+
+void MetricsRegistry::setSampleIntervalMs(int milliseconds)
+{
+    milliseconds = qMax(100, milliseconds);
+    if (milliseconds == m_sampleTimer.interval()) {
+        return;
+    }
+    m_sampleTimer.setInterval(milliseconds);
+    emit sampleIntervalMsChanged();
+}
+
+int MetricsRegistry::bucketFor(double latencyMs)
+{
+    if (!(latencyMs > FirstBucketMs)) {
+        return 0;
+    }
+    const int bucket = int(std::ceil(4.0 * std::log2(latencyMs / FirstBucketMs)));
+    return qBound(0, bucket, BucketCount - 1);
+}
+
+double MetricsRegistry::bucketUpperMs(int bucket)
+{
+    return FirstBucketMs * std::exp2(double(bucket) / 4.0);
+}
+
+double MetricsRegistry::percentile(const std::array<quint64, BucketCount> &buckets, quint64 total, double fraction) const
+{
+    if (total == 0) {
+        return 0.0;
+    }
+    // Upper bound of the bucket holding the rank, so at most a quarter octave high
+    const quint64 rank = qMax<quint64>(1, quint64(std::ceil(fraction * double(total))));
+    quint64 seen = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return bucketUpperMs(i);
+        }
+    }
+    return bucketUpperMs(BucketCount - 1);
+}
+
+void MetricsRegistry::sample()
+{
+    const qint64 nowNs = m_clock.nsecsElapsed();
+
+    for (int model = 1; model < MaxModels; ++model) {
+        const Counters &counters = m_counters[model];
+        const Process process = m_processes[model];
+        const quint64 frames = counters.frames.load(std::memory_order_relaxed);
+        const qint64 spawnLatencyMs = counters.spawnLatencyMs.load(std::memory_order_relaxed);
+
+        qsizetype row = 0;
+        while (row < m_rows.size() && m_rows[row].model < model) {
+            ++row;
+        }
+        const bool listed = row < m_rows.size() && m_rows[row].model == model;
+        if (!listed) {
+            // Models that have not been started this run get no row
+            if (frames == 0 && spawnLatencyMs < 0 && process.pid == 0) {
+                continue;
+            }
+            beginInsertRows(QModelIndex(), int(row), int(row));
+            Sample added;
+            added.model = model;
+            added.name = m_names[model].isEmpty() ? QString::number(model) : m_names[model];
+            m_rows.insert(row, added);
+            endInsertRows();
+            emit countChanged();
+        }
+
+        Sample &sample = m_rows[row];
+        sample.spawnLatencyMs = spawnLatencyMs;
+        sample.firstFrameMs = counters.firstFrameMs.load(std::memory_order_relaxed);
+        sample.dropped = counters.dropped.load(std::memory_order_relaxed);
+        sample.latencySumMs = double(counters.latencySumUs.load(std::memory_order_relaxed)) / 1000.0;
+
+        std::array<quint64, BucketCount> buckets;
+        quint64 total = 0;
+        for (int i = 0; i < BucketCount; ++i) {
+            buckets[i] = counters.buckets[i].load(std::memory_order_relaxed);
+            total += buckets[i];
+        }
+        sample.p50 = percentile(buckets, total, 0.50);
+        sample.p95 = percentile(buckets, total, 0.95);
+        sample.p99 = percentile(buckets, total, 0.99);
+
+        if (sample.previousSampleNs > 0 && frames >= sample.previousFrames) {
+            const double seconds = double(nowNs - sample.previousSampleNs) / 1e9;
+            sample.fps = seconds > 0.0 ? double(frames - sample.previousFrames) / seconds : 0.0;
+        }
+        sample.frames = frames;
+        sample.previousFrames = frames;
+
+        readProcess(sample, process.pid, nowNs);
+        sample.inProcess = process.inProcess;
+        sample.previousSampleNs = nowNs;
+    }
+
+    // The dashboard's own process is counted once, however many models run in it
+    m_totalCpuPercent = 0.0;
+    m_totalRssMb = 0.0;
+    bool inProcessCounted = false;
+    for (const Sample &sample : std::as_const(m_rows)) {
+        if (sample.inProcess && std::exchange(inProcessCounted, true)) {
+            continue;
+        }
+        m_totalCpuPercent += sample.cpuPercent;
+        m_totalRssMb += sample.rssMb;
+    }
+
+    m_poolStats = FramePool::instance().stats();
+    m_queueStats = FrameQueueBase::allStats();
+
+    if (!m_rows.isEmpty()) {
+        emit dataChanged(index(0), index(int(m_rows.size()) - 1));
+    }
+    emit sampled();
+    exportSample();
+}
+
+double MetricsRegistry::queueDrops() const
+{
+    quint64 drops = m_poolStats.exhausted;
+    for (const FrameQueueBase::Stats &queue : m_queueStats) {
+        drops += queue.droppedNewest + queue.droppedOldest;
+    }
+    return double(drops);
+}
+
+void MetricsRegistry::readProcess(Sample &sample, qint64 pid, qint64 nowNs)
+{
+    if (pid != sample.pid) {
+        sample.pid = pid;
+        sample.previousCpuTicks = 0;
+        sample.cpuPercent = 0.0;
+        sample.rssMb = 0.0;
+    }
+    if (pid <= 0) {
+        return;
+    }
+
+    QFile file(QString("/proc/%1/stat").arg(pid));
+    if (!file.open(QIODevice::ReadOnly)) {
+        sample.cpuPercent = 0.0;
+        sample.rssMb = 0.0;
+        return;
+    }
+    // The command name may hold spaces and parentheses; the fields follow the last ')'
+    const QByteArray stat = file.readAll();
+    const QList<QByteArray> fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+    if (fields.size() < 22) {
+        return;
+    }
+    // Fields 14, 15 and 24 of proc(5): utime, stime (clock ticks) and rss (pages)
+    const quint64 ticks = fields[11].toULongLong() + fields[12].toULongLong();
+    static const double ticksPerSecond = double(sysconf(_SC_CLK_TCK));
+    static const double pageSize = double(sysconf(_SC_PAGESIZE));
+
+    if (sample.previousCpuTicks > 0 && sample.previousSampleNs > 0 && ticks >= sample.previousCpuTicks) {
+        const double seconds = double(nowNs - sample.previousSampleNs) / 1e9;
+        sample.cpuPercent = seconds > 0.0
+                ? 100.0 * double(ticks - sample.previousCpuTicks) / ticksPerSecond / seconds
+                : 0.0;
+    }
+    sample.previousCpuTicks = qMax<quint64>(ticks, 1);
+    sample.rssMb = fields[21].toDouble() * pageSize / (1024.0 * 1024.0);
+}
+
+double MetricsRegistry::peakRssMb(qint64 pid)
+{
+    QFile file(QString("/proc/%1/status").arg(pid));
+    if (pid <= 0 || !file.open(QIODevice::ReadOnly)) {
+        return 0.0;
+    }
+    // "VmHWM:\t  123456 kB"
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    for (const QByteArray &line : lines) {
+        if (line.startsWith("VmHWM:")) {
+            return line.mid(6).simplified().split(' ').value(0).toDouble() / 1024.0;
+        }
+    }
+    return 0.0;
+}
+
+double MetricsRegistry::cpuSeconds(qint64 pid)
+{
+    QFile file(QString("/proc/%1/stat").arg(pid));
+    if (pid <= 0 || !file.open(QIODevice::ReadOnly)) {
+        return 0.0;
+    }
+    const QByteArray stat = file.readAll();
+    const QList<QByteArray> fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+    if (fields.size() < 13) {
+        return 0.0;
+    }
+    static const double ticksPerSecond = double(sysconf(_SC_CLK_TCK));
+    return double(fields[11].toULongLong() + fields[12].toULongLong()) / ticksPerSecond;
+}
+
+void MetricsRegistry::exportSample()
+{
+    if (m_exportPath.isEmpty()) {
+        return;
+    }
+    const bool json = m_exportPath.endsWith(".json", Qt::CaseInsensitive);
+
+    // Replaced whole, so a scraper never reads half a sample
+    QSaveFile file(m_exportPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "MetricsRegistry: could not write" << m_exportPath << ":" << file.errorString();
+        m_exportPath.clear();
+        return;
+    }
+    file.write((json ? toJson() : toPrometheus()).toUtf8());
+    file.commit();
+}
+
+QString MetricsRegistry::toJson() const
+{
+    QJsonArray models;
+    for (const Sample &sample : m_rows) {
+        QJsonObject model;
+        model["model"] = sample.model;
+        model["name"] = sample.name;
+        model["spawnLatencyMs"] = sample.spawnLatencyMs;
+        model["firstFrameMs"] = sample.firstFrameMs;
+        model["fps"] = sample.fps;
+        model["latencyP50Ms"] = sample.p50;
+        model["latencyP95Ms"] = sample.p95;
+        model["latencyP99Ms"] = sample.p99;
+        model["latencySumMs"] = sample.latencySumMs;
+        model["frames"] = double(sample.frames);
+        model["droppedFrames"] = double(sample.dropped);
+        model["cpuPercent"] = sample.cpuPercent;
+        model["rssMb"] = sample.rssMb;
+        model["inProcess"] = sample.inProcess;
+        models.append(model);
+    }
+
+    QJsonObject root;
+    root["time"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+    root["totalCpuPercent"] = m_totalCpuPercent;
+    root["totalRssMb"] = m_totalRssMb;
+    root["models"] = models;
+
+    QJsonObject pool;
+    pool["budgetBytes"] = double(m_poolStats.budgetBytes);
+    pool["allocatedBytes"] = double(m_poolStats.allocatedBytes);
+    pool["inUseBytes"] = double(m_poolStats.inUseBytes);
+    pool["peakInUseBytes"] = double(m_poolStats.peakInUseBytes);
+    pool["slabs"] = m_poolStats.slabs;
+    pool["slabsInUse"] = m_poolStats.slabsInUse;
+    pool["acquired"] = double(m_poolStats.acquired);
+    pool["exhausted"] = double(m_poolStats.exhausted);
+    root["framePool"] = pool;
+
+    QJsonArray queues;
+    for (const FrameQueueBase::Stats &stats : m_queueStats) {
+        QJsonObject queue;
+        queue["stage"] = stats.name;
+        queue["backPressure"] = FrameQueueBase::backPressureName(stats.backPressure);
+        queue["depth"] = stats.depth;
+        queue["queued"] = stats.queued;
+        queue["pushed"] = double(stats.pushed);
+        queue["droppedNewest"] = double(stats.droppedNewest);
+        queue["droppedOldest"] = double(stats.droppedOldest);
+        queue["blockTimeouts"] = double(stats.blockTimeouts);
+        queue["blockedMs"] = double(stats.blockedMs);
+        queues.append(queue);
+    }
+    root["queues"] = queues;
+    return QString::fromUtf8(QJsonDocument(root).toJson(QJsonDocument::Compact)) + '\n';
+}
+
+QString MetricsRegistry::toPrometheus() const
+{
+    QString text;
+    auto family = [&text](const char *name, const char *type, const char *help) {
+        text += QString("# HELP neurodrive_%1 %2\n# TYPE neurodrive_%1 %3\n").arg(name, help, type);
+    };
+    auto line = [&text](const char *name, const QString &labels, double value) {
+        text += QString("neurodrive_%1{%2} %3\n").arg(name, labels, QString::number(value, 'g', 10));
+    };
+    auto labels = [](const Sample &sample) {
+        QString name = sample.name;
+        name.replace('\\', "\\\\").replace('"', "\\\"");
+        return QString("model=\"%1\"").arg(name);
+    };
+
+    family("spawn_latency_ms", "gauge", "Start request to the worker's first event");
+    for (const Sample &sample : m_rows) {
+        if (sample.spawnLatencyMs >= 0) {
+            line("spawn_latency_ms", labels(sample), double(sample.spawnLatencyMs));
+        }
+    }
+    family("first_frame_ms", "gauge", "Start request to the first processed frame");
+    for (const Sample &sample : m_rows) {
+        if (sample.firstFrameMs >= 0) {
+            line("first_frame_ms", labels(sample), double(sample.firstFrameMs));
+        }
+    }
+    family("fps", "gauge", "Frames processed per second over the last sample");
+    for (const Sample &sample : m_rows) {
+        line("fps", labels(sample), sample.fps);
+    }
+    family("inference_latency_ms", "summary", "Per-frame inference latency");
+    for (const Sample &sample : m_rows) {
+        const QString model = labels(sample);
+        line("inference_latency_ms", model + ",quantile=\"0.5\"", sample.p50);
+        line("inference_latency_ms", model + ",quantile=\"0.95\"", sample.p95);
+        line("inference_latency_ms", model + ",quantile=\"0.99\"", sample.p99);
+        line("inference_latency_ms_sum", model, sample.latencySumMs);
+        line("inference_latency_ms_count", model, double(sample.frames));
+    }
+    family("dropped_frames_total", "counter", "Source frames the model never processed");
+    for (const Sample &sample : m_rows) {
+        line("dropped_frames_total", labels(sample), double(sample.dropped));
+    }
+    family("cpu_percent", "gauge", "CPU use of the worker process, 100 per core");
+    for (const Sample &sample : m_rows) {
+        line("cpu_percent", labels(sample) + QString(",in_process=\"%1\"").arg(sample.inProcess ? "true" : "false"),
+             sample.cpuPercent);
+    }
+    family("rss_bytes", "gauge", "Resident memory of the worker process");
+    for (const Sample &sample : m_rows) {
+        line("rss_bytes", labels(sample) + QString(",in_process=\"%1\"").arg(sample.inProcess ? "true" : "false"),
+             sample.rssMb * 1024.0 * 1024.0);
+    }
+
+    family("frame_pool_bytes", "gauge", "Frame pool memory by state");
+    line("frame_pool_bytes", "state=\"budget\"", double(m_poolStats.budgetBytes));
+    line("frame_pool_bytes", "state=\"allocated\"", double(m_poolStats.allocatedBytes));
+    line("frame_pool_bytes", "state=\"in_use\"", double(m_poolStats.inUseBytes));
+    line("frame_pool_bytes", "state=\"peak_in_use\"", double(m_poolStats.peakInUseBytes));
+    family("frame_pool_exhausted_total", "counter", "Frame buffer requests refused over the pool's budget");
+    line("frame_pool_exhausted_total", QString(), double(m_poolStats.exhausted));
+
+    auto stage = [](const FrameQueueBase::Stats &stats) {
+        QString name = stats.name;
+        name.replace('\\', "\\\\").replace('"', "\\\"");
+        return QString("stage=\"%1\",policy=\"%2\"").arg(name, FrameQueueBase::backPressureName(stats.backPressure));
+    };
+    family("frame_queue_frames", "gauge", "Frames held by a pipeline stage, the one in process included");
+    for (const FrameQueueBase::Stats &stats : m_queueStats) {
+        line("frame_queue_frames", stage(stats), double(stats.queued));
+    }
+    family("frame_queue_dropped_total", "counter", "Frames a pipeline stage dropped under back-pressure");
+    for (const FrameQueueBase::Stats &stats : m_queueStats) {
+        line("frame_queue_dropped_total", stage(stats) + ",dropped=\"newest\"", double(stats.droppedNewest));
+        line("frame_queue_dropped_total", stage(stats) + ",dropped=\"oldest\"", double(stats.droppedOldest));
+    }
+    family("frame_queue_blocked_ms_total", "counter", "Time producers waited on a blocking stage");
+    for (const FrameQueueBase::Stats &stats : m_queueStats) {
+        line("frame_queue_blocked_ms_total", stage(stats), double(stats.blockedMs));
+    }
+    return text;
+}
+
+int MetricsRegistry::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(m_rows.size());
+}
+
+QVariant MetricsRegistry::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size()) {
+        return QVariant();
+    }
+    const Sample &sample = m_rows[index.row()];
+    switch (role) {
+    case ModelRole: return sample.model;
+    case Qt::DisplayRole:
+    case NameRole: return sample.name;
+    case SpawnLatencyRole: return sample.spawnLatencyMs;
+    case FirstFrameRole: return sample.firstFrameMs;
+    case FpsRole: return sample.fps;
+    case P50Role: return sample.p50;
+    case P95Role: return sample.p95;
+    case P99Role: return sample.p99;
+    case FramesRole: return double(sample.frames);
+    case DroppedRole: return double(sample.dropped);
+    case CpuRole: return sample.cpuPercent;
+    case RssRole: return sample.rssMb;
+    case InProcessRole: return sample.inProcess;
+    default: return QVariant();
+    }
+}
+
+QHash<int, QByteArray> MetricsRegistry::roleNames() const
+{
+    return {
+        {ModelRole, "model"},
+        {NameRole, "name"},
+        {SpawnLatencyRole, "spawnLatencyMs"},
+        {FirstFrameRole, "firstFrameMs"},
+        {FpsRole, "fps"},
+        {P50Role, "p50"},
+        {P95Role, "p95"},
+        {P99Role, "p99"},
+        {FramesRole, "frames"},
+        {DroppedRole, "dropped"},
+        {CpuRole, "cpuPercent"},
+        {RssRole, "rssMb"},
+        {InProcessRole, "inProcess"}
+    };
+}
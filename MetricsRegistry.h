@@ -0,0 +1,172 @@
+#ifndef METRICSREGISTRY_H
+#define METRICSREGISTRY_H
+
+#include <QAbstractListModel>
+#include <QElapsedTimer>
+#include <QList>
+#include <QTimer>
+#include "FramePool.h"
+#include "FrameQueue.h"
+
+#include <array>
+#include <atomic>
+
+class QLocalServer;
+
+// Runtime metrics of every model in the current run: spawn latency, time to
+// first frame, processed fps, inference latency percentiles, dropped frames
+// and the worker's RSS and CPU from /proc, plus the occupancy of the frame
+// pool and the drops of every stage's frame queue. Recording a frame touches only
+// relaxed atomics, so it may be called from any thread; everything else is
+// computed once per sample on the GUI thread.
+//
+// As a list model there is one row per model seen in the run, for the
+// performance HUD. The samples are also written to NEURODRIVE_METRICS_FILE
+// (JSON when it ends in .json, Prometheus text otherwise) and served as
+// Prometheus text to every client of the local socket NEURODRIVE_METRICS_SOCKET.
+class MetricsRegistry : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(double totalCpuPercent READ totalCpuPercent NOTIFY sampled)
+    Q_PROPERTY(double totalRssMb READ totalRssMb NOTIFY sampled)
+    Q_PROPERTY(double framePoolInUseMb READ framePoolInUseMb NOTIFY sampled)
+    Q_PROPERTY(double framePoolAllocatedMb READ framePoolAllocatedMb NOTIFY sampled)
+    Q_PROPERTY(double framePoolBudgetMb READ framePoolBudgetMb NOTIFY sampled)
+    Q_PROPERTY(double queueDrops READ queueDrops NOTIFY sampled)
+    Q_PROPERTY(int sampleIntervalMs READ sampleIntervalMs WRITE setSampleIntervalMs NOTIFY sampleIntervalMsChanged)
+
+public:
+    static constexpr int MaxModels = 8;  // Model ids are ProcessManager::ModelType values
+
+    // Latency buckets grow by a quarter octave from 0.25 ms, up to about 14 s
+    static constexpr int BucketCount = 64;
+    static constexpr double FirstBucketMs = 0.25;
+
+    enum Roles {
+        ModelRole = Qt::UserRole + 1,
+        NameRole,
+        SpawnLatencyRole,
+        FirstFrameRole,
+        FpsRole,
+        P50Role,
+        P95Role,
+        P99Role,
+        FramesRole,
+        DroppedRole,
+        CpuRole,
+        RssRole,
+        InProcessRole
+    };
+
+    explicit MetricsRegistry(QObject *parent = nullptr);
+    ~MetricsRegistry();
+
+    void setModelName(int model, const QString &name);
+
+    // Hot path; safe from any thread
+    void recordFrame(int model, qint64 frameIndex, double latencyMs);
+    void recordDropped(int model, quint64 frames);
+
+    // Starts a new run: every model's counters are cleared
+    void beginRun();
+    void recordSpawnLatency(int model, qint64 milliseconds);
+    // pid 0 once the worker is gone; inProcess marks models run by the dashboard itself
+    void setProcessId(int model, qint64 pid, bool inProcess = false);
+    // Peak RSS (VmHWM) of a live process, or 0 when it cannot be read
+    static double peakRssMb(qint64 pid);
+    // User and system CPU time of a live process so far, or 0 when it cannot be read
+    static double cpuSeconds(qint64 pid);
+
+    int count() const { return int(m_rows.size()); }
+    double totalCpuPercent() const { return m_totalCpuPercent; }
+    double totalRssMb() const { return m_totalRssMb; }
+    double framePoolInUseMb() const { return double(m_poolStats.inUseBytes) / (1024.0 * 1024.0); }
+    double framePoolAllocatedMb() const { return double(m_poolStats.allocatedBytes) / (1024.0 * 1024.0); }
+    double framePoolBudgetMb() const { return double(m_poolStats.budgetBytes) / (1024.0 * 1024.0); }
+    // Frames dropped by every stage's queue, plus pool requests over budget
+    double queueDrops() const;
+    int sampleIntervalMs() const { return m_sampleTimer.interval(); }
+    void setSampleIntervalMs(int milliseconds);
+
+    Q_INVOKABLE QString toJson() const;
+    Q_INVOKABLE QString toPrometheus() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void countChanged();
+    void sampled();
+    void sampleIntervalMsChanged();
+
+private:
+    struct Counters
+    {
+        std::atomic<quint64> frames{0};
+        std::atomic<quint64> dropped{0};
+        std::atomic<qint64> lastFrameIndex{-1};
+        std::atomic<quint64> latencySumUs{0};
+        std::atomic<qint64> spawnLatencyMs{-1};
+        std::atomic<qint64> firstFrameMs{-1};
+        std::array<std::atomic<quint64>, BucketCount> buckets{};
+    };
+
+    // What the last sample saw, read by the model and the exports
+    struct Sample
+    {
+        int model = 0;
+        QString name;
+        qint64 spawnLatencyMs = -1;
+        qint64 firstFrameMs = -1;
+        double fps = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double latencySumMs = 0.0;
+        quint64 frames = 0;
+        quint64 dropped = 0;
+        double cpuPercent = 0.0;
+        double rssMb = 0.0;
+        bool inProcess = false;
+
+        // Previous readings, for the rates
+        qint64 pid = 0;
+        quint64 previousFrames = 0;
+        quint64 previousCpuTicks = 0;
+        qint64 previousSampleNs = 0;
+    };
+
+    struct Process
+    {
+        qint64 pid = 0;
+        bool inProcess = false;
+    };
+
+    void sample();
+    void readProcess(Sample &sample, qint64 pid, qint64 nowNs);
+    void exportSample();
+    static int bucketFor(double latencyMs);
+    static double bucketUpperMs(int bucket);
+    double percentile(const std::array<quint64, BucketCount> &buckets, quint64 total, double fraction) const;
+    bool validModel(int model) const { return model > 0 && model < MaxModels; }
+
+    std::array<Counters, MaxModels> m_counters;
+    std::array<QString, MaxModels> m_names;
+    std::array<Process, MaxModels> m_processes;
+    std::atomic<qint64> m_runStartNs{0};  // On m_clock, for time to first frame
+
+    QList<Sample> m_rows;  // Models seen this run, in model order
+    double m_totalCpuPercent = 0.0;
+    double m_totalRssMb = 0.0;
+    FramePool::Stats m_poolStats;
+    QList<FrameQueueBase::Stats> m_queueStats;
+    QElapsedTimer m_clock;  // Never restarted, so any thread may read it
+    QTimer m_sampleTimer;
+
+    QString m_exportPath;
+    QLocalServer *m_server = nullptr;
+};
+
+#endif // METRICSREGISTRY_H
@@ -1,24 +1,103 @@
 #include "NetworkService.h"
+#include "PerfLog.h"
 #include <QDebug>
 #include <QFileInfo>
 #include <QCoreApplication>
 #include <QSslSocket>
+#include <QImage>
+#include <QImageReader>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QSaveFile>
+#include <QStandardPaths>
 
-NetworkService::NetworkService(QObject *parent) : QObject(parent)
+#include <cstring>
+
+namespace {
+
+// Writes the base64 of data to out, which must have room for ((size + 2) / 3) * 4
+// bytes, and returns the end of what was written
+char *encodeBase64(const QByteArray &data, char *out)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const uchar *in = reinterpret_cast<const uchar*>(data.constData());
+    const qsizetype size = data.size();
+    qsizetype i = 0;
+    for (; i + 2 < size; i += 3) {
+        const quint32 triple = (quint32(in[i]) << 16) | (quint32(in[i + 1]) << 8) | in[i + 2];
+        *out++ = alphabet[(triple >> 18) & 0x3F];
+        *out++ = alphabet[(triple >> 12) & 0x3F];
+        *out++ = alphabet[(triple >> 6) & 0x3F];
+        *out++ = alphabet[triple & 0x3F];
+    }
+    if (i < size) {
+        const quint32 triple = (quint32(in[i]) << 16) | (i + 1 < size ? quint32(in[i + 1]) << 8 : 0u);
+        *out++ = alphabet[(triple >> 18) & 0x3F];
+        *out++ = alphabet[(triple >> 12) & 0x3F];
+        *out++ = i + 1 < size ? alphabet[(triple >> 6) & 0x3F] : '=';
+        *out++ = '=';
+    }
+    return out;
+}
+
+} // namespace
+
+NetworkService::NetworkService(QObject *parent)
+    : QObject(parent)
+    , m_verificationCache(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation),
+                          qEnvironmentVariable("NEURODRIVE_VERIFICATION_KEY_DIR",
+                                               QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation)))
 {
     m_networkManager = new QNetworkAccessManager(this);
     
     // Set up SSL configuration to ignore certificate validation (FOR DEVELOPMENT ONLY!)
     m_sslConfig = QSslConfiguration::defaultConfiguration();
     m_sslConfig.setPeerVerifyMode(QSslSocket::VerifyNone);
+
+    // HTTP/2 where the server offers it, and session tickets we can store
+    m_sslConfig.setAllowedNextProtocols({ QSslConfiguration::ALPNProtocolHTTP2,
+                                          QSslConfiguration::NextProtocolHttp1_1 });
+    m_sslConfig.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+
+    //the actual url for live web; NEURODRIVE_VERIFY_URL points at a local
+    //stand-in such as verify_server.py (https://localhost:5041/api/verify-driver)
+    m_verifyUrl = QUrl(qEnvironmentVariable("NEURODRIVE_VERIFY_URL",
+                                            "https://neurodrive.runasp.net/api/verify-driver"));
+
+    m_keepWarmTimer.setInterval(KeepWarmIntervalMs);
+    connect(&m_keepWarmTimer, &QTimer::timeout, this, &NetworkService::preconnect);
+    connect(this, &NetworkService::verificationComplete, this, [this](bool success) {
+        if (success) {
+            m_keepWarmTimer.stop();
+        }
+    });
     
     qDebug() << "SSL support available:" << QSslSocket::supportsSsl();
     qDebug() << "SSL library version:" << QSslSocket::sslLibraryVersionString();
 }
 
+void NetworkService::startServices()
+{
+    if (m_servicesStarted) {
+        return;
+    }
+    m_servicesStarted = true;
+
+    // The session ticket and the cache are read from disk only now
+    loadSessionTicket();
+    m_verificationCache.open();
+    if (m_preconnectRequested) {
+        preconnect();
+    }
+}
+
 bool NetworkService::verifyDriver(const QString &carId, const QString &imagePath)
 {
-    // Convert image to base64
+    QElapsedTimer clock;
+    clock.start();
+    startServices();
+
     // Handle both absolute and relative paths
     QString absoluteImagePath = imagePath;
     if (!QFileInfo(imagePath).isAbsolute()) {
@@ -26,34 +105,78 @@ bool NetworkService::verifyDriver(const QString &carId, const QString &imagePath
         qDebug() << "Converting relative path to absolute:" << absoluteImagePath;
     }
     
-    QString base64Image = imageToBase64(absoluteImagePath);
-    if (base64Image.isEmpty()) {
-        emit verificationComplete(false, "Failed to load image");
-        return false;
+    // A recent verification of the same driver and car is answered at once and
+    // revalidated below; the reply only matters if the server disagrees
+    const QByteArray fingerprint = VerificationCache::fingerprint(absoluteImagePath);
+    VerificationCache::Entry cached;
+    const bool answeredLocally = !fingerprint.isEmpty() && m_verificationCache.lookup(carId, fingerprint, &cached);
+    if (answeredLocally) {
+        qDebug() << "Driver verified from cache in" << double(clock.nsecsElapsed()) / 1e6
+                 << "ms, revalidating in the background";
+        PerfLog::record("login.cache_answer", double(clock.nsecsElapsed()) / 1e6, "ms");
+        // Queued, so QML gets the signal after this call returns as for a server answer
+        QMetaObject::invokeMethod(this, [this, cached]() {
+            emit verificationComplete(true, "Welcome " + cached.driverName);
+        }, Qt::QueuedConnection);
     }
+
+    QString encodeError;
+    const QByteArray jpeg = encodeCapture(absoluteImagePath, &encodeError);
+    if (jpeg.isEmpty()) {
+        if (!answeredLocally) {
+            emit verificationComplete(false, encodeError);
+        }
+        return answeredLocally;
+    }
+    const QByteArray data = buildPayload(carId, jpeg);
+    const double buildMs = double(clock.nsecsElapsed()) / 1e6;
+    qDebug() << "Verification payload:" << jpeg.size() << "byte JPEG," << data.size() << "byte body, built in"
+             << buildMs << "ms";
+    PerfLog::record("login.payload_build", buildMs, "ms",
+                    {{"imageBytes", jpeg.size()}, {"payloadBytes", data.size()}});
+    emit payloadPrepared(jpeg.size(), data.size(), buildMs);
     
     // Prepare the request
-   // QNetworkRequest request(QUrl("https://localhost:5041/api/verify-driver"));
-
-    //the actual url for live web
-    QNetworkRequest request(QUrl("https://neurodrive.runasp.net/api/verify-driver"));
+    QNetworkRequest request(m_verifyUrl);
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    request.setHeader(QNetworkRequest::ContentLengthHeader, data.size());
+    request.setTransferTimeout(TransferTimeoutMs);
     
     // Apply SSL configuration that ignores certificate validation
     request.setSslConfiguration(m_sslConfig);
     
-    // Create the JSON payload
-    QJsonObject jsonObj;
-    jsonObj["carId"] = carId;
-    jsonObj["imageBase64"] = "data:image/jpeg;base64," + base64Image;
-    
-    QJsonDocument doc(jsonObj);
-    QByteArray data = doc.toJson();
-    
     qDebug() << "Sending request to:" << request.url().toString();
     
     // Send the POST request
+    QElapsedTimer sent;
+    sent.start();
     QNetworkReply *reply = m_networkManager->post(request, data);
+
+    // No new socket means the request went out on the pre-connected connection
+    connect(reply, &QNetworkReply::socketStartedConnecting, reply, [reply]() {
+        reply->setProperty("newConnection", true);
+    });
+    // A new connection resumed only if the handshake kept the session of the
+    // offered ticket; a server rejecting it makes a new one
+    const QByteArray offeredTicket = m_sslConfig.sessionTicket();
+    connect(reply, &QNetworkReply::encrypted, reply, [reply, offeredTicket]() {
+        reply->setProperty("sessionResumed",
+                           !offeredTicket.isEmpty() && reply->sslConfiguration().sessionTicket() == offeredTicket);
+    });
+    connect(reply, &QNetworkReply::metaDataChanged, reply, [this, reply, sent, offeredTicket]() {
+        if (reply->property("firstByteReported").toBool()) {
+            return;
+        }
+        reply->setProperty("firstByteReported", true);
+        const QString connection = !reply->property("newConnection").toBool()
+                ? "warm" : (reply->property("sessionResumed").toBool() ? "resumed" : "cold");
+        const bool http2 = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+        qDebug() << "Verification time to first byte:" << sent.elapsed() << "ms," << connection
+                 << (http2 ? "HTTP/2" : "HTTP/1.1");
+        PerfLog::record("login.first_byte", sent.elapsed(), "ms",
+                        {{"connection", connection}, {"ticket_offered", !offeredTicket.isEmpty()}, {"http2", http2}});
+        emit firstByteReceived(sent.elapsed(), connection);
+    });
     
     // Connect to network errors
     connect(reply, &QNetworkReply::sslErrors, [reply](const QList<QSslError> &errors) {
@@ -63,7 +186,11 @@ bool NetworkService::verifyDriver(const QString &carId, const QString &imagePath
     });
     
     // Connect to the finished signal to handle the response
-    connect(reply, &QNetworkReply::finished, [this, reply]() {
+    connect(reply, &QNetworkReply::finished, [this, reply, clock, carId, fingerprint, answeredLocally]() {
+        qDebug() << "Verification round trip:" << clock.elapsed() << "ms";
+        PerfLog::record("login.round_trip", clock.elapsed(), "ms",
+                        {{"cached", answeredLocally}, {"error", int(reply->error())}});
+        saveSessionTicket(reply->sslConfiguration());
         if (reply->error() == QNetworkReply::NoError) {
             QByteArray responseData = reply->readAll();
             QJsonDocument responseDoc = QJsonDocument::fromJson(responseData);
@@ -77,16 +204,34 @@ bool NetworkService::verifyDriver(const QString &carId, const QString &imagePath
                 
                 if (success && isAuthorized) {
                     QString driverName = responseObj["driverName"].toString();
-                    emit verificationComplete(true, "Welcome " + driverName);
+                    m_verificationCache.store(carId, driverName, fingerprint);
+                    if (!answeredLocally) {
+                        emit verificationComplete(true, "Welcome " + driverName);
+                    }
+                } else if (success && answeredLocally) {
+                    // An explicit refusal also ends the session it let in
+                    m_verificationCache.revoke(carId, fingerprint);
+                    emit verificationRevoked(message);
+                } else if (success) {
+                    m_verificationCache.revoke(carId, fingerprint);
+                    emit verificationComplete(false, message);
+                } else if (answeredLocally) {
+                    dropUnconfirmed(carId, fingerprint);
                 } else {
                     emit verificationComplete(false, message);
                 }
+            } else if (answeredLocally) {
+                dropUnconfirmed(carId, fingerprint);
             } else {
                 emit verificationComplete(false, "Invalid response format");
             }
         } else {
             qDebug() << "Error:" << reply->errorString();
-            emit verificationComplete(false, "Login failed: " + reply->errorString());
+            if (answeredLocally) {
+                dropUnconfirmed(carId, fingerprint);
+            } else {
+                emit verificationComplete(false, "Login failed: " + reply->errorString());
+            }
         }
         
         reply->deleteLater();
@@ -95,19 +240,173 @@ bool NetworkService::verifyDriver(const QString &carId, const QString &imagePath
     return true;
 }
 
-QString NetworkService::imageToBase64(const QString &imagePath)
+void NetworkService::dropUnconfirmed(const QString &carId, const QByteArray &fingerprint)
+{
+    // Not a refusal, so the session goes on, but the entry is not served
+    // again until the server confirms the driver
+    qDebug() << "Revalidation failed, dropping the cached verification";
+    m_verificationCache.revoke(carId, fingerprint);
+}
+
+void NetworkService::preconnect()
+{
+    // The login page asks as it loads; the connection waits for the ticket
+    if (!m_servicesStarted) {
+        m_preconnectRequested = true;
+        return;
+    }
+    // DNS, TCP and the TLS handshake happen here instead of after the tap
+    const quint16 port = quint16(m_verifyUrl.port(443));
+    qDebug() << "Pre-connecting to" << m_verifyUrl.host() << port << (m_ticketOffered ? "with a stored session ticket" : "");
+    m_networkManager->connectToHostEncrypted(m_verifyUrl.host(), port, m_sslConfig);
+    if (!m_keepWarmTimer.isActive()) {
+        m_keepWarmTimer.start();
+    }
+}
+
+QString NetworkService::sessionTicketPath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/tls-session.bin";
+}
+
+void NetworkService::loadSessionTicket()
+{
+    QFile file(sessionTicketPath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QDataStream stream(&file);
+    QString host;
+    qint64 expiresAtMs = 0;
+    QByteArray ticket;
+    stream >> host >> expiresAtMs >> ticket;
+    if (stream.status() != QDataStream::Ok || host != m_verifyUrl.host() || ticket.isEmpty()
+            || expiresAtMs <= QDateTime::currentMSecsSinceEpoch()) {
+        return;
+    }
+    m_sslConfig.setSessionTicket(ticket);
+    m_ticketOffered = true;
+    qDebug() << "Loaded TLS session ticket for" << host << "valid for"
+             << (expiresAtMs - QDateTime::currentMSecsSinceEpoch()) / 1000 << "s";
+}
+
+void NetworkService::saveSessionTicket(const QSslConfiguration &configuration)
+{
+    const QByteArray ticket = configuration.sessionTicket();
+    if (ticket.isEmpty() || ticket == m_sslConfig.sessionTicket()) {
+        return;
+    }
+    // Later connections in this run resume with it too
+    m_sslConfig.setSessionTicket(ticket);
+    m_ticketOffered = true;
+
+    const int lifetimeHint = configuration.sessionTicketLifeTimeHint();
+    const qint64 expiresAtMs = QDateTime::currentMSecsSinceEpoch()
+            + qint64(lifetimeHint > 0 ? lifetimeHint : 7200) * 1000;
+
+    QDir().mkpath(QFileInfo(sessionTicketPath()).absolutePath());
+    QSaveFile file(sessionTicketPath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Could not store TLS session ticket:" << file.errorString();
+        return;
+    }
+    QDataStream stream(&file);
+    stream << m_verifyUrl.host() << expiresAtMs << ticket;
+    if (file.commit()) {
+        // The ticket resumes our session, so only we may read it
+        QFile::setPermissions(sessionTicketPath(), QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    }
+}
+
+QByteArray NetworkService::encodeCapture(const QString &imagePath, QString *error)
 {
     qDebug() << "Attempting to open image:" << imagePath;
     QFile file(imagePath);
     if (!file.open(QIODevice::ReadOnly)) {
         qDebug() << "Failed to open image file:" << imagePath << "Error:" << file.errorString();
-        return QString();
+        if (error) {
+            *error = "Failed to load image";
+        }
+        return QByteArray();
     }
-    
-    QByteArray imageData = file.readAll();
-    file.close();
-    qDebug() << "Successfully loaded image, size:" << imageData.size() << "bytes";
-    
-    // Convert to base64
-    return QString(imageData.toBase64());
-} 
+
+    // Only the header is read here
+    QImageReader reader(&file);
+    const QSize size = reader.size();
+    const bool oversized = size.width() > MaxImageSide || size.height() > MaxImageSide;
+
+    // A JPEG that already fits is sent as it is
+    if (reader.format() == "jpeg" && size.isValid() && !oversized && file.size() <= MaxImageBytes) {
+        file.seek(0);
+        return file.readAll();
+    }
+
+    // Large JPEGs are decoded straight to the smaller size rather than scaled afterwards
+    if (oversized) {
+        reader.setScaledSize(size.scaled(MaxImageSide, MaxImageSide, Qt::KeepAspectRatio));
+    }
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qDebug() << "Failed to decode image:" << imagePath << "Error:" << reader.errorString();
+        if (error) {
+            *error = "Failed to load image";
+        }
+        return QByteArray();
+    }
+
+    // The quality goes down first; only at MinJpegQuality is resolution
+    // given up, a quarter per side at a time
+    QByteArray jpeg;
+    int quality = JpegQuality;
+    for (;;) {
+        jpeg.clear();
+        QBuffer buffer(&jpeg);
+        buffer.open(QIODevice::WriteOnly);
+        if (!image.save(&buffer, "JPEG", quality)) {
+            qDebug() << "Failed to encode image:" << imagePath;
+            if (error) {
+                *error = "Failed to encode image";
+            }
+            return QByteArray();
+        }
+        if (jpeg.size() <= MaxImageBytes) {
+            break;
+        }
+        if (quality > MinJpegQuality) {
+            quality = qMax(MinJpegQuality, quality - 15);
+            continue;
+        }
+        const QSize smaller = image.size() * 0.75;
+        if (qMax(smaller.width(), smaller.height()) < MinImageSide) {
+            // The server would refuse it; a smaller face would not be recognised
+            qWarning() << "NetworkService: capture" << imagePath << "is still" << jpeg.size() << "bytes at"
+                       << image.size() << ", not uploading it";
+            if (error) {
+                *error = "Capture is too large to upload";
+            }
+            return QByteArray();
+        }
+        image = image.scaled(smaller, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    qDebug() << "Re-encoded" << file.size() << "byte" << size << "image to" << jpeg.size() << "byte"
+             << image.size() << "JPEG at quality" << quality;
+    return jpeg;
+}
+
+QByteArray NetworkService::buildPayload(const QString &carId, const QByteArray &jpeg)
+{
+    // Compact JSON, with the image encoded straight into the body:
+    // {"carId":"...","imageBase64":"data:image/jpeg;base64,..."}
+    QByteArray head = QJsonDocument(QJsonObject{ { "carId", carId } }).toJson(QJsonDocument::Compact);
+    head.chop(1);  // The closing brace
+    head += ",\"imageBase64\":\"data:image/jpeg;base64,";
+    static const char tail[] = "\"}";
+
+    const qsizetype encodedSize = ((jpeg.size() + 2) / 3) * 4;
+    QByteArray body(head.size() + encodedSize + qsizetype(sizeof(tail) - 1), Qt::Uninitialized);
+    char *out = body.data();
+    std::memcpy(out, head.constData(), size_t(head.size()));
+    out = encodeBase64(jpeg, out + head.size());
+    std::memcpy(out, tail, sizeof(tail) - 1);
+    return body;
+}
@@ -13,6 +13,9 @@
 #include <QFileInfo>
 #include <QCoreApplication>
 #include <QSslConfiguration>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "VerificationCache.h"
 
 class NetworkService : public QObject
 {
@@ -22,13 +25,60 @@ public:
     explicit NetworkService(QObject *parent = nullptr);
     Q_INVOKABLE bool verifyDriver(const QString &carId, const QString &imagePath);
 
+    // Opens the TLS connection to the verification server ahead of the
+    // request and keeps it open until a driver is verified; asked before
+    // startServices(), it waits for it
+    Q_INVOKABLE void preconnect();
+
+    // Captures are re-encoded to fit these before upload
+    static constexpr int MaxImageSide = 1024;
+    static constexpr int MaxImageBytes = 256 * 1024;
+    static constexpr int JpegQuality = 85;
+    static constexpr int MinJpegQuality = 40;
+    static constexpr int MinImageSide = 256;  // Not scaled below to fit
+
+    // Below typical server keep-alive timeouts
+    static constexpr int KeepWarmIntervalMs = 45000;
+    static constexpr int TransferTimeoutMs = 15000;
+
+    // The JPEG that is uploaded for a capture, never over MaxImageBytes;
+    // empty with the reason in error if it cannot be read or made to fit
+    static QByteArray encodeCapture(const QString &imagePath, QString *error = nullptr);
+    // The request body for a JPEG
+    static QByteArray buildPayload(const QString &carId, const QByteArray &jpeg);
+
+public slots:
+    // Loads the stored TLS session ticket and the verification cache, and
+    // makes a pre-connection asked for before; deferred from construction
+    // so the login page is up first, and run at the latest by verifyDriver()
+    void startServices();
+
 signals:
     void verificationComplete(bool success, const QString &message);
+    // The server refused a driver who had been let in from the cache
+    void verificationRevoked(const QString &message);
+    // Size of the JPEG and of the whole request body, and the time taken to build it
+    void payloadPrepared(qint64 imageBytes, qint64 payloadBytes, double buildMs);
+    // connection is "warm" (pre-connected), "resumed" (new connection whose
+    // handshake resumed the stored session) or "cold"
+    void firstByteReceived(qint64 milliseconds, const QString &connection);
 
 private:
     QNetworkAccessManager *m_networkManager;
     QSslConfiguration m_sslConfig;
-    QString imageToBase64(const QString &imagePath);
+    QUrl m_verifyUrl;
+    QTimer m_keepWarmTimer;
+    bool m_ticketOffered = false;
+    bool m_servicesStarted = false;
+    bool m_preconnectRequested = false;
+    VerificationCache m_verificationCache;
+
+    // TLS session tickets, kept across restarts so the first connection resumes
+    QString sessionTicketPath() const;
+    void loadSessionTicket();
+    void saveSessionTicket(const QSslConfiguration &configuration);
+    // A cached verification the server did not confirm, e.g. offline
+    void dropUnconfirmed(const QString &carId, const QByteArray &fingerprint);
 };
 
 #endif // NETWORKSERVICE_H 
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "ObjectTracker.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+float intersectionOverUnion(const ObjectTracker::Box &a, const ObjectTracker::Box &b)
+{
+    const float width = std::min(a.x2, b.x2) - std::max(a.x1, b.x1);
+    const float height = std::min(a.y2, b.y2) - std::max(a.y1, b.y1);
+    if (width <= 0.0f || height <= 0.0f) {
+        return 0.0f;
+    }
+    const float intersection = width * height;
+    const float areas = (a.x2 - a.x1) * (a.y2 - a.y1) + (b.x2 - b.x1) * (b.y2 - b.y1);
+    return intersection / (areas - intersection);
+}
+
+float area(const ObjectTracker::Box &box)
+{
+    return std::max(box.x2 - box.x1, 1.0f) * std::max(box.y2 - box.y1, 1.0f);
+}
+
+// Centre, width and height of a box, in the order of the track's axes
+void measure(const ObjectTracker::Box &box, float *values)
+{
+    values[0] = (box.x1 + box.x2) * 0.5f;
+    values[1] = (box.y1 + box.y2) * 0.5f;
+    values[2] = std::max(box.x2 - box.x1, 1.0f);
+    values[3] = std::max(box.y2 - box.y1, 1.0f);
+}
+
+class CostTimer
+{
+public:
+    explicit CostTimer(std::int64_t *total)
+        : m_total(total)
+        , m_start(std::chrono::steady_clock::now())
+    {
+    }
+    ~CostTimer()
+    {
+        *m_total += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    std::int64_t *m_total;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace
+
+void ObjectTracker::reset()
+{
+    m_tracks.clear();
+    m_nextId = 1;
+    m_calls = 0;
+    m_costNs = 0;
+}
+
+void ObjectTracker::propagate(Axis &axis, float dt, float height) const
+{
+    const float positionStd = m_policy.positionNoise * height;
+    const float velocityStd = m_policy.velocityNoise * height;
+    axis.x += axis.v * dt;
+    axis.p00 += dt * (2.0f * axis.p01 + dt * axis.p11) + positionStd * positionStd * dt;
+    axis.p01 += dt * axis.p11;
+    axis.p11 += velocityStd * velocityStd * dt;
+}
+
+void ObjectTracker::correct(Axis &axis, float measurement, float height) const
+{
+    const float measurementStd = m_policy.positionNoise * height;
+    const float innovation = measurement - axis.x;
+    const float variance = axis.p00 + measurementStd * measurementStd;
+    const float gainX = axis.p00 / variance;
+    const float gainV = axis.p01 / variance;
+    axis.x += gainX * innovation;
+    axis.v += gainV * innovation;
+    axis.p11 -= gainV * axis.p01;
+    axis.p00 -= gainX * axis.p00;
+    axis.p01 -= gainX * axis.p01;
+}
+
+ObjectTracker::Track ObjectTracker::predicted(const Track &track, std::int64_t frame) const
+{
+    Track result = track;
+    const float dt = float(frame - track.frame);
+    if (dt > 0.0f) {
+        const float height = std::max(track.axes[Height].x, 1.0f);
+        for (Axis &axis : result.axes) {
+            propagate(axis, dt, height);
+        }
+        result.frame = frame;
+    }
+    return result;
+}
+
+ObjectTracker::Box ObjectTracker::toBox(const Track &track)
+{
+    const float halfWidth = std::max(track.axes[Width].x, 1.0f) * 0.5f;
+    const float halfHeight = std::max(track.axes[Height].x, 1.0f) * 0.5f;
+    Box box;
+    box.classId = track.classId;
+    box.confidence = track.confidence;
+    box.x1 = track.axes[CentreX].x - halfWidth;
+    box.y1 = track.axes[CentreY].x - halfHeight;
+    box.x2 = track.axes[CentreX].x + halfWidth;
+    box.y2 = track.axes[CentreY].x + halfHeight;
+    box.trackId = track.id;
+    return box;
+}
+
+const std::vector<ObjectTracker::Box> &ObjectTracker::update(std::int64_t frame, std::vector<Box> &detections)
+{
+    CostTimer timer(&m_costNs);
+    ++m_calls;
+
+    // Past maxAgeFrames a track is not matched, however many frames were
+    // only predicted since the last update
+    m_tracks.erase(std::remove_if(m_tracks.begin(), m_tracks.end(), [this, frame](const Track &track) {
+        return frame - track.frame > m_policy.maxAgeFrames;
+    }), m_tracks.end());
+
+    const int trackCount = int(m_tracks.size());
+    const int detectionCount = int(detections.size());
+    m_predictions.clear();
+    m_predictedBoxes.clear();
+    for (const Track &track : m_tracks) {
+        m_predictions.push_back(predicted(track, frame));
+        m_predictedBoxes.push_back(toBox(m_predictions.back()));
+    }
+    m_trackMatch.assign(std::size_t(trackCount), -1);
+    m_detectionMatch.assign(std::size_t(detectionCount), -1);
+
+    auto assign = [this]() {
+        for (const Pair &pair : m_pairs) {
+            if (m_trackMatch[pair.track] < 0 && m_detectionMatch[pair.detection] < 0) {
+                m_trackMatch[pair.track] = pair.detection;
+                m_detectionMatch[pair.detection] = pair.track;
+            }
+        }
+    };
+
+    // Overlap with the prediction first, best pairs first
+    m_pairs.clear();
+    for (int t = 0; t < trackCount; ++t) {
+        for (int d = 0; d < detectionCount; ++d) {
+            if (detections[d].classId != m_predictions[t].classId) {
+                continue;
+            }
+            const float iou = intersectionOverUnion(m_predictedBoxes[t], detections[d]);
+            if (iou >= m_policy.minIou) {
+                m_pairs.push_back({ iou, t, d });
+            }
+        }
+    }
+    std::sort(m_pairs.begin(), m_pairs.end(), [](const Pair &a, const Pair &b) { return a.score > b.score; });
+    assign();
+
+    // Then the centre within the filter's uncertainty, nearest first; a box
+    // of a very different size is another object
+    m_pairs.clear();
+    for (int t = 0; t < trackCount; ++t) {
+        if (m_trackMatch[t] >= 0) {
+            continue;
+        }
+        const Track &track = m_predictions[t];
+        const float measurementStd = m_policy.positionNoise * std::max(track.axes[Height].x, 1.0f);
+        const float varianceX = track.axes[CentreX].p00 + measurementStd * measurementStd;
+        const float varianceY = track.axes[CentreY].p00 + measurementStd * measurementStd;
+        const float trackArea = area(m_predictedBoxes[t]);
+        for (int d = 0; d < detectionCount; ++d) {
+            if (m_detectionMatch[d] >= 0 || detections[d].classId != track.classId) {
+                continue;
+            }
+            const float ratio = area(detections[d]) / trackArea;
+            if (ratio < 0.25f || ratio > 4.0f) {
+                continue;
+            }
+            const float dx = (detections[d].x1 + detections[d].x2) * 0.5f - track.axes[CentreX].x;
+            const float dy = (detections[d].y1 + detections[d].y2) * 0.5f - track.axes[CentreY].x;
+            const float distance = dx * dx / varianceX + dy * dy / varianceY;
+            if (distance <= m_policy.centreGate) {
+                m_pairs.push_back({ distance, t, d });
+            }
+        }
+    }
+    std::sort(m_pairs.begin(), m_pairs.end(), [](const Pair &a, const Pair &b) { return a.score < b.score; });
+    assign();
+
+    // Matched tracks take the detection; the others coast on their last one
+    float values[AxisCount];
+    for (int t = 0; t < trackCount; ++t) {
+        Track &track = m_tracks[t];
+        const int d = m_trackMatch[t];
+        if (d < 0) {
+            ++track.missed;
+            continue;
+        }
+        track = m_predictions[t];
+        measure(detections[d], values);
+        const float height = std::max(track.axes[Height].x, 1.0f);
+        for (int i = 0; i < AxisCount; ++i) {
+            correct(track.axes[i], values[i], height);
+        }
+        track.frame = frame;
+        track.missed = 0;
+        track.confidence = detections[d].confidence;
+        detections[d].trackId = track.id;
+    }
+    for (int d = 0; d < detectionCount; ++d) {
+        if (m_detectionMatch[d] >= 0) {
+            continue;
+        }
+        Track track;
+        track.id = m_nextId++;
+        track.classId = detections[d].classId;
+        track.confidence = detections[d].confidence;
+        track.frame = frame;
+        measure(detections[d], values);
+        const float height = values[Height];
+        const float positionStd = 2.0f * m_policy.positionNoise * height;
+        const float velocityStd = 10.0f * m_policy.velocityNoise * height;
+        for (int i = 0; i < AxisCount; ++i) {
+            track.axes[i].x = values[i];
+            track.axes[i].p00 = positionStd * positionStd;
+            track.axes[i].p11 = velocityStd * velocityStd;
+        }
+        m_tracks.push_back(track);
+        detections[d].trackId = track.id;
+    }
+
+    collect(frame);
+    return m_output;
+}
+
+const std::vector<ObjectTracker::Box> &ObjectTracker::predict(std::int64_t frame)
+{
+    CostTimer timer(&m_costNs);
+    ++m_calls;
+    collect(frame);
+    return m_output;
+}
+
+void ObjectTracker::collect(std::int64_t frame)
+{
+    m_output.clear();
+    for (const Track &track : m_tracks) {
+        if (track.missed <= m_policy.maxMissed && frame - track.frame <= m_policy.maxAgeFrames) {
+            m_output.push_back(toBox(predicted(track, frame)));
+        }
+    }
+}
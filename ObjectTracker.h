@@ -0,0 +1,118 @@
+#ifndef OBJECTTRACKER_H
+#define OBJECTTRACKER_H
+
+#include <cstdint>
+#include <vector>
+
+// Tracks detected boxes across frames so a model can run inference on only
+// every Nth frame: each track carries a constant-velocity Kalman filter over
+// the box centre and size, is predicted onto every frame in between, and
+// keeps its id for as long as it is matched.
+//
+// On a frame the model ran on, tracks and detections of the same class are
+// associated greedily by IoU of the prediction, then, for what is left, by
+// the Mahalanobis distance of the centre, which catches a small sign that
+// moved further than its own width since the last inference. Unmatched
+// detections start new tracks. A track missed on more than
+// Policy::maxMissed inference frames in a row is no longer shown, but is
+// kept for matching until Policy::maxAgeFrames after its last detection.
+//
+// The four coordinates are filtered independently, each as a position and
+// a velocity, with DeepSORT's noise proportional to the box height. That is
+// the block-diagonal form of the usual 8-state filter, at a fraction of the
+// cost. Predictions do not modify the tracks, so frames may be predicted in
+// any order after the last update.
+class ObjectTracker
+{
+public:
+    struct Box
+    {
+        int classId = -1;
+        float confidence = 0.0f;
+        float x1 = 0.0f;
+        float y1 = 0.0f;
+        float x2 = 0.0f;
+        float y2 = 0.0f;
+        int trackId = -1;
+    };
+
+    struct Policy
+    {
+        float minIou = 0.3f;
+        float centreGate = 5.9915f;      // Squared Mahalanobis distance: chi-square 95%, 2 dof
+        int maxMissed = 1;               // Inference frames a track is shown coasting through
+        int maxAgeFrames = 30;           // Frames an undetected track is kept for matching
+        float positionNoise = 1.0f / 20.0f;   // Per frame, relative to the box height
+        float velocityNoise = 1.0f / 10.0f;   // Signs speed up as they are passed
+    };
+
+    ObjectTracker() = default;
+    explicit ObjectTracker(const Policy &policy) : m_policy(policy) {}
+
+    const Policy &policy() const { return m_policy; }
+    void reset();
+
+    // A frame the model ran on: sets each detection's trackId and returns
+    // every live track on that frame, matched or coasting
+    const std::vector<Box> &update(std::int64_t frame, std::vector<Box> &detections);
+    // A frame in between: every live track predicted onto it
+    const std::vector<Box> &predict(std::int64_t frame);
+
+    std::size_t trackCount() const { return m_tracks.size(); }
+    int tracksCreated() const { return m_nextId - 1; }
+    std::int64_t calls() const { return m_calls; }
+    // Mean cost of update() and predict(), for the performance log
+    double averageCostUs() const { return m_calls > 0 ? double(m_costNs) / double(m_calls) / 1000.0 : 0.0; }
+
+private:
+    // Position and velocity of one coordinate, with its covariance
+    struct Axis
+    {
+        float x = 0.0f;
+        float v = 0.0f;
+        float p00 = 0.0f;
+        float p01 = 0.0f;
+        float p11 = 0.0f;
+    };
+
+    enum { CentreX, CentreY, Width, Height, AxisCount };
+
+    struct Track
+    {
+        int id = 0;
+        int classId = -1;
+        float confidence = 0.0f;
+        std::int64_t frame = 0;      // Of the last detection; the axes are at this frame
+        int missed = 0;
+        Axis axes[AxisCount];
+    };
+
+    void propagate(Axis &axis, float dt, float height) const;
+    void correct(Axis &axis, float measurement, float height) const;
+    Track predicted(const Track &track, std::int64_t frame) const;
+    static Box toBox(const Track &track);
+    void collect(std::int64_t frame);
+
+    Policy m_policy;
+    std::vector<Track> m_tracks;
+    int m_nextId = 1;
+
+    // Working buffers, allocated once per tracker
+    std::vector<Track> m_predictions;
+    std::vector<Box> m_predictedBoxes;
+    std::vector<int> m_trackMatch;
+    std::vector<int> m_detectionMatch;
+    struct Pair
+    {
+        float score;
+        int track;
+        int detection;
+    };
+    std::vector<Pair> m_pairs;
+    std::vector<Box> m_output;
+
+    std::int64_t m_calls = 0;
+    std::int64_t m_costNs = 0;
+};
+
+#endif // OBJECTTRACKER_H
@@ -0,0 +1,68 @@
+#include "PerfLog.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+
+namespace {
+
+struct PerfLogFile
+{
+    QMutex mutex;
+    QFile file;
+    QString run;
+    bool enabled = false;
+
+    PerfLogFile()
+    {
+        const QString path = qEnvironmentVariable("NEURODRIVE_PERF_LOG");
+        if (path.isEmpty()) {
+            return;
+        }
+        file.setFileName(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+            qWarning() << "PerfLog: could not open" << path << ":" << file.errorString();
+            return;
+        }
+        // Groups the lines of one run of the application
+        run = QString("%1-%2").arg(QDateTime::currentSecsSinceEpoch()).arg(QCoreApplication::applicationPid());
+        enabled = true;
+    }
+};
+
+PerfLogFile &perfLogFile()
+{
+    static PerfLogFile instance;
+    return instance;
+}
+
+} // namespace
+
+bool PerfLog::isEnabled()
+{
+    return perfLogFile().enabled;
+}
+
+void PerfLog::record(const QString &metric, double value, const QString &unit, const QVariantMap &tags)
+{
+    PerfLogFile &log = perfLogFile();
+    if (!log.enabled) {
+        return;
+    }
+
+    QJsonObject line = QJsonObject::fromVariantMap(tags);
+    line["time"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+    line["version"] = QCoreApplication::applicationVersion();
+    line["run"] = log.run;
+    line["metric"] = metric;
+    line["value"] = value;
+    line["unit"] = unit;
+
+    QMutexLocker locker(&log.mutex);
+    log.file.write(QJsonDocument(line).toJson(QJsonDocument::Compact) + '\n');
+    log.file.flush();
+}
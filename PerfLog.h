@@ -0,0 +1,21 @@
+#ifndef PERFLOG_H
+#define PERFLOG_H
+
+#include <QString>
+#include <QVariantMap>
+
+// Appends timing measurements as JSON lines to the file named by
+// NEURODRIVE_PERF_LOG, so runs of different releases can be compared:
+//
+//   {"time":"...","version":"0.1","run":"...","metric":"model.start","value":412,"unit":"ms","model":"traffic","start":"warm"}
+//
+// Does nothing when the variable is not set.
+class PerfLog
+{
+public:
+    static bool isEnabled();
+    static void record(const QString &metric, double value, const QString &unit,
+                       const QVariantMap &tags = QVariantMap());
+};
+
+#endif // PERFLOG_H
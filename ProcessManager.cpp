@@ -1,34 +1,302 @@
 #include "ProcessManager.h"
+#include "FramePool.h"
+#include "PerfLog.h"
+#include <QCoreApplication>
+#include <QDateTime>
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
 #include <QTimer>
 #include <QFile>
+#include <QProcessEnvironment>
+#include <QStandardPaths>
+
+#include <utility>
 
 ProcessManager::ProcessManager(QObject *parent) 
     : QObject(parent)
+    , m_forkServer(new ForkServer(this))
+    , m_laneEngine(new LaneDetectionEngine(this))
+    , m_trafficEngine(new TrafficSignEngine(this))
+    , m_frontStream(new FrameStream("front", this))
+    , m_cabinStream(new FrameStream("cabin", this))
+    , m_eventLog(new EventLog(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/events", this))
+    , m_metrics(new MetricsRegistry(this))
+    , m_governor(new RateGovernor(this))
+    , m_resources(new WorkerResources(this))
+    , m_supervisor(new WorkerSupervisor(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/checkpoints", this))
+    , m_frontRecording(nullptr)
+    , m_cabinRecording(nullptr)
+    , m_detections(nullptr)
+    , m_alerts(new AlertEngine(this))
 {
-    // Try to detect the best Python executable
-    QProcess pythonTest;
-    pythonTest.start("python3", QStringList() << "--version");
-    if (pythonTest.waitForFinished(3000) && pythonTest.exitCode() == 0) {
-        m_pythonExecutable = "python3";
-    } else {
-        pythonTest.start("python", QStringList() << "--version");
-        if (pythonTest.waitForFinished(3000) && pythonTest.exitCode() == 0) {
-            m_pythonExecutable = "python";
-        } else {
-            m_pythonExecutable = "python3";  // Default fallback
-        }
+    for (int modelType : {TrafficSignRecognition, Drowsiness, LaneDetection}) {
+        m_metrics->setModelName(modelType, modelName(modelType));
+        m_resources->setModelKey(modelType, forkServerKey(modelType));
     }
-    updateStatus("ProcessManager initialized with " + m_pythonExecutable);
+    m_resources->setModelKey(Combined, "combined");
+
+    // Off the reserved core, below the dashboard; drowsiness alerts matter most
+    // and the combined extra script least
+    WorkerResources::Policy policy;
+    m_resources->setPolicy(TrafficSignRecognition, policy);
+    m_resources->setPolicy(LaneDetection, policy);
+    policy.nice = 5;
+    m_resources->setPolicy(Drowsiness, policy);
+    policy.idle = true;
+    m_resources->setPolicy(Combined, policy);
+
+    // Each view is recorded as it is shown, unless NEURODRIVE_RECORDINGS is "off"
+    const QString recordings = qEnvironmentVariable("NEURODRIVE_RECORDINGS");
+    const QString recordingsPath = recordings.isEmpty() || recordings == "off"
+            ? QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/recordings"
+            : recordings;
+    m_frontRecording = new SegmentRecorder(recordingsPath + "/front", this);
+    m_cabinRecording = new SegmentRecorder(recordingsPath + "/cabin", this);
+    m_detections = new DetectionSidecar(recordingsPath + "/detections", this);
+    m_detections->setEnabled(recordings != "off");
+    for (FrameStream *stream : {m_frontStream, m_cabinStream}) {
+        SegmentRecorder *recorder = stream == m_frontStream ? m_frontRecording : m_cabinRecording;
+        recorder->setEnabled(recordings != "off");
+        connect(stream, &FrameStream::frameReceived, recorder, [stream, recorder](qint64 frameIndex) {
+            recorder->record(stream->currentFrame(), frameIndex);
+        });
+        connect(recorder, &SegmentRecorder::segmentSealed, this,
+                [this, stream](const QString &path, qint64 startMs, qint64 durationMs) {
+            emit recordingSegmentSealed(stream->channel(), path, startMs, durationMs);
+        });
+    }
+
+    connect(m_supervisor, &WorkerSupervisor::restartDue, this, &ProcessManager::restartWorker);
+
+    m_frontCamera = qEnvironmentVariable("NEURODRIVE_FRONT_CAMERA");
+    m_cabinCamera = qEnvironmentVariable("NEURODRIVE_CABIN_CAMERA");
+
+    connect(m_forkServer, &ForkServer::preloadFinished, this, [](const QString &model, bool ok, double milliseconds) {
+        if (ok) {
+            qDebug() << "ProcessManager: preloaded" << model << "in" << milliseconds << "ms";
+        }
+    });
+    connect(m_forkServer, &ForkServer::ready, this, [this]() {
+        updateStatus("Models preloaded, ready for fast start");
+    });
+
+    // The fork server is (re)started shortly after the interpreter or a script path changes
+    m_forkServerTimer.setSingleShot(true);
+    m_forkServerTimer.setInterval(1000);
+    connect(&m_forkServerTimer, &QTimer::timeout, this, &ProcessManager::startForkServer);
+
+    // The native lane engine reports through the same signals as a worker channel
+    connect(m_laneEngine, &LaneDetectionEngine::started, this, [this](qint64 expectedFrames, double) {
+        setModelState(LaneDetection, Running);
+        if (!m_isRunning) {
+            m_isRunning = true;
+            emit isRunningChanged(m_isRunning);
+        }
+        reportStartLatency(LaneDetection);
+        updateProgress();
+        emit modelStarted(LaneDetection, expectedFrames);
+    });
+    connect(m_laneEngine, &LaneDetectionEngine::frameDecoded, m_frontStream, &FrameStream::present);
+    connect(m_laneEngine, &LaneDetectionEngine::lanesDetected, this,
+            [this](qint64 frameIndex, const QList<QPolygonF> &lanes) {
+        m_frontStream->setLanes(lanes);
+        emit lanesDetected(LaneDetection, frameIndex, lanes);
+    });
+    connect(m_laneEngine, &LaneDetectionEngine::frameProcessed, this,
+            [this](qint64 frameIndex, double fps, double latencyMs) {
+        m_metrics->recordFrame(LaneDetection, frameIndex, latencyMs);
+        emit frameProcessed(LaneDetection, frameIndex, fps, latencyMs);
+        updateProgress();
+    });
+    connect(m_laneEngine, &LaneDetectionEngine::finished, this, [this](qint64 framesProcessed) {
+        updateProgress();
+        updateStatus(QString("%1 processing complete (%2 frames, %3 ms/frame native)")
+                     .arg(modelName(LaneDetection)).arg(framesProcessed)
+                     .arg(m_laneEngine->averageLatencyMs(), 0, 'f', 2));
+        recordRunFootprint(LaneDetection, m_laneEngine->averageLatencyMs(), framesProcessed, "native");
+        emit modelCompleted(LaneDetection, framesProcessed);
+        setModelState(LaneDetection, Stopped);
+        emit processFinished(LaneDetection, 0);
+        if (!anyWorkerRunning()) {
+            m_isRunning = false;
+            emit isRunningChanged(m_isRunning);
+        }
+    });
+    connect(m_laneEngine, &LaneDetectionEngine::errorOccurred, this, [this](const QString &message) {
+        qWarning() << "Native lane detection error:" << message;
+        emit workerError(LaneDetection, message);
+        updateStatus(modelName(LaneDetection) + " error: " + message);
+        setModelState(LaneDetection, Stopped);
+        emit processFinished(LaneDetection, 1);
+        if (!anyWorkerRunning()) {
+            m_isRunning = false;
+            emit isRunningChanged(m_isRunning);
+        }
+    });
+
+    // So does the native traffic sign engine, whose detections take the
+    // worker's path to the overlay and the timeline
+    connect(m_trafficEngine, &TrafficSignEngine::loaded, this, [this](bool ok, const QString &error, double milliseconds) {
+        PerfLog::record("model.load", milliseconds, "ms",
+                        {{"model", modelName(TrafficSignRecognition)}, {"backend", "onnx"}, {"ok", ok}});
+        if (!ok) {
+            updateStatus("Traffic signs run with " + m_pythonExecutable + ", the ONNX model did not load: " + error);
+        }
+        // traffic.py is only preloaded while the native model is unusable
+        m_forkServerTimer.start();
+    });
+    connect(m_trafficEngine, &TrafficSignEngine::started, this, [this](qint64 expectedFrames, double) {
+        setModelState(TrafficSignRecognition, Running);
+        if (!m_isRunning) {
+            m_isRunning = true;
+            emit isRunningChanged(m_isRunning);
+        }
+        reportStartLatency(TrafficSignRecognition);
+        updateProgress();
+        emit modelStarted(TrafficSignRecognition, expectedFrames);
+    });
+    // Detections arrive a few frames after the frame they were made on, so
+    // every frame shows the tracks predicted onto it
+    connect(m_trafficEngine, &TrafficSignEngine::frameDecoded, this, [this](const QVideoFrame &frame, qint64 frameIndex) {
+        if (m_trackers.contains(TrafficSignRecognition)) {
+            const QList<Detection> boxes = trackedBoxes(TrafficSignRecognition, frameIndex, nullptr);
+            QStringList labels;
+            labels.reserve(boxes.size());
+            for (const Detection &box : boxes) {
+                labels.append(m_trafficEngine->classNames().value(box.classId));
+            }
+            m_frontStream->setDetections(boxes, labels);
+        }
+        m_frontStream->present(frame, frameIndex);
+    });
+    connect(m_trafficEngine, &TrafficSignEngine::detectionsReady, this,
+            [this](qint64 frameIndex, const QList<Detection> &reported, const QStringList &labels) {
+        const qint64 eventNs = AlertEngine::clockNs();
+        QList<Detection> detections = reported;
+        trackedBoxes(TrafficSignRecognition, frameIndex, &detections);
+        if (!detections.isEmpty()) {
+            m_alerts->handleDetections(detections, labels, eventNs);
+            m_detections->appendDetections(TrafficSignRecognition, frameIndex, detections, labels);
+            emit detectionsReady(TrafficSignRecognition, frameIndex, detections);
+        }
+    });
+    connect(m_trafficEngine, &TrafficSignEngine::frameProcessed, this,
+            [this](qint64 frameIndex, double fps, double latencyMs) {
+        m_metrics->recordFrame(TrafficSignRecognition, frameIndex, latencyMs);
+        emit frameProcessed(TrafficSignRecognition, frameIndex, fps, latencyMs);
+        updateProgress();
+    });
+    connect(m_trafficEngine, &TrafficSignEngine::finished, this, [this](qint64 framesProcessed) {
+        updateProgress();
+        updateStatus(QString("%1 processing complete (%2 frames, %3 ms/frame native)")
+                     .arg(modelName(TrafficSignRecognition)).arg(framesProcessed)
+                     .arg(m_trafficEngine->averageLatencyMs(), 0, 'f', 2));
+        recordRunFootprint(TrafficSignRecognition, m_trafficEngine->averageLatencyMs(), framesProcessed, "onnx");
+        emit modelCompleted(TrafficSignRecognition, framesProcessed);
+        setModelState(TrafficSignRecognition, Stopped);
+        emit processFinished(TrafficSignRecognition, 0);
+        if (!anyWorkerRunning()) {
+            m_isRunning = false;
+            emit isRunningChanged(m_isRunning);
+        }
+    });
+    connect(m_trafficEngine, &TrafficSignEngine::errorOccurred, this, [this](const QString &message) {
+        qWarning() << "Native traffic sign detection error:" << message;
+        emit workerError(TrafficSignRecognition, message);
+        updateStatus(modelName(TrafficSignRecognition) + " error: " + message);
+        // A model that failed to load in the middle of a run hands it to traffic.py
+        if (m_trafficEngine->status() == TrafficSignEngine::Failed && m_activeModel != ModelType::None) {
+            m_trafficEngineUsed = false;
+            startWorker(TrafficSignRecognition);
+            return;
+        }
+        setModelState(TrafficSignRecognition, Stopped);
+        emit processFinished(TrafficSignRecognition, 1);
+        if (!anyWorkerRunning()) {
+            m_isRunning = false;
+            emit isRunningChanged(m_isRunning);
+        }
+    });
 }
 
 ProcessManager::~ProcessManager()
 {
+    // Workers get SIGTERM here; any still running when their QProcess is
+    // destroyed right after are killed by it
     terminateAllProcesses();
 }
 
+void ProcessManager::startServices()
+{
+    if (m_servicesStarted) {
+        return;
+    }
+    m_servicesStarted = true;
+
+    // Nothing touches the disk or starts a thread before the login page is up
+    m_eventLog->open();
+    m_frontRecording->start();
+    m_cabinRecording->start();
+    m_resources->loadConfiguration();
+    // Decoded on the alert thread before any model runs
+    loadAlertSounds();
+    // The ONNX model loads on the engine's thread while the interpreter is probed
+    loadTrafficSignModel();
+
+    if (m_pythonExecutableSet) {
+        m_forkServerTimer.start();
+        return;
+    }
+    // Find the interpreter in the background; the fork server follows it
+    detectPythonExecutable(QStringList() << "python3" << "python");
+}
+
+void ProcessManager::detectPythonExecutable(QStringList candidates)
+{
+    if (m_pythonExecutableSet) {
+        return;  // Chosen explicitly while probing
+    }
+    if (candidates.isEmpty()) {
+        // Default fallback
+        updateStatus("ProcessManager initialized with " + m_pythonExecutable);
+        m_forkServerTimer.start();
+        return;
+    }
+
+    const QString candidate = candidates.takeFirst();
+    QProcess *probe = new QProcess(this);
+    connect(probe, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+            [this, probe, candidate, candidates](int exitCode, QProcess::ExitStatus exitStatus) {
+        probe->deleteLater();
+        if (exitStatus != QProcess::NormalExit || exitCode != 0) {
+            detectPythonExecutable(candidates);
+            return;
+        }
+        if (m_pythonExecutableSet) {
+            return;
+        }
+        if (m_pythonExecutable != candidate) {
+            m_pythonExecutable = candidate;
+            emit pythonExecutableChanged(m_pythonExecutable);
+        }
+        updateStatus("ProcessManager initialized with " + m_pythonExecutable);
+        m_forkServerTimer.start();
+    });
+    connect(probe, QOverload<QProcess::ProcessError>::of(&QProcess::errorOccurred), this,
+            [this, probe, candidates](QProcess::ProcessError error) {
+        // No finished signal follows a failed start
+        if (error == QProcess::FailedToStart) {
+            probe->deleteLater();
+            detectPythonExecutable(candidates);
+        }
+    });
+
+    // An interpreter that does not answer within the timeout counts as missing
+    QTimer::singleShot(StopTimeoutMs, probe, &QProcess::kill);
+    probe->start(candidate, QStringList() << "--version");
+}
+
 void ProcessManager::setActiveModel(int model)
 {
     if (m_activeModel != model) {
@@ -39,10 +307,60 @@ void ProcessManager::setActiveModel(int model)
 
 void ProcessManager::setPythonExecutable(const QString &executable)
 {
+    m_pythonExecutableSet = true;
     if (m_pythonExecutable != executable) {
         m_pythonExecutable = executable;
         emit pythonExecutableChanged(m_pythonExecutable);
         updateStatus("Python executable set to: " + m_pythonExecutable);
+        m_forkServerTimer.start();
+    }
+}
+
+void ProcessManager::setNativeLaneDetection(bool enabled)
+{
+    if (m_nativeLaneDetection != enabled) {
+        m_nativeLaneDetection = enabled;
+        emit nativeLaneDetectionChanged(m_nativeLaneDetection);
+        updateStatus(enabled ? "Lane detection runs natively" : "Lane detection runs with " + m_pythonExecutable);
+    }
+}
+
+void ProcessManager::setNativeTrafficSigns(bool enabled)
+{
+    if (m_nativeTrafficSigns != enabled) {
+        m_nativeTrafficSigns = enabled;
+        emit nativeTrafficSignsChanged(m_nativeTrafficSigns);
+        updateStatus(enabled ? "Traffic signs run natively when the ONNX model loads"
+                             : "Traffic signs run with " + m_pythonExecutable);
+        loadTrafficSignModel();
+        m_forkServerTimer.start();
+    }
+}
+
+void ProcessManager::setSharedDecode(bool enabled)
+{
+    if (m_sharedDecode != enabled) {
+        m_sharedDecode = enabled;
+        emit sharedDecodeChanged(m_sharedDecode);
+        updateStatus(enabled ? "Models share one decode per video" : "Each model decodes its own video");
+    }
+}
+
+void ProcessManager::setFrontCamera(const QString &device)
+{
+    if (m_frontCamera != device) {
+        m_frontCamera = device;
+        emit camerasChanged();
+        updateStatus(device.isEmpty() ? "Road models read their videos" : "Road models read camera " + device);
+    }
+}
+
+void ProcessManager::setCabinCamera(const QString &device)
+{
+    if (m_cabinCamera != device) {
+        m_cabinCamera = device;
+        emit camerasChanged();
+        updateStatus(device.isEmpty() ? "Drowsiness detection reads its video" : "Drowsiness detection reads camera " + device);
     }
 }
 
@@ -50,12 +368,17 @@ void ProcessManager::setTrafficSignPath(const QString &path)
 {
     m_trafficSignPath = path;
     updateStatus("Traffic sign path set to: " + path);
+    loadTrafficSignModel();
+    loadAlertSounds();
+    m_forkServerTimer.start();
 }
 
 void ProcessManager::setDrowsinessPath(const QString &path)
 {
     m_drowsinessPath = path;
     updateStatus("Drowsiness path set to: " + path);
+    loadAlertSounds();
+    m_forkServerTimer.start();
 }
 
 void ProcessManager::setCombinedPath(const QString &path)
@@ -68,15 +391,35 @@ void ProcessManager::setLaneDetectionPath(const QString &path)
 {
     m_laneDetectionPath = path;
     updateStatus("Lane detection path set to: " + path);
+    m_forkServerTimer.start();
 }
 
 void ProcessManager::startModel(int modelType)
 {
+    startServices();
+
     // If any model is currently running, stop it first
     stopCurrentModel();
     
     // Set the active model
     setActiveModel(modelType);
+    resetProgress();
+    m_launchClock.start();
+    m_latencyReported.clear();
+    m_metrics->beginRun();
+    m_detections->create(QDateTime::currentMSecsSinceEpoch());
+    m_supervisor->beginRun();
+    m_laneEngineUsed = false;
+    m_trafficEngineUsed = false;
+    m_trackers.clear();
+    m_alerts->reset();
+    m_drowsiness.reset();
+    m_reportedDrowsy = false;
+    m_reportedLongClosure = false;
+    m_longClosureMs = 0;
+    m_driverState.clear();
+    m_driverStateClock.invalidate();
+    emit driverStateChanged();
     
     // Start the selected model
     switch (static_cast<ModelType>(modelType)) {
@@ -96,11 +439,21 @@ void ProcessManager::startModel(int modelType)
             updateStatus("Invalid model selected");
             break;
     }
+
+    // Every model has subscribed by now; playback waits for the workers to attach
+    startFrameSources();
 }
 
 void ProcessManager::stopCurrentModel()
 {
     terminateAllProcesses();
+    m_frontStream->close();
+    m_frontStream->clear();
+    m_cabinStream->close();
+    m_cabinStream->clear();
+    m_frontRecording->seal();
+    m_cabinRecording->seal();
+    m_detections->finish();
     setActiveModel(ModelType::None);
     m_isRunning = false;
     emit isRunningChanged(m_isRunning);
@@ -129,8 +482,23 @@ void ProcessManager::handleProcessError(QProcess::ProcessError error)
     emit processError(errorMessage);
     updateStatus("Error: " + errorMessage);
     
-    m_isRunning = false;
-    emit isRunningChanged(m_isRunning);
+    // A crash is followed by finished(); a failed start is not
+    if (error == QProcess::FailedToStart) {
+        const int modelType = m_processes.key(process, ModelType::None);
+        m_processes.remove(modelType);
+        m_channels.remove(modelType);
+        m_stderrTails.remove(modelType);
+        if (FrameStream *stream = streamForModel(modelType)) {
+            stream->close();
+        }
+        setModelState(modelType, Stopped);
+        process->deleteLater();
+    }
+    
+    if (m_isRunning && !anyWorkerRunning()) {
+        m_isRunning = false;
+        emit isRunningChanged(m_isRunning);
+    }
 }
 
 void ProcessManager::handleProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
@@ -140,64 +508,101 @@ void ProcessManager::handleProcessFinished(int exitCode, QProcess::ExitStatus ex
     
     // Find which model this process belongs to
     int modelType = m_processes.key(process, ModelType::None);
-    
-    // Capture stderr output for debugging
-    QByteArray stderrData = process->readAllStandardError();
-    QByteArray stdoutData = process->readAllStandardOutput();
-    
-    QString modelName;
-    switch (static_cast<ModelType>(modelType)) {
-        case TrafficSignRecognition: modelName = "Traffic Sign"; break;
-        case Drowsiness: modelName = "Drowsiness"; break;
-        case LaneDetection: modelName = "Lane Detection"; break;
-        case Combined: modelName = "Combined"; break;
-        default: modelName = "Unknown"; break;
+    const QByteArray stderrData = m_stderrTails.take(modelType) + process->readAllStandardError();
+    finishWorker(modelType, exitCode, exitStatus, stderrData);
+}
+
+void ProcessManager::finishWorker(int modelType, int exitCode, QProcess::ExitStatus exitStatus, const QByteArray &stderrData)
+{
+    // Parse anything the worker wrote after the last readyRead
+    if (WorkerChannel *channel = m_channels.value(modelType)) {
+        channel->flush();
     }
     
+    const QString name = modelName(modelType);
+    
     if (exitStatus == QProcess::NormalExit) {
         if (exitCode == 0) {
-            updateStatus(QString("%1 process finished successfully").arg(modelName));
+            updateStatus(QString("%1 process finished successfully").arg(name));
         } else {
-            QString errorMsg = QString("%1 process finished with exit code %2").arg(modelName).arg(exitCode);
+            QString errorMsg = QString("%1 process finished with exit code %2").arg(name).arg(exitCode);
             if (!stderrData.isEmpty()) {
                 errorMsg += QString(" - Error: %1").arg(QString::fromUtf8(stderrData));
             }
             updateStatus(errorMsg);
-            qWarning() << modelName << "Process stderr:" << stderrData;
-            qWarning() << modelName << "Process stdout:" << stdoutData;
+            qWarning() << name << "Process stderr:" << stderrData;
         }
     } else {
-        updateStatus(QString("%1 process crashed").arg(modelName));
+        updateStatus(QString("%1 process crashed").arg(name));
         if (!stderrData.isEmpty()) {
-            qWarning() << modelName << "Process stderr before crash:" << stderrData;
+            qWarning() << name << "Process stderr before crash:" << stderrData;
+        }
+    }
+
+    // A worker that fails mid-run is restarted and resumes from its
+    // checkpoint; one that fails before its first frame (a wrong path, a
+    // missing model) would only fail again, unless it was killed
+    WorkerChannel *channel = m_channels.value(modelType);
+    const bool completed = channel && channel->isDone();
+    const bool progressed = channel && channel->framesProcessed() > 0;
+    if (!completed && m_activeModel != ModelType::None
+        && (exitStatus == QProcess::CrashExit || (exitCode != 0 && progressed))) {
+        const int delayMs = m_supervisor->workerFailed(modelType);
+        if (delayMs >= 0) {
+            const qint64 resumeFrame = m_supervisor->checkpoint(modelType).frame;
+            const int attempt = m_supervisor->restarts(modelType);
+            updateStatus(QString("%1 worker failed, restarting in %2 ms (attempt %3 of %4)")
+                         .arg(name).arg(delayMs).arg(attempt).arg(m_supervisor->policy().maxRestarts));
+            if (FrameStream *stream = streamForModel(modelType)) {
+                stream->close();
+            }
+            setModelState(modelType, Restarting);
+            emit workerRestarting(modelType, attempt, delayMs, resumeFrame);
+            return;
         }
     }
     
-    // Always print stdout if available for debugging
-    if (!stdoutData.isEmpty()) {
-        qDebug() << modelName << "Process stdout:" << stdoutData;
+    // The worker is gone; stop watching its ring but keep the last frame up
+    if (FrameStream *stream = streamForModel(modelType)) {
+        stream->close();
     }
     
+    setModelState(modelType, Stopped);
     emit processFinished(modelType, exitCode);
     
-    // Check if any processes are still running
-    bool anyRunning = false;
+    if (!anyWorkerRunning()) {
+        m_isRunning = false;
+        emit isRunningChanged(m_isRunning);
+    }
+}
+
+bool ProcessManager::anyWorkerRunning() const
+{
+    if (m_laneEngine->isRunning() || m_trafficEngine->isRunning()) {
+        return true;
+    }
+    // Forked workers leave m_forkedWorkers as soon as they finish
+    if (!m_forkedWorkers.isEmpty()) {
+        return true;
+    }
     for (auto proc : m_processes.values()) {
         if (proc->state() == QProcess::Running) {
-            anyRunning = true;
-            break;
+            return true;
         }
     }
-    
-    if (!anyRunning) {
-        m_isRunning = false;
-        emit isRunningChanged(m_isRunning);
-    }
+    return false;
 }
 
 void ProcessManager::handleProcessStateChanged(QProcess::ProcessState state)
 {
+    QProcess *process = qobject_cast<QProcess*>(sender());
+    if (!process) return;
+    
     if (state == QProcess::Running) {
+        const int modelType = m_processes.key(process, ModelType::None);
+        setModelState(modelType, Running);
+        updateStatus(QString("%1 started with %2 in %3")
+                     .arg(modelName(modelType), m_pythonExecutable, process->workingDirectory()));
         if (!m_isRunning) {
             m_isRunning = true;
             emit isRunningChanged(m_isRunning);
@@ -207,168 +612,183 @@ void ProcessManager::handleProcessStateChanged(QProcess::ProcessState state)
 
 void ProcessManager::startTrafficSignRecognition()
 {
-    QProcess *process = new QProcess(this);
-    
-    // Connect signals
-    connect(process, QOverload<QProcess::ProcessError>::of(&QProcess::errorOccurred),
-            this, &ProcessManager::handleProcessError);
-    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &ProcessManager::handleProcessFinished);
-    connect(process, &QProcess::stateChanged,
-            this, &ProcessManager::handleProcessStateChanged);
-    
-    // Store the process
-    if (m_processes.contains(ModelType::TrafficSignRecognition)) {
-        delete m_processes[ModelType::TrafficSignRecognition];
+    // The in-process engine needs neither Python nor torch
+    if (m_nativeTrafficSigns && startNativeTrafficSigns()) {
+        return;
     }
-    m_processes[ModelType::TrafficSignRecognition] = process;
-    
-    // Set working directory to the script's directory
-    QFileInfo scriptInfo(m_trafficSignPath);
-    if (scriptInfo.exists()) {
-        process->setWorkingDirectory(scriptInfo.absolutePath());
-        updateStatus("Working directory set to: " + scriptInfo.absolutePath());
-    } else {
-        updateStatus("Warning: Script file does not exist at " + m_trafficSignPath);
+
+    // A worker forked from the preloaded fork server skips the cold start
+    if (startWarmWorker(ModelType::TrafficSignRecognition)) {
+        return;
     }
+
+    QProcess *process = createWorkerProcess(ModelType::TrafficSignRecognition);
+    updateStatus("Starting video processing...");
     
-    // Remove the old output video file if it exists
-    QString outputPath = scriptInfo.absolutePath() + "/output.avi";
-    QFile::remove(outputPath);
-    updateStatus("Starting video processing... This may take several minutes on Raspberry Pi");
-    
-    // Start the process
+    // Start the process; handleProcessStateChanged reports when it is up
     QStringList arguments;
     arguments << m_trafficSignPath;
     process->start(m_pythonExecutable, arguments);
-    
-    // Use a shorter timeout for initial start
-    if (!process->waitForStarted(3000)) {
-        updateStatus("Failed to start traffic sign recognition process");
-        return;
-    }
-    
-    updateStatus("Traffic sign recognition started with " + m_pythonExecutable + " in " + process->workingDirectory());
-    
-    // Set up a timer to provide progress updates
-    QTimer *progressTimer = new QTimer(this);
-    progressTimer->setSingleShot(false);
-    progressTimer->setInterval(5000); // Check every 5 seconds
-    int progressCounter = 0;
-    connect(progressTimer, &QTimer::timeout, [this, process, progressTimer, progressCounter]() mutable {
-        if (process->state() == QProcess::Running) {
-            progressCounter++;
-            QString dots = QString(".").repeated((progressCounter % 4) + 1);
-            updateStatus(QString("Processing video%1 (%2s elapsed)").arg(dots).arg(progressCounter * 5));
-        } else {
-            progressTimer->deleteLater();
-        }
-    });
-    progressTimer->start();
 }
 
 void ProcessManager::startDrowsinessDetection()
 {
-    QProcess *process = new QProcess(this);
-    
-    // Connect signals
-    connect(process, QOverload<QProcess::ProcessError>::of(&QProcess::errorOccurred),
-            this, &ProcessManager::handleProcessError);
-    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &ProcessManager::handleProcessFinished);
-    connect(process, &QProcess::stateChanged,
-            this, &ProcessManager::handleProcessStateChanged);
-    
-    // Store the process
-    if (m_processes.contains(ModelType::Drowsiness)) {
-        delete m_processes[ModelType::Drowsiness];
-    }
-    m_processes[ModelType::Drowsiness] = process;
-    
-    // Set working directory to the script's directory
-    QFileInfo scriptInfo(m_drowsinessPath);
-    if (scriptInfo.exists()) {
-        process->setWorkingDirectory(scriptInfo.absolutePath());
-        updateStatus("Working directory set to: " + scriptInfo.absolutePath());
-    } else {
-        updateStatus("Warning: Script file does not exist at " + m_drowsinessPath);
+    // A worker forked from the preloaded fork server skips the cold start
+    if (startWarmWorker(ModelType::Drowsiness)) {
+        return;
     }
+
+    QProcess *process = createWorkerProcess(ModelType::Drowsiness);
     
     // Start the process
     QStringList arguments;
     arguments << m_drowsinessPath;
     process->start(m_pythonExecutable, arguments);
-    
-    // Wait a bit to see if it starts successfully
-    if (!process->waitForStarted(5000)) {
-        updateStatus("Failed to start drowsiness detection process");
-        return;
-    }
-    
-    updateStatus("Drowsiness detection started with " + m_pythonExecutable + " in " + process->workingDirectory());
 }
 
 void ProcessManager::startCombinedModel()
 {
-    // Start traffic sign recognition process
-    QProcess *trafficProcess = new QProcess(this);
-    connect(trafficProcess, QOverload<QProcess::ProcessError>::of(&QProcess::errorOccurred),
-            this, &ProcessManager::handleProcessError);
-    connect(trafficProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &ProcessManager::handleProcessFinished);
-    connect(trafficProcess, &QProcess::stateChanged,
-            this, &ProcessManager::handleProcessStateChanged);
-    
-    if (m_processes.contains(ModelType::TrafficSignRecognition)) {
-        delete m_processes[ModelType::TrafficSignRecognition];
-    }
-    m_processes[ModelType::TrafficSignRecognition] = trafficProcess;
-    
-    // Start drowsiness detection process
-    QProcess *drowsinessProcess = new QProcess(this);
-    connect(drowsinessProcess, QOverload<QProcess::ProcessError>::of(&QProcess::errorOccurred),
-            this, &ProcessManager::handleProcessError);
-    connect(drowsinessProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &ProcessManager::handleProcessFinished);
-    connect(drowsinessProcess, &QProcess::stateChanged,
-            this, &ProcessManager::handleProcessStateChanged);
-    
-    if (m_processes.contains(ModelType::Drowsiness)) {
-        delete m_processes[ModelType::Drowsiness];
+    // Traffic signs go to the front view, drowsiness to the cabin view; each
+    // runs natively or comes from the fork server when it can
+    if (!(m_nativeTrafficSigns && startNativeTrafficSigns())
+        && !startWarmWorker(ModelType::TrafficSignRecognition)) {
+        QStringList trafficArgs;
+        trafficArgs << m_trafficSignPath;
+        createWorkerProcess(ModelType::TrafficSignRecognition)->start(m_pythonExecutable, trafficArgs);
     }
-    m_processes[ModelType::Drowsiness] = drowsinessProcess;
-    
-    // Start combined process
-    QProcess *combinedProcess = new QProcess(this);
-    connect(combinedProcess, QOverload<QProcess::ProcessError>::of(&QProcess::errorOccurred),
-            this, &ProcessManager::handleProcessError);
-    connect(combinedProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &ProcessManager::handleProcessFinished);
-    connect(combinedProcess, &QProcess::stateChanged,
-            this, &ProcessManager::handleProcessStateChanged);
     
-    if (m_processes.contains(ModelType::Combined)) {
-        delete m_processes[ModelType::Combined];
+    if (!startWarmWorker(ModelType::Drowsiness)) {
+        QStringList drowsinessArgs;
+        drowsinessArgs << m_drowsinessPath;
+        createWorkerProcess(ModelType::Drowsiness)->start(m_pythonExecutable, drowsinessArgs);
     }
-    m_processes[ModelType::Combined] = combinedProcess;
-    
-    // Start the processes
-    QStringList trafficArgs;
-    trafficArgs << m_trafficSignPath;
-    trafficProcess->start(m_pythonExecutable, trafficArgs);
-    
-    QStringList drowsinessArgs;
-    drowsinessArgs << m_drowsinessPath;
-    drowsinessProcess->start(m_pythonExecutable, drowsinessArgs);
     
     QStringList combinedArgs;
     combinedArgs << m_combinedExtraPath;
-    combinedProcess->start(m_pythonExecutable, combinedArgs);
+    createWorkerProcess(ModelType::Combined)->start(m_pythonExecutable, combinedArgs);
     
-    updateStatus("Combined model started with " + m_pythonExecutable);
+    updateStatus("Combined model starting with " + m_pythonExecutable);
 }
 
 void ProcessManager::startLaneDetection()
+{
+    // The in-process engine needs neither Python nor a worker process
+    if (m_nativeLaneDetection && startNativeLaneDetection()) {
+        return;
+    }
+
+    // A worker forked from the preloaded fork server skips the cold start
+    if (startWarmWorker(ModelType::LaneDetection)) {
+        return;
+    }
+
+    QProcess *process = createWorkerProcess(ModelType::LaneDetection);
+    
+    // Start the process
+    QStringList arguments;
+    arguments << m_laneDetectionPath;
+    process->start(m_pythonExecutable, arguments);
+}
+
+bool ProcessManager::startNativeLaneDetection()
+{
+    // The engine always reads frames from a FrameSource, shared or not
+    FrameSource *source = frameSourceFor(LaneDetection);
+    if (!source) {
+        qDebug() << "ProcessManager: no" << inputVideoPath(LaneDetection)
+                 << "for native lane detection, using the script";
+        return false;
+    }
+
+    setModelState(LaneDetection, Starting);
+    m_laneEngineUsed = true;
+    m_laneEngine->start(source);
+    updateStatus("Lane Detection started natively on " + source->videoPath());
+    return true;
+}
+
+bool ProcessManager::startNativeTrafficSigns()
+{
+    // A model still loading is waited for; frames until then are only shown
+    if (!m_trafficEngine->isUsable() || m_trafficEngine->modelPath() != trafficSignModelPath()) {
+        return false;
+    }
+    FrameSource *source = frameSourceFor(TrafficSignRecognition);
+    if (!source) {
+        qDebug() << "ProcessManager: no" << inputVideoPath(TrafficSignRecognition)
+                 << "for native traffic sign detection, using the script";
+        return false;
+    }
+
+    setModelState(TrafficSignRecognition, Starting);
+    m_trafficEngineUsed = true;
+    m_trafficEngine->start(source);
+    updateStatus("Traffic Sign started natively on " + source->videoPath());
+    return true;
+}
+
+void ProcessManager::loadTrafficSignModel()
+{
+    if (!m_servicesStarted || !m_nativeTrafficSigns || !TrafficSignDetector::isAvailable()) {
+        return;
+    }
+    const QString path = trafficSignModelPath();
+    if (!QFileInfo::exists(path)) {
+        qDebug() << "ProcessManager: no" << path << "for native traffic sign detection, using the script";
+        return;
+    }
+
+    TrafficSignDetector::Options options;
+    bool ok = false;
+    const int threads = qEnvironmentVariableIntValue("NEURODRIVE_ONNX_THREADS", &ok);
+    if (ok && threads > 0) {
+        options.threads = threads;
+    }
+    if (qEnvironmentVariableIsSet("NEURODRIVE_ONNX_XNNPACK")) {
+        options.xnnpack = qEnvironmentVariable("NEURODRIVE_ONNX_XNNPACK") != "0";
+    }
+    m_trafficEngine->load(path, options);
+}
+
+QString ProcessManager::trafficSignModelPath() const
+{
+    // traffic.py's model_v2.pt, exported next to it
+    const QString path = qEnvironmentVariable("NEURODRIVE_TRAFFIC_ONNX");
+    return !path.isEmpty() ? path : QFileInfo(m_trafficSignPath).absolutePath() + "/model_v2.onnx";
+}
+
+void ProcessManager::startWorker(int modelType)
+{
+    // A worker forked from the preloaded fork server skips the cold start
+    if (startWarmWorker(modelType)) {
+        return;
+    }
+    createWorkerProcess(modelType)->start(m_pythonExecutable, QStringList() << scriptPath(modelType));
+}
+
+void ProcessManager::restartWorker(int modelType, int attempt)
+{
+    if (m_activeModel == ModelType::None || m_modelStates.value(modelType, Stopped) != Restarting) {
+        return;
+    }
+
+    // The failed process and its channel are replaced
+    if (QProcess *process = m_processes.take(modelType)) {
+        process->disconnect(this);
+        process->deleteLater();
+    }
+    m_channels.remove(modelType);
+
+    const WorkerSupervisor::Checkpoint checkpoint = m_supervisor->checkpoint(modelType);
+    PerfLog::record("model.restart", attempt, "count",
+                    {{"model", modelName(modelType)}, {"resume_frame", checkpoint.frame}});
+    updateStatus(checkpoint.isValid()
+                 ? QString("Restarting %1, resuming after frame %2").arg(modelName(modelType)).arg(checkpoint.frame)
+                 : QString("Restarting %1 from the start").arg(modelName(modelType)));
+    startWorker(modelType);
+}
+
+QProcess *ProcessManager::createWorkerProcess(int modelType)
 {
     QProcess *process = new QProcess(this);
     
@@ -380,67 +800,721 @@ void ProcessManager::startLaneDetection()
     connect(process, &QProcess::stateChanged,
             this, &ProcessManager::handleProcessStateChanged);
     
-    // Store the process
-    if (m_processes.contains(ModelType::LaneDetection)) {
-        delete m_processes[ModelType::LaneDetection];
-    }
-    m_processes[ModelType::LaneDetection] = process;
+    // Pinned and deprioritised from its first instruction, before the interpreter starts
+    process->setChildProcessModifier(m_resources->childModifier(modelType));
+
+    // Store the process; any previous worker for this model is already stopping
+    m_processes[modelType] = process;
     
     // Set working directory to the script's directory
-    QFileInfo scriptInfo(m_laneDetectionPath);
+    const QString path = scriptPath(modelType);
+    QFileInfo scriptInfo(path);
     if (scriptInfo.exists()) {
         process->setWorkingDirectory(scriptInfo.absolutePath());
         updateStatus("Working directory set to: " + scriptInfo.absolutePath());
     } else {
-        updateStatus("Warning: Script file does not exist at " + m_laneDetectionPath);
+        updateStatus("Warning: Script file does not exist at " + path);
     }
     
-    // Start the process
-    QStringList arguments;
-    arguments << m_laneDetectionPath;
-    
-    // Print the exact command we're running for debugging
-    QString command = m_pythonExecutable + " " + m_laneDetectionPath;
-    qDebug() << "Running lane detection command:" << command;
-    
-    process->start(m_pythonExecutable, arguments);
-    
-    // Wait a bit to see if it starts successfully
-    if (!process->waitForStarted(5000)) {
-        updateStatus("Failed to start lane detection process");
+    // Frames are streamed live through shared memory
+    process->setProcessEnvironment(workerEnvironment(modelType));
+    attachWorkerChannel(process, process, modelType);
+    captureStderrTail(process, modelType);
+    setModelState(modelType, Starting);
+    return process;
+}
+
+void ProcessManager::terminateAllProcesses()
+{
+    // Workers that are being stopped no longer report to the dashboard
+    for (WorkerChannel *channel : std::as_const(m_channels)) {
+        channel->disconnect(this);
+    }
+    m_channels.clear();
+    m_stderrTails.clear();
+    m_governor->detachAll();
+
+    // A worker waiting out its backoff is not started again
+    m_supervisor->cancelAll();
+    for (int modelType : m_modelStates.keys(Restarting)) {
+        setModelState(modelType, Stopped);
+    }
+
+    // The native engines drop their in-flight frame and stop at once
+    if (m_laneEngine->isRunning()) {
+        m_laneEngine->stop();
+        if (!hasCurrentWorker(LaneDetection)) {
+            setModelState(LaneDetection, Stopped);
+        }
+    }
+    if (m_trafficEngine->isRunning()) {
+        m_trafficEngine->stop();
+        if (!hasCurrentWorker(TrafficSignRecognition)) {
+            setModelState(TrafficSignRecognition, Stopped);
+        }
+    }
+
+    // Nothing waits here: each worker winds down in the background while the
+    // next model may already be starting
+    const QMap<int, ForkedWorker*> forkedWorkers = std::exchange(m_forkedWorkers, {});
+    for (auto it = forkedWorkers.constBegin(); it != forkedWorkers.constEnd(); ++it) {
+        stopForkedWorker(it.key(), it.value());
+    }
+    const QMap<int, QProcess*> processes = std::exchange(m_processes, {});
+    for (auto it = processes.constBegin(); it != processes.constEnd(); ++it) {
+        stopProcess(it.key(), it.value());
+    }
+
+    // Stopping marks the input rings ended, so workers still reading wind down too
+    for (FrameSource *source : std::as_const(m_frameSources)) {
+        source->stop();
+        source->deleteLater();
+    }
+    m_frameSources.clear();
+}
+
+void ProcessManager::stopProcess(int modelType, QProcess *process)
+{
+    process->disconnect(this);
+    if (process->state() == QProcess::NotRunning) {
+        process->deleteLater();
         return;
     }
-    
-    updateStatus("Lane detection started with " + m_pythonExecutable + " in " + process->workingDirectory());
-    
-    // Set up a timer to check process status periodically
-    QTimer *laneStatusTimer = new QTimer(this);
-    laneStatusTimer->setSingleShot(false);
-    laneStatusTimer->setInterval(10000); // Check every 10 seconds
-    connect(laneStatusTimer, &QTimer::timeout, [this, process, laneStatusTimer]() {
-        if (process->state() == QProcess::Running) {
-            updateStatus("Lane detection process still running...");
-        } else {
-            laneStatusTimer->deleteLater();
+
+    setModelState(modelType, Stopping);
+    QElapsedTimer stopClock;
+    stopClock.start();
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, [this, process, modelType, stopClock]() {
+        process->deleteLater();
+        PerfLog::record("model.stop", stopClock.elapsed(), "ms", {{"model", modelName(modelType)}, {"start", "cold"}});
+        if (!hasCurrentWorker(modelType)) {
+            setModelState(modelType, Stopped);
+        }
+    });
+
+    // Ask politely first and escalate if the worker ignores SIGTERM
+    process->terminate();
+    const QString name = modelName(modelType);
+    QTimer::singleShot(StopTimeoutMs, process, [process, name]() {
+        if (process->state() != QProcess::NotRunning) {
+            qWarning() << name << "worker ignored SIGTERM, killing it";
+            process->kill();
         }
     });
-    laneStatusTimer->start();
 }
 
-void ProcessManager::terminateAllProcesses()
+void ProcessManager::stopForkedWorker(int modelType, ForkedWorker *worker)
 {
-    for (auto process : m_processes) {
-        if (process->state() != QProcess::NotRunning) {
-            process->terminate();
-            if (!process->waitForFinished(3000)) {
-                process->kill();
+    // Forked workers are the zygote's children and delete themselves once reaped
+    worker->disconnect(this);
+    setModelState(modelType, Stopping);
+    QElapsedTimer stopClock;
+    stopClock.start();
+    connect(worker, &ForkedWorker::finished, this, [this, modelType, stopClock]() {
+        PerfLog::record("model.stop", stopClock.elapsed(), "ms", {{"model", modelName(modelType)}, {"start", "warm"}});
+        if (!hasCurrentWorker(modelType)) {
+            setModelState(modelType, Stopped);
+        }
+    });
+    worker->terminate();
+    QTimer::singleShot(StopTimeoutMs, worker, &ForkedWorker::kill);
+}
+
+bool ProcessManager::hasCurrentWorker(int modelType) const
+{
+    return m_processes.contains(modelType) || m_forkedWorkers.contains(modelType) || runsInProcess(modelType);
+}
+
+bool ProcessManager::runsInProcess(int modelType) const
+{
+    return (modelType == LaneDetection && m_laneEngine->isRunning())
+        || (modelType == TrafficSignRecognition && m_trafficEngine->isRunning());
+}
+
+void ProcessManager::setModelState(int modelType, WorkerState state)
+{
+    if (modelType == ModelType::None || m_modelStates.value(modelType, Stopped) == state) {
+        return;
+    }
+    m_modelStates[modelType] = state;
+
+    // Resource use is sampled from, and the resource policy applied to,
+    // whichever process runs the model
+    if (state == Running) {
+        m_supervisor->workerStarted(modelType);
+        if (runsInProcess(modelType)) {
+            m_metrics->setProcessId(modelType, QCoreApplication::applicationPid(), true);
+        } else if (QProcess *process = m_processes.value(modelType)) {
+            m_metrics->setProcessId(modelType, process->processId());
+            m_resources->attach(modelType, process->processId());
+        } else if (ForkedWorker *worker = m_forkedWorkers.value(modelType)) {
+            m_metrics->setProcessId(modelType, worker->processId());
+            m_resources->attach(modelType, worker->processId());
+        }
+    } else if (state == Stopping || state == Stopped || state == Restarting) {
+        m_metrics->setProcessId(modelType, 0);
+        m_resources->detach(modelType);
+    }
+
+    emit modelStateChanged(modelType, state);
+}
+
+FrameStream *ProcessManager::streamForModel(int modelType) const
+{
+    switch (static_cast<ModelType>(modelType)) {
+        case TrafficSignRecognition:
+        case LaneDetection:
+            return m_frontStream;
+        case Drowsiness:
+            return m_cabinStream;
+        default:
+            return nullptr;
+    }
+}
+
+QProcessEnvironment ProcessManager::workerEnvironment(int modelType)
+{
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+
+    // Workers only emit protocol lines when asked to, so running a script by
+    // hand keeps its plain console output
+    env.insert("NEURODRIVE_EVENTS", "1");
+    env.insert("PYTHONUNBUFFERED", "1");
+
+    // Where the worker checkpoints, and resumes from after a restart
+    env.insert("NEURODRIVE_CHECKPOINT", m_supervisor->checkpointPath(modelType));
+    if (m_supervisor->restarts(modelType) > 0) {
+        env.insert("NEURODRIVE_RESTART", QString::number(m_supervisor->restarts(modelType)));
+    }
+
+    // Workers look for this variable and publish into the ring instead of writing output.avi
+    FrameStream *stream = streamForModel(modelType);
+    if (stream && stream->open()) {
+        env.insert("NEURODRIVE_FRAME_SHM", stream->ringName());
+    }
+
+    // drowsiness.py answers /last_records from the event log instead of its CSV
+    if (m_eventLog->isOpen()) {
+        env.insert("NEURODRIVE_EVENT_LOG", m_eventLog->directory());
+    }
+
+    // traffic.py takes its detection stride, input width and fps from the governor
+    if (modelType == TrafficSignRecognition) {
+        const QString controlName = m_governor->attach(modelType, forkServerKey(modelType));
+        if (!controlName.isEmpty()) {
+            env.insert("NEURODRIVE_CONTROL_SHM", controlName);
+        }
+    }
+
+    // Workers read their input from the shared decode instead of opening the
+    // video; a camera has a single reader, so its workers always do
+    if (m_sharedDecode || V4L2Capture::isCaptureDevice(inputVideoPath(modelType))) {
+        FrameSource *source = frameSourceFor(modelType);
+        const QString ringName = source ? source->subscribe(forkServerKey(modelType), inputPolicy(modelType)) : QString();
+        if (!ringName.isEmpty()) {
+            env.insert("NEURODRIVE_INPUT_SHM", ringName);
+        }
+    }
+    return env;
+}
+
+void ProcessManager::attachWorkerChannel(QIODevice *device, QObject *owner, int modelType)
+{
+    WorkerChannel *channel = new WorkerChannel(modelName(modelType), device, owner);
+    m_channels[modelType] = channel;
+
+    connect(channel, &WorkerChannel::workerStarted, this, [this, modelType](qint64 expectedFrames, double) {
+        reportStartLatency(modelType);
+        updateProgress();
+        emit modelStarted(modelType, expectedFrames);
+    });
+    connect(channel, &WorkerChannel::frameProcessed, this,
+            [this, channel, modelType](qint64 frameIndex, double fps, double latencyMs, const QList<Detection> &reported,
+                                       bool inferred) {
+        const qint64 eventNs = AlertEngine::clockNs();
+        auto labelsOf = [channel](const QList<Detection> &detections) {
+            QStringList labels;
+            labels.reserve(detections.size());
+            for (const Detection &detection : detections) {
+                labels.append(channel->className(detection.classId));
             }
+            return labels;
+        };
+        // A worker that skips frames has its boxes tracked across them; the
+        // timeline only gets what the model saw
+        QList<Detection> detections = reported;
+        const QList<Detection> boxes = channel->marksInference()
+                ? trackedBoxes(modelType, frameIndex, inferred ? &detections : nullptr) : detections;
+        const QStringList labels = labelsOf(detections);
+        if (FrameStream *stream = streamForModel(modelType)) {
+            stream->setDetections(boxes, channel->marksInference() ? labelsOf(boxes) : labels);
+        }
+        if (!detections.isEmpty()) {
+            m_alerts->handleDetections(detections, labels, eventNs);
+            m_detections->appendDetections(modelType, frameIndex, detections, labels);
+            emit detectionsReady(modelType, frameIndex, detections);
         }
+        m_metrics->recordFrame(modelType, frameIndex, latencyMs);
+        m_governor->recordFrame(modelType, latencyMs);
+        emit frameProcessed(modelType, frameIndex, fps, latencyMs);
+        updateProgress();
+    });
+    connect(channel, &WorkerChannel::lanesDetected, this,
+            [this, modelType](qint64 frameIndex, const QList<QPolygonF> &lanes) {
+        if (FrameStream *stream = streamForModel(modelType)) {
+            stream->setLanes(lanes);
+        }
+        emit lanesDetected(modelType, frameIndex, lanes);
+    });
+    connect(channel, &WorkerChannel::stateChanged, this,
+            [this, modelType](qint64 frameIndex, const QByteArray &name, double value) {
+        recordWorkerState(modelType, frameIndex, name, value);
+    });
+    connect(channel, &WorkerChannel::eyesDetected, this,
+            [this, modelType](qint64 frameIndex, double timeMs, const EyeLandmarks &eyes) {
+        analyzeEyes(modelType, frameIndex, timeMs, eyes);
+    });
+    connect(channel, &WorkerChannel::workerError, this, [this, modelType](const QString &message) {
+        qWarning() << modelName(modelType) << "worker error:" << message;
+        emit workerError(modelType, message);
+        updateStatus(modelName(modelType) + " error: " + message);
+    });
+    connect(channel, &WorkerChannel::workerDone, this, [this, channel, modelType](qint64 framesProcessed) {
+        qDebug() << "ProcessManager:" << modelName(modelType) << "averaged"
+                 << channel->averageLatencyMs() << "ms/frame over" << framesProcessed << "frames";
+        recordRunFootprint(modelType, channel->averageLatencyMs(), framesProcessed, "python");
+        updateProgress();
+        updateStatus(QString("%1 processing complete (%2 frames)").arg(modelName(modelType)).arg(framesProcessed));
+        emit modelCompleted(modelType, framesProcessed);
+    });
+}
+
+void ProcessManager::captureStderrTail(QProcess *process, int modelType)
+{
+    // stderr is only needed to explain a failure, so keep a bounded tail of it
+    connect(process, &QProcess::readyReadStandardError, this, [this, process, modelType]() {
+        static constexpr qsizetype MaxStderrTail = 4096;
+        QByteArray &tail = m_stderrTails[modelType];
+        tail += process->readAllStandardError();
+        if (tail.size() > MaxStderrTail) {
+            tail.remove(0, tail.size() - MaxStderrTail);
+        }
+    });
+}
+
+void ProcessManager::reportStartLatency(int modelType)
+{
+    if (!m_launchClock.isValid() || m_latencyReported.contains(modelType)) {
+        return;
+    }
+    m_latencyReported.insert(modelType);
+
+    const qint64 milliseconds = m_launchClock.elapsed();
+    const bool native = runsInProcess(modelType);
+    const bool warm = native || m_forkedWorkers.contains(modelType);
+    qDebug() << "ProcessManager:" << modelName(modelType) << "start latency" << milliseconds << "ms"
+             << (native ? "(native)" : warm ? "(warm, forked)" : "(cold start)");
+    m_metrics->recordSpawnLatency(modelType, milliseconds);
+    PerfLog::record("model.start", milliseconds, "ms",
+                    {{"model", modelName(modelType)}, {"start", native ? "native" : warm ? "warm" : "cold"}});
+    emit startLatencyMeasured(modelType, milliseconds, warm);
+}
+
+void ProcessManager::recordWorkerState(int modelType, qint64 frameIndex, const QByteArray &name, double value)
+{
+    // drowsiness.py no longer burns "DROWSY" into its frames
+    if (name == "drowsy") {
+        if (FrameStream *stream = streamForModel(modelType)) {
+            stream->setAlertText(value > 0.0 ? "DROWSY" : QString());
+        }
+        m_eventLog->append(EventLog::DrowsinessState, modelType, value, frameIndex);
+    }
+    m_detections->appendState(modelType, frameIndex, name, value);
+    emit workerStateChanged(modelType, frameIndex, name, value);
+}
+
+void ProcessManager::analyzeEyes(int modelType, qint64 frameIndex, double timeMs, const EyeLandmarks &eyes)
+{
+    static const QByteArray drowsy("drowsy");
+    static const QByteArray longClosure("long_closure");
+    const DrowsinessAnalyzer::Result &result = m_drowsiness.update(std::int64_t(timeMs),
+                                                                  eyes.found ? eyes.points : nullptr);
+    // The alert repeats and escalates on every frame's state; the event log,
+    // the sidecar and QML only get the changes
+    m_alerts->handleDrowsiness(result.drowsy ? 1.0 : 0.0, AlertEngine::clockNs());
+    if (result.drowsy != m_reportedDrowsy) {
+        m_reportedDrowsy = result.drowsy;
+        recordWorkerState(modelType, frameIndex, drowsy, result.drowsy ? 1.0 : 0.0);
+    }
+    // The state is a flag like drowsy; the length of the closure goes to the
+    // event log once it is over
+    if (result.longClosure) {
+        m_longClosureMs = result.closureMs;
+    }
+    if (result.longClosure != m_reportedLongClosure) {
+        m_reportedLongClosure = result.longClosure;
+        recordWorkerState(modelType, frameIndex, longClosure, result.longClosure ? 1.0 : 0.0);
+        if (!result.longClosure) {
+            m_eventLog->append(EventLog::LongClosure, modelType, double(m_longClosureMs), frameIndex);
+        }
+    }
+
+    // The HUD follows at a readable rate
+    if (!m_driverStateClock.isValid() || m_driverStateClock.elapsed() >= 500) {
+        m_driverStateClock.start();
+        QVariantMap state;
+        state.insert("face", result.face);
+        state.insert("ear", result.ear);
+        state.insert("perclos", result.perclos);
+        state.insert("blinksPerMinute", result.blinksPerMinute);
+        state.insert("threshold", result.threshold);
+        state.insert("calibrated", result.calibrated);
+        state.insert("drowsy", result.drowsy);
+        m_driverState = state;
+        emit driverStateChanged();
+    }
+}
+
+void ProcessManager::recordRunFootprint(int modelType, double averageLatencyMs, qint64 frames, const QString &backend)
+{
+    // The two backends of a model are compared by the same clip's latency and
+    // by the peak RSS of the process running it, next to the dashboard's own
+    qint64 pid = QCoreApplication::applicationPid();
+    if (QProcess *process = m_processes.value(modelType)) {
+        pid = process->processId();
+    } else if (ForkedWorker *worker = m_forkedWorkers.value(modelType)) {
+        pid = worker->processId();
+    }
+    // The shared decode is compared with each worker decoding its own copy
+    // by running the same clip with the setting on and off
+    const qint64 dashboardPid = QCoreApplication::applicationPid();
+    const bool sharedDecode = backend != "python" || m_sharedDecode
+            || V4L2Capture::isCaptureDevice(inputVideoPath(modelType));
+    const QString decode = sharedDecode ? "shared" : "own";
+    const double dashboardMb = MetricsRegistry::peakRssMb(dashboardPid);
+    PerfLog::record("model.frame_latency", averageLatencyMs, "ms",
+                    {{"model", modelName(modelType)}, {"frames", frames}, {"backend", backend}});
+    PerfLog::record("model.peak_rss", MetricsRegistry::peakRssMb(pid), "MB",
+                    {{"model", modelName(modelType)}, {"backend", backend}, {"decode", decode},
+                     {"dashboard_mb", dashboardMb}});
+    PerfLog::record("model.cpu", MetricsRegistry::cpuSeconds(pid), "s",
+                    {{"model", modelName(modelType)}, {"backend", backend}, {"decode", decode},
+                     {"frames", frames}, {"dashboard_s", MetricsRegistry::cpuSeconds(dashboardPid)}});
+
+    const FramePool::Stats pool = FramePool::instance().stats();
+    PerfLog::record("frame_pool.peak_in_use", double(pool.peakInUseBytes) / (1024.0 * 1024.0), "MB",
+                    {{"model", modelName(modelType)}, {"budget_mb", double(pool.budgetBytes) / (1024.0 * 1024.0)},
+                     {"allocated_mb", double(pool.allocatedBytes) / (1024.0 * 1024.0)}, {"exhausted", pool.exhausted}});
+
+    if (modelType == Drowsiness && m_drowsiness.calls() > 0) {
+        const DrowsinessAnalyzer::Result &result = m_drowsiness.result();
+        PerfLog::record("drowsiness.frame_cost", m_drowsiness.averageCostUs(), "us",
+                        {{"calls", m_drowsiness.calls()}, {"calibrated", result.calibrated},
+                         {"threshold", result.threshold}});
+    }
+
+    const auto tracker = m_trackers.constFind(modelType);
+    if (tracker != m_trackers.constEnd()) {
+        PerfLog::record("tracker.frame_cost", tracker->averageCostUs(), "us",
+                        {{"model", modelName(modelType)}, {"calls", tracker->calls()}});
+        PerfLog::record("tracker.tracks", tracker->tracksCreated(), "count",
+                        {{"model", modelName(modelType)}, {"frames", frames}});
+    }
+}
+
+QList<Detection> ProcessManager::trackedBoxes(int modelType, qint64 frameIndex, QList<Detection> *detections)
+{
+    // With detections, a frame the model ran on: they get their track ids.
+    // Without, a frame in between. Either way the boxes to draw on the frame
+    ObjectTracker &tracker = m_trackers[modelType];
+    const std::vector<ObjectTracker::Box> *tracks;
+    if (detections) {
+        std::vector<ObjectTracker::Box> boxes;
+        boxes.reserve(std::size_t(detections->size()));
+        for (const Detection &detection : std::as_const(*detections)) {
+            ObjectTracker::Box box;
+            box.classId = detection.classId;
+            box.confidence = detection.confidence;
+            box.x1 = float(detection.box.left());
+            box.y1 = float(detection.box.top());
+            box.x2 = float(detection.box.right());
+            box.y2 = float(detection.box.bottom());
+            boxes.push_back(box);
+        }
+        tracks = &tracker.update(frameIndex, boxes);
+        for (qsizetype i = 0; i < detections->size(); ++i) {
+            (*detections)[i].trackId = boxes[std::size_t(i)].trackId;
+        }
+    } else {
+        tracks = &tracker.predict(frameIndex);
+    }
+
+    QList<Detection> result;
+    result.reserve(qsizetype(tracks->size()));
+    for (const ObjectTracker::Box &box : *tracks) {
+        Detection detection;
+        detection.classId = box.classId;
+        detection.confidence = box.confidence;
+        detection.box = QRectF(QPointF(box.x1, box.y1), QPointF(box.x2, box.y2));
+        detection.trackId = box.trackId;
+        result.append(detection);
+    }
+    return result;
+}
+
+void ProcessManager::resetProgress()
+{
+    m_progress = 0.0;
+    m_framesProcessed = 0;
+    m_expectedFrames = 0;
+    m_processingFps = 0.0;
+    m_reportedPercent = -1;
+    emit progressChanged();
+}
+
+void ProcessManager::updateProgress()
+{
+    // Combined mode reports the slowest worker's view of the run
+    qint64 processed = 0;
+    qint64 expected = 0;
+    double fps = 0.0;
+    bool first = true;
+    auto consider = [&](qint64 workerProcessed, qint64 workerExpected, double workerFps) {
+        if (workerExpected <= 0) {
+            return;
+        }
+        const double fraction = double(workerProcessed) / double(workerExpected);
+        if (first || fraction < double(processed) / double(expected)) {
+            processed = workerProcessed;
+            expected = workerExpected;
+            fps = workerFps;
+            first = false;
+        }
+    };
+    for (WorkerChannel *channel : std::as_const(m_channels)) {
+        consider(channel->framesProcessed(), channel->expectedFrames(), channel->fps());
+    }
+    // Frames the native engine skipped while busy still count as progress through the video
+    if (m_laneEngineUsed) {
+        consider(m_laneEngine->framesDecoded(), m_laneEngine->expectedFrames(), m_laneEngine->fps());
+    }
+    if (m_trafficEngineUsed) {
+        consider(m_trafficEngine->framesDecoded(), m_trafficEngine->expectedFrames(), m_trafficEngine->fps());
+    }
+
+    m_framesProcessed = int(processed);
+    m_expectedFrames = int(expected);
+    m_processingFps = fps;
+    m_progress = expected > 0 ? qBound(0.0, double(processed) / double(expected), 1.0) : 0.0;
+    emit progressChanged();
+
+    // Only touch the status line when the visible percentage changes
+    const int percent = int(m_progress * 100.0);
+    if (expected > 0 && percent != m_reportedPercent) {
+        m_reportedPercent = percent;
+        updateStatus(QString("Processing: %1% (%2/%3 frames, %4 fps)")
+                     .arg(percent).arg(processed).arg(expected).arg(fps, 0, 'f', 1));
     }
-    
-    // Clean up the processes
-    qDeleteAll(m_processes.values());
-    m_processes.clear();
+}
+
+QString ProcessManager::modelName(int modelType) const
+{
+    switch (static_cast<ModelType>(modelType)) {
+        case TrafficSignRecognition: return "Traffic Sign";
+        case Drowsiness: return "Drowsiness";
+        case LaneDetection: return "Lane Detection";
+        case Combined: return "Combined";
+        default: return "Unknown";
+    }
+}
+
+QString ProcessManager::scriptPath(int modelType) const
+{
+    switch (static_cast<ModelType>(modelType)) {
+        case TrafficSignRecognition: return m_trafficSignPath;
+        case Drowsiness: return m_drowsinessPath;
+        case LaneDetection: return m_laneDetectionPath;
+        case Combined: return m_combinedExtraPath;
+        default: return QString();
+    }
+}
+
+void ProcessManager::loadAlertSounds()
+{
+    if (!m_servicesStarted) {
+        return;
+    }
+    // NEURODRIVE_ALERT_SOUNDS first, then the class_audio the scripts serve
+    QStringList directories;
+    const QString configured = qEnvironmentVariable("NEURODRIVE_ALERT_SOUNDS");
+    if (!configured.isEmpty()) {
+        directories << configured;
+    }
+    for (int modelType : {Drowsiness, TrafficSignRecognition}) {
+        directories << QFileInfo(scriptPath(modelType)).absolutePath() + "/class_audio";
+    }
+    m_alerts->loadSounds(directories);
+}
+
+QString ProcessManager::forkServerKey(int modelType) const
+{
+    switch (static_cast<ModelType>(modelType)) {
+        case TrafficSignRecognition: return "traffic";
+        case Drowsiness: return "drowsiness";
+        case LaneDetection: return "lane";
+        default: return QString();
+    }
+}
+
+QString ProcessManager::inputVideoPath(int modelType) const
+{
+    // The configured camera, else the video each worker script opens from its own directory
+    switch (static_cast<ModelType>(modelType)) {
+        case TrafficSignRecognition:
+            return !m_frontCamera.isEmpty() ? m_frontCamera : QFileInfo(m_trafficSignPath).absolutePath() + "/vid.mp4";
+        case Drowsiness:
+            return !m_cabinCamera.isEmpty() ? m_cabinCamera : QFileInfo(m_drowsinessPath).absolutePath() + "/vid.mp4";
+        case LaneDetection:
+            return !m_frontCamera.isEmpty() ? m_frontCamera : QFileInfo(m_laneDetectionPath).absolutePath() + "/Lane_detect.mp4";
+        default: return QString();
+    }
+}
+
+FrameSource::Policy ProcessManager::inputPolicy(int modelType) const
+{
+    // What each script would otherwise do to the frames it decodes itself
+    FrameSource::Policy policy;
+    switch (static_cast<ModelType>(modelType)) {
+        case TrafficSignRecognition:
+            policy.maxFps = 15.0;
+            policy.size = QSize(640, 640);
+            break;
+        case LaneDetection:
+            policy.size = QSize(600, 600);
+            policy.aspectMode = Qt::IgnoreAspectRatio;
+            break;
+        default:
+            break;
+    }
+    return policy;
+}
+
+V4L2Capture::Format ProcessManager::cameraFormat(int modelType) const
+{
+    // The face needs far fewer pixels than signs and lane markings at a distance
+    V4L2Capture::Format format;
+    if (modelType == Drowsiness) {
+        format.size = QSize(640, 480);
+    }
+    return format;
+}
+
+FrameSource *ProcessManager::frameSourceFor(int modelType)
+{
+    const QFileInfo info(inputVideoPath(modelType));
+    if (!info.exists()) {
+        return nullptr;
+    }
+
+    const QString key = info.canonicalFilePath();
+    FrameSource *source = m_frameSources.value(key);
+    if (!source) {
+        source = new FrameSource(key, this);
+        source->setCaptureFormat(cameraFormat(modelType));
+        connect(source, &FrameSource::errorOccurred, this, [this](const QString &message) {
+            qWarning() << "FrameSource error:" << message;
+        });
+        m_frameSources.insert(key, source);
+    }
+    return source;
+}
+
+void ProcessManager::startFrameSources()
+{
+    for (FrameSource *source : std::as_const(m_frameSources)) {
+        source->start();
+    }
+}
+
+void ProcessManager::startForkServer()
+{
+    // Script paths set while starting up wait for the services
+    if (!m_servicesStarted) {
+        return;
+    }
+
+    // Restarting the zygote would take its running workers down with it
+    if (!m_forkedWorkers.isEmpty()) {
+        m_forkServerTimer.start();
+        return;
+    }
+
+    const QString zygotePath = qEnvironmentVariable("NEURODRIVE_ZYGOTE",
+                                                    QCoreApplication::applicationDirPath() + "/zygote.py");
+    ForkServer::Preloads preloads;
+    for (int modelType : {TrafficSignRecognition, Drowsiness, LaneDetection}) {
+        // torch is the bulk of the zygote's memory; it is not loaded for
+        // traffic signs the native engine will detect
+        if (modelType == TrafficSignRecognition && m_nativeTrafficSigns && m_trafficEngine->isUsable()) {
+            continue;
+        }
+        if (QFileInfo::exists(scriptPath(modelType))) {
+            preloads.insert(forkServerKey(modelType), scriptPath(modelType));
+        }
+    }
+
+    if (zygotePath == "off" || !QFileInfo::exists(zygotePath) || preloads.isEmpty()) {
+        if (m_forkServer->isRunning()) {
+            m_forkServer->stop();
+        }
+        qDebug() << "ProcessManager: fork server not started, models will start cold";
+        return;
+    }
+
+    if (m_forkServer->isRunning() && m_forkServer->preloads() == preloads
+        && m_forkServer->pythonExecutable() == m_pythonExecutable
+        && m_forkServer->zygotePath() == zygotePath) {
+        return;
+    }
+
+    m_forkServer->start(m_pythonExecutable, zygotePath, preloads);
+}
+
+bool ProcessManager::startWarmWorker(int modelType)
+{
+    const QString key = forkServerKey(modelType);
+    const QString path = scriptPath(modelType);
+    if (key.isEmpty() || !m_forkServer->hasPreloaded(key) || m_forkServer->preloads().value(key) != path) {
+        return false;
+    }
+
+    ForkedWorker *worker = m_forkServer->spawn(key, QFileInfo(path).absolutePath(), workerEnvironment(modelType));
+    if (!worker) {
+        return false;
+    }
+    m_forkedWorkers[modelType] = worker;
+    setModelState(modelType, Starting);
+
+    connect(worker, &ForkedWorker::outputReady, this, [this, worker, modelType](QIODevice *device) {
+        attachWorkerChannel(device, worker, modelType);
+    });
+    connect(worker, &ForkedWorker::started, this, [this, modelType]() {
+        setModelState(modelType, Running);
+        if (!m_isRunning) {
+            m_isRunning = true;
+            emit isRunningChanged(m_isRunning);
+        }
+    });
+    connect(worker, &ForkedWorker::finished, this, [this, modelType](int exitCode, QProcess::ExitStatus exitStatus) {
+        // stderr shares the socket with stdout and was already logged line by line
+        m_forkedWorkers.remove(modelType);
+        finishWorker(modelType, exitCode, exitStatus, QByteArray());
+        m_channels.remove(modelType);
+    });
+    connect(worker, &ForkedWorker::finished, worker, &QObject::deleteLater);
+
+    updateStatus(modelName(modelType) + " forked from the preloaded fork server");
+    return true;
 }
 
 void ProcessManager::updateStatus(const QString &message)
@@ -487,9 +1561,4 @@ void ProcessManager::testPythonEnvironment()
     
     updateStatus("Testing Python environment...");
     testProcess->start(m_pythonExecutable, QStringList() << "--version");
-    
-    if (!testProcess->waitForStarted(3000)) {
-        updateStatus("Failed to start Python test");
-        testProcess->deleteLater();
-    }
 } 
\ No newline at end of file
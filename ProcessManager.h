@@ -4,7 +4,27 @@
 #include <QObject>
 #include <QProcess>
 #include <QVariantList>
+#include <QVariantMap>
 #include <QMap>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "AlertEngine.h"
+#include "DetectionSidecar.h"
+#include "DrowsinessAnalyzer.h"
+#include "EventLog.h"
+#include "ForkServer.h"
+#include "FrameSource.h"
+#include "FrameStream.h"
+#include "LaneDetectionEngine.h"
+#include "MetricsRegistry.h"
+#include "ObjectTracker.h"
+#include "RateGovernor.h"
+#include "SegmentRecorder.h"
+#include "TrafficSignEngine.h"
+#include "WorkerChannel.h"
+#include "WorkerResources.h"
+#include "WorkerSupervisor.h"
 
 class ProcessManager : public QObject
 {
@@ -13,6 +33,27 @@ class ProcessManager : public QObject
     Q_PROPERTY(bool isRunning READ isRunning NOTIFY isRunningChanged)
     Q_PROPERTY(QString statusMessage READ statusMessage NOTIFY statusMessageChanged)
     Q_PROPERTY(QString pythonExecutable READ pythonExecutable WRITE setPythonExecutable NOTIFY pythonExecutableChanged)
+    Q_PROPERTY(bool nativeLaneDetection READ nativeLaneDetection WRITE setNativeLaneDetection NOTIFY nativeLaneDetectionChanged)
+    Q_PROPERTY(bool nativeTrafficSigns READ nativeTrafficSigns WRITE setNativeTrafficSigns NOTIFY nativeTrafficSignsChanged)
+    Q_PROPERTY(bool sharedDecode READ sharedDecode WRITE setSharedDecode NOTIFY sharedDecodeChanged)
+    Q_PROPERTY(QString frontCamera READ frontCamera WRITE setFrontCamera NOTIFY camerasChanged)
+    Q_PROPERTY(QString cabinCamera READ cabinCamera WRITE setCabinCamera NOTIFY camerasChanged)
+    Q_PROPERTY(FrameStream* frontStream READ frontStream CONSTANT)
+    Q_PROPERTY(FrameStream* cabinStream READ cabinStream CONSTANT)
+    Q_PROPERTY(EventLog* eventLog READ eventLog CONSTANT)
+    Q_PROPERTY(MetricsRegistry* metrics READ metrics CONSTANT)
+    Q_PROPERTY(RateGovernor* governor READ governor CONSTANT)
+    Q_PROPERTY(WorkerResources* resources READ resources CONSTANT)
+    Q_PROPERTY(WorkerSupervisor* supervisor READ supervisor CONSTANT)
+    Q_PROPERTY(SegmentRecorder* frontRecording READ frontRecording CONSTANT)
+    Q_PROPERTY(SegmentRecorder* cabinRecording READ cabinRecording CONSTANT)
+    Q_PROPERTY(DetectionSidecar* detections READ detections CONSTANT)
+    Q_PROPERTY(AlertEngine* alerts READ alerts CONSTANT)
+    Q_PROPERTY(QVariantMap driverState READ driverState NOTIFY driverStateChanged)
+    Q_PROPERTY(double progress READ progress NOTIFY progressChanged)
+    Q_PROPERTY(int framesProcessed READ framesProcessed NOTIFY progressChanged)
+    Q_PROPERTY(int expectedFrames READ expectedFrames NOTIFY progressChanged)
+    Q_PROPERTY(double processingFps READ processingFps NOTIFY progressChanged)
 
 public:
     explicit ProcessManager(QObject *parent = nullptr);
@@ -27,15 +68,56 @@ public:
     };
     Q_ENUM(ModelType)
 
+    // Lifecycle of the worker serving one model
+    enum WorkerState {
+        Stopped = 0,
+        Starting,
+        Running,
+        Stopping,
+        Restarting      // Failed mid-run, waiting out the supervisor's backoff
+    };
+    Q_ENUM(WorkerState)
+
+    // Grace period between SIGTERM and SIGKILL, also used for the interpreter probe
+    static constexpr int StopTimeoutMs = 3000;
+
     // Property getters
     int activeModel() const { return m_activeModel; }
     bool isRunning() const { return m_isRunning; }
     QString statusMessage() const { return m_statusMessage; }
     QString pythonExecutable() const { return m_pythonExecutable; }
+    bool nativeLaneDetection() const { return m_nativeLaneDetection; }
+    bool nativeTrafficSigns() const { return m_nativeTrafficSigns; }
+    bool sharedDecode() const { return m_sharedDecode; }
+    QString frontCamera() const { return m_frontCamera; }
+    QString cabinCamera() const { return m_cabinCamera; }
+    FrameStream *frontStream() const { return m_frontStream; }
+    FrameStream *cabinStream() const { return m_cabinStream; }
+    EventLog *eventLog() const { return m_eventLog; }
+    MetricsRegistry *metrics() const { return m_metrics; }
+    RateGovernor *governor() const { return m_governor; }
+    WorkerResources *resources() const { return m_resources; }
+    WorkerSupervisor *supervisor() const { return m_supervisor; }
+    SegmentRecorder *frontRecording() const { return m_frontRecording; }
+    SegmentRecorder *cabinRecording() const { return m_cabinRecording; }
+    DetectionSidecar *detections() const { return m_detections; }
+    AlertEngine *alerts() const { return m_alerts; }
+    // PERCLOS, blink rate and EAR threshold of the current run:
+    // {face, ear, perclos, blinksPerMinute, threshold, calibrated, drowsy}
+    QVariantMap driverState() const { return m_driverState; }
+    double progress() const { return m_progress; }
+    int framesProcessed() const { return m_framesProcessed; }
+    int expectedFrames() const { return m_expectedFrames; }
+    double processingFps() const { return m_processingFps; }
 
     // Property setters
     void setActiveModel(int model);
     void setPythonExecutable(const QString &executable);
+    void setNativeLaneDetection(bool enabled);
+    void setNativeTrafficSigns(bool enabled);
+    void setSharedDecode(bool enabled);
+    void setFrontCamera(const QString &device);
+    void setCabinCamera(const QString &device);
 
     // Script paths configuration
     Q_INVOKABLE void setTrafficSignPath(const QString &path);
@@ -49,7 +131,14 @@ public:
     Q_INVOKABLE QString getCombinedPath() const { return m_combinedExtraPath; }
     Q_INVOKABLE QString getLaneDetectionPath() const { return m_laneDetectionPath; }
 
+    Q_INVOKABLE int modelState(int modelType) const { return m_modelStates.value(modelType, Stopped); }
+
 public slots:
+    // Opens the event log and recordings, starts the alert thread, reads
+    // the resource policy file, finds the interpreter and lets the fork
+    // server preload the models; deferred from construction so the login
+    // page is up first, and run at the latest when a model is started
+    Q_INVOKABLE void startServices();
     Q_INVOKABLE void startModel(int modelType);
     Q_INVOKABLE void stopCurrentModel();
     Q_INVOKABLE void testPythonEnvironment();
@@ -59,8 +148,34 @@ signals:
     void isRunningChanged(bool running);
     void statusMessageChanged(const QString &message);
     void pythonExecutableChanged(const QString &executable);
+    void nativeLaneDetectionChanged(bool enabled);
+    void nativeTrafficSignsChanged(bool enabled);
+    void sharedDecodeChanged(bool enabled);
+    void camerasChanged();
     void processError(const QString &error);
     void processFinished(int modelType, int exitCode);
+    void progressChanged();
+    void driverStateChanged();
+    void modelStateChanged(int modelType, int state);
+
+    // Typed worker events, forwarded from each model's WorkerChannel
+    void modelStarted(int modelType, qint64 expectedFrames);
+    void frameProcessed(int modelType, qint64 frameIndex, double fps, double latencyMs);
+    void detectionsReady(int modelType, qint64 frameIndex, const QList<Detection> &detections);
+    void lanesDetected(int modelType, qint64 frameIndex, const QList<QPolygonF> &lanes);
+    void workerStateChanged(int modelType, qint64 frameIndex, const QByteArray &name, double value);
+    void workerError(int modelType, const QString &message);
+    void modelCompleted(int modelType, qint64 framesProcessed);
+
+    // A worker failed mid-run and starts again after delayMs, from the frame
+    // after resumeFrame (-1 when it had not checkpointed yet)
+    void workerRestarting(int modelType, int attempt, int delayMs, qint64 resumeFrame);
+
+    // A recorded segment of a camera view ("front" or "cabin") is complete and playable
+    void recordingSegmentSealed(const QString &channel, const QString &path, qint64 startMs, qint64 durationMs);
+
+    // Time from startModel() to the worker's first protocol event
+    void startLatencyMeasured(int modelType, qint64 milliseconds, bool warm);
 
 private slots:
     void handleProcessError(QProcess::ProcessError error);
@@ -72,13 +187,58 @@ private:
     void startDrowsinessDetection();
     void startCombinedModel();
     void startLaneDetection();
+    bool startNativeLaneDetection();
+    bool startNativeTrafficSigns();
+    void loadTrafficSignModel();
+    QString trafficSignModelPath() const;
+    void startWorker(int modelType);
+    void restartWorker(int modelType, int attempt);
     void terminateAllProcesses();
+    void detectPythonExecutable(QStringList candidates);
+    QProcess *createWorkerProcess(int modelType);
+    void stopProcess(int modelType, QProcess *process);
+    void stopForkedWorker(int modelType, ForkedWorker *worker);
+    bool hasCurrentWorker(int modelType) const;
+    bool runsInProcess(int modelType) const;
+    void setModelState(int modelType, WorkerState state);
     void updateStatus(const QString &message);
+    FrameStream *streamForModel(int modelType) const;
+    QProcessEnvironment workerEnvironment(int modelType);
+    void attachWorkerChannel(QIODevice *device, QObject *owner, int modelType);
+    void captureStderrTail(QProcess *process, int modelType);
+    void finishWorker(int modelType, int exitCode, QProcess::ExitStatus exitStatus, const QByteArray &stderrData);
+    void reportStartLatency(int modelType);
+    // The event log, sidecar and QML side of a state. The alert follows
+    // analyzeEyes() alone, so a /detect result cannot start or end it
+    void recordWorkerState(int modelType, qint64 frameIndex, const QByteArray &name, double value);
+    void analyzeEyes(int modelType, qint64 frameIndex, double timeMs, const EyeLandmarks &eyes);
+    void recordRunFootprint(int modelType, double averageLatencyMs, qint64 frames, const QString &backend);
+    QList<Detection> trackedBoxes(int modelType, qint64 frameIndex, QList<Detection> *detections);
+    bool anyWorkerRunning() const;
+    void resetProgress();
+    void updateProgress();
+    QString modelName(int modelType) const;
+
+    // Pre-warmed workers
+    void startForkServer();
+    bool startWarmWorker(int modelType);
+    QString forkServerKey(int modelType) const;
+    QString scriptPath(int modelType) const;
+    void loadAlertSounds();
+
+    // Shared decode
+    QString inputVideoPath(int modelType) const;
+    FrameSource::Policy inputPolicy(int modelType) const;
+    V4L2Capture::Format cameraFormat(int modelType) const;
+    FrameSource *frameSourceFor(int modelType);
+    void startFrameSources();
 
     int m_activeModel = ModelType::None;
     bool m_isRunning = false;
     QString m_statusMessage = "Ready";
     QString m_pythonExecutable = "python3";  // Default to python3 for Linux
+    bool m_pythonExecutableSet = false;
+    bool m_servicesStarted = false;
 
     // Script paths - Linux paths as specified
     QString m_trafficSignPath = "/models/traffic_signs_detection_3/main.py";
@@ -88,6 +248,89 @@ private:
 
     // Process management
     QMap<int, QProcess*> m_processes;
+    QMap<int, WorkerChannel*> m_channels;
+    QMap<int, QByteArray> m_stderrTails;
+    QMap<int, ForkedWorker*> m_forkedWorkers;
+    QMap<int, WorkerState> m_modelStates;
+
+    // Fork server holding the preloaded worker scripts; restarted (debounced)
+    // whenever the interpreter or a script path changes
+    ForkServer *m_forkServer;
+    QTimer m_forkServerTimer;
+
+    // Start latency, measured once per model per startModel()
+    QElapsedTimer m_launchClock;
+    QSet<int> m_latencyReported;
+
+    // In-process lane detection, used instead of lane.py when enabled
+    LaneDetectionEngine *m_laneEngine;
+    bool m_nativeLaneDetection = true;
+    bool m_laneEngineUsed = false;  // By the current startModel()
+
+    // In-process traffic sign detection on the ONNX export of traffic.py's
+    // model, used instead of the worker when enabled and the model loads
+    TrafficSignEngine *m_trafficEngine;
+    bool m_nativeTrafficSigns = true;
+    bool m_trafficEngineUsed = false;  // By the current startModel()
+
+    // One decode per distinct input video of the current startModel(), keyed
+    // by canonical path and fanned out to every model reading it
+    QMap<QString, FrameSource*> m_frameSources;
+    bool m_sharedDecode = true;
+
+    // V4L2 devices used instead of the videos when set: the road camera feeds
+    // traffic and lane detection, the cabin camera drowsiness
+    QString m_frontCamera;
+    QString m_cabinCamera;
+
+    // Real progress reported by the workers
+    double m_progress = 0.0;
+    int m_framesProcessed = 0;
+    int m_expectedFrames = 0;
+    double m_processingFps = 0.0;
+    int m_reportedPercent = -1;
+
+    // Live frame streams shared with the model workers
+    FrameStream *m_frontStream;
+    FrameStream *m_cabinStream;
+
+    // Driver events reported by the workers, kept across runs
+    EventLog *m_eventLog;
+
+    // Per-model runtime metrics for the performance HUD and fleet scraping
+    MetricsRegistry *m_metrics;
+
+    // Adapts traffic.py's stride, input width and fps to latency, load and temperature
+    RateGovernor *m_governor;
+
+    // CPU affinity, priority and cgroup limits of each model's worker
+    WorkerResources *m_resources;
+
+    // Restarts failed workers from their checkpoints
+    WorkerSupervisor *m_supervisor;
+
+    // Rolling on-disk recordings of what each camera view showed
+    SegmentRecorder *m_frontRecording;
+    SegmentRecorder *m_cabinRecording;
+
+    // Every detection of the current run, searchable by class and time
+    DetectionSidecar *m_detections;
+
+    // Boxes of the models that skip frames, predicted onto the ones in
+    // between; one tracker per model, reset by startModel()
+    QMap<int, ObjectTracker> m_trackers;
+
+    // Plays the drowsiness and traffic sign alerts straight from the events
+    AlertEngine *m_alerts;
+
+    // Drowsiness from drowsiness.py's eye landmarks, reset by startModel()
+    DrowsinessAnalyzer m_drowsiness;
+    // Its last forwarded states, so that only changes are recorded
+    bool m_reportedDrowsy = false;
+    bool m_reportedLongClosure = false;
+    int m_longClosureMs = 0;    // Of the long closure in progress
+    QVariantMap m_driverState;
+    QElapsedTimer m_driverStateClock;
 };
 
 #endif // PROCESSMANAGER_H
\ No newline at end of file
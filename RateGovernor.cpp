@@ -0,0 +1,213 @@
+#include "RateGovernor.h"
+#include "PerfLog.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QThread>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+const QVector<WorkerControl::Settings> &RateGovernor::ladder()
+{
+    // stride, max width, fps; the input ring never delivers more than 15 fps at 640 px.
+    // The dashboard tracks boxes across skipped frames, so the stride goes up
+    // first and the picture degrades last
+    static const QVector<WorkerControl::Settings> levels = {
+        {1, 640, 15.0, 0},
+        {2, 640, 15.0, 1},
+        {3, 640, 15.0, 2},
+        {5, 640, 15.0, 3},
+        {5, 512, 12.0, 4},
+        {8, 416, 10.0, 5},
+        {10, 320, 8.0, 6},
+        {10, 320, 5.0, 7}
+    };
+    return levels;
+}
+
+RateGovernor::RateGovernor(QObject *parent)
+    : QObject(parent)
+{
+    const QString sysfsRoot = qEnvironmentVariable("NEURODRIVE_SYSFS_ROOT");
+    if (!sysfsRoot.isEmpty()) {
+        m_policy.sysfsRoot = sysfsRoot;
+    }
+    const QString procRoot = qEnvironmentVariable("NEURODRIVE_PROC_ROOT");
+    if (!procRoot.isEmpty()) {
+        m_policy.procRoot = procRoot;
+    }
+
+    m_timer.setInterval(m_policy.intervalMs);
+    connect(&m_timer, &QTimer::timeout, this, &RateGovernor::tick);
+}
+
+void RateGovernor::setPolicy(const Policy &policy)
+{
+    m_policy = policy;
+    m_timer.setInterval(m_policy.intervalMs);
+}
+
+void RateGovernor::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled) {
+        return;
+    }
+    m_enabled = enabled;
+
+    // Disabled, the workers go back to the fixed settings they always had
+    if (!m_enabled) {
+        m_timer.stop();
+        for (auto it = m_governed.begin(); it != m_governed.end(); ++it) {
+            apply(it.key(), *it.value(), DefaultLevel, "governor disabled");
+        }
+    } else if (!m_governed.isEmpty()) {
+        m_timer.start();
+    }
+    emit enabledChanged();
+}
+
+QString RateGovernor::attach(int model, const QString &subscriber)
+{
+    detach(model);
+
+    // Unique per block, so a detached block being unlinked never takes its successor's name
+    static quint32 serial = 0;
+    const QString name = QString("/neurodrive-%1-ctl%2-%3")
+            .arg(QCoreApplication::applicationPid()).arg(++serial).arg(subscriber);
+
+    auto governed = std::make_shared<Governed>();
+    if (!governed->control.create(name, ladder().at(DefaultLevel))) {
+        qWarning() << "RateGovernor: could not create control block for" << subscriber << ":"
+                   << governed->control.errorString();
+        return QString();
+    }
+    m_governed.insert(model, governed);
+    if (m_enabled && !m_timer.isActive()) {
+        m_timer.start();
+    }
+    return governed->control.name();
+}
+
+void RateGovernor::detach(int model)
+{
+    m_governed.remove(model);
+    if (m_governed.isEmpty()) {
+        m_timer.stop();
+    }
+}
+
+void RateGovernor::detachAll()
+{
+    m_governed.clear();
+    m_timer.stop();
+}
+
+void RateGovernor::recordFrame(int model, double latencyMs)
+{
+    const auto it = m_governed.constFind(model);
+    if (it != m_governed.constEnd()) {
+        it.value()->latencies.append(latencyMs);
+    }
+}
+
+int RateGovernor::level(int model) const
+{
+    const auto it = m_governed.constFind(model);
+    return it != m_governed.constEnd() ? it.value()->level : -1;
+}
+
+void RateGovernor::tick()
+{
+    m_temperatureC = readTemperature();
+    m_loadRatio = readLoadRatio();
+    emit sampled();
+
+    const int cheapest = int(ladder().size()) - 1;
+    for (auto it = m_governed.begin(); it != m_governed.end(); ++it) {
+        Governed &governed = *it.value();
+        QVector<double> latencies = std::exchange(governed.latencies, {});
+
+        // Readings right after a change still reflect the previous level
+        if (++governed.ticksSinceChange <= m_policy.holdTicks) {
+            continue;
+        }
+
+        double p95 = -1.0;
+        if (latencies.size() >= m_policy.minSamples) {
+            const qsizetype rank = qsizetype(std::ceil(0.95 * double(latencies.size()))) - 1;
+            std::nth_element(latencies.begin(), latencies.begin() + rank, latencies.end());
+            p95 = latencies[rank];
+        }
+
+        if (m_temperatureC >= m_policy.criticalC) {
+            apply(it.key(), governed, cheapest, QString("%1 °C is critical").arg(m_temperatureC, 0, 'f', 1));
+        } else if (m_temperatureC >= m_policy.hotC) {
+            apply(it.key(), governed, governed.level + 1, QString("%1 °C").arg(m_temperatureC, 0, 'f', 1));
+        } else if (p95 > m_policy.targetLatencyMs) {
+            apply(it.key(), governed, governed.level + 1, QString("p95 latency %1 ms").arg(p95, 0, 'f', 1));
+        } else if (m_loadRatio > m_policy.highLoad) {
+            apply(it.key(), governed, governed.level + 1, QString("load %1 per core").arg(m_loadRatio, 0, 'f', 2));
+        } else if (p95 >= 0.0 && p95 < 0.6 * m_policy.targetLatencyMs
+                   && m_temperatureC < m_policy.warmC && m_loadRatio < m_policy.lowLoad) {
+            if (++governed.calmTicks >= m_policy.headroomTicks) {
+                apply(it.key(), governed, governed.level - 1, QString("headroom, p95 latency %1 ms").arg(p95, 0, 'f', 1));
+            }
+        } else {
+            governed.calmTicks = 0;
+        }
+    }
+}
+
+void RateGovernor::apply(int model, Governed &governed, int level, const QString &reason)
+{
+    level = qBound(0, level, int(ladder().size()) - 1);
+    governed.calmTicks = 0;
+    if (level == governed.level) {
+        return;
+    }
+
+    governed.level = level;
+    governed.ticksSinceChange = 0;
+    governed.latencies.clear();
+    const WorkerControl::Settings &settings = ladder().at(level);
+    governed.control.setSettings(settings);
+
+    qDebug() << "RateGovernor: model" << model << "to level" << level << "(stride" << settings.stride
+             << "," << settings.maxWidth << "px," << settings.fps << "fps):" << reason;
+    PerfLog::record("governor.level", level, "level", {{"model", model}, {"reason", reason},
+                    {"temperatureC", m_temperatureC}, {"loadRatio", m_loadRatio}});
+    emit levelChanged(model, level, reason);
+}
+
+double RateGovernor::readTemperature() const
+{
+    // The hottest zone decides; millidegrees Celsius in each zone's temp file
+    double hottest = -1.0;
+    const QDir thermal(m_policy.sysfsRoot + "/class/thermal");
+    const QStringList zones = thermal.entryList({"thermal_zone*"}, QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &zone : zones) {
+        QFile file(thermal.filePath(zone + "/temp"));
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        bool ok = false;
+        const double celsius = file.readAll().trimmed().toDouble(&ok) / 1000.0;
+        if (ok) {
+            hottest = qMax(hottest, celsius);
+        }
+    }
+    return hottest;
+}
+
+double RateGovernor::readLoadRatio() const
+{
+    QFile file(m_policy.procRoot + "/loadavg");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0.0;
+    }
+    const double load = file.readAll().split(' ').value(0).toDouble();
+    return load / double(qMax(1, QThread::idealThreadCount()));
+}
@@ -0,0 +1,104 @@
+#ifndef RATEGOVERNOR_H
+#define RATEGOVERNOR_H
+
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+#include <memory>
+
+#include "WorkerControl.h"
+
+// Control loop holding each governed worker near a target inference latency
+// without driving the board into thermal throttling. Once per interval it
+// reads the workers' reported latencies, the load average and the hottest
+// thermal zone, and moves each worker one step along a ladder of settings
+// (detection stride, input width, processed fps), pushed to the worker
+// through its WorkerControl block.
+//
+// A step down is taken as soon as there is pressure; a step up only after
+// HeadroomTicks calm intervals in a row, so the level does not oscillate.
+// sysfs and procfs are read below Policy::sysfsRoot and Policy::procRoot,
+// which NEURODRIVE_SYSFS_ROOT and NEURODRIVE_PROC_ROOT override, so the loop
+// can be driven from a fake tree.
+class RateGovernor : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(double temperatureC READ temperatureC NOTIFY sampled)
+    Q_PROPERTY(double loadRatio READ loadRatio NOTIFY sampled)
+    Q_PROPERTY(double targetLatencyMs READ targetLatencyMs CONSTANT)
+
+public:
+    struct Policy
+    {
+        double targetLatencyMs = 150.0;  // p95 of the worker's per-frame latency
+        double warmC = 65.0;             // No step up at or above
+        double hotC = 75.0;              // Step down at or above
+        double criticalC = 80.0;         // Straight to the cheapest level; the Pi throttles here
+        double highLoad = 1.5;           // 1-minute load average per core
+        double lowLoad = 0.9;
+        int intervalMs = 1000;
+        int holdTicks = 3;               // Intervals left alone after a change
+        int headroomTicks = 5;           // Calm intervals before a step up
+        int minSamples = 5;              // Fewer frames in an interval say nothing about latency
+        QString sysfsRoot = "/sys";
+        QString procRoot = "/proc";
+    };
+
+    // Cheapest last; the default level matches what traffic.py used to hard-code
+    static const QVector<WorkerControl::Settings> &ladder();
+    static constexpr int DefaultLevel = 2;
+
+    explicit RateGovernor(QObject *parent = nullptr);
+
+    Policy policy() const { return m_policy; }
+    void setPolicy(const Policy &policy);
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+    double temperatureC() const { return m_temperatureC; }
+    double loadRatio() const { return m_loadRatio; }
+    double targetLatencyMs() const { return m_policy.targetLatencyMs; }
+
+    // Creates the model's control block and returns its name for the worker, empty on failure
+    QString attach(int model, const QString &subscriber);
+    void detach(int model);
+    void detachAll();
+
+    void recordFrame(int model, double latencyMs);
+    int level(int model) const;
+
+    // Reads the sensors and adjusts every governed worker; called by the timer
+    void tick();
+
+signals:
+    void enabledChanged();
+    void sampled();
+    void levelChanged(int model, int level, const QString &reason);
+
+private:
+    struct Governed
+    {
+        WorkerControl control;
+        int level = DefaultLevel;
+        int ticksSinceChange = 0;
+        int calmTicks = 0;
+        QVector<double> latencies;  // Since the last tick
+    };
+
+    double readTemperature() const;
+    double readLoadRatio() const;
+    void apply(int model, Governed &governed, int level, const QString &reason);
+
+    Policy m_policy;
+    bool m_enabled = true;
+    double m_temperatureC = -1.0;
+    double m_loadRatio = 0.0;
+    QMap<int, std::shared_ptr<Governed>> m_governed;
+    QTimer m_timer;
+};
+
+#endif // RATEGOVERNOR_H
@@ -0,0 +1,503 @@
+#include "SegmentRecorder.h"
+#include "FramePool.h"
+#include <QBuffer>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QUrl>
+#include <QtEndian>
+
+#include <algorithm>
+
+namespace {
+
+// RIFF header, hdrl list and the movi list header of a single-stream AVI
+constexpr quint32 HeaderSize = 224;
+// idx1 offsets count from the 'movi' fourcc
+constexpr quint32 MoviOffset = 220;
+constexpr quint32 KeyFrameFlag = 0x10;  // AVIIF_KEYFRAME
+constexpr quint32 HasIndexFlag = 0x10;  // AVIF_HASINDEX
+
+void putFourcc(QByteArray &out, const char *code)
+{
+    out.append(code, 4);
+}
+
+void putU32(QByteArray &out, quint32 value)
+{
+    char bytes[4];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 4);
+}
+
+void putU16(QByteArray &out, quint16 value)
+{
+    char bytes[2];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 2);
+}
+
+QByteArray aviHeader(const QSize &size, quint32 frames, quint32 usPerFrame, quint32 maxChunk,
+                     quint32 moviSize, quint32 riffSize)
+{
+    const quint32 width = quint32(size.width());
+    const quint32 height = quint32(size.height());
+
+    QByteArray header;
+    header.reserve(HeaderSize);
+    putFourcc(header, "RIFF");
+    putU32(header, riffSize);
+    putFourcc(header, "AVI ");
+
+    putFourcc(header, "LIST");
+    putU32(header, 192);
+    putFourcc(header, "hdrl");
+
+    putFourcc(header, "avih");
+    putU32(header, 56);
+    putU32(header, usPerFrame);
+    putU32(header, quint32(quint64(maxChunk) * 1000000u / qMax(1u, usPerFrame)));
+    putU32(header, 0);                 // Padding granularity
+    putU32(header, HasIndexFlag);
+    putU32(header, frames);
+    putU32(header, 0);                 // Initial frames
+    putU32(header, 1);                 // Streams
+    putU32(header, maxChunk);
+    putU32(header, width);
+    putU32(header, height);
+    for (int i = 0; i < 4; ++i) {
+        putU32(header, 0);
+    }
+
+    putFourcc(header, "LIST");
+    putU32(header, 116);
+    putFourcc(header, "strl");
+
+    putFourcc(header, "strh");
+    putU32(header, 56);
+    putFourcc(header, "vids");
+    putFourcc(header, "MJPG");
+    putU32(header, 0);                 // Flags
+    putU16(header, 0);                 // Priority
+    putU16(header, 0);                 // Language
+    putU32(header, 0);                 // Initial frames
+    putU32(header, usPerFrame);        // Scale; rate / scale is the frame rate
+    putU32(header, 1000000);           // Rate
+    putU32(header, 0);                 // Start
+    putU32(header, frames);
+    putU32(header, maxChunk);
+    putU32(header, 0xFFFFFFFFu);       // Quality: driver default
+    putU32(header, 0);                 // Sample size: varies
+    putU16(header, 0);
+    putU16(header, 0);
+    putU16(header, quint16(width));
+    putU16(header, quint16(height));
+
+    putFourcc(header, "strf");
+    putU32(header, 40);
+    putU32(header, 40);                // BITMAPINFOHEADER
+    putU32(header, width);
+    putU32(header, height);
+    putU16(header, 1);                 // Planes
+    putU16(header, 24);                // Bits per pixel once decoded
+    putFourcc(header, "MJPG");
+    putU32(header, width * height * 3);
+    for (int i = 0; i < 4; ++i) {
+        putU32(header, 0);
+    }
+
+    putFourcc(header, "LIST");
+    putU32(header, moviSize);
+    putFourcc(header, "movi");
+
+    Q_ASSERT(quint32(header.size()) == HeaderSize);
+    return header;
+}
+
+} // namespace
+
+SegmentRecorder::SegmentRecorder(const QString &directory, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_directory(directory)
+    , m_workerContext(new QObject)
+    , m_queue("recording " + QFileInfo(directory).fileName(), m_workerContext, [this](PendingFrame &pending) {
+        writeFrame(pending.frame, pending.frameIndex, pending.wallMs, pending.monoMs, pending.policy);
+    })
+{
+    m_queue.setPolicy(FrameQueueBase::configuredPolicy("recording"));
+    m_clock.start();
+
+    m_thread.setObjectName("SegmentRecorder");
+    m_workerContext->moveToThread(&m_thread);
+}
+
+SegmentRecorder::~SegmentRecorder()
+{
+    seal();
+    m_thread.quit();
+    m_thread.wait();  // The segment being written is sealed before exit
+    delete m_workerContext;
+}
+
+void SegmentRecorder::start()
+{
+    if (m_thread.isRunning()) {
+        return;
+    }
+    beginResetModel();
+    loadIndex();
+    endResetModel();
+    if (!m_segments.isEmpty()) {
+        emit countChanged();
+    }
+    m_thread.start();
+}
+
+void SegmentRecorder::setPolicy(const Policy &policy)
+{
+    m_policy = policy;
+}
+
+void SegmentRecorder::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled) {
+        return;
+    }
+    m_enabled = enabled;
+    if (!m_enabled) {
+        seal();
+    }
+    emit enabledChanged();
+}
+
+qint64 SegmentRecorder::durationMs() const
+{
+    qint64 total = 0;
+    for (const Segment &segment : m_segments) {
+        total += segment.durationMs;
+    }
+    return total;
+}
+
+void SegmentRecorder::record(const QVideoFrame &frame, qint64 frameIndex)
+{
+    if (!m_enabled || !frame.isValid() || !m_thread.isRunning()) {
+        return;
+    }
+
+    const qint64 monoMs = m_clock.elapsed();
+    if (m_policy.maxFps > 0.0 && m_lastRecordedMs >= 0) {
+        const qint64 intervalMs = qint64(1000.0 / m_policy.maxFps);
+        // A quarter interval of slack keeps a display at the limit from halving the rate
+        if (monoMs + intervalMs / 4 < m_lastRecordedMs + intervalMs) {
+            return;
+        }
+    }
+    // The frame may pin a ring slot, so by default at most one waits for the encoder
+    if (m_queue.push({ frame, frameIndex, QDateTime::currentMSecsSinceEpoch(), monoMs, m_policy })) {
+        m_lastRecordedMs = monoMs;
+    }
+}
+
+void SegmentRecorder::seal()
+{
+    if (!m_thread.isRunning()) {
+        return;
+    }
+    const Policy policy = m_policy;
+    QMetaObject::invokeMethod(m_workerContext, [this, policy]() { sealSegment(policy); });
+}
+
+QVariantMap SegmentRecorder::locate(qint64 timeMs) const
+{
+    if (m_segments.isEmpty()) {
+        return {};
+    }
+    const Segment *found = &m_segments.last();
+    for (const Segment &segment : m_segments) {
+        if (timeMs < segment.startMs + segment.durationMs) {
+            found = &segment;
+            break;
+        }
+    }
+    return {
+        {"source", QUrl::fromLocalFile(pathOf(*found))},
+        {"positionMs", qBound<qint64>(0, timeMs - found->startMs, found->durationMs)},
+        {"sequence", found->sequence}
+    };
+}
+
+int SegmentRecorder::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : count();
+}
+
+QVariant SegmentRecorder::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= count()) {
+        return QVariant();
+    }
+    const Segment &segment = m_segments.at(index.row());
+    switch (role) {
+    case SourceRole:
+        return QUrl::fromLocalFile(pathOf(segment));
+    case SequenceRole:
+        return segment.sequence;
+    case StartTimeRole:
+        return QDateTime::fromMSecsSinceEpoch(segment.startMs);
+    case DurationRole:
+        return segment.durationMs;
+    case FramesRole:
+        return segment.frames;
+    case BytesRole:
+        return segment.bytes;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> SegmentRecorder::roleNames() const
+{
+    return {
+        {SourceRole, "source"},
+        {SequenceRole, "sequence"},
+        {StartTimeRole, "startTime"},
+        {DurationRole, "durationMs"},
+        {FramesRole, "frames"},
+        {BytesRole, "bytes"}
+    };
+}
+
+QString SegmentRecorder::pathOf(const Segment &segment) const
+{
+    return m_directory + "/" + segment.fileName;
+}
+
+void SegmentRecorder::loadIndex()
+{
+    QDir directory(m_directory);
+    if (!directory.mkpath(".")) {
+        qWarning() << "SegmentRecorder: cannot create" << m_directory;
+        return;
+    }
+
+    QFile file(directory.filePath("index.json"));
+    if (file.open(QIODevice::ReadOnly)) {
+        const QJsonArray entries = QJsonDocument::fromJson(file.readAll()).object().value("segments").toArray();
+        for (const QJsonValue &value : entries) {
+            const QJsonObject entry = value.toObject();
+            Segment segment;
+            segment.sequence = quint64(entry.value("sequence").toInteger());
+            segment.fileName = entry.value("file").toString();
+            segment.startMs = entry.value("startMs").toInteger();
+            segment.durationMs = entry.value("durationMs").toInteger();
+            segment.frames = entry.value("frames").toInt();
+            segment.firstFrameIndex = entry.value("firstFrame").toInteger(-1);
+            segment.lastFrameIndex = entry.value("lastFrame").toInteger(-1);
+            segment.bytes = entry.value("bytes").toInteger();
+            segment.size = QSize(entry.value("width").toInt(), entry.value("height").toInt());
+            if (!segment.fileName.isEmpty() && directory.exists(segment.fileName)) {
+                m_segments.append(segment);
+            }
+        }
+    }
+
+    // Segments left unsealed by a crash, or sealed but never indexed, do not count against the bound
+    for (const QString &name : directory.entryList({"segment-*.avi", "segment-*.avi.part"}, QDir::Files)) {
+        const bool indexed = std::any_of(m_segments.cbegin(), m_segments.cend(),
+                                         [&name](const Segment &segment) { return segment.fileName == name; });
+        if (!indexed) {
+            directory.remove(name);
+        }
+    }
+
+    m_onDisk = m_segments;
+    m_nextSequence = m_segments.isEmpty() ? 0 : m_segments.last().sequence + 1;
+    if (!m_segments.isEmpty()) {
+        qDebug() << "SegmentRecorder:" << m_segments.size() << "segments," << durationMs() / 1000 << "s recorded in" << m_directory;
+    }
+}
+
+void SegmentRecorder::writeFrame(const QVideoFrame &frame, qint64 frameIndex, qint64 wallMs, qint64 monoMs,
+                                 const Policy &policy)
+{
+    const QImage image = FramePool::instance().convert(frame, QSize(), QImage::Format_RGB32);
+    if (image.isNull()) {
+        return;
+    }
+
+    // A long pause would stretch the segment's frame rate over the gap
+    Writer &writer = m_writer;
+    if (writer.file.isOpen() && (image.size() != writer.segment.size
+                                 || monoMs - writer.startMonoMs >= policy.segmentMs
+                                 || monoMs - writer.lastMonoMs >= policy.segmentMs / 2)) {
+        sealSegment(policy);
+    }
+    if (!writer.file.isOpen() && !openSegment(image.size(), frameIndex, wallMs, monoMs)) {
+        return;
+    }
+
+    QByteArray jpeg;
+    QBuffer buffer(&jpeg);
+    buffer.open(QIODevice::WriteOnly);
+    if (!image.save(&buffer, "JPG", policy.jpegQuality)) {
+        qWarning() << "SegmentRecorder: could not encode frame" << frameIndex;
+        return;
+    }
+
+    QByteArray chunk;
+    chunk.reserve(jpeg.size() + 9);
+    putFourcc(chunk, "00dc");
+    putU32(chunk, quint32(jpeg.size()));
+    chunk.append(jpeg);
+    if (jpeg.size() % 2 != 0) {
+        chunk.append('\0');  // Chunks are word aligned
+    }
+
+    const quint32 offset = quint32(writer.file.pos()) - MoviOffset;
+    if (writer.file.write(chunk) != chunk.size()) {
+        // Most likely a full card; the segment is dropped rather than left broken
+        qWarning() << "SegmentRecorder: could not write" << writer.file.fileName() << ":" << writer.file.errorString();
+        writer.file.remove();
+        return;
+    }
+    writer.chunks.append({offset, quint32(jpeg.size())});
+    writer.maxChunk = qMax(writer.maxChunk, quint32(jpeg.size()));
+    writer.lastMonoMs = monoMs;
+    ++writer.segment.frames;
+    writer.segment.lastFrameIndex = frameIndex;
+}
+
+bool SegmentRecorder::openSegment(const QSize &size, qint64 frameIndex, qint64 wallMs, qint64 monoMs)
+{
+    Writer &writer = m_writer;
+    writer.segment = Segment();
+    writer.segment.sequence = m_nextSequence++;
+    writer.segment.fileName = QString("segment-%1.avi").arg(writer.segment.sequence, 8, 10, QChar('0'));
+    writer.segment.startMs = wallMs;
+    writer.segment.firstFrameIndex = frameIndex;
+    writer.segment.size = size;
+    writer.startMonoMs = monoMs;
+    writer.lastMonoMs = monoMs;
+    writer.maxChunk = 0;
+    writer.chunks.clear();
+
+    writer.file.setFileName(pathOf(writer.segment) + ".part");
+    if (!writer.file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "SegmentRecorder: cannot create" << writer.file.fileName() << ":" << writer.file.errorString();
+        return false;
+    }
+    // Filled in once the frame count and sizes are known
+    writer.file.write(QByteArray(HeaderSize, '\0'));
+    return true;
+}
+
+void SegmentRecorder::sealSegment(const Policy &policy)
+{
+    Writer &writer = m_writer;
+    if (!writer.file.isOpen()) {
+        return;
+    }
+    Segment segment = writer.segment;
+    if (segment.frames == 0) {
+        writer.file.remove();
+        return;
+    }
+
+    // Plus one frame interval, so consecutive segments add up to the time recorded
+    const qint64 spanMs = writer.lastMonoMs - writer.startMonoMs;
+    const qint64 intervalMs = segment.frames > 1 ? spanMs / (segment.frames - 1)
+                                                 : qint64(1000.0 / qMax(1.0, policy.maxFps));
+    segment.durationMs = qMax<qint64>(1, spanMs + intervalMs);
+    const quint32 usPerFrame = quint32(qMax<qint64>(1, segment.durationMs * 1000 / segment.frames));
+
+    QByteArray index;
+    index.reserve(8 + writer.chunks.size() * 16);
+    putFourcc(index, "idx1");
+    putU32(index, quint32(writer.chunks.size() * 16));
+    for (const auto &chunk : std::as_const(writer.chunks)) {
+        putFourcc(index, "00dc");
+        putU32(index, KeyFrameFlag);
+        putU32(index, chunk.first);
+        putU32(index, chunk.second);
+    }
+
+    const quint32 moviEnd = quint32(writer.file.pos());
+    const quint32 fileSize = moviEnd + quint32(index.size());
+    const QByteArray header = aviHeader(segment.size, quint32(segment.frames), usPerFrame, writer.maxChunk,
+                                        moviEnd - MoviOffset, fileSize - 8);
+    const bool written = writer.file.write(index) == index.size()
+            && writer.file.seek(0) && writer.file.write(header) == header.size()
+            && writer.file.flush();
+    writer.file.close();
+    segment.bytes = fileSize;
+
+    const QString path = pathOf(segment);
+    if (!written || !QFile::rename(path + ".part", path)) {
+        qWarning() << "SegmentRecorder: could not seal" << path;
+        QFile::remove(path + ".part");
+        return;
+    }
+
+    // Oldest out first; the newest segment always stays
+    m_onDisk.append(segment);
+    qint64 totalBytes = 0;
+    for (const Segment &kept : std::as_const(m_onDisk)) {
+        totalBytes += kept.bytes;
+    }
+    int removed = 0;
+    while (m_onDisk.size() > 1 && (m_onDisk.size() > policy.maxSegments || totalBytes > policy.maxBytes)) {
+        totalBytes -= m_onDisk.first().bytes;
+        QFile::remove(pathOf(m_onDisk.first()));
+        m_onDisk.removeFirst();
+        ++removed;
+    }
+    writeIndex();
+
+    QMetaObject::invokeMethod(this, [this, segment, removed]() {
+        const int stale = qMin(removed, count());
+        if (stale > 0) {
+            beginRemoveRows(QModelIndex(), 0, stale - 1);
+            m_segments.erase(m_segments.begin(), m_segments.begin() + stale);
+            endRemoveRows();
+        }
+        beginInsertRows(QModelIndex(), count(), count());
+        m_segments.append(segment);
+        endInsertRows();
+        emit countChanged();
+        emit segmentSealed(pathOf(segment), segment.startMs, segment.durationMs);
+    });
+}
+
+void SegmentRecorder::writeIndex() const
+{
+    QJsonArray entries;
+    for (const Segment &segment : m_onDisk) {
+        entries.append(QJsonObject {
+            {"sequence", qint64(segment.sequence)},
+            {"file", segment.fileName},
+            {"startMs", segment.startMs},
+            {"durationMs", segment.durationMs},
+            {"frames", segment.frames},
+            {"firstFrame", segment.firstFrameIndex},
+            {"lastFrame", segment.lastFrameIndex},
+            {"bytes", segment.bytes},
+            {"width", segment.size.width()},
+            {"height", segment.size.height()}
+        });
+    }
+
+    // Readers never see a half-written index
+    QSaveFile file(m_directory + "/index.json");
+    if (!file.open(QIODevice::WriteOnly)
+            || file.write(QJsonDocument(QJsonObject {{"segments", entries}}).toJson(QJsonDocument::Compact)) < 0
+            || !file.commit()) {
+        qWarning() << "SegmentRecorder: could not write index in" << m_directory << ":" << file.errorString();
+    }
+}
@@ -0,0 +1,149 @@
+#ifndef SEGMENTRECORDER_H
+#define SEGMENTRECORDER_H
+
+#include <QAbstractListModel>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QSize>
+#include <QThread>
+#include <QVariantMap>
+#include <QVideoFrame>
+#include "FrameQueue.h"
+
+
+// Records one camera view as a rolling ring of short MJPEG AVI segments,
+// replacing the single output.avi that could only be opened once the worker
+// had finished. A segment is written as segment-<n>.avi.part and renamed
+// when sealed, after Policy::segmentMs or a change of frame size, so every
+// listed segment is a complete file that plays and seeks on its own while
+// recording goes on. Every frame is a JPEG key frame.
+//
+// index.json in the directory lists the sealed segments, oldest first, and
+// is rewritten on every seal; the oldest segments are deleted beyond
+// Policy::maxSegments or Policy::maxBytes to bound use of the SD card.
+// Encoding and writing happen on a thread of their own. As a list model the
+// recorder is the same index, for playback from QML.
+class SegmentRecorder : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(qint64 durationMs READ durationMs NOTIFY countChanged)
+    Q_PROPERTY(QString directory READ directory CONSTANT)
+
+public:
+    struct Policy
+    {
+        int segmentMs = 4000;
+        double maxFps = 15.0;        // Frames shown faster are not all recorded
+        int jpegQuality = 75;
+        int maxSegments = 256;
+        qint64 maxBytes = 512ll * 1024 * 1024;
+    };
+
+    struct Segment
+    {
+        quint64 sequence = 0;
+        QString fileName;
+        qint64 startMs = 0;          // Wall clock of the first frame, since the epoch
+        qint64 durationMs = 0;
+        int frames = 0;
+        qint64 firstFrameIndex = -1;
+        qint64 lastFrameIndex = -1;
+        qint64 bytes = 0;
+        QSize size;
+    };
+
+    enum Roles {
+        SourceRole = Qt::UserRole + 1,
+        SequenceRole,
+        StartTimeRole,
+        DurationRole,
+        FramesRole,
+        BytesRole
+    };
+
+    explicit SegmentRecorder(const QString &directory, QObject *parent = nullptr);
+    ~SegmentRecorder();
+
+    // Reads index.json, clears what a crash left and starts the encoder
+    // thread; frames are not recorded before
+    void start();
+
+    Policy policy() const { return m_policy; }
+    void setPolicy(const Policy &policy);
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+    QString directory() const { return m_directory; }
+    int count() const { return int(m_segments.size()); }
+    qint64 durationMs() const;
+    QList<Segment> segments() const { return m_segments; }
+
+    // Called for every frame shown; a frame beyond Policy::maxFps is skipped,
+    // and by default one arriving while the previous one is still being encoded
+    void record(const QVideoFrame &frame, qint64 frameIndex);
+    // Back-pressure of the hand-off to the encoder thread
+    void setQueuePolicy(const FrameQueueBase::Policy &policy) { m_queue.setPolicy(policy); }
+    // Seals the segment being written, e.g. when the model stops
+    void seal();
+
+    // The segment holding a wall-clock time and the position in it:
+    // {source, positionMs, sequence}, empty when nothing is recorded
+    Q_INVOKABLE QVariantMap locate(qint64 timeMs) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void enabledChanged();
+    void countChanged();
+    void segmentSealed(const QString &path, qint64 startMs, qint64 durationMs);
+
+private:
+    struct PendingFrame
+    {
+        QVideoFrame frame;
+        qint64 frameIndex = 0;
+        qint64 wallMs = 0;
+        qint64 monoMs = 0;
+        Policy policy;
+    };
+
+    // Worker thread only
+    struct Writer
+    {
+        QFile file;
+        Segment segment;
+        qint64 startMonoMs = 0;
+        qint64 lastMonoMs = 0;
+        quint32 maxChunk = 0;
+        QList<QPair<quint32, quint32>> chunks;  // Offset from the movi list, size
+    };
+
+    void loadIndex();
+    void writeFrame(const QVideoFrame &frame, qint64 frameIndex, qint64 wallMs, qint64 monoMs, const Policy &policy);
+    bool openSegment(const QSize &size, qint64 frameIndex, qint64 wallMs, qint64 monoMs);
+    void sealSegment(const Policy &policy);
+    void writeIndex() const;
+    QString pathOf(const Segment &segment) const;
+
+    QString m_directory;
+    Policy m_policy;
+    bool m_enabled = true;
+
+    QList<Segment> m_segments;  // GUI thread, mirrors m_onDisk
+    QElapsedTimer m_clock;
+    qint64 m_lastRecordedMs = -1;
+
+    QThread m_thread;
+    QObject *m_workerContext;
+    FrameQueue<PendingFrame> m_queue;
+    Writer m_writer;
+    QList<Segment> m_onDisk;    // Worker thread
+    quint64 m_nextSequence = 0;
+};
+
+#endif // SEGMENTRECORDER_H
@@ -0,0 +1,115 @@
+#include "StartupTrace.h"
+#include "PerfLog.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QQuickWindow>
+#include <QTimer>
+
+#include <atomic>
+#include <memory>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Time the process has existed, from the start time in /proc/self/stat
+// (field 22, clock ticks after boot) and the uptime; 0 where unavailable
+qint64 processAgeMs()
+{
+#ifdef Q_OS_LINUX
+    QFile stat("/proc/self/stat");
+    QFile uptime("/proc/uptime");
+    if (!stat.open(QIODevice::ReadOnly) || !uptime.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    // The command name may hold spaces; the fields after it start at field 3
+    const QByteArray line = stat.readAll();
+    const QList<QByteArray> fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+    const long ticksPerSecond = sysconf(_SC_CLK_TCK);
+    if (fields.size() < 20 || ticksPerSecond <= 0) {
+        return 0;
+    }
+    const double startSeconds = fields.at(19).toDouble() / double(ticksPerSecond);
+    const double uptimeSeconds = uptime.readAll().split(' ').value(0).toDouble();
+    return qMax<qint64>(0, qint64((uptimeSeconds - startSeconds) * 1000.0));
+#else
+    return 0;
+#endif
+}
+
+} // namespace
+
+StartupTrace::StartupTrace(QObject *parent)
+    : QObject(parent)
+{
+    m_clock.start();
+    m_offsetMs = processAgeMs();
+
+    bool ok = false;
+    const qint64 budget = qEnvironmentVariableIntValue("NEURODRIVE_STARTUP_BUDGET_MS", &ok);
+    if (ok && budget > 0) {
+        m_budgetMs = budget;
+    }
+    m_check = qEnvironmentVariable("NEURODRIVE_STARTUP_CHECK") == "1";
+}
+
+void StartupTrace::mark(const QString &milestone)
+{
+    record(milestone, elapsed());
+}
+
+void StartupTrace::watch(QQuickWindow *window)
+{
+    if (!window || m_watching) {
+        return;
+    }
+    m_watching = true;
+
+    // frameSwapped comes from the render thread; the time is taken there
+    auto swapped = std::make_shared<std::atomic_bool>(false);
+    auto connection = std::make_shared<QMetaObject::Connection>();
+    *connection = connect(window, &QQuickWindow::frameSwapped, this, [this, swapped, connection]() {
+        if (swapped->exchange(true)) {
+            return;
+        }
+        const qint64 ms = elapsed();
+        QMetaObject::invokeMethod(this, [this, ms, connection]() {
+            QObject::disconnect(*connection);
+            record("first_frame", ms);
+            emit firstFrame();
+            // Whatever was queued while the first frame was made runs before
+            // input can be handled
+            QTimer::singleShot(0, this, &StartupTrace::finish);
+        });
+    }, Qt::DirectConnection);
+}
+
+void StartupTrace::record(const QString &milestone, qint64 ms)
+{
+    m_milestones.append(QString("%1 %2 ms").arg(milestone).arg(ms));
+    PerfLog::record("startup." + milestone, double(ms), "ms");
+}
+
+void StartupTrace::finish()
+{
+    const qint64 ms = elapsed();
+    const bool overBudget = ms > m_budgetMs;
+    m_milestones.append(QString("interactive %1 ms").arg(ms));
+    PerfLog::record("startup.interactive", double(ms), "ms", {{"budget", m_budgetMs}, {"over_budget", overBudget}});
+
+    if (overBudget) {
+        qWarning() << "StartupTrace: over the budget of" << m_budgetMs << "ms:" << m_milestones.join(", ");
+    } else {
+        qDebug() << "StartupTrace:" << m_milestones.join(", ");
+    }
+
+    m_interactive = true;
+    emit interactive();
+
+    if (m_check) {
+        QCoreApplication::exit(overBudget ? 1 : 0);
+    }
+}
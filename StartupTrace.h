@@ -0,0 +1,57 @@
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QStringList>
+
+class QQuickWindow;
+
+// Times the cold start from the creation of the process, taken from
+// /proc/self/stat so loading the libraries counts too, to the first frame
+// on screen and to the login page being interactive: the first time the
+// event loop is free again after that frame. Each milestone is written to
+// the PerfLog as startup.<name>.
+//
+// Interactive later than NEURODRIVE_STARTUP_BUDGET_MS (DefaultBudgetMs if
+// unset) is logged as a warning. With NEURODRIVE_STARTUP_CHECK=1 the
+// application quits once interactive, with exit code 1 over budget and 0
+// otherwise, so a regression check can run it headless.
+class StartupTrace : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool interactive READ isInteractive NOTIFY interactive)
+    Q_PROPERTY(qint64 budgetMs READ budgetMs CONSTANT)
+
+public:
+    static constexpr qint64 DefaultBudgetMs = 2000;
+
+    explicit StartupTrace(QObject *parent = nullptr);
+
+    // Since the process was created
+    qint64 elapsed() const { return m_offsetMs + m_clock.elapsed(); }
+    qint64 budgetMs() const { return m_budgetMs; }
+    bool isInteractive() const { return m_interactive; }
+
+    void mark(const QString &milestone);
+    // Takes the first frame and the interactive milestone from the window
+    void watch(QQuickWindow *window);
+
+signals:
+    void firstFrame();
+    void interactive();
+
+private:
+    void record(const QString &milestone, qint64 ms);
+    void finish();
+
+    QElapsedTimer m_clock;
+    qint64 m_offsetMs = 0;       // From the creation of the process to m_clock
+    qint64 m_budgetMs = DefaultBudgetMs;
+    bool m_check = false;
+    bool m_watching = false;
+    bool m_interactive = false;
+    QStringList m_milestones;    // "<name> <ms> ms", for the summary
+};
+
+#endif // STARTUPTRACE_H
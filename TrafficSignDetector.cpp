@@ -0,0 +1,369 @@
+#include "TrafficSignDetector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#ifdef NEURODRIVE_HAVE_ONNXRUNTIME
+#include <onnxruntime_cxx_api.h>
+
+struct TrafficSignDetector::Session
+{
+    Ort::Session session { nullptr };
+    Ort::MemoryInfo memory = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    std::string inputName;
+    std::string outputName;
+    std::vector<std::int64_t> inputShape;
+};
+
+namespace {
+
+// One environment per process, shared by every session
+Ort::Env &environment()
+{
+    static Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "neurodrive");
+    return env;
+}
+
+} // namespace
+#else
+struct TrafficSignDetector::Session
+{
+};
+#endif
+
+namespace {
+
+float intersectionOverUnion(const TrafficSignDetector::Box &a, const TrafficSignDetector::Box &b)
+{
+    const float width = std::min(a.x2, b.x2) - std::max(a.x1, b.x1);
+    const float height = std::min(a.y2, b.y2) - std::max(a.y1, b.y1);
+    if (width <= 0.0f || height <= 0.0f) {
+        return 0.0f;
+    }
+    const float intersection = width * height;
+    const float areas = (a.x2 - a.x1) * (a.y2 - a.y1) + (b.x2 - b.x1) * (b.y2 - b.y1);
+    return intersection / (areas - intersection);
+}
+
+} // namespace
+
+TrafficSignDetector::TrafficSignDetector() = default;
+
+TrafficSignDetector::~TrafficSignDetector() = default;
+
+bool TrafficSignDetector::isAvailable()
+{
+#ifdef NEURODRIVE_HAVE_ONNXRUNTIME
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool TrafficSignDetector::load(const std::string &path, const Options &options)
+{
+    m_session.reset();
+    m_error.clear();
+    m_usesXnnpack = false;
+    m_options = options;
+    m_letterbox = Letterbox();
+
+#ifdef NEURODRIVE_HAVE_ONNXRUNTIME
+    try {
+        Ort::SessionOptions sessionOptions;
+        sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+        sessionOptions.SetInterOpNumThreads(1);
+        // Spinning threads would take the cores the decoder and the UI need
+        sessionOptions.AddConfigEntry("session.intra_op.allow_spinning", "0");
+
+        const int threads = std::max(1, options.threads);
+        bool xnnpack = false;
+        if (options.xnnpack) {
+            try {
+                // XNNPACK runs its own pool; ORT's would only compete with it
+                sessionOptions.AppendExecutionProvider("XNNPACK", { { "intra_op_num_threads", std::to_string(threads) } });
+                sessionOptions.SetIntraOpNumThreads(1);
+                xnnpack = true;
+            } catch (const Ort::Exception &) {
+                // Not built into this ONNX Runtime
+            }
+        }
+        if (!xnnpack) {
+            sessionOptions.SetIntraOpNumThreads(threads);
+        }
+
+        auto session = std::make_unique<Session>();
+        session->session = Ort::Session(environment(), path.c_str(), sessionOptions);
+        if (session->session.GetInputCount() != 1 || session->session.GetOutputCount() < 1) {
+            m_error = "expected one image input and a detection output";
+            return false;
+        }
+
+        Ort::AllocatorWithDefaultOptions allocator;
+        session->inputName = session->session.GetInputNameAllocated(0, allocator).get();
+        session->outputName = session->session.GetOutputNameAllocated(0, allocator).get();
+
+        // [1, 3, height, width]; a dynamic export takes the default size
+        const std::vector<std::int64_t> shape = session->session.GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+        if (shape.size() != 4 || (shape[1] > 0 && shape[1] != 3)) {
+            m_error = "expected a [1, 3, height, width] input";
+            return false;
+        }
+        m_inputHeight = shape[2] > 0 ? int(shape[2]) : DefaultInputSize;
+        m_inputWidth = shape[3] > 0 ? int(shape[3]) : DefaultInputSize;
+        session->inputShape = { 1, 3, m_inputHeight, m_inputWidth };
+
+        Ort::ModelMetadata metadata = session->session.GetModelMetadata();
+        Ort::AllocatedStringPtr names = metadata.LookupCustomMetadataMapAllocated("names", allocator);
+        m_classNames = names ? parseClassNames(names.get()) : std::vector<std::string>();
+
+        m_input.assign(std::size_t(3) * m_inputWidth * m_inputHeight, PadValue / 255.0f);
+        m_session = std::move(session);
+        m_usesXnnpack = xnnpack;
+        return true;
+    } catch (const Ort::Exception &exception) {
+        m_error = exception.what();
+        return false;
+    }
+#else
+    (void)path;
+    m_error = "built without ONNX Runtime";
+    return false;
+#endif
+}
+
+std::string TrafficSignDetector::className(int classId) const
+{
+    return classId >= 0 && classId < int(m_classNames.size()) ? m_classNames[classId] : std::string();
+}
+
+const std::vector<TrafficSignDetector::Box> &TrafficSignDetector::detect(const std::uint32_t *pixels, int width,
+                                                                         int height, int bytesPerLine)
+{
+    m_boxes.clear();
+    if (!m_session || !pixels || width <= 0 || height <= 0) {
+        return m_boxes;
+    }
+
+#ifdef NEURODRIVE_HAVE_ONNXRUNTIME
+    letterbox(pixels, width, height, bytesPerLine);
+    try {
+        Ort::Value input = Ort::Value::CreateTensor<float>(m_session->memory, m_input.data(), m_input.size(),
+                                                           m_session->inputShape.data(), m_session->inputShape.size());
+        const char *inputNames[] = { m_session->inputName.c_str() };
+        const char *outputNames[] = { m_session->outputName.c_str() };
+        std::vector<Ort::Value> outputs = m_session->session.Run(Ort::RunOptions { nullptr },
+                                                                 inputNames, &input, 1, outputNames, 1);
+
+        const std::vector<std::int64_t> shape = outputs[0].GetTensorTypeAndShapeInfo().GetShape();
+        if (shape.size() != 3 || shape[1] <= 0 || shape[2] <= 0) {
+            m_error = "unexpected output shape";
+            return m_boxes;
+        }
+        // There are always far more anchors than attributes
+        const bool attributeMajor = shape[1] < shape[2];
+        const int attributes = int(attributeMajor ? shape[1] : shape[2]);
+        const int anchors = int(attributeMajor ? shape[2] : shape[1]);
+        decode(outputs[0].GetTensorData<float>(), attributes, anchors, attributeMajor);
+        nonMaximumSuppression(m_candidates, m_options.iou, m_options.maxDetections, m_boxes);
+    } catch (const Ort::Exception &exception) {
+        m_error = exception.what();
+        m_boxes.clear();
+    }
+#else
+    (void)bytesPerLine;
+#endif
+    return m_boxes;
+}
+
+void TrafficSignDetector::letterbox(const std::uint32_t *pixels, int width, int height, int bytesPerLine)
+{
+    const int planeSize = m_inputWidth * m_inputHeight;
+
+    if (width != m_letterbox.frameWidth || height != m_letterbox.frameHeight) {
+        m_letterbox = fitLetterbox(width, height, m_inputWidth, m_inputHeight);
+        const int resizedWidth = m_letterbox.resizedWidth;
+
+        // The padding stays the same until the frame size changes
+        std::fill(m_input.begin(), m_input.end(), PadValue / 255.0f);
+
+        // Bilinear taps with half-pixel centres, as cv2.INTER_LINEAR
+        m_columnOffsets.resize(std::size_t(resizedWidth) * 2);
+        m_columnWeights.resize(std::size_t(resizedWidth));
+        const float stepX = float(width) / float(resizedWidth);
+        for (int x = 0; x < resizedWidth; ++x) {
+            const float source = std::max(0.0f, (x + 0.5f) * stepX - 0.5f);
+            const int left = std::min(int(source), width - 1);
+            m_columnOffsets[std::size_t(x) * 2] = left;
+            m_columnOffsets[std::size_t(x) * 2 + 1] = std::min(left + 1, width - 1);
+            m_columnWeights[x] = source - float(left);
+        }
+    }
+
+    const int resizedWidth = m_letterbox.resizedWidth;
+    const int resizedHeight = m_letterbox.resizedHeight;
+    const float stepY = float(height) / float(resizedHeight);
+    const std::uint8_t *bytes = reinterpret_cast<const std::uint8_t *>(pixels);
+    float *red = m_input.data();
+    float *green = red + planeSize;
+    float *blue = green + planeSize;
+
+    for (int y = 0; y < resizedHeight; ++y) {
+        const float source = std::max(0.0f, (y + 0.5f) * stepY - 0.5f);
+        const int top = std::min(int(source), height - 1);
+        const int bottom = std::min(top + 1, height - 1);
+        const float fy = source - float(top);
+        const std::uint32_t *topRow = reinterpret_cast<const std::uint32_t *>(bytes + std::size_t(top) * bytesPerLine);
+        const std::uint32_t *bottomRow = reinterpret_cast<const std::uint32_t *>(bytes + std::size_t(bottom) * bytesPerLine);
+        const int offset = (m_letterbox.padY + y) * m_inputWidth + m_letterbox.padX;
+
+        for (int x = 0; x < resizedWidth; ++x) {
+            const int left = m_columnOffsets[std::size_t(x) * 2];
+            const int right = m_columnOffsets[std::size_t(x) * 2 + 1];
+            const float fx = m_columnWeights[x];
+            const std::uint32_t p00 = topRow[left];
+            const std::uint32_t p01 = topRow[right];
+            const std::uint32_t p10 = bottomRow[left];
+            const std::uint32_t p11 = bottomRow[right];
+
+            auto sample = [fx, fy](std::uint32_t a, std::uint32_t b, std::uint32_t c, std::uint32_t d, int shift) {
+                const float upper = float((a >> shift) & 0xff) + (float((b >> shift) & 0xff) - float((a >> shift) & 0xff)) * fx;
+                const float lower = float((c >> shift) & 0xff) + (float((d >> shift) & 0xff) - float((c >> shift) & 0xff)) * fx;
+                return (upper + (lower - upper) * fy) * (1.0f / 255.0f);
+            };
+            red[offset + x] = sample(p00, p01, p10, p11, 16);
+            green[offset + x] = sample(p00, p01, p10, p11, 8);
+            blue[offset + x] = sample(p00, p01, p10, p11, 0);
+        }
+    }
+}
+
+void TrafficSignDetector::decode(const float *output, int attributes, int anchors, bool attributeMajor)
+{
+    m_candidates.clear();
+
+    const bool objectness = !m_classNames.empty() && attributes - 5 == int(m_classNames.size());
+    const int firstClass = objectness ? 5 : 4;
+    const int classes = attributes - firstClass;
+    if (classes <= 0) {
+        return;
+    }
+
+    auto value = [output, attributes, anchors, attributeMajor](int anchor, int attribute) {
+        return attributeMajor ? output[std::size_t(attribute) * anchors + anchor]
+                              : output[std::size_t(anchor) * attributes + attribute];
+    };
+
+    for (int anchor = 0; anchor < anchors; ++anchor) {
+        int classId = 0;
+        float score = value(anchor, firstClass);
+        for (int c = 1; c < classes; ++c) {
+            const float classScore = value(anchor, firstClass + c);
+            if (classScore > score) {
+                score = classScore;
+                classId = c;
+            }
+        }
+        if (objectness) {
+            score *= value(anchor, 4);
+        }
+        if (score < m_options.confidence) {
+            continue;
+        }
+
+        // Centre and size in the letterboxed input, back onto the frame
+        const float cx = value(anchor, 0);
+        const float cy = value(anchor, 1);
+        const float halfWidth = value(anchor, 2) * 0.5f;
+        const float halfHeight = value(anchor, 3) * 0.5f;
+        Box box;
+        box.classId = classId;
+        box.confidence = score;
+        box.x1 = cx - halfWidth;
+        box.y1 = cy - halfHeight;
+        box.x2 = cx + halfWidth;
+        box.y2 = cy + halfHeight;
+        m_candidates.push_back(m_letterbox.toFrame(box));
+    }
+}
+
+TrafficSignDetector::Letterbox TrafficSignDetector::fitLetterbox(int width, int height, int inputWidth, int inputHeight)
+{
+    Letterbox letterbox;
+    if (width <= 0 || height <= 0) {
+        return letterbox;
+    }
+    letterbox.frameWidth = width;
+    letterbox.frameHeight = height;
+    letterbox.scale = std::min(float(inputWidth) / float(width), float(inputHeight) / float(height));
+    letterbox.resizedWidth = std::max(1, int(std::lround(width * letterbox.scale)));
+    letterbox.resizedHeight = std::max(1, int(std::lround(height * letterbox.scale)));
+    letterbox.padX = int(std::lround((inputWidth - letterbox.resizedWidth) / 2.0 - 0.1));
+    letterbox.padY = int(std::lround((inputHeight - letterbox.resizedHeight) / 2.0 - 0.1));
+    return letterbox;
+}
+
+TrafficSignDetector::Box TrafficSignDetector::Letterbox::toFrame(const Box &input) const
+{
+    Box box = input;
+    box.x1 = std::clamp((input.x1 - padX) / scale, 0.0f, float(frameWidth));
+    box.y1 = std::clamp((input.y1 - padY) / scale, 0.0f, float(frameHeight));
+    box.x2 = std::clamp((input.x2 - padX) / scale, 0.0f, float(frameWidth));
+    box.y2 = std::clamp((input.y2 - padY) / scale, 0.0f, float(frameHeight));
+    return box;
+}
+
+void TrafficSignDetector::nonMaximumSuppression(std::vector<Box> &candidates, float iou, int maxDetections,
+                                                std::vector<Box> &kept)
+{
+    std::sort(candidates.begin(), candidates.end(), [](const Box &a, const Box &b) {
+        return a.confidence > b.confidence;
+    });
+    for (const Box &candidate : candidates) {
+        if (int(kept.size()) >= maxDetections) {
+            break;
+        }
+        bool suppressed = false;
+        for (const Box &other : kept) {
+            if (other.classId == candidate.classId && intersectionOverUnion(other, candidate) > iou) {
+                suppressed = true;
+                break;
+            }
+        }
+        if (!suppressed) {
+            kept.push_back(candidate);
+        }
+    }
+}
+
+std::vector<std::string> TrafficSignDetector::parseClassNames(const std::string &metadata)
+{
+    std::vector<std::string> names;
+    std::size_t position = 0;
+    while (position < metadata.size()) {
+        const std::size_t keyStart = metadata.find_first_of("0123456789", position);
+        if (keyStart == std::string::npos) {
+            break;
+        }
+        const std::size_t keyEnd = metadata.find_first_not_of("0123456789", keyStart);
+        const std::size_t quote = metadata.find_first_of("'\"", keyEnd);
+        if (keyEnd == std::string::npos || quote == std::string::npos) {
+            break;
+        }
+        // A name holding one kind of quote is written between the other
+        const std::size_t closing = metadata.find(metadata[quote], quote + 1);
+        if (closing == std::string::npos) {
+            break;
+        }
+        const int classId = std::atoi(metadata.c_str() + keyStart);
+        if (classId >= 0 && classId < 10000) {
+            if (int(names.size()) <= classId) {
+                names.resize(std::size_t(classId) + 1);
+            }
+            names[classId] = metadata.substr(quote + 1, closing - quote - 1);
+        }
+        position = closing + 1;
+    }
+    return names;
+}
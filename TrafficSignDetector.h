@@ -0,0 +1,118 @@
+#ifndef TRAFFICSIGNDETECTOR_H
+#define TRAFFICSIGNDETECTOR_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Runs traffic.py's YOLO model in-process through ONNX Runtime on the CPU,
+// from the ONNX export of model_v2.pt. Preprocessing and postprocessing follow
+// ultralytics: a letterbox to the model's input size padded with grey 114,
+// RGB scaled to [0, 1], confidence filter, class-aware NMS and boxes mapped
+// back onto the input frame. Class names come from the model's "names"
+// metadata, which the export writes.
+//
+// Like LaneDetector it is plain C++ with no Qt types; TrafficSignEngine runs
+// it on a thread. Without NEURODRIVE_HAVE_ONNXRUNTIME at build time load()
+// always fails and the Python worker is used.
+class TrafficSignDetector
+{
+public:
+    struct Options
+    {
+        int threads = 2;             // Intra-op threads, or XNNPACK's pool when it is used
+        bool xnnpack = true;         // Falls back to the default CPU provider if unavailable
+        float confidence = 0.85f;    // traffic.py's conf and iou
+        float iou = 0.85f;
+        int maxDetections = 100;
+    };
+
+    struct Box
+    {
+        int classId = -1;
+        float confidence = 0.0f;
+        float x1 = 0.0f;
+        float y1 = 0.0f;
+        float x2 = 0.0f;
+        float y2 = 0.0f;
+    };
+
+    // Where a frame lands in the model's input: scaled to fit, centred
+    struct Letterbox
+    {
+        int frameWidth = 0;
+        int frameHeight = 0;
+        float scale = 1.0f;
+        int resizedWidth = 0;
+        int resizedHeight = 0;
+        int padX = 0;
+        int padY = 0;
+
+        // A box in input pixels back onto the frame, clamped to it
+        Box toFrame(const Box &input) const;
+    };
+
+    static constexpr int DefaultInputSize = 640;
+    static constexpr std::uint8_t PadValue = 114;
+
+    TrafficSignDetector();
+    ~TrafficSignDetector();
+
+    // Whether the build has ONNX Runtime at all
+    static bool isAvailable();
+
+    bool load(const std::string &path, const Options &options);
+    bool isLoaded() const { return m_session != nullptr; }
+    const std::string &errorString() const { return m_error; }
+    // Whether the XNNPACK provider was actually registered
+    bool usesXnnpack() const { return m_usesXnnpack; }
+
+    int inputWidth() const { return m_inputWidth; }
+    int inputHeight() const { return m_inputHeight; }
+    const std::vector<std::string> &classNames() const { return m_classNames; }
+    // Empty for an id the model has no name for
+    std::string className(int classId) const;
+
+    // pixels are width x height 0xAARRGGBB words (QImage::Format_RGB32);
+    // boxes are in the same pixel coordinates, best first
+    const std::vector<Box> &detect(const std::uint32_t *pixels, int width, int height, int bytesPerLine);
+
+    // "{0: 'stop', 1: 'yield'}", as ultralytics writes the names metadata
+    static std::vector<std::string> parseClassNames(const std::string &metadata);
+
+    // The geometry of ultralytics' LetterBox for a width x height frame
+    static Letterbox fitLetterbox(int width, int height, int inputWidth, int inputHeight);
+    // Greedy and per class, as ultralytics' non_max_suppression(agnostic=False):
+    // candidates are sorted best first and the ones kept appended to kept
+    static void nonMaximumSuppression(std::vector<Box> &candidates, float iou, int maxDetections,
+                                      std::vector<Box> &kept);
+
+private:
+    struct Session;
+
+    void letterbox(const std::uint32_t *pixels, int width, int height, int bytesPerLine);
+    // YOLOv8 exports are attribute-major [1, 4 + classes, anchors], YOLOv5
+    // ones anchor-major [1, anchors, 5 + classes] with an objectness score
+    void decode(const float *output, int attributes, int anchors, bool attributeMajor);
+
+    std::unique_ptr<Session> m_session;
+    Options m_options;
+    std::string m_error;
+    bool m_usesXnnpack = false;
+    int m_inputWidth = DefaultInputSize;
+    int m_inputHeight = DefaultInputSize;
+    std::vector<std::string> m_classNames;
+
+    // The current frame's letterbox
+    Letterbox m_letterbox;
+
+    // Working buffers, allocated once per detector
+    std::vector<float> m_input;         // CHW, RGB
+    std::vector<int> m_columnOffsets;   // Bilinear taps of each resized column
+    std::vector<float> m_columnWeights;
+    std::vector<Box> m_candidates;
+    std::vector<Box> m_boxes;
+};
+
+#endif // TRAFFICSIGNDETECTOR_H
@@ -0,0 +1,238 @@
+#include "TrafficSignEngine.h"
+#include "FramePool.h"
+#include "FrameSource.h"
+#include <QDebug>
+#include <QFile>
+#include <QImage>
+
+namespace {
+
+bool sameOptions(const TrafficSignDetector::Options &a, const TrafficSignDetector::Options &b)
+{
+    return a.threads == b.threads && a.xnnpack == b.xnnpack && a.confidence == b.confidence
+        && a.iou == b.iou && a.maxDetections == b.maxDetections;
+}
+
+} // namespace
+
+TrafficSignEngine::TrafficSignEngine(QObject *parent)
+    : QObject(parent)
+    , m_workerContext(new QObject)
+    , m_queue("traffic", m_workerContext, [this](PendingFrame &pending) { processFrame(pending); })
+{
+    m_queue.setPolicy(FrameQueueBase::configuredPolicy("traffic"));
+    m_thread.setObjectName("TrafficSigns");
+    m_workerContext->moveToThread(&m_thread);
+    m_thread.start();
+}
+
+TrafficSignEngine::~TrafficSignEngine()
+{
+    ++m_generation;
+    m_thread.quit();
+    m_thread.wait();  // At most the frame or the load in flight
+    delete m_workerContext;
+}
+
+double TrafficSignEngine::averageLatencyMs() const
+{
+    return m_framesProcessed > 0 ? m_totalLatencyMs / double(m_framesProcessed) : 0.0;
+}
+
+void TrafficSignEngine::load(const QString &path, const TrafficSignDetector::Options &options)
+{
+    if (isUsable() && path == m_modelPath && sameOptions(options, m_options)) {
+        return;
+    }
+    m_modelPath = path;
+    m_options = options;
+    m_status = Loading;
+    const quint64 loadGeneration = ++m_loadGeneration;
+
+    // Loads are queued on the worker thread, so frames never see a half loaded session
+    const std::string fileName = QFile::encodeName(path).toStdString();
+    QMetaObject::invokeMethod(m_workerContext, [this, fileName, options, loadGeneration]() {
+        QElapsedTimer timer;
+        timer.start();
+        const bool ok = m_detector.load(fileName, options);
+        const double milliseconds = double(timer.nsecsElapsed()) / 1e6;
+        const QString error = QString::fromStdString(m_detector.errorString());
+        QStringList classNames;
+        for (const std::string &name : m_detector.classNames()) {
+            classNames.append(QString::fromStdString(name));
+        }
+        if (ok) {
+            qDebug() << "TrafficSignEngine: loaded" << fileName.c_str() << "in" << milliseconds << "ms,"
+                     << m_detector.inputWidth() << "x" << m_detector.inputHeight() << "input,"
+                     << classNames.size() << "classes," << (m_detector.usesXnnpack() ? "XNNPACK" : "CPU provider");
+        }
+        QMetaObject::invokeMethod(this, [this, loadGeneration, ok, error, milliseconds, classNames]() {
+            handleLoaded(loadGeneration, ok, error, milliseconds, classNames);
+        });
+    });
+}
+
+void TrafficSignEngine::handleLoaded(quint64 loadGeneration, bool ok, const QString &error, double milliseconds,
+                                     const QStringList &classNames)
+{
+    // A later load is still queued behind this one
+    if (loadGeneration != m_loadGeneration) {
+        return;
+    }
+    m_status = ok ? Ready : Failed;
+    m_classNames = classNames;
+    if (!ok) {
+        qWarning() << "TrafficSignEngine: could not load" << m_modelPath << "-" << error;
+    }
+    emit loaded(ok, error, milliseconds);
+
+    if (!ok && m_running) {
+        stop();
+        emit errorOccurred("Could not load " + m_modelPath + ": " + error);
+    }
+}
+
+void TrafficSignEngine::start(FrameSource *source)
+{
+    stop();
+
+    ++m_generation;
+    m_running = true;
+    m_startReported = false;
+    m_framesReceived = 0;
+    m_framesProcessed = 0;
+    m_framesDropped = 0;
+    m_expectedFrames = 0;
+    m_fps = 0.0;
+    m_totalLatencyMs = 0.0;
+    m_lastFrameTimer.invalidate();
+    m_lastDispatchTimer.invalidate();
+
+    m_source = source;
+    connect(source, &FrameSource::started, this, [this](qint64 expectedFrames, double fps) {
+        m_expectedFrames = expectedFrames;
+        if (!m_startReported) {
+            m_startReported = true;
+            emit started(expectedFrames, fps);
+        }
+    });
+    connect(source, &FrameSource::frameDecoded, this, &TrafficSignEngine::handleVideoFrame);
+    connect(source, &FrameSource::finished, this, &TrafficSignEngine::finishWhenIdle);
+    connect(source, &FrameSource::errorOccurred, this, [this](const QString &message) {
+        if (m_running) {
+            stop();
+            emit errorOccurred(message);
+        }
+    });
+}
+
+void TrafficSignEngine::stop()
+{
+    if (!m_running) {
+        return;
+    }
+    // Results still in flight belong to the old generation and are dropped
+    ++m_generation;
+    m_running = false;
+    m_queue.clear();
+    // The source is shared with the other models, so it is left running
+    if (m_source) {
+        m_source->disconnect(this);
+    }
+    m_source = nullptr;
+}
+
+void TrafficSignEngine::handleVideoFrame(const QVideoFrame &frame, qint64 frameIndex)
+{
+    if (!m_running || !frame.isValid()) {
+        return;
+    }
+
+    ++m_framesReceived;
+    emit frameDecoded(frame, frameIndex);
+
+    // Frames ahead of traffic.py's rate are not meant to be processed at all
+    if (m_lastDispatchTimer.isValid() && m_lastDispatchTimer.nsecsElapsed() < qint64(1e9 / MaxFps)) {
+        return;
+    }
+    if (m_status != Ready || !m_queue.push({ frame, frameIndex, m_generation })) {
+        ++m_framesDropped;
+        return;
+    }
+    m_lastDispatchTimer.start();
+}
+
+void TrafficSignEngine::processFrame(const PendingFrame &pending)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // The detector letterboxes the frame itself, so it is only converted
+    const QImage image = FramePool::instance().convert(pending.frame, QSize(), QImage::Format_RGB32);
+    if (image.isNull()) {
+        return;  // Over the pool's budget; the frame is dropped
+    }
+    const std::vector<TrafficSignDetector::Box> &boxes = m_detector.detect(
+                reinterpret_cast<const std::uint32_t *>(image.constBits()),
+                image.width(), image.height(), int(image.bytesPerLine()));
+
+    QList<Detection> detections;
+    QStringList labels;
+    detections.reserve(qsizetype(boxes.size()));
+    labels.reserve(qsizetype(boxes.size()));
+    for (const TrafficSignDetector::Box &box : boxes) {
+        Detection detection;
+        detection.classId = box.classId;
+        detection.confidence = box.confidence;
+        detection.box = QRectF(QPointF(box.x1, box.y1), QPointF(box.x2, box.y2));
+        detections.append(detection);
+        labels.append(QString::fromStdString(m_detector.className(box.classId)));
+    }
+    const double latencyMs = double(timer.nsecsElapsed()) / 1e6;
+
+    const quint64 generation = pending.generation;
+    const qint64 frameIndex = pending.frameIndex;
+    QMetaObject::invokeMethod(this, [this, generation, frameIndex, latencyMs, detections, labels]() {
+        handleResult(generation, frameIndex, latencyMs, detections, labels);
+    });
+}
+
+void TrafficSignEngine::handleResult(quint64 generation, qint64 frameIndex, double latencyMs,
+                                     const QList<Detection> &detections, const QStringList &labels)
+{
+    if (generation != m_generation) {
+        return;
+    }
+
+    // Same EWMA as WorkerEvents.frame() in worker_ipc.py
+    if (m_lastFrameTimer.isValid()) {
+        const qint64 elapsed = m_lastFrameTimer.nsecsElapsed();
+        if (elapsed > 0) {
+            const double instant = 1e9 / double(elapsed);
+            m_fps = m_fps == 0.0 ? instant : 0.9 * m_fps + 0.1 * instant;
+        }
+    }
+    m_lastFrameTimer.start();
+
+    ++m_framesProcessed;
+    m_totalLatencyMs += latencyMs;
+    emit detectionsReady(frameIndex, detections, labels);
+    emit frameProcessed(frameIndex, m_fps, latencyMs);
+}
+
+void TrafficSignEngine::finishWhenIdle()
+{
+    // Queue behind the frame in flight, if any, so its result arrives first
+    const quint64 generation = m_generation;
+    QMetaObject::invokeMethod(m_workerContext, [this, generation]() {
+        QMetaObject::invokeMethod(this, [this, generation]() {
+            if (generation != m_generation || !m_running) {
+                return;
+            }
+            m_running = false;
+            qDebug() << "TrafficSignEngine:" << m_framesProcessed << "frames," << averageLatencyMs()
+                     << "ms/frame," << m_framesDropped << "dropped";
+            emit finished(m_framesProcessed);
+        });
+    });
+}
@@ -0,0 +1,117 @@
+#ifndef TRAFFICSIGNENGINE_H
+#define TRAFFICSIGNENGINE_H
+
+#include <QObject>
+#include <QPointer>
+#include <QStringList>
+#include <QThread>
+#include <QVideoFrame>
+#include <QElapsedTimer>
+#include "FrameQueue.h"
+#include "TrafficSignDetector.h"
+#include "WorkerChannel.h"
+
+class FrameSource;
+
+// Runs TrafficSignDetector in-process in place of traffic.py, the way
+// LaneDetectionEngine replaces lane.py. The model is loaded once on the
+// worker thread, ahead of the first run. Frames come from a shared
+// FrameSource and every frame is shown as is; one is handed to the worker
+// thread for detection through the "traffic" FrameQueue unless the detector
+// is ahead of MaxFps, traffic.py's limit.
+class TrafficSignEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Status {
+        Unloaded,
+        Loading,
+        Ready,
+        Failed
+    };
+
+    static constexpr double MaxFps = 15.0;
+
+    explicit TrafficSignEngine(QObject *parent = nullptr);
+    ~TrafficSignEngine();
+
+    Status status() const { return m_status; }
+    // Loaded or still loading; a run started while loading waits for it
+    bool isUsable() const { return m_status == Loading || m_status == Ready; }
+    QString modelPath() const { return m_modelPath; }
+    QStringList classNames() const { return m_classNames; }
+
+    bool isRunning() const { return m_running; }
+    qint64 framesDecoded() const { return m_framesReceived; }
+    qint64 framesProcessed() const { return m_framesProcessed; }
+    qint64 expectedFrames() const { return m_expectedFrames; }
+    qint64 framesDropped() const { return m_framesDropped; }
+    double fps() const { return m_fps; }
+    double averageLatencyMs() const;
+    // Back-pressure of the hand-off to the worker thread
+    void setQueuePolicy(const FrameQueueBase::Policy &policy) { m_queue.setPolicy(policy); }
+
+public slots:
+    // Loads the model in the background; loaded() reports the outcome. A
+    // model already loaded from the same path with the same options is kept.
+    void load(const QString &path, const TrafficSignDetector::Options &options);
+    // The caller starts the source once every consumer is attached
+    void start(FrameSource *source);
+    void stop();
+
+signals:
+    void loaded(bool ok, const QString &error, double milliseconds);
+    void started(qint64 expectedFrames, double fps);
+    // Every decoded frame, whether or not it is processed
+    void frameDecoded(const QVideoFrame &frame, qint64 frameIndex);
+    void frameProcessed(qint64 frameIndex, double fps, double latencyMs);
+    // Boxes in the decoded frame's pixel coordinates, with their class names
+    void detectionsReady(qint64 frameIndex, const QList<Detection> &detections, const QStringList &labels);
+    void finished(qint64 framesProcessed);
+    void errorOccurred(const QString &message);
+
+private:
+    struct PendingFrame
+    {
+        QVideoFrame frame;
+        qint64 frameIndex = 0;
+        quint64 generation = 0;
+    };
+
+    void handleLoaded(quint64 loadGeneration, bool ok, const QString &error, double milliseconds,
+                      const QStringList &classNames);
+    void handleVideoFrame(const QVideoFrame &frame, qint64 frameIndex);
+    void processFrame(const PendingFrame &pending);
+    void handleResult(quint64 generation, qint64 frameIndex, double latencyMs,
+                      const QList<Detection> &detections, const QStringList &labels);
+    void finishWhenIdle();
+
+    QPointer<FrameSource> m_source;
+    QThread m_thread;
+    QObject *m_workerContext;
+    FrameQueue<PendingFrame> m_queue;
+
+    // Only touched on the worker thread
+    TrafficSignDetector m_detector;
+
+    Status m_status = Unloaded;
+    quint64 m_loadGeneration = 0;
+    QString m_modelPath;
+    TrafficSignDetector::Options m_options;
+    QStringList m_classNames;
+
+    quint64 m_generation = 0;
+    bool m_running = false;
+    bool m_startReported = false;
+    qint64 m_framesReceived = 0;
+    qint64 m_framesProcessed = 0;
+    qint64 m_framesDropped = 0;
+    qint64 m_expectedFrames = 0;
+    double m_fps = 0.0;
+    double m_totalLatencyMs = 0.0;
+    QElapsedTimer m_lastFrameTimer;
+    QElapsedTimer m_lastDispatchTimer;
+};
+
+#endif // TRAFFICSIGNENGINE_H
@@ -0,0 +1,438 @@
+#include "V4L2Capture.h"
+#include <QAbstractVideoBuffer>
+#include <QDebug>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QVideoFrameFormat>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <mutex>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+int xioctl(int fd, unsigned long request, void *argument)
+{
+    int result;
+    do {
+        result = ioctl(fd, request, argument);
+    } while (result < 0 && errno == EINTR);
+    return result;
+}
+
+QString lastError()
+{
+    return QString::fromLocal8Bit(strerror(errno));
+}
+
+QVideoFrameFormat::PixelFormat toQtFormat(quint32 pixelFormat)
+{
+    switch (pixelFormat) {
+    case V4L2_PIX_FMT_YUYV:
+        return QVideoFrameFormat::Format_YUYV;
+    case V4L2_PIX_FMT_UYVY:
+        return QVideoFrameFormat::Format_UYVY;
+    case V4L2_PIX_FMT_NV12:
+        return QVideoFrameFormat::Format_NV12;
+    case V4L2_PIX_FMT_MJPEG:
+    case V4L2_PIX_FMT_JPEG:
+        return QVideoFrameFormat::Format_Jpeg;
+    default:
+        return QVideoFrameFormat::Format_Invalid;
+    }
+}
+
+} // namespace
+
+// The mapped driver buffers; outlives the capture while frames are still held
+struct V4L2Capture::State
+{
+    struct Buffer
+    {
+        void *start = MAP_FAILED;
+        size_t length = 0;
+        bool inFlight = false;
+    };
+
+    int fd = -1;
+    quint32 bytesPerLine = 0;
+    std::vector<Buffer> buffers;
+    std::mutex mutex;
+    bool streaming = false;
+    std::atomic<int> inFlight { 0 };
+
+    ~State()
+    {
+        for (const Buffer &buffer : buffers) {
+            if (buffer.start != MAP_FAILED) {
+                munmap(buffer.start, buffer.length);
+            }
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    bool queue(int index)
+    {
+        v4l2_buffer buffer {};
+        buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buffer.memory = V4L2_MEMORY_MMAP;
+        buffer.index = quint32(index);
+        return xioctl(fd, VIDIOC_QBUF, &buffer) == 0;
+    }
+
+    // Called from whichever thread drops the last copy of a frame
+    void release(int index)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffers[size_t(index)].inFlight = false;
+        --inFlight;
+        // A stopped stream queues its free buffers again when it starts
+        if (streaming) {
+            queue(index);
+        }
+    }
+};
+
+// A QVideoFrame's view of one driver buffer, handed back to the driver on destruction
+class V4L2Capture::MappedBuffer : public QAbstractVideoBuffer
+{
+public:
+    MappedBuffer(std::shared_ptr<State> state, int index, quint32 bytesUsed, const QVideoFrameFormat &format)
+        : m_state(std::move(state))
+        , m_index(index)
+        , m_bytesUsed(bytesUsed)
+        , m_format(format)
+    {
+    }
+
+    ~MappedBuffer() override
+    {
+        m_state->release(m_index);
+    }
+
+    MapData map(QVideoFrame::MapMode) override
+    {
+        MapData data;
+        uchar *start = static_cast<uchar *>(m_state->buffers[size_t(m_index)].start);
+        const int stride = int(m_state->bytesPerLine);
+        const int height = m_format.frameHeight();
+
+        if (m_format.pixelFormat() == QVideoFrameFormat::Format_NV12) {
+            // Luma plane followed by interleaved chroma at half height
+            data.planeCount = 2;
+            data.data[0] = start;
+            data.bytesPerLine[0] = stride;
+            data.dataSize[0] = stride * height;
+            data.data[1] = start + stride * height;
+            data.bytesPerLine[1] = stride;
+            data.dataSize[1] = stride * height / 2;
+        } else {
+            data.planeCount = 1;
+            data.data[0] = start;
+            data.bytesPerLine[0] = stride;
+            data.dataSize[0] = int(m_bytesUsed);
+        }
+        return data;
+    }
+
+    QVideoFrameFormat format() const override { return m_format; }
+
+private:
+    std::shared_ptr<State> m_state;
+    int m_index;
+    quint32 m_bytesUsed;
+    QVideoFrameFormat m_format;
+};
+
+QString V4L2Capture::fourccName(quint32 code)
+{
+    QString name;
+    for (int shift = 0; shift < 32; shift += 8) {
+        name.append(QChar(char((code >> shift) & 0xff)));
+    }
+    return name.trimmed();
+}
+
+V4L2Capture::V4L2Capture(const QString &device, QObject *parent)
+    : QObject(parent)
+    , m_device(device)
+    , m_workerContext(new QObject)
+{
+    m_thread.setObjectName("V4L2Capture");
+    m_workerContext->moveToThread(&m_thread);
+    m_thread.start();
+}
+
+V4L2Capture::~V4L2Capture()
+{
+    close();
+    m_thread.quit();
+    m_thread.wait();
+    delete m_workerContext;
+}
+
+bool V4L2Capture::setError(const QString &what)
+{
+    m_errorString = m_device + ": " + what;
+    qWarning() << "V4L2Capture:" << m_errorString;
+    return false;
+}
+
+bool V4L2Capture::open(const Format &format)
+{
+    close();
+
+    const int fd = ::open(QFile::encodeName(m_device).constData(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return setError("cannot open: " + lastError());
+    }
+    // Closes the device on every failure below
+    auto state = std::make_shared<State>();
+    state->fd = fd;
+
+    v4l2_capability capability {};
+    if (xioctl(fd, VIDIOC_QUERYCAP, &capability) != 0) {
+        return setError("not a V4L2 device: " + lastError());
+    }
+    const quint32 caps = (capability.capabilities & V4L2_CAP_DEVICE_CAPS) ? capability.device_caps
+                                                                        : capability.capabilities;
+    if (!(caps & V4L2_CAP_VIDEO_CAPTURE) || !(caps & V4L2_CAP_STREAMING)) {
+        return setError("not a single-planar streaming capture device");
+    }
+
+    // The first preferred format the device offers
+    QList<quint32> offered;
+    v4l2_fmtdesc description {};
+    description.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    while (xioctl(fd, VIDIOC_ENUM_FMT, &description) == 0) {
+        offered.append(description.pixelformat);
+        ++description.index;
+    }
+    quint32 pixelFormat = 0;
+    for (quint32 candidate : format.pixelFormats) {
+        if (offered.contains(candidate) && toQtFormat(candidate) != QVideoFrameFormat::Format_Invalid) {
+            pixelFormat = candidate;
+            break;
+        }
+    }
+    if (pixelFormat == 0) {
+        QStringList names;
+        for (quint32 code : offered) {
+            names.append(fourccName(code));
+        }
+        return setError("offers none of the usable pixel formats, only " + names.join(", "));
+    }
+
+    v4l2_format negotiated {};
+    negotiated.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    negotiated.fmt.pix.width = quint32(format.size.width());
+    negotiated.fmt.pix.height = quint32(format.size.height());
+    negotiated.fmt.pix.pixelformat = pixelFormat;
+    negotiated.fmt.pix.field = V4L2_FIELD_NONE;
+    if (xioctl(fd, VIDIOC_S_FMT, &negotiated) != 0) {
+        return setError("cannot set format: " + lastError());
+    }
+    if (negotiated.fmt.pix.pixelformat != pixelFormat) {
+        return setError("refused pixel format " + fourccName(pixelFormat));
+    }
+    const QSize size(int(negotiated.fmt.pix.width), int(negotiated.fmt.pix.height));
+    state->bytesPerLine = negotiated.fmt.pix.bytesperline;
+
+    // Drivers without frame interval control run at their own rate
+    double fps = format.fps;
+    v4l2_streamparm parameters {};
+    parameters.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(fd, VIDIOC_G_PARM, &parameters) == 0 && (parameters.parm.capture.capability & V4L2_CAP_TIMEPERFRAME)) {
+        parameters.parm.capture.timeperframe.numerator = 1000;
+        parameters.parm.capture.timeperframe.denominator = quint32(format.fps * 1000.0);
+        xioctl(fd, VIDIOC_S_PARM, &parameters);
+    }
+    const v4l2_fract interval = parameters.parm.capture.timeperframe;
+    if (interval.numerator > 0 && interval.denominator > 0) {
+        fps = double(interval.denominator) / double(interval.numerator);
+    }
+
+    v4l2_requestbuffers request {};
+    request.count = BufferCount;
+    request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    request.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(fd, VIDIOC_REQBUFS, &request) != 0) {
+        return setError("cannot request mmap buffers: " + lastError());
+    }
+    if (request.count < 2) {
+        return setError(QString("only %1 capture buffer").arg(request.count));
+    }
+    state->buffers.resize(request.count);
+    for (quint32 index = 0; index < request.count; ++index) {
+        v4l2_buffer buffer {};
+        buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buffer.memory = V4L2_MEMORY_MMAP;
+        buffer.index = index;
+        if (xioctl(fd, VIDIOC_QUERYBUF, &buffer) != 0) {
+            return setError("cannot query buffer: " + lastError());
+        }
+        State::Buffer &mapped = state->buffers[index];
+        mapped.length = buffer.length;
+        mapped.start = mmap(nullptr, buffer.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buffer.m.offset);
+        if (mapped.start == MAP_FAILED) {
+            return setError("cannot map buffer: " + lastError());
+        }
+    }
+
+    m_state = state;
+    m_size = size;
+    m_fps = fps;
+    m_pixelFormat = pixelFormat;
+    m_errorString.clear();
+    qDebug() << "V4L2Capture:" << m_device << "(" << reinterpret_cast<const char *>(capability.card) << ")"
+             << size << fourccName(pixelFormat) << "at" << fps << "fps," << request.count << "buffers";
+    return true;
+}
+
+void V4L2Capture::close()
+{
+    stop();
+    // In-flight frames keep the mappings and the device open until released
+    m_state.reset();
+}
+
+bool V4L2Capture::isStreaming() const
+{
+    if (!m_state) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    return m_state->streaming;
+}
+
+void V4L2Capture::setDropPolicy(const DropPolicy &policy)
+{
+    m_maxInFlight = qMax(1, policy.maxInFlight);
+    m_minIntervalUs = policy.maxFps > 0.0 ? qint64(1e6 / policy.maxFps) : 0;
+}
+
+bool V4L2Capture::start()
+{
+    if (!m_state) {
+        return setError("not open");
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        if (m_state->streaming) {
+            return true;
+        }
+        // Buffers still held downstream are queued when released
+        for (size_t index = 0; index < m_state->buffers.size(); ++index) {
+            if (!m_state->buffers[index].inFlight && !m_state->queue(int(index))) {
+                return setError("cannot queue buffer: " + lastError());
+            }
+        }
+        int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        if (xioctl(m_state->fd, VIDIOC_STREAMON, &type) != 0) {
+            return setError("cannot start streaming: " + lastError());
+        }
+        m_state->streaming = true;
+    }
+
+    const int fd = m_state->fd;
+    QMetaObject::invokeMethod(m_workerContext, [this, fd]() {
+        m_firstTimestampUs = -1;
+        m_lastDeliveredUs = -1;
+        m_notifier = new QSocketNotifier(fd, QSocketNotifier::Read);
+        connect(m_notifier, &QSocketNotifier::activated, m_workerContext, [this]() { readFrames(); });
+    }, Qt::BlockingQueuedConnection);
+    return true;
+}
+
+void V4L2Capture::stop()
+{
+    if (!isStreaming()) {
+        return;
+    }
+    // No dequeue is running once the notifier is gone
+    QMetaObject::invokeMethod(m_workerContext, [this]() {
+        delete m_notifier;
+        m_notifier = nullptr;
+    }, Qt::BlockingQueuedConnection);
+
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    m_state->streaming = false;
+    int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(m_state->fd, VIDIOC_STREAMOFF, &type) != 0) {
+        qWarning() << "V4L2Capture:" << m_device << "cannot stop streaming:" << lastError();
+    }
+    qDebug() << "V4L2Capture:" << m_device << "captured" << m_framesCaptured << "frames," << m_framesDropped << "dropped";
+}
+
+void V4L2Capture::readFrames()
+{
+    const std::shared_ptr<State> state = m_state;
+
+    // Drain everything that is ready; only the newest frame is worth delivering
+    v4l2_buffer latest {};
+    bool haveFrame = false;
+    for (;;) {
+        v4l2_buffer buffer {};
+        buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buffer.memory = V4L2_MEMORY_MMAP;
+        if (xioctl(state->fd, VIDIOC_DQBUF, &buffer) != 0) {
+            if (errno == EAGAIN) {
+                break;
+            }
+            // Unplugged or failed; the notifier would fire forever
+            m_notifier->setEnabled(false);
+            const QString message = m_device + ": capture failed: " + lastError();
+            qWarning() << "V4L2Capture:" << message;
+            emit errorOccurred(message);
+            break;
+        }
+        ++m_framesCaptured;
+        if (haveFrame) {
+            state->queue(int(latest.index));
+            ++m_framesDropped;
+        }
+        latest = buffer;
+        haveFrame = true;
+    }
+    if (!haveFrame) {
+        return;
+    }
+
+    const qint64 timestampUs = qint64(latest.timestamp.tv_sec) * 1000000 + qint64(latest.timestamp.tv_usec);
+    if (m_firstTimestampUs < 0) {
+        m_firstTimestampUs = timestampUs;
+    }
+    const qint64 timeUs = timestampUs - m_firstTimestampUs;
+    const qint64 minIntervalUs = m_minIntervalUs;
+    const int maxInFlight = qMin(int(m_maxInFlight), int(state->buffers.size()) - 1);
+    // A quarter interval of slack keeps timestamp jitter from halving the rate
+    const bool tooSoon = minIntervalUs > 0 && m_lastDeliveredUs >= 0
+            && timeUs + minIntervalUs / 4 < m_lastDeliveredUs + minIntervalUs;
+    if ((latest.flags & V4L2_BUF_FLAG_ERROR) || tooSoon || state->inFlight >= maxInFlight) {
+        state->queue(int(latest.index));
+        ++m_framesDropped;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->buffers[latest.index].inFlight = true;
+        ++state->inFlight;
+    }
+    m_lastDeliveredUs = timeUs;
+
+    QVideoFrameFormat format(m_size, toQtFormat(m_pixelFormat));
+    format.setStreamFrameRate(m_fps);
+    QVideoFrame frame(std::make_unique<MappedBuffer>(state, int(latest.index), latest.bytesused, format));
+    frame.setStartTime(timeUs);
+    emit frameCaptured(frame);
+}
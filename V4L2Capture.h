@@ -0,0 +1,107 @@
+#ifndef V4L2CAPTURE_H
+#define V4L2CAPTURE_H
+
+#include <QList>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QThread>
+#include <QVideoFrame>
+
+#include <atomic>
+#include <memory>
+
+class QSocketNotifier;
+
+// Live capture from a V4L2 camera (/dev/videoN) with memory-mapped driver
+// buffers. Each captured frame is a QVideoFrame over the driver's buffer
+// itself; the buffer goes back to the driver when the last copy of the frame
+// is released, so showing a frame or handing it to the native engines costs
+// no copy. Frames are dequeued on a thread of its own.
+//
+// Under load frames are dropped here rather than queued: only the newest of
+// several ready buffers is delivered, and nothing is delivered while
+// DropPolicy::maxInFlight frames are still held downstream, so the driver
+// always has buffers to fill.
+class V4L2Capture : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Format
+    {
+        QSize size = QSize(1280, 720);  // The driver picks the nearest it supports
+        double fps = 30.0;
+        // V4L2 fourccs in order of preference; YUYV and NV12 are drawn without conversion
+        QList<quint32> pixelFormats = {fourcc("YUYV"), fourcc("NV12"), fourcc("UYVY"), fourcc("MJPG")};
+    };
+
+    struct DropPolicy
+    {
+        int maxInFlight = 3;  // Of BufferCount; the rest stay with the driver
+        double maxFps = 0.0;  // 0 delivers every captured frame
+    };
+
+    static constexpr int BufferCount = 6;
+
+    static constexpr quint32 fourcc(const char (&code)[5])
+    {
+        return quint32(quint8(code[0])) | (quint32(quint8(code[1])) << 8)
+             | (quint32(quint8(code[2])) << 16) | (quint32(quint8(code[3])) << 24);
+    }
+    static QString fourccName(quint32 code);
+    static bool isCaptureDevice(const QString &path) { return path.startsWith("/dev/video"); }
+
+    explicit V4L2Capture(const QString &device, QObject *parent = nullptr);
+    ~V4L2Capture();
+
+    // Opens the device and negotiates the format; the result may differ from the request
+    bool open(const Format &format);
+    void close();
+    bool start();
+    void stop();
+
+    void setDropPolicy(const DropPolicy &policy);
+
+    QString device() const { return m_device; }
+    QString errorString() const { return m_errorString; }
+    bool isOpen() const { return m_state != nullptr; }
+    bool isStreaming() const;
+    QSize size() const { return m_size; }
+    double fps() const { return m_fps; }
+    quint32 pixelFormat() const { return m_pixelFormat; }
+    quint64 framesCaptured() const { return m_framesCaptured; }
+    quint64 framesDropped() const { return m_framesDropped; }
+
+signals:
+    // Emitted on the capture thread; startTime() counts from the first frame of the stream
+    void frameCaptured(const QVideoFrame &frame);
+    void errorOccurred(const QString &message);
+
+private:
+    struct State;
+    class MappedBuffer;
+
+    void readFrames();
+    bool setError(const QString &what);
+
+    QString m_device;
+    QString m_errorString;
+    std::shared_ptr<State> m_state;  // Shared with the frames still in flight
+    QSize m_size;
+    double m_fps = 0.0;
+    quint32 m_pixelFormat = 0;
+
+    QThread m_thread;
+    QObject *m_workerContext;
+    QSocketNotifier *m_notifier = nullptr;  // Lives on m_thread
+
+    std::atomic<int> m_maxInFlight { 3 };  // DropPolicy defaults
+    std::atomic<qint64> m_minIntervalUs { 0 };
+    qint64 m_firstTimestampUs = -1;  // Capture thread only
+    qint64 m_lastDeliveredUs = -1;
+    std::atomic<quint64> m_framesCaptured { 0 };
+    std::atomic<quint64> m_framesDropped { 0 };
+};
+
+#endif // V4L2CAPTURE_H
@@ -0,0 +1,232 @@
+#include "VerificationCache.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QMessageAuthenticationCode>
+#include <QRandomGenerator>
+#include <QSaveFile>
+
+namespace {
+
+constexpr qsizetype KeySize = 32;
+constexpr qsizetype MacSize = 32;  // HMAC-SHA256
+
+QByteArray mac(const QByteArray &payload, const QByteArray &key)
+{
+    return QMessageAuthenticationCode::hash(payload, key, QCryptographicHash::Sha256);
+}
+
+// Compares in constant time so the check does not leak how much of the MAC matched
+bool sameMac(const QByteArray &a, const QByteArray &b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    uchar difference = 0;
+    for (qsizetype i = 0; i < a.size(); ++i) {
+        difference |= uchar(a[i] ^ b[i]);
+    }
+    return difference == 0;
+}
+
+bool writePrivateFile(const QString &path, const QByteArray &data)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qWarning() << "VerificationCache: could not write" << path << ":" << file.errorString();
+        return false;
+    }
+    QFile::setPermissions(path, QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    return true;
+}
+
+} // namespace
+
+VerificationCache::VerificationCache(const QString &directory, const QString &keyDirectory, const Policy &policy)
+    : m_directory(directory)
+    , m_keyDirectory(keyDirectory)
+    , m_policy(policy)
+{
+}
+
+void VerificationCache::open()
+{
+    if (m_opened) {
+        return;
+    }
+    m_opened = true;
+    if (loadKey()) {
+        load();
+    }
+}
+
+QByteArray VerificationCache::fingerprint(const QString &imagePath)
+{
+    QFile file(imagePath);
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!file.open(QIODevice::ReadOnly) || !hash.addData(&file)) {
+        return QByteArray();
+    }
+    return hash.result();
+}
+
+bool VerificationCache::lookup(const QString &carId, const QByteArray &fingerprint, Entry *entry) const
+{
+    const qsizetype index = find(carId, fingerprint);
+    if (index < 0 || m_entries[index].expiresAtMs <= QDateTime::currentMSecsSinceEpoch()) {
+        return false;
+    }
+    if (entry) {
+        *entry = m_entries[index];
+    }
+    return true;
+}
+
+void VerificationCache::store(const QString &carId, const QString &driverName, const QByteArray &fingerprint)
+{
+    if (m_key.isEmpty() || fingerprint.isEmpty()) {
+        return;
+    }
+
+    const qsizetype index = find(carId, fingerprint);
+    if (index >= 0) {
+        m_entries.removeAt(index);
+    }
+
+    Entry entry;
+    entry.carId = carId;
+    entry.driverName = driverName;
+    entry.fingerprint = fingerprint;
+    entry.verifiedAtMs = QDateTime::currentMSecsSinceEpoch();
+    entry.expiresAtMs = entry.verifiedAtMs + m_policy.ttlSeconds * 1000;
+    m_entries.prepend(entry);
+
+    prune(entry.verifiedAtMs);
+    save();
+}
+
+void VerificationCache::revoke(const QString &carId, const QByteArray &fingerprint)
+{
+    const qsizetype index = find(carId, fingerprint);
+    if (index < 0) {
+        return;
+    }
+    qDebug() << "VerificationCache: revoked" << m_entries[index].driverName << "for car" << carId;
+    m_entries.removeAt(index);
+    save();
+}
+
+qsizetype VerificationCache::find(const QString &carId, const QByteArray &fingerprint) const
+{
+    for (qsizetype i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].carId == carId && m_entries[i].fingerprint == fingerprint) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void VerificationCache::prune(qint64 nowMs)
+{
+    m_entries.removeIf([nowMs](const Entry &entry) { return entry.expiresAtMs <= nowMs; });
+    while (m_entries.size() > m_policy.maxEntries) {
+        m_entries.removeLast();
+    }
+}
+
+QString VerificationCache::filePath() const
+{
+    return QDir(m_directory).filePath("verification-cache.bin");
+}
+
+QString VerificationCache::keyPath() const
+{
+    return QDir(m_keyDirectory).filePath("verification-cache.key");
+}
+
+bool VerificationCache::loadKey()
+{
+    for (const QString &directory : {m_directory, m_keyDirectory}) {
+        if (!QDir().mkpath(directory)) {
+            qWarning() << "VerificationCache: could not create" << directory;
+            return false;
+        }
+    }
+    QFile::setPermissions(m_keyDirectory, QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ExeOwner);
+
+    QFile file(keyPath());
+    if (file.open(QIODevice::ReadOnly)) {
+        m_key = file.readAll();
+        if (m_key.size() == KeySize) {
+            return true;
+        }
+    }
+
+    // A new key invalidates whatever cache was there
+    m_key.resize(KeySize);
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32*>(m_key.data()), KeySize / 4);
+    if (!writePrivateFile(keyPath(), m_key)) {
+        m_key.clear();
+        return false;
+    }
+    QFile::remove(filePath());
+    // Left by versions that kept the key next to the entries
+    if (QDir(m_keyDirectory) != QDir(m_directory)) {
+        QFile::remove(QDir(m_directory).filePath("verification-cache.key"));
+    }
+    return true;
+}
+
+void VerificationCache::load()
+{
+    QFile file(filePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QByteArray data = file.readAll();
+    const QByteArray payload = data.left(data.size() - MacSize);
+    if (data.size() <= MacSize || !sameMac(mac(payload, m_key), data.right(MacSize))) {
+        qWarning() << "VerificationCache: discarding" << filePath() << "which failed its integrity check";
+        QFile::remove(filePath());
+        return;
+    }
+
+    QDataStream stream(payload);
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> count;
+    if (magic != Magic || version != Version) {
+        return;
+    }
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        Entry entry;
+        stream >> entry.carId >> entry.driverName >> entry.fingerprint >> entry.verifiedAtMs >> entry.expiresAtMs;
+        m_entries.append(entry);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        m_entries.clear();
+        return;
+    }
+
+    prune(QDateTime::currentMSecsSinceEpoch());
+    qDebug() << "VerificationCache:" << m_entries.size() << "cached verifications";
+}
+
+void VerificationCache::save()
+{
+    if (m_key.isEmpty()) {
+        return;
+    }
+
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << Magic << Version << quint32(m_entries.size());
+    for (const Entry &entry : std::as_const(m_entries)) {
+        stream << entry.carId << entry.driverName << entry.fingerprint << entry.verifiedAtMs << entry.expiresAtMs;
+    }
+    writePrivateFile(filePath(), payload + mac(payload, m_key));
+}
@@ -0,0 +1,74 @@
+#ifndef VERIFICATIONCACHE_H
+#define VERIFICATIONCACHE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+// Recent successful driver verifications, so a login can be answered without
+// the server. An entry matches on carId and on the SHA-256 of the capture
+// file, so only an exact re-upload of the capture the server accepted hits,
+// such as a retried login; a fresh camera capture is never byte-identical
+// and always goes to the server. Entries expire after Policy::ttlSeconds.
+// The server stays the authority: it revokes an entry by refusing the driver
+// on revalidation, and an entry whose revalidation could not reach it is
+// dropped until it confirms again.
+// The file is authenticated with HMAC-SHA256 under a per-install key, kept
+// in a directory of its own away from the entries, and is discarded whole
+// if it does not verify.
+class VerificationCache
+{
+public:
+    struct Policy
+    {
+        int maxEntries = 8;                  // Least recently verified go first
+        qint64 ttlSeconds = 72 * 3600;
+    };
+
+    struct Entry
+    {
+        QString carId;
+        QString driverName;
+        QByteArray fingerprint;
+        qint64 verifiedAtMs = 0;
+        qint64 expiresAtMs = 0;
+    };
+
+    static constexpr quint32 Magic = 0x4356444E;  // "NDVC"
+    static constexpr quint32 Version = 2;
+
+    VerificationCache(const QString &directory, const QString &keyDirectory, const Policy &policy = Policy());
+
+    // Reads the key and the entries; until then the cache is empty and
+    // stores nothing, so construction costs no I/O
+    void open();
+    bool isOpen() const { return m_opened; }
+
+    // SHA-256 of the capture file, empty if it cannot be read
+    static QByteArray fingerprint(const QString &imagePath);
+
+    bool lookup(const QString &carId, const QByteArray &fingerprint, Entry *entry) const;
+    void store(const QString &carId, const QString &driverName, const QByteArray &fingerprint);
+    void revoke(const QString &carId, const QByteArray &fingerprint);
+
+    Policy policy() const { return m_policy; }
+    int size() const { return int(m_entries.size()); }
+
+private:
+    QString filePath() const;
+    QString keyPath() const;
+    bool loadKey();
+    void load();
+    void save();
+    void prune(qint64 nowMs);
+    qsizetype find(const QString &carId, const QByteArray &fingerprint) const;
+
+    QString m_directory;
+    QString m_keyDirectory;
+    Policy m_policy;
+    bool m_opened = false;
+    QByteArray m_key;
+    QList<Entry> m_entries;  // Most recently verified first
+};
+
+#endif // VERIFICATIONCACHE_H
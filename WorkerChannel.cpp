@@ -0,0 +1,232 @@
+#include "WorkerChannel.h"
+#include <QDebug>
+#include <QTimer>
+
+#include <cstring>
+
+namespace {
+
+const QByteArrayView ProtocolPrefix("ND1\t");
+
+// Walks tab-separated fields of a line without copying them
+class FieldReader
+{
+public:
+    explicit FieldReader(QByteArrayView fields) : m_rest(fields) {}
+
+    bool atEnd() const { return m_rest.isEmpty(); }
+    QByteArrayView rest() const { return m_rest; }
+
+    QByteArrayView next()
+    {
+        if (m_rest.isEmpty()) {
+            return QByteArrayView();
+        }
+        const void *tab = std::memchr(m_rest.data(), '\t', size_t(m_rest.size()));
+        if (!tab) {
+            QByteArrayView field = m_rest;
+            m_rest = QByteArrayView();
+            return field;
+        }
+        const qsizetype length = static_cast<const char*>(tab) - m_rest.data();
+        QByteArrayView field = m_rest.first(length);
+        m_rest = m_rest.sliced(length + 1);
+        return field;
+    }
+
+    qint64 nextInt() { return next().toLongLong(); }
+    double nextDouble() { return next().toDouble(); }
+
+private:
+    QByteArrayView m_rest;
+};
+
+} // namespace
+
+WorkerChannel::WorkerChannel(const QString &name, QIODevice *device, QObject *parent)
+    : QObject(parent)
+    , m_name(name)
+    , m_device(device)
+{
+    m_buffer.resize(BufferSize);
+    m_pendingDetections.reserve(32);
+    connect(device, &QIODevice::readyRead, this, &WorkerChannel::readAvailable);
+
+    // Output that arrived before the channel was attached gets no new readyRead
+    if (device->bytesAvailable() > 0) {
+        QTimer::singleShot(0, this, &WorkerChannel::readAvailable);
+    }
+}
+
+void WorkerChannel::flush()
+{
+    readAvailable();
+
+    // A worker that dies mid-line still gets its last words reported
+    if (m_used > 0 && !m_discarding) {
+        handleLine(QByteArrayView(m_buffer.constData(), m_used));
+    }
+    m_used = 0;
+    m_discarding = false;
+}
+
+void WorkerChannel::readAvailable()
+{
+    if (!m_device) {
+        return;
+    }
+
+    for (;;) {
+        const qint64 bytesRead = m_device->read(m_buffer.data() + m_used, BufferSize - m_used);
+        if (bytesRead <= 0) {
+            break;
+        }
+
+        const char *data = m_buffer.constData();
+        const qsizetype end = m_used + bytesRead;
+        qsizetype lineStart = 0;
+        qsizetype scanFrom = m_used;
+
+        while (scanFrom < end) {
+            const void *newline = std::memchr(data + scanFrom, '\n', size_t(end - scanFrom));
+            if (!newline) {
+                break;
+            }
+            const qsizetype lineEnd = static_cast<const char*>(newline) - data;
+            if (m_discarding) {
+                m_discarding = false;
+            } else {
+                handleLine(QByteArrayView(data + lineStart, lineEnd - lineStart));
+            }
+            lineStart = lineEnd + 1;
+            scanFrom = lineStart;
+        }
+
+        // Keep the unfinished tail at the front of the buffer
+        m_used = end - lineStart;
+        if (m_used > 0 && lineStart > 0) {
+            std::memmove(m_buffer.data(), data + lineStart, size_t(m_used));
+        }
+
+        // A single line larger than the buffer is dropped rather than grown
+        if (m_used == BufferSize) {
+            qWarning() << m_name << "worker line exceeds" << BufferSize << "bytes, discarding";
+            m_used = 0;
+            m_discarding = true;
+        }
+    }
+}
+
+void WorkerChannel::handleLine(QByteArrayView line)
+{
+    if (line.endsWith('\r')) {
+        line.chop(1);
+    }
+
+    if (!line.startsWith(ProtocolPrefix)) {
+        if (!line.isEmpty()) {
+            qDebug().noquote() << m_name << "worker:" << line;
+        }
+        return;
+    }
+
+    FieldReader reader(line.sliced(ProtocolPrefix.size()));
+    const QByteArrayView event = reader.next();
+    handleEvent(event, reader.rest());
+}
+
+void WorkerChannel::handleEvent(QByteArrayView event, QByteArrayView fields)
+{
+    FieldReader reader(fields);
+
+    if (event == "det") {
+        reader.nextInt();  // Frame index; detections belong to the next frame event
+        Detection detection;
+        detection.classId = int(reader.nextInt());
+        detection.confidence = float(reader.nextDouble());
+        const double x1 = reader.nextDouble();
+        const double y1 = reader.nextDouble();
+        const double x2 = reader.nextDouble();
+        const double y2 = reader.nextDouble();
+        detection.box = QRectF(QPointF(x1, y1), QPointF(x2, y2));
+        m_pendingDetections.append(detection);
+    } else if (event == "infer") {
+        m_marksInference = true;
+        m_pendingInference = true;
+    } else if (event == "lane") {
+        reader.nextInt();  // Frame index; the lane belongs to the frame event that follows
+        QPolygonF lane;
+        while (!reader.atEnd()) {
+            const double x = reader.nextDouble();
+            const double y = reader.nextDouble();
+            lane.append(QPointF(x, y));
+        }
+        if (lane.size() >= 2) {
+            m_pendingLanes.append(lane);
+        }
+    } else if (event == "frame") {
+        const qint64 frameIndex = reader.nextInt();
+        if (!m_pendingLanes.isEmpty() || m_hadLanes) {
+            m_hadLanes = !m_pendingLanes.isEmpty();
+            emit lanesDetected(frameIndex, m_pendingLanes);
+            m_pendingLanes.clear();
+        }
+        m_fps = reader.nextDouble();
+        m_latencyMs = reader.nextDouble();
+        m_totalLatencyMs += m_latencyMs;
+        ++m_latencySamples;
+        ++m_framesProcessed;
+        emit frameProcessed(frameIndex, m_fps, m_latencyMs, m_pendingDetections,
+                            !m_marksInference || m_pendingInference);
+        m_pendingDetections.clear();
+        m_pendingInference = false;
+    } else if (event == "state") {
+        const qint64 frameIndex = reader.nextInt();
+        const QByteArrayView stateName = reader.next();
+        const double value = reader.nextDouble();
+
+        // State names are interned so repeated updates do not allocate
+        qsizetype index = 0;
+        while (index < m_stateNames.size() && QByteArrayView(m_stateNames.at(index)) != stateName) {
+            ++index;
+        }
+        if (index == m_stateNames.size()) {
+            m_stateNames.append(stateName.toByteArray());
+        }
+        emit stateChanged(frameIndex, m_stateNames.at(index), value);
+    } else if (event == "eyes") {
+        const qint64 frameIndex = reader.nextInt();
+        const double timeMs = reader.nextDouble();
+        int values = 0;
+        while (!reader.atEnd() && values < EyeLandmarks::PointCount * 2) {
+            m_eyes.points[values++] = float(reader.nextDouble());
+        }
+        m_eyes.found = values == EyeLandmarks::PointCount * 2;
+        emit eyesDetected(frameIndex, timeMs, m_eyes);
+    } else if (event == "class") {
+        const int classId = int(reader.nextInt());
+        m_classNames.insert(classId, QString::fromUtf8(reader.rest()));
+    } else if (event == "start") {
+        m_expectedFrames = reader.nextInt();
+        m_fps = reader.nextDouble();
+        // A worker resumed from its checkpoint counts on from there
+        m_framesProcessed = reader.nextInt();
+        m_totalLatencyMs = 0.0;
+        m_latencySamples = 0;
+        m_done = false;
+        emit workerStarted(m_expectedFrames, m_fps);
+    } else if (event == "error") {
+        emit workerError(QString::fromUtf8(reader.rest()));
+    } else if (event == "done") {
+        // A count that is missing or garbled leaves the frames counted so far
+        bool ok = false;
+        const qint64 framesProcessed = reader.next().toLongLong(&ok);
+        if (ok) {
+            m_framesProcessed = framesProcessed;
+        }
+        m_done = true;
+        emit workerDone(m_framesProcessed);
+    } else {
+        qDebug() << m_name << "ignoring unknown worker event" << event;
+    }
+}
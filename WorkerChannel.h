@@ -0,0 +1,119 @@
+#ifndef WORKERCHANNEL_H
+#define WORKERCHANNEL_H
+
+#include <QObject>
+#include <QIODevice>
+#include <QPointer>
+#include <QRectF>
+#include <QPolygonF>
+#include <QList>
+#include <QHash>
+#include <QByteArrayView>
+
+// One detection reported by a worker, in source frame pixel coordinates
+struct Detection
+{
+    int classId = -1;
+    float confidence = 0.0f;
+    QRectF box;
+    int trackId = -1;    // Set by ObjectTracker; workers do not send one
+};
+
+// Eye landmarks reported by drowsiness.py: per eye, left then right, the
+// six points of the eye aspect ratio as x, y pairs in source frame pixels
+struct EyeLandmarks
+{
+    static constexpr int PointCount = 12;
+    bool found = false;    // No face on the frame otherwise
+    float points[PointCount * 2] = {};
+};
+
+// Incremental reader for the worker event protocol (see worker_ipc.py).
+//
+// Every protocol line is "ND1<TAB>event<TAB>field...\n"; any other line is
+// treated as worker log output. Lines are parsed in place from a fixed
+// buffer as soon as they arrive, so long runs never accumulate output.
+//
+// A worker that runs its model on only some frames sends "infer" ahead of
+// the detections of each of those; its other frames carry no detections and
+// are left to the dashboard's tracker. A worker that never sends it runs the
+// model on every frame.
+//
+//   start   <expected_frames> <fps> [<first_frame>]
+//   class   <id> <name>
+//   infer   <frame>
+//   det     <frame> <class_id> <conf> <x1> <y1> <x2> <y2>
+//   lane    <frame> <x1> <y1> <x2> <y2> [<x> <y>...]
+//   state   <frame> <name> <value>
+//   eyes    <frame> <time_ms> [<x> <y> x 12]
+//   frame   <frame> <fps> <latency_ms>
+//   error   <message>
+//   done    <frames>
+class WorkerChannel : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit WorkerChannel(const QString &name, QIODevice *device, QObject *parent = nullptr);
+
+    static constexpr int BufferSize = 64 * 1024;
+
+    QString name() const { return m_name; }
+    qint64 framesProcessed() const { return m_framesProcessed; }
+    qint64 expectedFrames() const { return m_expectedFrames; }
+    double fps() const { return m_fps; }
+    double latencyMs() const { return m_latencyMs; }
+    double averageLatencyMs() const { return m_latencySamples > 0 ? m_totalLatencyMs / double(m_latencySamples) : 0.0; }
+    bool isDone() const { return m_done; }
+    QString className(int classId) const { return m_classNames.value(classId); }
+    bool marksInference() const { return m_marksInference; }
+
+    // Drains whatever is left in the device, e.g. after the process exited
+    void flush();
+
+signals:
+    void workerStarted(qint64 expectedFrames, double fps);
+    // Detections are batched until the frame event that closes them arrives;
+    // inferred is false for a frame the model did not run on
+    void frameProcessed(qint64 frameIndex, double fps, double latencyMs, const QList<Detection> &detections,
+                        bool inferred);
+    // Lane polylines of a frame, sent just before its frameProcessed; an empty
+    // list clears the lanes of the previous frame
+    void lanesDetected(qint64 frameIndex, const QList<QPolygonF> &lanes);
+    void stateChanged(qint64 frameIndex, const QByteArray &name, double value);
+    // timeMs is the frame's position in the video; eyes is reused per event
+    void eyesDetected(qint64 frameIndex, double timeMs, const EyeLandmarks &eyes);
+    void workerError(const QString &message);
+    void workerDone(qint64 framesProcessed);
+
+private slots:
+    void readAvailable();
+
+private:
+    void handleLine(QByteArrayView line);
+    void handleEvent(QByteArrayView event, QByteArrayView fields);
+
+    QString m_name;
+    QPointer<QIODevice> m_device;
+    QByteArray m_buffer;
+    qsizetype m_used = 0;
+    bool m_discarding = false;
+
+    QHash<int, QString> m_classNames;
+    QList<QByteArray> m_stateNames;
+    QList<Detection> m_pendingDetections;
+    QList<QPolygonF> m_pendingLanes;
+    bool m_hadLanes = false;
+    EyeLandmarks m_eyes;
+    bool m_marksInference = false;
+    bool m_pendingInference = false;
+    qint64 m_framesProcessed = 0;
+    qint64 m_expectedFrames = 0;
+    double m_fps = 0.0;
+    double m_latencyMs = 0.0;
+    double m_totalLatencyMs = 0.0;
+    qint64 m_latencySamples = 0;
+    bool m_done = false;
+};
+
+#endif // WORKERCHANNEL_H
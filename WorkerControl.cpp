@@ -0,0 +1,82 @@
+#include "WorkerControl.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+WorkerControl::~WorkerControl()
+{
+    destroy();
+}
+
+bool WorkerControl::create(const QString &name, const Settings &settings)
+{
+    destroy();
+
+    QByteArray shmName = name.toUtf8();
+    if (!shmName.startsWith('/')) {
+        shmName.prepend('/');
+    }
+    shm_unlink(shmName.constData());
+
+    int fd = shm_open(shmName.constData(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        m_errorString = QString("shm_open failed: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    if (ftruncate(fd, off_t(sizeof(Block))) != 0) {
+        m_errorString = QString("ftruncate failed: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        close(fd);
+        shm_unlink(shmName.constData());
+        return false;
+    }
+    void *base = mmap(nullptr, sizeof(Block), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        m_errorString = QString("mmap failed: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        shm_unlink(shmName.constData());
+        return false;
+    }
+
+    m_block = static_cast<Block*>(base);
+    m_block->version = Version;
+    m_block->sequence = 0;
+    m_name = QString::fromUtf8(shmName);
+    m_errorString.clear();
+    setSettings(settings);
+    // Publish the magic last so a worker never sees a half-initialised block
+    __atomic_store_n(&m_block->magic, Magic, __ATOMIC_RELEASE);
+    return true;
+}
+
+void WorkerControl::destroy()
+{
+    if (m_block) {
+        munmap(m_block, sizeof(Block));
+        m_block = nullptr;
+    }
+    if (!m_name.isEmpty()) {
+        shm_unlink(m_name.toUtf8().constData());
+    }
+    m_name.clear();
+}
+
+void WorkerControl::setSettings(const Settings &settings)
+{
+    m_settings = settings;
+    if (!m_block) {
+        return;
+    }
+
+    const quint32 sequence = __atomic_load_n(&m_block->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&m_block->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    m_block->stride = quint32(qMax(1, settings.stride));
+    m_block->maxWidth = quint32(qMax(0, settings.maxWidth));
+    m_block->fpsMilli = quint32(qMax(0.0, settings.fps) * 1000.0);
+    m_block->level = quint32(settings.level);
+    __atomic_store_n(&m_block->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,71 @@
+#ifndef WORKERCONTROL_H
+#define WORKERCONTROL_H
+
+#include <QString>
+
+// Shared-memory block through which the dashboard adjusts a running worker's
+// processing rate. Created by the dashboard and polled by the worker once per
+// frame; the layout is mirrored in worker_ipc.py:
+//
+//   [Block 64 bytes]
+//
+// The sequence is odd while the dashboard is writing, so a worker retries
+// instead of reading half an update.
+class WorkerControl
+{
+public:
+    static constexpr quint32 Magic = 0x4357444E;  // "NDWC"
+    static constexpr quint32 Version = 1;
+
+    struct Block {
+        quint32 magic;
+        quint32 version;
+        quint32 sequence;
+        quint32 stride;    // Inference on every stride-th processed frame
+        quint32 maxWidth;  // Wider frames are scaled down first, 0 for no limit
+        quint32 fpsMilli;  // Frames processed per second, 0 for every frame
+        quint32 level;     // Governor level, for the worker's log
+        quint8 reserved[36];
+    };
+
+    static_assert(sizeof(Block) == 64, "Block layout is shared with worker_ipc.py");
+
+    struct Settings
+    {
+        int stride = 3;
+        int maxWidth = 640;
+        double fps = 15.0;
+        int level = 0;
+
+        bool operator==(const Settings &other) const
+        {
+            return stride == other.stride && maxWidth == other.maxWidth
+                && qFuzzyCompare(fps + 1.0, other.fps + 1.0) && level == other.level;
+        }
+        bool operator!=(const Settings &other) const { return !(*this == other); }
+    };
+
+    WorkerControl() = default;
+    ~WorkerControl();
+
+    WorkerControl(const WorkerControl &) = delete;
+    WorkerControl &operator=(const WorkerControl &) = delete;
+
+    bool create(const QString &name, const Settings &settings);
+    void destroy();
+
+    bool isValid() const { return m_block != nullptr; }
+    QString name() const { return m_name; }
+    QString errorString() const { return m_errorString; }
+
+    Settings settings() const { return m_settings; }
+    void setSettings(const Settings &settings);
+
+private:
+    QString m_name;
+    QString m_errorString;
+    Block *m_block = nullptr;
+    Settings m_settings;
+};
+
+#endif // WORKERCONTROL_H
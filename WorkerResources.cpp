@@ -0,0 +1,356 @@
+#include "WorkerResources.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QThread>
+
+#include <cerrno>
+#include <cstring>
+#include <sched.h>
+#include <sys/resource.h>
+
+namespace {
+
+QByteArray readFile(const QString &path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+// cgroup files take one value per write()
+bool writeFile(const QString &path, const QByteArray &value)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Unbuffered) || file.write(value) != value.size()) {
+        qWarning() << "WorkerResources: could not write" << value << "to" << path << ":" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QString coreList(const QList<int> &cores)
+{
+    QStringList names;
+    for (int core : cores) {
+        names.append(QString::number(core));
+    }
+    return names.join(',');
+}
+
+} // namespace
+
+WorkerResources::WorkerResources(QObject *parent)
+    : QObject(parent)
+{
+    // The GUI and render threads keep core 0 to themselves on anything with cores to spare
+    if (QThread::idealThreadCount() >= 3) {
+        m_reservedCores = {0};
+    }
+    const QString sysfsRoot = qEnvironmentVariable("NEURODRIVE_SYSFS_ROOT");
+    if (!sysfsRoot.isEmpty()) {
+        m_sysfsRoot = sysfsRoot;
+    }
+    const QString procRoot = qEnvironmentVariable("NEURODRIVE_PROC_ROOT");
+    if (!procRoot.isEmpty()) {
+        m_procRoot = procRoot;
+    }
+
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, [this]() {
+        qDebug() << "WorkerResources:" << m_filePath << "changed, reloading";
+        loadConfiguration();
+    });
+}
+
+void WorkerResources::setModelKey(int model, const QString &key)
+{
+    m_keys[model] = key;
+}
+
+void WorkerResources::loadConfiguration()
+{
+    m_filePath = qEnvironmentVariable("NEURODRIVE_RESOURCE_POLICY");
+    if (m_filePath.isEmpty()) {
+        return;
+    }
+    // Editors replace the file rather than write it, which drops the watch
+    if (!m_watcher.files().contains(m_filePath)) {
+        m_watcher.addPath(m_filePath);
+    }
+
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(readFile(m_filePath), &error);
+    if (!document.isObject()) {
+        qWarning() << "WorkerResources: ignoring" << m_filePath << ":" << error.errorString();
+        return;
+    }
+    const QVariantMap configuration = document.object().toVariantMap();
+
+    if (configuration.contains("reservedCores")) {
+        QList<int> cores;
+        for (const QVariant &core : configuration.value("reservedCores").toList()) {
+            cores.append(core.toInt());
+        }
+        setReservedCores(cores);
+    }
+    for (auto it = m_keys.constBegin(); it != m_keys.constEnd(); ++it) {
+        if (configuration.contains(it.value())) {
+            setPolicy(it.key(), fromMap(configuration.value(it.value()).toMap(), policy(it.key())));
+        }
+    }
+}
+
+void WorkerResources::setPolicy(int model, const Policy &policy)
+{
+    m_policies[model] = policy;
+    if (m_attached.contains(model)) {
+        apply(model, m_attached.value(model));
+    }
+    emit policyChanged();
+}
+
+void WorkerResources::setReservedCores(const QList<int> &cores)
+{
+    if (m_reservedCores == cores) {
+        return;
+    }
+    m_reservedCores = cores;
+    for (auto it = m_attached.constBegin(); it != m_attached.constEnd(); ++it) {
+        apply(it.key(), it.value());
+    }
+    emit policyChanged();
+}
+
+QVariantMap WorkerResources::policyMap(int model) const
+{
+    const Policy current = policy(model);
+    QVariantList cores;
+    for (int core : current.cores) {
+        cores.append(core);
+    }
+    return {
+        {"cores", cores},
+        {"nice", current.nice},
+        {"idle", current.idle},
+        {"cpuMaxPercent", current.cpuMaxPercent},
+        {"memoryMaxMb", current.memoryMaxMb}
+    };
+}
+
+void WorkerResources::setPolicyMap(int model, const QVariantMap &policy)
+{
+    setPolicy(model, fromMap(policy, this->policy(model)));
+}
+
+WorkerResources::Policy WorkerResources::fromMap(const QVariantMap &map, const Policy &base) const
+{
+    Policy policy = base;
+    if (map.contains("cores")) {
+        policy.cores.clear();
+        for (const QVariant &core : map.value("cores").toList()) {
+            policy.cores.append(core.toInt());
+        }
+    }
+    policy.nice = qBound(-20, map.value("nice", policy.nice).toInt(), 19);
+    policy.idle = map.value("idle", policy.idle).toBool();
+    policy.cpuMaxPercent = qMax(0, map.value("cpuMaxPercent", policy.cpuMaxPercent).toInt());
+    policy.memoryMaxMb = qMax(0, map.value("memoryMaxMb", policy.memoryMaxMb).toInt());
+    return policy;
+}
+
+QList<int> WorkerResources::allowedCores(const Policy &policy) const
+{
+    const int coreCount = QThread::idealThreadCount();
+    QList<int> cores;
+    if (policy.cores.isEmpty()) {
+        for (int core = 0; core < coreCount; ++core) {
+            cores.append(core);
+        }
+    } else {
+        for (int core : policy.cores) {
+            if (core >= 0 && core < coreCount) {
+                cores.append(core);
+            }
+        }
+    }
+    cores.removeIf([this](int core) { return m_reservedCores.contains(core); });
+    // Nothing left means no pinning rather than a worker that cannot run
+    return cores.size() < coreCount ? cores : QList<int>();
+}
+
+QString WorkerResources::summary(const Policy &policy) const
+{
+    const QList<int> cores = allowedCores(policy);
+    QString text = QString("cores %1, %2")
+            .arg(cores.isEmpty() ? QString("any") : coreList(cores),
+                 policy.idle ? QString("SCHED_IDLE") : QString("nice %1").arg(policy.nice));
+    if (policy.cpuMaxPercent > 0) {
+        text += QString(", cpu.max %1%").arg(policy.cpuMaxPercent);
+    }
+    if (policy.memoryMaxMb > 0) {
+        text += QString(", memory.max %1 MB").arg(policy.memoryMaxMb);
+    }
+    return text;
+}
+
+std::function<void()> WorkerResources::childModifier(int model) const
+{
+    const Policy current = policy(model);
+    const QList<int> cores = allowedCores(current);
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int core : cores) {
+        CPU_SET(core, &mask);
+    }
+    const bool pin = !cores.isEmpty();
+    const int nice = current.nice;
+    const bool idle = current.idle;
+
+    // Runs between fork and exec, so only plain system calls
+    return [mask, pin, nice, idle]() {
+        if (pin) {
+            sched_setaffinity(0, sizeof(mask), &mask);
+        }
+        setpriority(PRIO_PROCESS, 0, nice);
+        if (idle) {
+            sched_param param {};
+            sched_setscheduler(0, SCHED_IDLE, &param);
+        }
+    };
+}
+
+void WorkerResources::attach(int model, qint64 pid)
+{
+    if (pid <= 0) {
+        return;
+    }
+    m_attached[model] = pid;
+    apply(model, pid);
+}
+
+void WorkerResources::detach(int model)
+{
+    m_attached.remove(model);
+}
+
+void WorkerResources::apply(int model, qint64 pid)
+{
+    const Policy current = policy(model);
+    const QList<int> cores = allowedCores(current);
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int core : cores) {
+        CPU_SET(core, &mask);
+    }
+
+    // Threads the worker starts later inherit from the thread that starts them
+    const QStringList tasks = QDir(QString("%1/%2/task").arg(m_procRoot).arg(pid)).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    QString failure;
+    for (const QString &task : tasks) {
+        const pid_t tid = pid_t(task.toInt());
+        if (!cores.isEmpty() && sched_setaffinity(tid, sizeof(mask), &mask) != 0 && failure.isEmpty()) {
+            failure = QString("affinity: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        }
+        sched_param param {};
+        if (sched_setscheduler(tid, current.idle ? SCHED_IDLE : SCHED_OTHER, &param) != 0 && failure.isEmpty()) {
+            failure = QString("scheduler: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        }
+        // A lower nice than the worker already has needs CAP_SYS_NICE
+        if (setpriority(PRIO_PROCESS, id_t(tid), current.nice) != 0 && failure.isEmpty()) {
+            failure = QString("nice %1: %2").arg(current.nice).arg(QString::fromLocal8Bit(strerror(errno)));
+        }
+    }
+    if (tasks.isEmpty()) {
+        return;
+    }
+
+    applyCgroup(model, pid, current);
+
+    const QString text = summary(current);
+    if (failure.isEmpty()) {
+        qDebug() << "WorkerResources:" << m_keys.value(model) << "pid" << pid << "->" << text;
+    } else {
+        qWarning() << "WorkerResources:" << m_keys.value(model) << "pid" << pid << "->" << text
+                   << "partly failed (" << failure << ")";
+    }
+    emit policyApplied(model, pid, text);
+}
+
+bool WorkerResources::prepareCgroups()
+{
+    if (m_cgroupState != CgroupsUnknown) {
+        return m_cgroupState == CgroupsReady;
+    }
+    m_cgroupState = CgroupsUnavailable;
+
+    // cgroup v2 has a single hierarchy, listed as "0::<path>"
+    QString path;
+    for (const QByteArray &line : readFile(m_procRoot + "/self/cgroup").split('\n')) {
+        if (line.startsWith("0::")) {
+            path = QString::fromUtf8(line.mid(3));
+        }
+    }
+    const QString root = QDir::cleanPath(m_sysfsRoot + "/fs/cgroup/" + path);
+    const QList<QByteArray> controllers = readFile(root + "/cgroup.controllers").trimmed().split(' ');
+    if (path.isEmpty() || (!controllers.contains("cpu") && !controllers.contains("memory"))) {
+        qDebug() << "WorkerResources: no cgroup v2 cpu or memory controller delegated at" << root
+                 << ", cpu.max and memory.max are not applied";
+        return false;
+    }
+
+    // Only leaf cgroups may hold processes once controllers are enabled for
+    // their children, so the dashboard and the fork server move to a leaf of their own
+    const QString leaf = root + "/dashboard";
+    if (!QDir().mkpath(leaf)) {
+        qDebug() << "WorkerResources: cannot create cgroups under" << root;
+        return false;
+    }
+    for (const QByteArray &pid : readFile(root + "/cgroup.procs").split('\n')) {
+        if (!pid.isEmpty() && !writeFile(leaf + "/cgroup.procs", pid)) {
+            return false;
+        }
+    }
+    bool enabled = false;
+    for (const char *controller : {"cpu", "memory"}) {
+        if (controllers.contains(controller)) {
+            enabled |= writeFile(root + "/cgroup.subtree_control", QByteArray("+") + controller);
+        }
+    }
+    if (!enabled) {
+        return false;
+    }
+
+    m_cgroupRoot = root;
+    m_cgroupState = CgroupsReady;
+    qDebug() << "WorkerResources: worker cgroups under" << root;
+    emit policyChanged();
+    return true;
+}
+
+void WorkerResources::applyCgroup(int model, qint64 pid, const Policy &policy)
+{
+    // A worker without limits stays where it is unless a cgroup was set up for it before
+    const QString key = m_keys.value(model, QString::number(model));
+    if (!policy.needsCgroup() && (m_cgroupState != CgroupsReady || !QFileInfo::exists(m_cgroupRoot + "/worker-" + key))) {
+        return;
+    }
+    if (!prepareCgroups()) {
+        return;
+    }
+
+    const QString directory = m_cgroupRoot + "/worker-" + key;
+    if (!QDir().mkpath(directory)) {
+        return;
+    }
+    writeFile(directory + "/cpu.max", policy.cpuMaxPercent > 0
+              ? QByteArray::number(policy.cpuMaxPercent * 1000) + " 100000"
+              : QByteArray("max 100000"));
+    writeFile(directory + "/memory.max", policy.memoryMaxMb > 0
+              ? QByteArray::number(qint64(policy.memoryMaxMb) * 1024 * 1024)
+              : QByteArray("max"));
+    writeFile(directory + "/cgroup.procs", QByteArray::number(pid));
+}
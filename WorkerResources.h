@@ -0,0 +1,100 @@
+#ifndef WORKERRESOURCES_H
+#define WORKERRESOURCES_H
+
+#include <QFileSystemWatcher>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+
+#include <functional>
+
+// CPU and memory policy of each model's worker, so workers running together
+// do not starve the dashboard's GUI and render threads. A policy pins the
+// worker to cores (never the reserved ones), sets its nice level or the
+// SCHED_IDLE class, and optionally caps it through cgroup v2 cpu.max and
+// memory.max when the dashboard's cgroup is delegated to it.
+//
+// Scheduling is applied to every thread of the worker, so a policy change
+// takes effect on a running worker at once. Policies come from defaults for a
+// four-core Pi, the JSON file named by NEURODRIVE_RESOURCE_POLICY (reloaded
+// when it changes) and setPolicy(). procfs and the cgroup tree are read below
+// NEURODRIVE_PROC_ROOT and NEURODRIVE_SYSFS_ROOT when set, as for RateGovernor.
+class WorkerResources : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QList<int> reservedCores READ reservedCores WRITE setReservedCores NOTIFY policyChanged)
+    Q_PROPERTY(bool cgroupsAvailable READ cgroupsAvailable NOTIFY policyChanged)
+
+public:
+    struct Policy
+    {
+        QList<int> cores;        // Empty for every core that is not reserved
+        int nice = 10;
+        bool idle = false;       // SCHED_IDLE: only runs on otherwise idle cores
+        int cpuMaxPercent = 0;   // cgroup cpu.max, 100 per core; 0 for no limit
+        int memoryMaxMb = 0;     // cgroup memory.max; 0 for no limit
+
+        bool needsCgroup() const { return cpuMaxPercent > 0 || memoryMaxMb > 0; }
+    };
+
+    explicit WorkerResources(QObject *parent = nullptr);
+
+    // key names the model in the policy file, e.g. "traffic"
+    void setModelKey(int model, const QString &key);
+    // Reads NEURODRIVE_RESOURCE_POLICY over the current policies and watches it
+    void loadConfiguration();
+
+    Policy policy(int model) const { return m_policies.value(model, m_defaultPolicy); }
+    void setPolicy(int model, const Policy &policy);
+
+    QList<int> reservedCores() const { return m_reservedCores; }
+    void setReservedCores(const QList<int> &cores);
+    bool cgroupsAvailable() const { return m_cgroupState == CgroupsReady; }
+
+    // Same fields as the policy file, for QML
+    Q_INVOKABLE QVariantMap policyMap(int model) const;
+    Q_INVOKABLE void setPolicyMap(int model, const QVariantMap &policy);
+
+    // Applies the scheduling part in a QProcess child before exec
+    std::function<void()> childModifier(int model) const;
+
+    // Applies the whole policy to a started worker and keeps it applied on changes
+    void attach(int model, qint64 pid);
+    void detach(int model);
+
+signals:
+    void policyChanged();
+    void policyApplied(int model, qint64 pid, const QString &summary);
+
+private:
+    enum CgroupState {
+        CgroupsUnknown,
+        CgroupsReady,
+        CgroupsUnavailable
+    };
+
+    Policy fromMap(const QVariantMap &map, const Policy &base) const;
+    QList<int> allowedCores(const Policy &policy) const;
+    QString summary(const Policy &policy) const;
+    void apply(int model, qint64 pid);
+    bool prepareCgroups();
+    void applyCgroup(int model, qint64 pid, const Policy &policy);
+
+    QMap<int, Policy> m_policies;
+    Policy m_defaultPolicy;
+    QMap<int, QString> m_keys;
+    QMap<int, qint64> m_attached;
+    QList<int> m_reservedCores;
+
+    QString m_filePath;
+    QFileSystemWatcher m_watcher;
+
+    CgroupState m_cgroupState = CgroupsUnknown;
+    QString m_cgroupRoot;  // The dashboard's own cgroup, parent of the worker cgroups
+    QString m_sysfsRoot = "/sys";
+    QString m_procRoot = "/proc";
+};
+
+#endif // WORKERRESOURCES_H
@@ -0,0 +1,106 @@
+#include "WorkerSupervisor.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+
+WorkerSupervisor::WorkerSupervisor(const QString &directory, QObject *parent)
+    : QObject(parent)
+    , m_directory(directory)
+{
+    if (!QDir().mkpath(m_directory)) {
+        qWarning() << "WorkerSupervisor: could not create" << m_directory;
+    }
+}
+
+void WorkerSupervisor::beginRun()
+{
+    cancelAll();
+    m_workers.clear();
+
+    // Checkpoints of the previous run would make the new one skip ahead
+    const QStringList names = QDir(m_directory).entryList(QStringList() << "model-*.json", QDir::Files);
+    for (const QString &name : names) {
+        QFile::remove(m_directory + "/" + name);
+    }
+}
+
+void WorkerSupervisor::cancelAll()
+{
+    for (Supervised &worker : m_workers) {
+        cancel(worker);
+    }
+}
+
+void WorkerSupervisor::cancel(Supervised &worker)
+{
+    if (worker.timer) {
+        worker.timer->stop();
+        worker.timer->deleteLater();
+        worker.timer = nullptr;
+    }
+}
+
+QString WorkerSupervisor::checkpointPath(int model) const
+{
+    return QString("%1/model-%2.json").arg(m_directory).arg(model);
+}
+
+WorkerSupervisor::Checkpoint WorkerSupervisor::checkpoint(int model) const
+{
+    Checkpoint checkpoint;
+    QFile file(checkpointPath(model));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return checkpoint;
+    }
+    // Workers replace the file as a whole, so it is never seen half written
+    const QJsonObject object = QJsonDocument::fromJson(file.readAll()).object();
+    checkpoint.frame = object.value("frame").toInteger(-1);
+    checkpoint.position = object.value("position").toInteger(-1);
+    checkpoint.savedMs = qint64(object.value("time").toDouble() * 1000.0);
+    checkpoint.state = object.value("state").toObject().toVariantMap();
+    return checkpoint;
+}
+
+void WorkerSupervisor::workerStarted(int model)
+{
+    m_workers[model].running.start();
+}
+
+int WorkerSupervisor::workerFailed(int model)
+{
+    Supervised &worker = m_workers[model];
+    cancel(worker);
+
+    // A failure long after the last one is not part of a crash loop
+    if (worker.running.isValid() && worker.running.elapsed() >= m_policy.stableMs) {
+        worker.restarts = 0;
+    }
+    worker.running.invalidate();
+
+    if (worker.restarts >= m_policy.maxRestarts) {
+        qWarning() << "WorkerSupervisor: model" << model << "failed after" << worker.restarts << "restarts, giving up";
+        emit gaveUp(model, worker.restarts);
+        return -1;
+    }
+
+    const int attempt = ++worker.restarts;
+    qint64 delayMs = m_policy.initialBackoffMs;
+    for (int i = 1; i < attempt && delayMs < m_policy.maxBackoffMs; ++i) {
+        delayMs *= 2;
+    }
+    delayMs = qMin<qint64>(delayMs, m_policy.maxBackoffMs);
+
+    worker.timer = new QTimer(this);
+    worker.timer->setSingleShot(true);
+    connect(worker.timer, &QTimer::timeout, this, [this, model, attempt]() {
+        Supervised &worker = m_workers[model];
+        worker.timer->deleteLater();
+        worker.timer = nullptr;
+        emit restartDue(model, attempt);
+    });
+    worker.timer->start(int(delayMs));
+    return int(delayMs);
+}
@@ -0,0 +1,86 @@
+#ifndef WORKERSUPERVISOR_H
+#define WORKERSUPERVISOR_H
+
+#include <QElapsedTimer>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+
+class QTimer;
+
+// Restarts a model's worker that crashed, was OOM-killed or failed in the
+// middle of a run. The backoff doubles with every restart in a row, from
+// Policy::initialBackoffMs up to Policy::maxBackoffMs, and the supervisor
+// gives up after Policy::maxRestarts. A worker that ran for Policy::stableMs
+// before failing starts over from the initial backoff.
+//
+// Workers checkpoint to the file named by NEURODRIVE_CHECKPOINT (see
+// WorkerCheckpoint in worker_ipc.py): the last committed frame, their input
+// position and the state they carry from frame to frame, such as smoothing
+// and trackers. The file outlives the worker, so a restarted worker resumes
+// from it instead of from frame 0. Each run starts without checkpoints.
+class WorkerSupervisor : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Policy
+    {
+        int maxRestarts = 5;
+        int initialBackoffMs = 500;
+        int maxBackoffMs = 30000;
+        qint64 stableMs = 60000;
+    };
+
+    struct Checkpoint
+    {
+        qint64 frame = -1;       // Last frame the worker committed
+        qint64 position = -1;    // Input frames consumed, for seeking a video
+        qint64 savedMs = 0;      // Wall clock, since the epoch
+        QVariantMap state;
+
+        bool isValid() const { return frame >= 0; }
+    };
+
+    explicit WorkerSupervisor(const QString &directory, QObject *parent = nullptr);
+
+    Policy policy() const { return m_policy; }
+    void setPolicy(const Policy &policy) { m_policy = policy; }
+    QString directory() const { return m_directory; }
+
+    // Forgets the restarts and checkpoints of the previous run
+    void beginRun();
+    // Drops pending restarts, e.g. when the run is stopped
+    void cancelAll();
+
+    QString checkpointPath(int model) const;
+    Checkpoint checkpoint(int model) const;
+    int restarts(int model) const { return m_workers.value(model).restarts; }
+    bool isRestartPending(int model) const { return m_workers.value(model).timer != nullptr; }
+
+    void workerStarted(int model);
+    // Schedules a restart of a worker that failed; returns its delay, or -1
+    // when the worker has used up its restarts
+    int workerFailed(int model);
+
+signals:
+    void restartDue(int model, int attempt);
+    void gaveUp(int model, int restarts);
+
+private:
+    struct Supervised
+    {
+        int restarts = 0;
+        QElapsedTimer running;
+        QTimer *timer = nullptr;
+    };
+
+    void cancel(Supervised &worker);
+
+    QString m_directory;
+    Policy m_policy;
+    QMap<int, Supervised> m_workers;
+};
+
+#endif // WORKERSUPERVISOR_H
@@ -0,0 +1,117 @@
+"""
+Compares the traffic sign detections of two runs of the same clip, as the
+dashboard's detection sidecar recorded them: typically one with the native
+ONNX engine and one with traffic.py as a worker.
+
+    python3 compare_detections.py recordings/detections/run-A.ndds recordings/detections/run-B.ndds
+
+Only frames both runs have detections on are compared, since the two
+backends skip different frames while busy. On those, detections are paired
+by class name and IoU (greedily, best first), and the agreement, the IoU of
+the pairs and their confidence difference are reported.
+"""
+import argparse
+import json
+import struct
+import sys
+from collections import defaultdict
+
+MAGIC = 0x5344444E
+VERSION = 1
+HEADER = struct.Struct('<IIIIqQ32x')
+# Column widths of a block, in the order of DetectionSidecar::Block
+COLUMNS = (('frame', 'I'), ('timeMs', 'I'), ('classId', 'H'), ('confidence', 'H'),
+           ('x1', 'H'), ('y1', 'H'), ('x2', 'H'), ('y2', 'H'), ('model', 'B'), ('kind', 'B'))
+TRAFFIC_MODEL = 1
+DETECTION_ROW = 0
+
+
+def read_run(path, model):
+    """Detections of one model by frame: {frame: [(name, confidence, box)]}"""
+    with open(path, 'rb') as file:
+        data = file.read()
+    magic, version, rows_per_block, _, _, row_count = HEADER.unpack_from(data, 0)
+    if magic != MAGIC or version != VERSION:
+        sys.exit(f'{path}: not a detection sidecar')
+    with open(path[:-5] + '.json') as file:
+        classes = json.load(file)['classes']
+
+    frames = defaultdict(list)
+    block_size = rows_per_block * sum(struct.calcsize(kind) for _, kind in COLUMNS)
+    for first in range(0, row_count, rows_per_block):
+        offset = HEADER.size + (first // rows_per_block) * block_size
+        count = min(rows_per_block, row_count - first)
+        columns = {}
+        for name, kind in COLUMNS:
+            columns[name] = struct.unpack_from(f'<{count}{kind}', data, offset)
+            offset += rows_per_block * struct.calcsize(kind)
+        for i in range(count):
+            if columns['model'][i] != model or columns['kind'][i] != DETECTION_ROW:
+                continue
+            box = (columns['x1'][i], columns['y1'][i], columns['x2'][i], columns['y2'][i])
+            frames[columns['frame'][i]].append(
+                (classes[columns['classId'][i]]['name'], columns['confidence'][i] / 65535.0, box))
+    return frames
+
+
+def iou(a, b):
+    width = min(a[2], b[2]) - max(a[0], b[0])
+    height = min(a[3], b[3]) - max(a[1], b[1])
+    if width <= 0 or height <= 0:
+        return 0.0
+    inter = width * height
+    return inter / ((a[2] - a[0]) * (a[3] - a[1]) + (b[2] - b[0]) * (b[3] - b[1]) - inter)
+
+
+def match(first, second, threshold):
+    """Pairs of (iou, confidence difference), best overlaps first"""
+    candidates = []
+    for i, (name_a, conf_a, box_a) in enumerate(first):
+        for j, (name_b, conf_b, box_b) in enumerate(second):
+            if name_a == name_b:
+                overlap = iou(box_a, box_b)
+                if overlap >= threshold:
+                    candidates.append((overlap, i, j, abs(conf_a - conf_b)))
+    candidates.sort(reverse=True)
+    used_a, used_b, pairs = set(), set(), []
+    for overlap, i, j, confidence in candidates:
+        if i not in used_a and j not in used_b:
+            used_a.add(i)
+            used_b.add(j)
+            pairs.append((overlap, confidence))
+    return pairs
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare the detections of two recorded runs')
+    parser.add_argument('first', help='.ndds file of one run, e.g. the native engine')
+    parser.add_argument('second', help='.ndds file of the other, e.g. traffic.py')
+    parser.add_argument('--model', type=int, default=TRAFFIC_MODEL, help='model id (1 = traffic signs)')
+    parser.add_argument('--iou', type=float, default=0.5, help='IoU for two detections to pair')
+    args = parser.parse_args()
+
+    first = read_run(args.first, args.model)
+    second = read_run(args.second, args.model)
+    common = sorted(set(first) & set(second))
+    if not common:
+        sys.exit('no frame has detections in both runs')
+
+    pairs = []
+    count_a = count_b = 0
+    for frame in common:
+        pairs.extend(match(first[frame], second[frame], args.iou))
+        count_a += len(first[frame])
+        count_b += len(second[frame])
+
+    print(f'frames with detections: {len(first)} and {len(second)}, {len(common)} in both')
+    print(f'detections on those frames: {count_a} and {count_b}, {len(pairs)} paired at IoU >= {args.iou}')
+    print(f'paired: {100.0 * len(pairs) / count_a:.1f}% of the first, {100.0 * len(pairs) / count_b:.1f}% of the second')
+    if pairs:
+        print(f'mean IoU of the pairs: {sum(p[0] for p in pairs) / len(pairs):.3f}, '
+              f'worst {min(p[0] for p in pairs):.3f}')
+        print(f'mean confidence difference: {sum(p[1] for p in pairs) / len(pairs):.3f}, '
+              f'largest {max(p[1] for p in pairs):.3f}')
+
+
+if __name__ == '__main__':
+    main()
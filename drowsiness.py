@@ -6,9 +6,12 @@ from fastapi.responses import HTMLResponse
 from fastapi.middleware.cors import CORSMiddleware
 from fastapi.staticfiles import StaticFiles
 import csv
+from collections import deque
 from datetime import datetime
 import os
 import urllib3
+import time
+from worker_ipc import open_checkpoint, open_frame_ring, open_video, open_event_log, read_frame, resume_input, WorkerEvents
 
 # Disable insecure request warnings
 urllib3.disable_warnings(urllib3.exceptions.InsecureRequestWarning)
@@ -28,14 +31,11 @@ app.add_middleware(
 app.mount('/static', StaticFiles(directory='static'), name='static')
 app.mount('/class_audio', StaticFiles(directory='class_audio'), name='class_audio')
 
-# Set CSV path
+# Set CSV path; only used when run by hand, the dashboard keeps its own event log
 CSV_PATH = 'drowsiness_log.csv'
 
-# Create CSV file if not exists
-if not os.path.exists(CSV_PATH):
-    with open(CSV_PATH, 'w', newline='') as file:
-        writer = csv.writer(file)
-        writer.writerow(['Date', 'Time', 'Status'])
+# /detect results go to the dashboard as state events when launched by it
+detect_events = WorkerEvents()
 
 # Initialize MediaPipe Face Mesh
 mp_face_mesh = mp.solutions.face_mesh
@@ -44,9 +44,16 @@ face_mesh = mp_face_mesh.FaceMesh(static_image_mode=True, max_num_faces=1, refin
 # Eye landmarks indices
 LEFT_EYE_IDX = [33, 160, 158, 133, 153, 144]
 RIGHT_EYE_IDX = [362, 385, 387, 263, 373, 380]
+EYE_IDX = LEFT_EYE_IDX + RIGHT_EYE_IDX
 
 def log_drowsiness_status(drowsy):
+    if open_event_log() is not None:
+        detect_events.state(-1, 'drowsy', 1 if drowsy else 0)
+        return
     try:
+        if not os.path.exists(CSV_PATH):
+            with open(CSV_PATH, 'w', newline='') as file:
+                csv.writer(file).writerow(['Date', 'Time', 'Status'])
         current_time = datetime.now()
         date = current_time.strftime('%Y-%m-%d')
         time_str = current_time.strftime('%H:%M:%S')
@@ -79,18 +86,17 @@ def index():
 @app.get('/last_records')
 def get_last_records():
     try:
+        event_log = open_event_log()
+        if event_log is not None:
+            return event_log.last_records(5)
+
         records = []
         if not os.path.exists(CSV_PATH):
             return []
             
         with open(CSV_PATH, 'r', newline='', encoding='utf-8') as file:
             reader = csv.DictReader(file)
-            all_records = list(reader)
-            
-            if len(all_records) == 0:
-                return []
-            
-            last_records = all_records[-5:] if len(all_records) >= 5 else all_records
+            last_records = deque(reader, maxlen=5)
             
             for record in last_records:
                 records.append({
@@ -136,53 +142,87 @@ def detect_drowsiness(file: UploadFile = File(...)):
     except Exception as e:
         return {"error": str(e)}
 
-if __name__ == '__main__':
+def process_video(video_path='vid.mp4', output_path='output.avi'):
     # --- Automatic video processing for 'vid.mp4' ---
-    video_path = 'vid.mp4'
-    output_path = 'output.avi'  # Changed to AVI format for Qt compatibility on Linux
+    # output.avi uses AVI format for Qt compatibility on Linux
     if os.path.exists(video_path):
         print(f"\nProcessing {video_path} for drowsiness detection...")
-        cap = cv2.VideoCapture(video_path)
-        # Using MJPG codec which is widely compatible with Qt on Linux
-        fourcc = cv2.VideoWriter_fourcc(*'MJPG')
+        events = WorkerEvents()
+        cap = open_video(video_path)
         fps = cap.get(cv2.CAP_PROP_FPS)
         width = int(cap.get(cv2.CAP_PROP_FRAME_WIDTH))
         height = int(cap.get(cv2.CAP_PROP_FRAME_HEIGHT))
-        out = cv2.VideoWriter(output_path, fourcc, fps, (width, height))
-        frame_idx = 0
+        # Stream to the dashboard's shared-memory ring when launched by it
+        ring = open_frame_ring()
+        out = None
+        if ring is None:
+            # Using MJPG codec which is widely compatible with Qt on Linux
+            fourcc = cv2.VideoWriter_fourcc(*'MJPG')
+            out = cv2.VideoWriter(output_path, fourcc, fps, (width, height))
+        # A worker restarted after a crash carries on from its checkpoint.
+        # Frames are numbered by the video's own index throughout, as the
+        # shared decode skips frames the worker has no time for
+        next_idx = 0
+        checkpoint = open_checkpoint()
+        if checkpoint is not None:
+            last, position, _ = checkpoint.load()
+            if last is not None:
+                next_idx = last + 1
+                resume_input(cap, position)
+                print(f"Resuming after frame {last}")
+        events.start(int(cap.get(cv2.CAP_PROP_FRAME_COUNT)), fps, next_idx)
+        streamed = 0
         while cap.isOpened():
-            ret, frame = cap.read()
+            ret, frame, source_idx, time_ms = read_frame(cap)
             if not ret:
                 break
+            frame_start = time.perf_counter()
             rgb_frame = cv2.cvtColor(frame, cv2.COLOR_BGR2RGB)
             results = face_mesh.process(rgb_frame)
-            drowsy = False
+            # Only the 12 eye landmarks are read; the dashboard's
+            # DrowsinessAnalyzer decides on them over time
+            eyes = None
             if results.multi_face_landmarks:
-                for face_landmarks in results.multi_face_landmarks:
-                    landmarks = np.array([(lm.x * frame.shape[1], lm.y * frame.shape[0]) for lm in face_landmarks.landmark])
-                    leftEye = landmarks[LEFT_EYE_IDX]
-                    rightEye = landmarks[RIGHT_EYE_IDX]
-                    leftEAR = eye_aspect_ratio(leftEye)
-                    rightEAR = eye_aspect_ratio(rightEye)
-                    ear = (leftEAR + rightEAR) / 2.0
-                    if ear < EYE_AR_THRESH:
-                        drowsy = True
-            # Optionally, mark drowsy frames visually
-            if drowsy:
-                cv2.putText(frame, 'DROWSY', (50, 50), cv2.FONT_HERSHEY_SIMPLEX, 2, (0,0,255), 4)
-            out.write(frame)
-            frame_idx += 1
+                face = results.multi_face_landmarks[0].landmark
+                h, w = frame.shape[:2]
+                eyes = [(face[i].x * w, face[i].y * h) for i in EYE_IDX]
+            events.eyes(source_idx, time_ms, eyes)
+            # Run by hand, output.avi is still marked from the single frame
+            if ring is None and eyes is not None:
+                landmarks = np.array(eyes)
+                ear = (eye_aspect_ratio(landmarks[:6]) + eye_aspect_ratio(landmarks[6:])) / 2.0
+                if ear < EYE_AR_THRESH:
+                    cv2.putText(frame, 'DROWSY', (50, 50), cv2.FONT_HERSHEY_SIMPLEX, 2, (0,0,255), 4)
+            latency_ms = (time.perf_counter() - frame_start) * 1000.0
+            if ring is not None:
+                ring.publish(frame, source_idx, fps)
+            else:
+                out.write(frame)
+            events.frame(source_idx, latency_ms)
+            next_idx = source_idx + 1
+            streamed += 1
+            if checkpoint is not None:
+                checkpoint.save(source_idx, next_idx)
         cap.release()
-        out.release()
-        print(f"Done. Output saved as {output_path}")
+        events.done(next_idx)
+        if ring is not None:
+            ring.close()
+            print(f"Done. Streamed {streamed} frames to dashboard")
+        else:
+            out.release()
+            print(f"Done. Output saved as {output_path}")
     else:
         print(f"{video_path} not found. Skipping automatic video processing.")
 
+def start_server():
     # --- Start FastAPI server after video processing ---
     import uvicorn
     print("\n=== Starting main server ===")
     print("Server will be available at: https://localhost:8000")
-    print("CSV file path:", os.path.abspath(CSV_PATH))
+    if open_event_log() is not None:
+        print("Event log:", os.environ['NEURODRIVE_EVENT_LOG'])
+    else:
+        print("CSV file path:", os.path.abspath(CSV_PATH))
     print("=== Server starting... ===\n")
     
     ssl_keyfile = 'key.pem'
@@ -201,3 +241,11 @@ if __name__ == '__main__':
         )
     else:
         print("SSL certificates not found. Server not started.")
+
+def run_worker():
+    """Entry point for ProcessManager, both as a fresh process and from the fork server"""
+    process_video()
+    start_server()
+
+if __name__ == '__main__':
+    run_worker()
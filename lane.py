@@ -2,6 +2,7 @@ import cv2
 import numpy as np
 import time
 import os
+from worker_ipc import open_checkpoint, open_frame_ring, open_video, read_frame, resume_input, WorkerEvents
 
 VIDEO_SOURCE = 'Lane_detect.mp4'
 OUTPUT_VIDEO = 'output.avi'  # Using AVI format for Qt compatibility on Linux
@@ -60,7 +61,8 @@ def separate_lines(lines, img_shape):
 
     return fit_line(left_points), fit_line(right_points)
 
-def process_frame(frame):
+def detect_lanes(frame):
+    """Returns the raw Hough segments and the smoothed left/right lane end points"""
     height, width = frame.shape[:2]
     roi_top = height // 2 + 50
 
@@ -82,21 +84,23 @@ def process_frame(frame):
     smoothed_left_fit = fit_average(prev_left_fits, left_fit)
     smoothed_right_fit = fit_average(prev_right_fits, right_fit)
 
+    left_pts = extrapolate_line(smoothed_left_fit, height, roi_top)
+    right_pts = extrapolate_line(smoothed_right_fit, height, roi_top)
+    return lines, left_pts, right_pts
+
+def draw_lanes(frame, lines, left_pts, right_pts):
     line_img = np.zeros_like(frame)
     if DEBUG and lines is not None:
         for line in lines[:30]:
             x1, y1, x2, y2 = line[0]
             cv2.line(line_img, (x1, y1), (x2, y2), (0, 0, 255), 1)
 
-    for fit, color in zip([smoothed_left_fit, smoothed_right_fit], [(0, 255, 0), (0, 255, 0)]):
-        pts = extrapolate_line(fit, height, roi_top)
+    for pts in (left_pts, right_pts):
         if pts:
-            cv2.line(line_img, pts[0], pts[1], color, 5)
+            cv2.line(line_img, pts[0], pts[1], (0, 255, 0), 5)
 
     result = cv2.addWeighted(frame, 0.8, line_img, 1.0, 0)
 
-    left_pts = extrapolate_line(smoothed_left_fit, height, roi_top)
-    right_pts = extrapolate_line(smoothed_right_fit, height, roi_top)
     if left_pts and right_pts:
         polygon = np.array([left_pts[0], left_pts[1], right_pts[1], right_pts[0]], dtype=np.int32)
         overlay = result.copy()
@@ -105,11 +109,16 @@ def process_frame(frame):
 
     return result
 
+def process_frame(frame):
+    return draw_lanes(frame, *detect_lanes(frame))
+
 def main():
-    cap = cv2.VideoCapture(VIDEO_SOURCE)
+    events = WorkerEvents()
+    cap = open_video(VIDEO_SOURCE)
     if not cap.isOpened():
         print("❌ Error: Could not open video source.")
-        return
+        events.error("Could not open video source")
+        return 1
 
     # Get original video info
     original_width = int(cap.get(cv2.CAP_PROP_FRAME_WIDTH))
@@ -117,33 +126,82 @@ def main():
     fps = cap.get(cv2.CAP_PROP_FPS)
     output_size = (600, 600)
 
-    # Output video setup - Using XVID codec which is widely compatible with Qt on Linux
-    fourcc = cv2.VideoWriter_fourcc(*'XVID')
-    out = cv2.VideoWriter(OUTPUT_VIDEO, fourcc, fps, output_size)
-    
-    if not out.isOpened():
-        print("Warning: Could not open video writer with XVID, trying MJPG...")
-        fourcc = cv2.VideoWriter_fourcc(*'MJPG')
+    # Stream to the dashboard's shared-memory ring when launched by it
+    ring = open_frame_ring()
+    out = None
+    if ring is None:
+        # Output video setup - Using XVID codec which is widely compatible with Qt on Linux
+        fourcc = cv2.VideoWriter_fourcc(*'XVID')
         out = cv2.VideoWriter(OUTPUT_VIDEO, fourcc, fps, output_size)
-        
-    if not out.isOpened():
-        print("Error: Could not open video writer")
-        return
 
+        if not out.isOpened():
+            print("Warning: Could not open video writer with XVID, trying MJPG...")
+            fourcc = cv2.VideoWriter_fourcc(*'MJPG')
+            out = cv2.VideoWriter(OUTPUT_VIDEO, fourcc, fps, output_size)
+
+        if not out.isOpened():
+            print("Error: Could not open video writer")
+            events.error("Could not open video writer")
+            return 1
+
+    # A worker restarted after a crash carries on from its checkpoint, with
+    # the lane fits it was smoothing over. Frames are numbered by the video's
+    # own index, as the other models number them
+    next_idx = 0
+    checkpoint = open_checkpoint()
+    if checkpoint is not None:
+        last, position, state = checkpoint.load()
+        if last is not None:
+            next_idx = last + 1
+            prev_left_fits[:] = [np.array(fit) for fit in state.get('left_fits', [])]
+            prev_right_fits[:] = [np.array(fit) for fit in state.get('right_fits', [])]
+            resume_input(cap, position)
+            print(f"Resuming after frame {last}")
+
+    events.start(int(cap.get(cv2.CAP_PROP_FRAME_COUNT)), fps, next_idx)
+    streamed = 0
     while True:
-        ret, frame = cap.read()
+        ret, frame, frame_idx, _ = read_frame(cap)
         if not ret:
             break
 
-        frame = cv2.resize(frame, output_size)
-        processed = process_frame(frame)
-
-        out.write(processed)  # Save frame
+        frame_start = time.perf_counter()
+        if (frame.shape[1], frame.shape[0]) != output_size:
+            frame = cv2.resize(frame, output_size)
+        if ring is not None:
+            # The dashboard draws the lanes itself over the raw frame
+            _, left_pts, right_pts = detect_lanes(frame)
+            latency_ms = (time.perf_counter() - frame_start) * 1000.0
+            for pts in (left_pts, right_pts):
+                if pts:
+                    events.lane(frame_idx, pts)
+            ring.publish(frame, frame_idx, fps)
+        else:
+            processed = process_frame(frame)
+            latency_ms = (time.perf_counter() - frame_start) * 1000.0
+            out.write(processed)  # Save frame
+        events.frame(frame_idx, latency_ms)
+        next_idx = frame_idx + 1
+        streamed += 1
+        if checkpoint is not None:
+            checkpoint.save(frame_idx, next_idx, lambda: {
+                'left_fits': [fit.tolist() for fit in prev_left_fits],
+                'right_fits': [fit.tolist() for fit in prev_right_fits],
+            })
 
     cap.release()
-    out.release()
+    events.done(next_idx)
     cv2.destroyAllWindows()
-    print(f"✅ Output saved to: {os.path.abspath(OUTPUT_VIDEO)}")
+    if ring is not None:
+        ring.close()
+        print(f"✅ Streamed {streamed} frames to dashboard")
+    else:
+        out.release()
+        print(f"✅ Output saved to: {os.path.abspath(OUTPUT_VIDEO)}")
+
+def run_worker():
+    """Entry point for ProcessManager, both as a fresh process and from the fork server"""
+    return main()
 
 if __name__ == "__main__":
     main()
\ No newline at end of file
@@ -1,12 +1,25 @@
+#include <QElapsedTimer>
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
+#include <QQmlEngineExtensionPlugin>
+#include <QQuickWindow>
+#include "FrameTimeMonitor.h"
 #include "NetworkService.h"
+#include "PerfLog.h"
 #include "ProcessManager.h"
+#include "StartupTrace.h"
+
+// Main.qml and the pages live in neurodrive_core's static QML module
+Q_IMPORT_QML_PLUGIN(NeuroDrive_13_5_2025Plugin)
 
 int main(int argc, char *argv[])
 {
     QGuiApplication app(argc, argv);
+    app.setApplicationVersion(NEURODRIVE_VERSION);
+
+    StartupTrace startupTrace;
+    startupTrace.mark("application");
 
     // Create network service instance
     NetworkService networkService;
@@ -21,6 +34,13 @@ int main(int argc, char *argv[])
     
     // Register the process manager to QML
     engine.rootContext()->setContextProperty("processManager", &processManager);
+    engine.rootContext()->setContextProperty("startupTrace", &startupTrace);
+
+    // The interpreter probe, the model preloads and the disk reads of both
+    // services would compete with the login page; they start once it is
+    // interactive
+    QObject::connect(&startupTrace, &StartupTrace::interactive, &processManager, &ProcessManager::startServices);
+    QObject::connect(&startupTrace, &StartupTrace::interactive, &networkService, &NetworkService::startServices);
     
     QObject::connect(
         &engine,
@@ -28,7 +48,27 @@ int main(int argc, char *argv[])
         &app,
         []() { QCoreApplication::exit(-1); },
         Qt::QueuedConnection);
+    // Cold start milestones, and the frame times from then on next to the
+    // worker resource policies
+    QObject::connect(&engine, &QQmlApplicationEngine::objectCreated, &app,
+                     [&app, &startupTrace, &processManager](QObject *object) {
+        auto *window = qobject_cast<QQuickWindow*>(object);
+        if (!window) {
+            return;
+        }
+        startupTrace.watch(window);
+        auto *frameTimes = new FrameTimeMonitor(window, &app);
+        QObject::connect(processManager.resources(), &WorkerResources::policyApplied, frameTimes,
+                         [frameTimes](int, qint64 pid, const QString &summary) {
+            frameTimes->mark(QString("pid %1: %2").arg(pid).arg(summary));
+        });
+    });
+
+    QElapsedTimer loadClock;
+    loadClock.start();
     engine.loadFromModule("NeuroDrive_13_5_2025", "Main");
+    PerfLog::record("qml.load", loadClock.elapsed(), "ms", {{"component", "Main"}});
+    startupTrace.mark("qml_loaded");
 
     return app.exec();
 }
@@ -0,0 +1,20 @@
+import QtQuick
+
+// Holds a popup that is only created the first time it is opened, so the
+// dashboard's popups (and the media player of the timeline) cost nothing
+// before the login page is on screen
+Loader {
+    anchors.fill: parent
+    active: false
+
+    function open() {
+        active = true
+        item.open()
+    }
+
+    function close() {
+        if (item) {
+            item.close()
+        }
+    }
+}
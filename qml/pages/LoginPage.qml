@@ -120,6 +120,10 @@ Page {
         }
     }
     
+    // Open the connection to the verification server while the driver is
+    // still looking at this page, so LOGIN only pays for the request itself
+    Component.onCompleted: networkService.preconnect()
+    
     // Connect to the signal from NetworkService
     Connections {
         target: networkService
@@ -136,6 +140,13 @@ Page {
                 statusMessage.color = "red"
             }
         }
+        
+        function onVerificationRevoked(message) {
+            successTimer.stop()
+            statusMessage.text = message
+            statusMessage.color = "red"
+            statusMessage.visible = true
+        }
     }
     
     Timer {
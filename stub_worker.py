@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""
+Stand-in model worker for timing the dashboard's worker handling without the
+models: start latency (cold and forked), stop latency, log throughput and the
+frame stream. Point a model path in the settings at this file and run the
+dashboard with NEURODRIVE_PERF_LOG set; the measurements land in that file.
+
+Behaviour is set through the environment:
+    STUB_STARTUP_S    seconds of simulated model loading at import (default 2.0);
+                      the fork server pays this once when preloading
+    STUB_FRAMES       frames to produce (default 300)
+    STUB_FPS          frame rate (default 30)
+    STUB_WORK_MS      simulated inference time per frame (default 10)
+    STUB_LOG_LINES    plain log lines per frame, to stdout and stderr (default 20)
+    STUB_IGNORE_TERM  set to 1 to ignore SIGTERM, exercising the kill path
+    STUB_SIZE         frame size when there is no input ring (default 640x360)
+    STUB_CRASH_AT     frame at which the worker SIGKILLs itself, as the OOM
+                      killer would, exercising the supervisor's restart and
+                      the checkpointed resume (default: never)
+    STUB_CRASH_TIMES  how many starts crash at STUB_CRASH_AT; restarts beyond
+                      that run through (default 1)
+
+Frames come from the dashboard's shared decode when it provides one and are
+synthesized otherwise. A running mean of the box position stands in for the
+smoothing state a model carries from frame to frame; it is checkpointed and
+restored with the frame count.
+"""
+import os
+import signal
+import sys
+import time
+
+import cv2
+import numpy as np
+
+from worker_ipc import open_checkpoint, open_frame_ring, open_video, read_frame, resume_input, WorkerEvents
+
+STARTUP_S = float(os.environ.get('STUB_STARTUP_S', '2.0'))
+FRAMES = int(os.environ.get('STUB_FRAMES', '300'))
+FPS = float(os.environ.get('STUB_FPS', '30'))
+WORK_MS = float(os.environ.get('STUB_WORK_MS', '10'))
+LOG_LINES = int(os.environ.get('STUB_LOG_LINES', '20'))
+IGNORE_TERM = os.environ.get('STUB_IGNORE_TERM') == '1'
+WIDTH, HEIGHT = (int(v) for v in os.environ.get('STUB_SIZE', '640x360').split('x'))
+CRASH_AT = int(os.environ.get('STUB_CRASH_AT', '-1'))
+CRASH_TIMES = int(os.environ.get('STUB_CRASH_TIMES', '1'))
+
+# Stands in for importing the framework and loading the weights
+time.sleep(STARTUP_S)
+
+
+def synthetic_frame(index):
+    frame = np.zeros((HEIGHT, WIDTH, 3), dtype=np.uint8)
+    x = (index * 8) % WIDTH
+    frame[:, x:x + 16] = (0, 255, 0)
+    return frame
+
+
+def run_worker():
+    """Entry point for ProcessManager, both as a fresh process and from the fork server"""
+    if IGNORE_TERM:
+        signal.signal(signal.SIGTERM, signal.SIG_IGN)
+
+    events = WorkerEvents()
+    ring = open_frame_ring()
+    cap = open_video('vid.mp4') if os.environ.get('NEURODRIVE_INPUT_SHM') else None
+    frames = FRAMES
+    if cap is not None and cap.isOpened():
+        frames = min(frames, int(cap.get(cv2.CAP_PROP_FRAME_COUNT)) or frames)
+
+    # Set by the dashboard when this start is a restart after a failure
+    restart = int(os.environ.get('NEURODRIVE_RESTART', '0'))
+    checkpoint = open_checkpoint()
+    first = 0
+    smoothed_x = 0.0
+    if checkpoint is not None:
+        last, position, state = checkpoint.load()
+        if last is not None:
+            first = last + 1
+            smoothed_x = float(state.get('smoothed_x', 0.0))
+            resume_input(cap, position)
+            print(f"stub resuming after frame {last} (restart {restart}), smoothed x {smoothed_x:.1f}",
+                  file=sys.stderr)
+
+    events.start(frames, FPS, first)
+    events.class_names({0: 'stub'})
+    noise = 'x' * 120
+    processed = first
+    for index in range(first, frames):
+        if index == CRASH_AT and restart < CRASH_TIMES:
+            print(f"stub killing itself at frame {index}", file=sys.stderr)
+            sys.stderr.flush()
+            os.kill(os.getpid(), signal.SIGKILL)
+
+        frame_start = time.perf_counter()
+        frame = None
+        if cap is not None:
+            ok, frame, _, _ = read_frame(cap)
+            if not ok:
+                break
+        if frame is None:
+            frame = synthetic_frame(index)
+
+        # Output the dashboard has to drain without parsing
+        for line in range(LOG_LINES):
+            print(f"stub frame {index} line {line} {noise}")
+            print(f"stub frame {index} line {line} {noise}", file=sys.stderr)
+
+        time.sleep(WORK_MS / 1000.0)
+        height, width = frame.shape[:2]
+        smoothed_x = 0.9 * smoothed_x + 0.1 * ((index * 8) % width)
+        events.detection(index, 0, 0.9, width // 4, height // 4, width // 2, height // 2)
+        latency_ms = (time.perf_counter() - frame_start) * 1000.0
+        if ring is not None:
+            ring.publish(frame, index, FPS)
+        else:
+            time.sleep(max(0.0, 1.0 / FPS - latency_ms / 1000.0))
+        events.frame(index, latency_ms)
+        processed += 1
+        if checkpoint is not None:
+            checkpoint.save(index, index + 1, lambda: {'smoothed_x': smoothed_x})
+
+    if cap is not None:
+        cap.release()
+    events.done(processed)
+    if ring is not None:
+        ring.close()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(run_worker())
@@ -0,0 +1,45 @@
+#ifndef TESTREGISTRY_H
+#define TESTREGISTRY_H
+
+#include <QList>
+#include <QObject>
+#include <QString>
+
+#include <functional>
+
+// The test classes of neurodrive_tests, each registered by its file with
+// NEURODRIVE_TEST(Class) and run by main() on its own or with the others
+class TestRegistry
+{
+public:
+    struct Test
+    {
+        QString name;
+        std::function<QObject*()> create;
+    };
+
+    static QList<Test> &tests()
+    {
+        static QList<Test> registered;
+        return registered;
+    }
+
+    template <class T>
+    struct Add
+    {
+        explicit Add(const char *name)
+        {
+            tests().append({ QString::fromLatin1(name), []() -> QObject* { return new T; } });
+        }
+    };
+};
+
+#define NEURODRIVE_TEST(Class) static TestRegistry::Add<Class> s_register##Class(#Class);
+
+// Source tree files: the stand-in scripts, the sample capture
+inline QString sourcePath(const QString &relative)
+{
+    return QStringLiteral(NEURODRIVE_SOURCE_DIR "/") + relative;
+}
+
+#endif // TESTREGISTRY_H
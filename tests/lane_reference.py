@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+"""
+Reference lanes for TestLaneDetector: takes runs of consecutive frames from
+a video, resizes them to 600x600 as lane.py does, saves each as a PNG and
+runs lane.py's detect_lanes() on it, starting the smoothing over at each run.
+
+    python3 tests/lane_reference.py Lane_detect.mp4 <output dir> <first frame> [<first frame> ...]
+
+Writes <output dir>/frame-<index>.png and <output dir>/lanes.json, a list of
+{"run", "frame", "image", "left", "right", "segments"} where left and right
+are [[x_bottom, y_bottom], [x_top, y_top]] or null.
+"""
+import json
+import os
+import sys
+
+import cv2
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+import lane  # noqa: E402
+
+RUN_FRAMES = 8
+FRAME_SIZE = (600, 600)
+
+
+def main():
+    if len(sys.argv) < 4:
+        print(__doc__)
+        return 2
+    video, output = sys.argv[1], sys.argv[2]
+    firsts = [int(value) for value in sys.argv[3:]]
+    os.makedirs(output, exist_ok=True)
+
+    cap = cv2.VideoCapture(video)
+    if not cap.isOpened():
+        print(f'cannot open {video}', file=sys.stderr)
+        return 1
+
+    results = []
+    for run, first in enumerate(firsts):
+        lane.prev_left_fits.clear()
+        lane.prev_right_fits.clear()
+        cap.set(cv2.CAP_PROP_POS_FRAMES, first)
+        for index in range(first, first + RUN_FRAMES):
+            ok, frame = cap.read()
+            if not ok:
+                break
+            frame = cv2.resize(frame, FRAME_SIZE)
+            image = os.path.join(output, f'frame-{index}.png')
+            cv2.imwrite(image, frame)
+            lines, left, right = lane.detect_lanes(frame)
+            results.append({
+                'run': run,
+                'frame': index,
+                'image': image,
+                'left': [list(point) for point in left] if left else None,
+                'right': [list(point) for point in right] if right else None,
+                'segments': 0 if lines is None else len(lines),
+            })
+    cap.release()
+
+    with open(os.path.join(output, 'lanes.json'), 'w') as file:
+        json.dump(results, file)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,56 @@
+#include <QGuiApplication>
+#include <QQmlEngineExtensionPlugin>
+#include <QStandardPaths>
+#include <QTest>
+#include "TestRegistry.h"
+
+Q_IMPORT_QML_PLUGIN(NeuroDrive_13_5_2025Plugin)
+
+// neurodrive_tests [class] [QtTest options]: runs the class, or every class
+// when none is named. With several classes an "-o file,format" gets the
+// class name inserted before the extension, so one run does not overwrite
+// the results of the other.
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    // The event log, recordings and caches go to a scratch location
+    QStandardPaths::setTestModeEnabled(true);
+
+    QStringList arguments = app.arguments();
+    QString only;
+    if (arguments.size() > 1 && !arguments.at(1).startsWith('-')) {
+        only = arguments.takeAt(1);
+    }
+
+    int failed = 0;
+    bool found = false;
+    for (const TestRegistry::Test &test : TestRegistry::tests()) {
+        if (!only.isEmpty() && test.name != only) {
+            continue;
+        }
+        found = true;
+        QStringList testArguments = arguments;
+        if (only.isEmpty()) {
+            for (int i = 1; i + 1 < testArguments.size(); ++i) {
+                if (testArguments.at(i) != "-o" || testArguments.at(i + 1).startsWith("-,")) {
+                    continue;
+                }
+                QString &output = testArguments[i + 1];
+                const qsizetype comma = output.contains(',') ? output.lastIndexOf(',') : output.size();
+                const qsizetype dot = output.lastIndexOf('.', comma - 1);
+                output.insert(dot > output.lastIndexOf('/') ? dot : comma, '-' + test.name);
+            }
+        }
+        QObject *object = test.create();
+        failed += QTest::qExec(object, testArguments);
+        delete object;
+    }
+    if (!found) {
+        qWarning() << "neurodrive_tests: no test class" << only;
+        return 1;
+    }
+    return failed;
+}
@@ -0,0 +1,172 @@
+#include <QSignalSpy>
+#include <QTest>
+#include "AlertEngine.h"
+#include "TestRegistry.h"
+
+// AlertEngine's drowsiness timeline on event times set by the test: the
+// first chime, the repeats every repeatMs, the escalation to the alarm
+// escalateAfterMs after the first chime and the clear clearMs after the
+// last drowsy state. No sounds are loaded; alertRaised() tells what would play.
+class TestAlertEngine : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void repeatAndEscalate();
+    void repeatFromLastChime();
+    void confirm();
+    void clear();
+    void disabled();
+
+private:
+    static qint64 at(qint64 ms) { return Start + ms * 1000000; }
+    // Sounds raised so far, as "<sound>@<ms>"
+    static QStringList raised(const QSignalSpy &spy);
+
+    static constexpr qint64 Start = 1000000000000;
+};
+
+QStringList TestAlertEngine::raised(const QSignalSpy &spy)
+{
+    QStringList sounds;
+    for (const QList<QVariant> &alert : spy) {
+        sounds.append(QString("%1@%2").arg(alert.at(0).toString()).arg((alert.at(2).toLongLong() - Start) / 1000000));
+    }
+    return sounds;
+}
+
+void TestAlertEngine::initTestCase()
+{
+    // NEURODRIVE_ALERTS=off would start every engine disabled
+    qunsetenv("NEURODRIVE_ALERTS");
+}
+
+void TestAlertEngine::repeatAndEscalate()
+{
+    AlertEngine engine;
+    QSignalSpy alerts(&engine, &AlertEngine::alertRaised);
+
+    // Drowsy states every 500 ms from 0 to 9 s
+    for (qint64 ms = 0; ms <= 9000; ms += 500) {
+        engine.handleDrowsiness(1.0, at(ms));
+        if (ms == 0) {
+            QCOMPARE(engine.level(), int(AlertEngine::Warning));
+        }
+        if (ms == 5500) {
+            QCOMPARE(engine.level(), int(AlertEngine::Warning));
+        }
+    }
+    QCOMPARE(raised(alerts), QStringList({ "drowsy@0", "drowsy@3000", "alarm@6000" }));
+    QCOMPARE(alerts.at(2).at(1).toInt(), int(AlertEngine::Alarm));
+    QCOMPARE(engine.level(), int(AlertEngine::Alarm));
+
+    // Right at the limits, not a nanosecond before
+    AlertEngine edges;
+    QSignalSpy edgeAlerts(&edges, &AlertEngine::alertRaised);
+    edges.handleDrowsiness(1.0, at(0));
+    edges.handleDrowsiness(1.0, at(3000) - 1);
+    edges.handleDrowsiness(1.0, at(3000));
+    edges.handleDrowsiness(1.0, at(6000) - 1);
+    QCOMPARE(edges.level(), int(AlertEngine::Warning));
+    edges.handleDrowsiness(1.0, at(6000));
+    QCOMPARE(edges.level(), int(AlertEngine::Alarm));
+    QCOMPARE(raised(edgeAlerts), QStringList({ "drowsy@0", "drowsy@3000", "alarm@6000" }));
+}
+
+void TestAlertEngine::repeatFromLastChime()
+{
+    AlertEngine engine;
+    QSignalSpy alerts(&engine, &AlertEngine::alertRaised);
+
+    // Repeats count from the last chime, the escalation from the first
+    engine.handleDrowsiness(1.0, at(0));
+    engine.handleDrowsiness(1.0, at(3500));
+    engine.handleDrowsiness(1.0, at(6000));
+    QCOMPARE(raised(alerts), QStringList({ "drowsy@0", "drowsy@3500", "alarm@6000" }));
+
+    AlertEngine sparse;
+    QSignalSpy sparseAlerts(&sparse, &AlertEngine::alertRaised);
+    sparse.handleDrowsiness(1.0, at(0));
+    sparse.handleDrowsiness(1.0, at(2000));
+    sparse.handleDrowsiness(1.0, at(4100));
+    sparse.handleDrowsiness(1.0, at(5900));
+    QCOMPARE(raised(sparseAlerts), QStringList({ "drowsy@0", "drowsy@4100" }));
+}
+
+void TestAlertEngine::confirm()
+{
+    AlertEngine engine;
+    AlertEngine::Policy policy = engine.policy();
+    policy.confirmMs = 1000;
+    engine.setPolicy(policy);
+    QSignalSpy alerts(&engine, &AlertEngine::alertRaised);
+
+    // A state that is not drowsy before confirmMs starts the count over
+    engine.handleDrowsiness(1.0, at(0));
+    engine.handleDrowsiness(1.0, at(500));
+    engine.handleDrowsiness(0.0, at(700));
+    engine.handleDrowsiness(1.0, at(800));
+    engine.handleDrowsiness(1.0, at(1799));
+    QCOMPARE(engine.level(), int(AlertEngine::Clear));
+    QVERIFY(alerts.isEmpty());
+    engine.handleDrowsiness(1.0, at(1800));
+    QCOMPARE(engine.level(), int(AlertEngine::Warning));
+
+    // The repeat and escalation count from the first chime, not the first state
+    engine.handleDrowsiness(1.0, at(4799));
+    engine.handleDrowsiness(1.0, at(4800));
+    engine.handleDrowsiness(1.0, at(7799));
+    QCOMPARE(engine.level(), int(AlertEngine::Warning));
+    engine.handleDrowsiness(1.0, at(7800));
+    QCOMPARE(raised(alerts), QStringList({ "drowsy@1800", "drowsy@4800", "alarm@7800" }));
+}
+
+void TestAlertEngine::clear()
+{
+    AlertEngine engine;
+    AlertEngine::Policy policy = engine.policy();
+    policy.clearMs = 300;
+    engine.setPolicy(policy);
+    QSignalSpy levels(&engine, &AlertEngine::levelChanged);
+    QSignalSpy alerts(&engine, &AlertEngine::alertRaised);
+
+    engine.handleDrowsiness(1.0, at(0));
+    engine.handleDrowsiness(1.0, at(6000));
+    QCOMPARE(engine.level(), int(AlertEngine::Alarm));
+
+    // States that are not drowsy leave the alarm to the clear timer, which
+    // each drowsy state restarts
+    engine.handleDrowsiness(0.0, at(6100));
+    QCOMPARE(engine.level(), int(AlertEngine::Alarm));
+    QTest::qWait(150);
+    engine.handleDrowsiness(1.0, at(6150));
+    QTest::qWait(200);
+    QCOMPARE(engine.level(), int(AlertEngine::Alarm));
+    QTRY_COMPARE_WITH_TIMEOUT(engine.level(), int(AlertEngine::Clear), 2000);
+    QCOMPARE(levels.size(), 3);
+
+    // A new drowsy state after the clear chimes again, from the start
+    engine.handleDrowsiness(1.0, at(20000));
+    QCOMPARE(engine.level(), int(AlertEngine::Warning));
+    QCOMPARE(raised(alerts), QStringList({ "drowsy@0", "alarm@6000", "drowsy@20000" }));
+}
+
+void TestAlertEngine::disabled()
+{
+    AlertEngine engine;
+    QSignalSpy alerts(&engine, &AlertEngine::alertRaised);
+    engine.handleDrowsiness(1.0, at(0));
+    engine.handleDrowsiness(1.0, at(6000));
+    QCOMPARE(engine.level(), int(AlertEngine::Alarm));
+
+    // Turning alerts off clears the one playing and ignores the next
+    engine.setEnabled(false);
+    QCOMPARE(engine.level(), int(AlertEngine::Clear));
+    engine.handleDrowsiness(1.0, at(7000));
+    QCOMPARE(engine.level(), int(AlertEngine::Clear));
+    QCOMPARE(alerts.size(), 2);
+}
+
+NEURODRIVE_TEST(TestAlertEngine)
+#include "tst_alertengine.moc"
@@ -0,0 +1,223 @@
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QtEndian>
+#include "DetectionSidecar.h"
+#include "TestRegistry.h"
+
+#include <cstddef>
+
+// DetectionSidecar runs written, finished and read back by a second sidecar:
+// the on-disk layout of the header and the block columns, rows across a
+// block boundary, and the rows a reader finds in a run cut short
+class TestDetectionSidecar : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void layout();
+    void roundTrip();
+    void stateOnsets();
+    void crashRecovery();
+
+private:
+    static constexpr int Traffic = 1;
+    static constexpr int Drowsiness = 2;
+    static constexpr qint64 StartMs = 1747000000000;
+    // Row i: class i % 3, box moving with i, confidence from i
+    static Detection detection(int i);
+    static QStringList labels(int i) { return { QStringList({"car", "person", "stop sign"}).at(i % 3) }; }
+    static void appendRows(DetectionSidecar &sidecar, int first, int count);
+    static void compareRow(const DetectionSidecar::Row &row, int i);
+};
+
+Detection TestDetectionSidecar::detection(int i)
+{
+    Detection result;
+    result.classId = i % 3;
+    result.confidence = float(i % 100) / 100.0f;
+    result.box = QRectF(i % 600, i % 400, 40, 30);
+    return result;
+}
+
+void TestDetectionSidecar::appendRows(DetectionSidecar &sidecar, int first, int count)
+{
+    for (int i = first; i < first + count; ++i) {
+        sidecar.appendDetections(Traffic, i, { detection(i) }, labels(i));
+    }
+}
+
+void TestDetectionSidecar::compareRow(const DetectionSidecar::Row &row, int i)
+{
+    const Detection expected = detection(i);
+    QCOMPARE(row.frameIndex, qint64(i));
+    QCOMPARE(row.classId, i % 3);
+    QCOMPARE(row.model, Traffic);
+    QCOMPARE(row.kind, DetectionSidecar::DetectionRow);
+    QVERIFY(qAbs(row.confidence - double(expected.confidence)) <= 1.0 / 65535.0);
+    QCOMPARE(row.box, expected.box);
+}
+
+void TestDetectionSidecar::layout()
+{
+    // The file format: a 64-byte header, then per block one array per column
+    using Header = DetectionSidecar::Header;
+    using Block = DetectionSidecar::Block;
+    constexpr size_t N = DetectionSidecar::RowsPerBlock;
+    QCOMPARE(offsetof(Header, magic), size_t(0));
+    QCOMPARE(offsetof(Header, version), size_t(4));
+    QCOMPARE(offsetof(Header, rowsPerBlock), size_t(8));
+    QCOMPARE(offsetof(Header, startMs), size_t(16));
+    QCOMPARE(offsetof(Header, rowCount), size_t(24));
+    QCOMPARE(offsetof(Block, frame), size_t(0));
+    QCOMPARE(offsetof(Block, timeMs), 4 * N);
+    QCOMPARE(offsetof(Block, classId), 8 * N);
+    QCOMPARE(offsetof(Block, confidence), 10 * N);
+    QCOMPARE(offsetof(Block, x1), 12 * N);
+    QCOMPARE(offsetof(Block, y1), 14 * N);
+    QCOMPARE(offsetof(Block, x2), 16 * N);
+    QCOMPARE(offsetof(Block, y2), 18 * N);
+    QCOMPARE(offsetof(Block, model), 20 * N);
+    QCOMPARE(offsetof(Block, kind), 21 * N);
+
+    // And the bytes a finished run has there
+    QTemporaryDir directory;
+    DetectionSidecar sidecar(directory.path());
+    QVERIFY(sidecar.create(StartMs));
+    appendRows(sidecar, 7, 2);
+    sidecar.finish();
+    QFile file(sidecar.path());
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray bytes = file.readAll();
+    QCOMPARE(qint64(bytes.size()), qint64(sizeof(Header) + sizeof(Block)));
+    const char *data = bytes.constData();
+    QCOMPARE(bytes.left(4), QByteArray("NDDS"));
+    QCOMPARE(qFromLittleEndian<quint32>(data + 4), DetectionSidecar::Version);
+    QCOMPARE(qFromLittleEndian<quint32>(data + 8), DetectionSidecar::RowsPerBlock);
+    QCOMPARE(qFromLittleEndian<qint64>(data + 16), StartMs);
+    QCOMPARE(qFromLittleEndian<quint64>(data + 24), quint64(2));
+    const char *block = data + sizeof(Header);
+    QCOMPARE(qFromLittleEndian<quint32>(block + 4), quint32(8));                  // frame[1]
+    QCOMPARE(qFromLittleEndian<quint16>(block + 8 * N + 2), quint16(8 % 3));      // classId[1]
+    QCOMPARE(qFromLittleEndian<quint16>(block + 12 * N + 2), quint16(8));         // x1[1]
+    QCOMPARE(qFromLittleEndian<quint16>(block + 18 * N + 2), quint16(8 + 30));    // y2[1]
+    QCOMPARE(quint8(block[20 * N + 1]), quint8(Traffic));                         // model[1]
+    QCOMPARE(quint8(block[21 * N + 1]), quint8(DetectionSidecar::DetectionRow));  // kind[1]
+}
+
+void TestDetectionSidecar::roundTrip()
+{
+    const int rows = int(DetectionSidecar::RowsPerBlock) + 100;
+    QTemporaryDir directory;
+    QString path;
+    {
+        DetectionSidecar sidecar(directory.path());
+        QVERIFY(sidecar.create(StartMs));
+        QVERIFY(sidecar.isRecording());
+        appendRows(sidecar, 0, rows);
+        QCOMPARE(sidecar.rowCount(), rows);
+        sidecar.finish();
+        QVERIFY(!sidecar.isRecording());
+        path = sidecar.path();
+    }
+    // Only the blocks in use are kept
+    QCOMPARE(QFileInfo(path).size(), qint64(sizeof(DetectionSidecar::Header) + 2 * sizeof(DetectionSidecar::Block)));
+
+    DetectionSidecar reader(directory.path());
+    QCOMPARE(reader.runs().size(), 1);
+    QVERIFY(reader.open(path));
+    QVERIFY(!reader.isRecording());
+    QCOMPARE(reader.startMs(), StartMs);
+    QCOMPARE(reader.rowCount(), rows);
+    for (int i = 0; i < rows; ++i) {
+        compareRow(reader.row(i), i);
+    }
+    QCOMPARE(reader.row(rows).classId, -1);
+
+    // Classes by first appearance, with their rows
+    const QVariantList classes = reader.classes();
+    QCOMPARE(classes.size(), 3);
+    for (int id = 0; id < 3; ++id) {
+        const QVariantMap info = classes.at(id).toMap();
+        QCOMPARE(info.value("name").toString(), labels(id).first());
+        QCOMPARE(info.value("model").toInt(), Traffic);
+        QCOMPARE(info.value("count").toInt(), rows / 3 + (id < rows % 3 ? 1 : 0));
+    }
+    const QVariantMap first = reader.nextEvent(2, 0);
+    QCOMPARE(first.value("row").toLongLong(), qint64(2));
+    QCOMPARE(first.value("name").toString(), QString("stop sign"));
+    QVERIFY(reader.previousEvent(2, 0).isEmpty());
+    const QVariantMap last = reader.previousEvent(2, reader.row(rows - 1).timeMs + 1);
+    QCOMPARE(last.value("row").toLongLong(), qint64(rows - 1 - (rows - 1 - 2) % 3));
+    QCOMPARE(reader.events(-1, 4).size(), 4);
+}
+
+void TestDetectionSidecar::stateOnsets()
+{
+    QTemporaryDir directory;
+    DetectionSidecar sidecar(directory.path());
+    QVERIFY(sidecar.create(StartMs));
+    // A row at each onset only, and only for frames of the run
+    sidecar.appendState(Drowsiness, 10, "drowsy", 1.0);
+    sidecar.appendState(Drowsiness, 11, "drowsy", 1.0);
+    sidecar.appendState(Drowsiness, 12, "drowsy", 0.0);
+    sidecar.appendState(Drowsiness, 20, "drowsy", 1.0);
+    sidecar.appendState(Drowsiness, 21, "long_closure", 1.0);
+    // Not from a frame of the run, e.g. a /detect result
+    sidecar.appendState(Drowsiness, -1, "eyes_closed", 1.0);
+    sidecar.appendDetections(Traffic, -1, { detection(0) }, labels(0));
+    sidecar.finish();
+
+    DetectionSidecar reader(directory.path());
+    QVERIFY(reader.open(sidecar.path()));
+    QCOMPARE(reader.rowCount(), 3);
+    const qint64 frames[3] = { 10, 20, 21 };
+    for (int i = 0; i < 3; ++i) {
+        const DetectionSidecar::Row row = reader.row(i);
+        QCOMPARE(row.frameIndex, frames[i]);
+        QCOMPARE(row.kind, DetectionSidecar::StateRow);
+        QCOMPARE(row.model, Drowsiness);
+        QCOMPARE(row.box, QRectF());
+    }
+    QCOMPARE(reader.row(0).classId, reader.row(1).classId);
+    QCOMPARE(reader.classes().size(), 2);
+}
+
+void TestDetectionSidecar::crashRecovery()
+{
+    QTemporaryDir directory;
+    // The live file as a crash would leave it: mapped at its full capacity,
+    // with the count of the rows whose columns were written
+    DetectionSidecar sidecar(directory.path());
+    QVERIFY(sidecar.create(StartMs));
+    const int rows = int(DetectionSidecar::RowsPerBlock) + 10;
+    appendRows(sidecar, 0, rows);
+    const QString crashed = directory.filePath("run-crashed.ndds");
+    QVERIFY(QFile::copy(sidecar.path(), crashed));
+    QVERIFY(QFile::copy(sidecar.path().chopped(5) + ".json", directory.filePath("run-crashed.json")));
+
+    DetectionSidecar reader(directory.path());
+    QVERIFY(reader.open(crashed));
+    QCOMPARE(reader.rowCount(), rows);
+    compareRow(reader.row(rows - 1), rows - 1);
+    QCOMPARE(reader.classes().size(), 3);
+    // Without a finished duration, the run lasts until its last row
+    QCOMPARE(reader.durationMs(), reader.row(rows - 1).timeMs);
+
+    // Blocks cut off the end of the file are not read past
+    reader.open(sidecar.path());  // Lets go of the copy's mapping
+    QFile file(crashed);
+    QVERIFY(file.resize(qint64(sizeof(DetectionSidecar::Header) + sizeof(DetectionSidecar::Block))));
+    QVERIFY(reader.open(crashed));
+    QCOMPARE(reader.rowCount(), int(DetectionSidecar::RowsPerBlock));
+    compareRow(reader.row(reader.rowCount() - 1), reader.rowCount() - 1);
+
+    // Not a sidecar at all
+    QVERIFY(file.resize(16));
+    QVERIFY(!reader.open(crashed));
+    QCOMPARE(reader.rowCount(), 0);
+}
+
+NEURODRIVE_TEST(TestDetectionSidecar)
+#include "tst_detectionsidecar.moc"
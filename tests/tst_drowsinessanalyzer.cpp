@@ -0,0 +1,260 @@
+#include <QFile>
+#include <QTest>
+#include <algorithm>
+#include <cmath>
+#include "DrowsinessAnalyzer.h"
+#include "TestRegistry.h"
+
+// DrowsinessAnalyzer against the traces in tests/data/drowsiness: a blink
+// and a long closure on either side of their 500 ms and 1000 ms limits,
+// PERCLOS as its 60 s window fills and slides, and the per-driver threshold
+class TestDrowsinessAnalyzer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void blinkAndLongClosureLimits();
+    void perclosWindow();
+    void calibration();
+    void implausibleCalibration();
+    void frameCost();
+
+private:
+    struct Frame
+    {
+        qint64 timeMs = 0;
+        bool face = false;
+        float points[DrowsinessAnalyzer::PointCount * 2] = {};
+    };
+
+    // Rows of time_ms then either one EAR or the 24 landmark coordinates;
+    // a row with the time alone has no face
+    static QList<Frame> loadTrace(const QString &name);
+    // Both eyes 30 px wide with lids apart for ear
+    static void eyesWithEar(float ear, float *points);
+};
+
+QList<TestDrowsinessAnalyzer::Frame> TestDrowsinessAnalyzer::loadTrace(const QString &name)
+{
+    QList<Frame> frames;
+    QFile file(sourcePath("tests/data/drowsiness/" + name));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "TestDrowsinessAnalyzer: cannot open" << file.fileName();
+        return frames;
+    }
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#') || line.startsWith("time_ms")) {
+            continue;
+        }
+        const QList<QByteArray> fields = line.split(',');
+        Frame frame;
+        frame.timeMs = fields.at(0).toLongLong();
+        if (fields.size() == 2 && !fields.at(1).isEmpty()) {
+            frame.face = true;
+            eyesWithEar(fields.at(1).toFloat(), frame.points);
+        } else if (fields.size() == 1 + DrowsinessAnalyzer::PointCount * 2) {
+            frame.face = true;
+            for (int i = 0; i < DrowsinessAnalyzer::PointCount * 2; ++i) {
+                frame.points[i] = fields.at(i + 1).toFloat();
+            }
+        }
+        frames.append(frame);
+    }
+    return frames;
+}
+
+void TestDrowsinessAnalyzer::eyesWithEar(float ear, float *points)
+{
+    // Corners 30 px apart, lid pairs 2h apart: EAR = 4h / (2 * 30)
+    const float h = ear * 15.0f;
+    for (int eye = 0; eye < 2; ++eye) {
+        const float x = eye == 0 ? 400.0f : 520.0f;
+        const float y = 300.0f;
+        const float eyePoints[12] = { x - 15.0f, y, x - 5.0f, y - h, x + 5.0f, y - h,
+                                      x + 15.0f, y, x + 5.0f, y + h, x - 5.0f, y + h };
+        std::copy(eyePoints, eyePoints + 12, points + eye * 12);
+    }
+}
+
+void TestDrowsinessAnalyzer::blinkAndLongClosureLimits()
+{
+    const QList<Frame> trace = loadTrace("blinks.csv");
+    QVERIFY(!trace.isEmpty());
+
+    // Each closure, by the time of its first closed frame: the longest
+    // closureMs it reached and when longClosure was first set
+    struct Closure
+    {
+        qint64 startMs = -1;
+        int maxClosureMs = 0;
+        qint64 longSinceMs = -1;
+    };
+    QList<Closure> closures;
+    DrowsinessAnalyzer analyzer;
+    bool closed = false;
+    for (const Frame &frame : trace) {
+        const DrowsinessAnalyzer::Result &result = analyzer.update(frame.timeMs, frame.points);
+        if (result.closed && !closed) {
+            closures.append({ frame.timeMs });
+        }
+        closed = result.closed;
+        if (result.closed) {
+            Closure &closure = closures.last();
+            closure.maxClosureMs = std::max(closure.maxClosureMs, result.closureMs);
+            if (result.longClosure && closure.longSinceMs < 0) {
+                closure.longSinceMs = frame.timeMs;
+            }
+            // The drowsy state follows a long closure at once
+            QCOMPARE(result.drowsy, result.longClosure);
+        } else {
+            QVERIFY(!result.longClosure);
+        }
+    }
+
+    // Closed to reopened: 480, 500, 520, 1000, 1020 and 1500 ms
+    QCOMPARE(closures.size(), 6);
+    const int expectedMax[6] = { 460, 480, 500, 980, 1000, 1480 };
+    for (int i = 0; i < closures.size(); ++i) {
+        QCOMPARE(closures.at(i).maxClosureMs, expectedMax[i]);
+    }
+    // Long from the frame 1000 ms after closing, not one before
+    QCOMPARE(closures.at(3).longSinceMs, qint64(-1));
+    QCOMPARE(closures.at(4).longSinceMs, closures.at(4).startMs + 1000);
+    QCOMPARE(closures.at(5).longSinceMs, closures.at(5).startMs + 1000);
+    for (int i = 0; i < 3; ++i) {
+        QCOMPARE(closures.at(i).longSinceMs, qint64(-1));
+    }
+
+    // Blinks are the closures up to 500 ms: the first two. The whole trace is
+    // inside the window, so the rate is over the time since its first frame.
+    const DrowsinessAnalyzer::Result &result = analyzer.result();
+    const double spanMs = double(trace.last().timeMs - trace.first().timeMs);
+    QCOMPARE(qRound(result.blinksPerMinute * spanMs / 60000.0), 2);
+    QVERIFY(!result.drowsy);
+}
+
+void TestDrowsinessAnalyzer::perclosWindow()
+{
+    const QList<Frame> trace = loadTrace("perclos.csv");
+    QVERIFY(!trace.isEmpty());
+    const DrowsinessAnalyzer::Policy policy;
+
+    DrowsinessAnalyzer analyzer;
+    struct Sample
+    {
+        qint64 timeMs;
+        int durationMs;
+        bool closed;
+    };
+    QList<Sample> samples;
+    bool wasDrowsy = false;
+    bool becameDrowsy = false;
+    bool recovered = false;
+    for (const Frame &frame : trace) {
+        const DrowsinessAnalyzer::Result &result = analyzer.update(frame.timeMs, frame.points);
+        const int durationMs = samples.isEmpty()
+                ? 0 : int(std::min<qint64>(frame.timeMs - samples.last().timeMs, policy.maxGapMs));
+        samples.append({ frame.timeMs, durationMs, result.closed });
+
+        // PERCLOS over the frames of the last 60 s, by their durations
+        qint64 windowMs = 0;
+        qint64 closedMs = 0;
+        for (const Sample &sample : std::as_const(samples)) {
+            if (sample.timeMs >= frame.timeMs - policy.windowMs) {
+                windowMs += sample.durationMs;
+                closedMs += sample.closed ? sample.durationMs : 0;
+            }
+        }
+        if (windowMs < policy.minWindowMs) {
+            QCOMPARE(result.perclos, 0.0f);
+            QVERIFY(!result.drowsy);
+            continue;
+        }
+        const float expected = float(closedMs) / float(windowMs);
+        QVERIFY2(std::abs(result.perclos - expected) < 1e-4f,
+                 qPrintable(QString("at %1 ms: %2, expected %3").arg(frame.timeMs).arg(result.perclos).arg(expected)));
+
+        // Drowsy from 15% until below 10%
+        if (result.perclos >= policy.perclosDrowsy) {
+            QVERIFY(result.drowsy);
+            becameDrowsy = true;
+        } else if (result.perclos < policy.perclosAwake) {
+            QVERIFY(!result.drowsy);
+            recovered = recovered || becameDrowsy;
+        } else {
+            QCOMPARE(result.drowsy, wasDrowsy);
+        }
+        wasDrowsy = result.drowsy;
+    }
+    QVERIFY(becameDrowsy);
+    // The closed 30 s leave the window by 100 s
+    QVERIFY(recovered);
+    QVERIFY(!analyzer.result().drowsy);
+}
+
+void TestDrowsinessAnalyzer::calibration()
+{
+    const QList<Frame> trace = loadTrace("calibration.csv");
+    QVERIFY(!trace.isEmpty());
+    const DrowsinessAnalyzer::Policy policy;
+
+    DrowsinessAnalyzer analyzer;
+    qint64 calibratedAtMs = -1;
+    for (const Frame &frame : trace) {
+        const DrowsinessAnalyzer::Result &result = analyzer.update(frame.timeMs, frame.face ? frame.points : nullptr);
+        QCOMPARE(result.face, frame.face);
+        if (result.calibrated && calibratedAtMs < 0) {
+            calibratedAtMs = frame.timeMs;
+        }
+        if (!frame.face) {
+            continue;
+        }
+        // The 0.25 dips are open against the default 0.23 and closed against
+        // 75% of the driver's 0.36
+        const bool dip = result.ear < 0.3f;
+        if (!result.calibrated) {
+            QCOMPARE(result.threshold, policy.defaultThreshold);
+            QVERIFY(!result.closed);
+        } else if (dip) {
+            QVERIFY(result.closed);
+        }
+    }
+
+    // 20 s of frames with a face: 4.9 s before the 5 s without one, then
+    // from 10 s on
+    QCOMPARE(calibratedAtMs, qint64(25000));
+    const DrowsinessAnalyzer::Result &result = analyzer.result();
+    // One histogram bin is 0.5 / 128
+    QVERIFY(std::abs(result.openEar - 0.36f) <= 0.5f / 128.0f);
+    QVERIFY(std::abs(result.threshold - result.openEar * policy.thresholdRatio) < 1e-6f);
+}
+
+void TestDrowsinessAnalyzer::implausibleCalibration()
+{
+    // An open EAR no driver has keeps the default threshold
+    DrowsinessAnalyzer analyzer;
+    float points[DrowsinessAnalyzer::PointCount * 2];
+    eyesWithEar(0.48f, points);
+    for (qint64 timeMs = 0; timeMs <= 21000; timeMs += 100) {
+        analyzer.update(timeMs, points);
+    }
+    QVERIFY(analyzer.result().calibrated);
+    QCOMPARE(analyzer.result().threshold, DrowsinessAnalyzer::Policy().defaultThreshold);
+}
+
+void TestDrowsinessAnalyzer::frameCost()
+{
+    const QList<Frame> trace = loadTrace("perclos.csv");
+    QVERIFY(!trace.isEmpty());
+    DrowsinessAnalyzer analyzer;
+    QBENCHMARK {
+        analyzer.reset();
+        for (const Frame &frame : trace) {
+            analyzer.update(frame.timeMs, frame.points);
+        }
+    }
+}
+
+NEURODRIVE_TEST(TestDrowsinessAnalyzer)
+#include "tst_drowsinessanalyzer.moc"
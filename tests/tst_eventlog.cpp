@@ -0,0 +1,222 @@
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QTemporaryDir>
+#include <QTest>
+#include "EventLog.h"
+#include "TestRegistry.h"
+
+#include <cstddef>
+#include <cstring>
+
+// EventLog over segment files written by the test: counts recovered from the
+// record checksums, rotation at RecordsPerSegment, the oldest segments pruned
+// beyond MaxSegments, and time lookups that cross segment boundaries
+class TestEventLog : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void recoverCount();
+    void rotate();
+    void prune();
+    void lookupAcrossSegments();
+
+private:
+    // A segment file as EventLog leaves it, holding count records timestamped
+    // firstMs, firstMs + stepMs, ...; the header claims headerCount of them
+    static QString writeSegment(const QTemporaryDir &directory, quint64 firstSequence, quint32 count,
+                                qint64 firstMs, qint64 stepMs = 10, qint64 headerCount = -1);
+    static QString segmentName(quint64 firstSequence);
+};
+
+namespace {
+
+// FNV-1a over the fields before the checksum, as in worker_ipc.py
+quint32 recordChecksum(const EventLog::Record &record)
+{
+    const uchar *bytes = reinterpret_cast<const uchar*>(&record);
+    quint32 hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(EventLog::Record, checksum); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+const qint64 SegmentSize = sizeof(EventLog::SegmentHeader)
+                           + qint64(EventLog::RecordsPerSegment) * sizeof(EventLog::Record);
+
+} // namespace
+
+QString TestEventLog::segmentName(quint64 firstSequence)
+{
+    return QString("segment-%1.ndev").arg(firstSequence, 20, 10, QChar('0'));
+}
+
+QString TestEventLog::writeSegment(const QTemporaryDir &directory, quint64 firstSequence, quint32 count,
+                                   qint64 firstMs, qint64 stepMs, qint64 headerCount)
+{
+    EventLog::SegmentHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = EventLog::Magic;
+    header.version = EventLog::Version;
+    header.recordSize = sizeof(EventLog::Record);
+    header.capacity = EventLog::RecordsPerSegment;
+    header.firstSequence = firstSequence;
+    header.count = quint32(headerCount >= 0 ? headerCount : count);
+
+    QByteArray records(int(count * sizeof(EventLog::Record)), '\0');
+    EventLog::Record *record = reinterpret_cast<EventLog::Record*>(records.data());
+    for (quint32 i = 0; i < count; ++i, ++record) {
+        record->timestampMs = firstMs + qint64(i) * stepMs;
+        record->frameIndex = qint64(firstSequence + i);
+        record->value = 1.0;
+        record->type = EventLog::DrowsinessState;
+        record->model = 0;
+        record->checksum = recordChecksum(*record);
+    }
+
+    // The records past count stay zero, and on disk sparse
+    const QString path = directory.filePath(segmentName(firstSequence));
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(records);
+        file.resize(SegmentSize);
+    }
+    return path;
+}
+
+void TestEventLog::recoverCount()
+{
+    QTemporaryDir directory;
+    // Records that reached the disk ahead of the header's count are kept
+    writeSegment(directory, 0, 12, 1000, 10, 10);
+    {
+        QTest::ignoreMessage(QtWarningMsg, QRegularExpression("recovered .* with 12 records, header said 10"));
+        EventLog log(directory.path());
+        log.open();
+        QCOMPARE(log.count(), 12);
+        QCOMPARE(log.record(11).timestampMs, qint64(1110));
+    }
+
+    // A count ahead of records that never made it, or were torn, is cut back
+    const QString path = writeSegment(directory, 0, 12, 1000, 10, 14);
+    {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.seek(sizeof(EventLog::SegmentHeader) + 11 * sizeof(EventLog::Record)));
+        file.write("torn");
+    }
+    {
+        QTest::ignoreMessage(QtWarningMsg, QRegularExpression("recovered .* with 11 records, header said 14"));
+        EventLog log(directory.path());
+        log.open();
+        QCOMPARE(log.count(), 11);
+        QCOMPARE(log.record(10).frameIndex, qint64(10));
+
+        // The torn slot is appended over
+        QVERIFY(log.append(EventLog::LongClosure, 0, 1200.0, 99));
+        QCOMPARE(log.count(), 12);
+        QCOMPARE(log.record(11).frameIndex, qint64(99));
+    }
+
+    // The corrected count is written back, so the next open agrees
+    EventLog reopened(directory.path());
+    reopened.open();
+    QCOMPARE(reopened.count(), 12);
+}
+
+void TestEventLog::rotate()
+{
+    QTemporaryDir directory;
+    writeSegment(directory, 0, EventLog::RecordsPerSegment - 1, 1000, 1);
+
+    EventLog log(directory.path());
+    log.open();
+    QCOMPARE(log.count(), int(EventLog::RecordsPerSegment - 1));
+
+    // The last free record fills the segment, the next starts a new one
+    const QString next = directory.filePath(segmentName(EventLog::RecordsPerSegment));
+    QVERIFY(log.append(EventLog::DrowsinessState, 0, 1.0, 1));
+    QVERIFY(!QFile::exists(next));
+    QVERIFY(log.append(EventLog::DrowsinessState, 0, 0.0, 2));
+    QVERIFY(QFile::exists(next));
+    QCOMPARE(QFileInfo(next).size(), SegmentSize);
+    QCOMPARE(log.count(), int(EventLog::RecordsPerSegment + 1));
+    QCOMPARE(log.record(EventLog::RecordsPerSegment - 1).frameIndex, qint64(1));
+    QCOMPARE(log.record(EventLog::RecordsPerSegment).frameIndex, qint64(2));
+
+    // A full segment left by the previous run is not appended to either
+    QVERIFY(QFile::remove(next));
+    EventLog full(directory.path());
+    full.open();
+    QVERIFY(QFile::exists(next));
+    QCOMPARE(full.count(), int(EventLog::RecordsPerSegment));
+}
+
+void TestEventLog::prune()
+{
+    QTemporaryDir directory;
+    const int segments = EventLog::MaxSegments + 2;
+    const quint32 perSegment = 4;
+    for (int i = 0; i < segments; ++i) {
+        writeSegment(directory, quint64(i) * EventLog::RecordsPerSegment, perSegment, 1000 + i * 100);
+    }
+
+    EventLog log(directory.path());
+    log.open();
+    QCOMPARE(log.count(), int(EventLog::MaxSegments * perSegment));
+    QCOMPARE(QDir(directory.path()).entryList({ "segment-*.ndev" }, QDir::Files).size(), int(EventLog::MaxSegments));
+    QVERIFY(!QFile::exists(directory.filePath(segmentName(0))));
+    QVERIFY(!QFile::exists(directory.filePath(segmentName(EventLog::RecordsPerSegment))));
+
+    // What is left starts with the oldest retained segment
+    QCOMPARE(log.record(0).timestampMs, qint64(1200));
+    QCOMPARE(log.record(0).frameIndex, qint64(2 * EventLog::RecordsPerSegment));
+    QCOMPARE(log.lowerBound(0), qint64(0));
+    QCOMPARE(log.lowerBound(1150), qint64(0));
+}
+
+void TestEventLog::lookupAcrossSegments()
+{
+    QTemporaryDir directory;
+    // Three segments of 10 records at 10 ms steps, with gaps between them:
+    // 1000..1090, 2000..2090, 3000..3090
+    for (int i = 0; i < 3; ++i) {
+        writeSegment(directory, quint64(i) * EventLog::RecordsPerSegment, 10, 1000 * (i + 1));
+    }
+    EventLog log(directory.path());
+    log.open();
+    QCOMPARE(log.count(), 30);
+
+    QCOMPARE(log.lowerBound(0), qint64(0));
+    QCOMPARE(log.lowerBound(1000), qint64(0));
+    QCOMPARE(log.lowerBound(1005), qint64(1));
+    QCOMPARE(log.lowerBound(1090), qint64(9));
+    // Past the last record of a segment is the first of the next one
+    QCOMPARE(log.lowerBound(1091), qint64(10));
+    QCOMPARE(log.lowerBound(2000), qint64(10));
+    QCOMPARE(log.lowerBound(2500), qint64(20));
+    QCOMPARE(log.lowerBound(3090), qint64(29));
+    QCOMPARE(log.lowerBound(3091), qint64(30));
+
+    // Half-open ranges, across the boundaries, cut at the limit
+    QList<EventLog::Record> records = log.range(1050, 3020, 1000);
+    QCOMPARE(records.size(), 5 + 10 + 2);
+    QCOMPARE(records.first().timestampMs, qint64(1050));
+    QCOMPARE(records.last().timestampMs, qint64(3010));
+    records = log.range(1050, 3020, 7);
+    QCOMPARE(records.size(), 7);
+    QCOMPARE(records.last().timestampMs, qint64(2010));
+    QVERIFY(log.range(1091, 2000, 1000).isEmpty());
+    QCOMPARE(log.range(0, 1000000, 1000).size(), 30);
+
+    // Newest first as a model
+    QCOMPARE(log.data(log.index(0), EventLog::FrameIndexRole).toLongLong(),
+             qint64(2 * EventLog::RecordsPerSegment + 9));
+}
+
+NEURODRIVE_TEST(TestEventLog)
+#include "tst_eventlog.moc"
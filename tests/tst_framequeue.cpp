@@ -0,0 +1,254 @@
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSemaphore>
+#include <QTest>
+#include <QThread>
+#include "FramePool.h"
+#include "FrameQueue.h"
+#include "TestRegistry.h"
+
+// FrameQueue in front of a stage held busy by the test: what each
+// back-pressure policy drops and counts when the stage falls behind, and
+// FramePool running out of budget while a stage holds its frames
+class TestFrameQueue : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void dropNewest();
+    void dropOldest();
+    void block();
+    void poolExhaustion();
+    void droppedFrameReturnsToPool();
+};
+
+namespace {
+
+// A stage on a thread of its own that holds each item until let go
+struct Stage
+{
+    QThread thread;
+    QObject context;
+    QSemaphore entered;
+    QSemaphore proceed;
+    QMutex mutex;
+    QList<int> consumed;
+
+    Stage()
+    {
+        context.moveToThread(&thread);
+        thread.start();
+    }
+
+    ~Stage()
+    {
+        thread.quit();
+        thread.wait();
+    }
+
+    void consume(int item)
+    {
+        {
+            QMutexLocker locker(&mutex);
+            consumed.append(item);
+        }
+        entered.release();
+        proceed.acquire();
+    }
+
+    QList<int> items()
+    {
+        QMutexLocker locker(&mutex);
+        return consumed;
+    }
+};
+
+FrameQueueBase::Policy policy(FrameQueueBase::BackPressure backPressure, int depth, int blockTimeoutMs = 200)
+{
+    FrameQueueBase::Policy policy;
+    policy.backPressure = backPressure;
+    policy.depth = depth;
+    policy.blockTimeoutMs = blockTimeoutMs;
+    return policy;
+}
+
+} // namespace
+
+void TestFrameQueue::dropNewest()
+{
+    Stage stage;
+    FrameQueue<int> queue("test", &stage.context, [&stage](int &item) { stage.consume(item); });
+    queue.setPolicy(policy(FrameQueueBase::DropNewest, 2));
+
+    // One frame being processed and one waiting fill a depth of 2
+    QVERIFY(queue.push(1));
+    QVERIFY(stage.entered.tryAcquire(1, 5000));
+    QVERIFY(queue.push(2));
+    QVERIFY(!queue.push(3));
+    QVERIFY(!queue.push(4));
+
+    FrameQueueBase::Stats stats = queue.stats();
+    QCOMPARE(stats.queued, 2);
+    QCOMPARE(stats.pushed, quint64(4));
+    QCOMPARE(stats.droppedNewest, quint64(2));
+    QCOMPARE(stats.droppedOldest, quint64(0));
+
+    stage.proceed.release(2);
+    QTRY_VERIFY(queue.isIdle());
+    QCOMPARE(stage.items(), QList<int>({ 1, 2 }));
+    QCOMPARE(queue.stats().queued, 0);
+}
+
+void TestFrameQueue::dropOldest()
+{
+    Stage stage;
+    FrameQueue<int> queue("test", &stage.context, [&stage](int &item) { stage.consume(item); });
+    queue.setPolicy(policy(FrameQueueBase::DropOldest, 2));
+
+    // The frame waiting is replaced by each newer one; the one being
+    // processed is not taken back
+    QVERIFY(queue.push(1));
+    QVERIFY(stage.entered.tryAcquire(1, 5000));
+    QVERIFY(queue.push(2));
+    QVERIFY(queue.push(3));
+    QVERIFY(queue.push(4));
+
+    FrameQueueBase::Stats stats = queue.stats();
+    QCOMPARE(stats.queued, 2);
+    QCOMPARE(stats.pushed, quint64(4));
+    QCOMPARE(stats.droppedOldest, quint64(2));
+    QCOMPARE(stats.droppedNewest, quint64(0));
+
+    stage.proceed.release(2);
+    QTRY_VERIFY(queue.isIdle());
+    QCOMPARE(stage.items(), QList<int>({ 1, 4 }));
+
+    // At depth 1 there is nothing waiting to drop, so the newest goes
+    queue.setPolicy(policy(FrameQueueBase::DropOldest, 1));
+    QVERIFY(queue.push(5));
+    QVERIFY(stage.entered.tryAcquire(2, 5000));
+    QVERIFY(!queue.push(6));
+    QCOMPARE(queue.stats().droppedNewest, quint64(1));
+    stage.proceed.release();
+    QTRY_VERIFY(queue.isIdle());
+}
+
+void TestFrameQueue::block()
+{
+    Stage stage;
+    FrameQueue<int> queue("test", &stage.context, [&stage](int &item) { stage.consume(item); });
+    queue.setPolicy(policy(FrameQueueBase::Block, 1, 100));
+
+    // A stage that stays busy past the timeout costs the incoming frame
+    QVERIFY(queue.push(1));
+    QVERIFY(stage.entered.tryAcquire(1, 5000));
+    QElapsedTimer clock;
+    clock.start();
+    QVERIFY(!queue.push(2));
+    QVERIFY(clock.elapsed() >= 90);
+
+    FrameQueueBase::Stats stats = queue.stats();
+    QCOMPARE(stats.blockTimeouts, quint64(1));
+    QCOMPARE(stats.droppedNewest, quint64(1));
+    QVERIFY(stats.blockedMs >= 90);
+
+    // One that frees up in time takes it, after holding up the producer
+    queue.setPolicy(policy(FrameQueueBase::Block, 1, 5000));
+    QThread *releaser = QThread::create([&stage]() {
+        QThread::msleep(200);
+        stage.proceed.release();
+    });
+    clock.restart();
+    releaser->start();
+    QVERIFY(queue.push(3));
+    QVERIFY(clock.elapsed() >= 100);
+    QVERIFY(clock.elapsed() < 5000);
+    releaser->wait();
+    delete releaser;
+
+    const quint64 blockedMs = stats.blockedMs;
+    stats = queue.stats();
+    QCOMPARE(stats.blockTimeouts, quint64(1));
+    QCOMPARE(stats.droppedNewest, quint64(1));
+    QVERIFY(stats.blockedMs > blockedMs);
+
+    QVERIFY(stage.entered.tryAcquire(1, 5000));
+    stage.proceed.release();
+    QTRY_VERIFY(queue.isIdle());
+    QCOMPARE(stage.items(), QList<int>({ 1, 3 }));
+}
+
+void TestFrameQueue::poolExhaustion()
+{
+    FramePool &pool = FramePool::instance();
+    const FramePool::Policy saved = pool.policy();
+    // 64x64 ARGB32 is 16 KiB a slab; the budget holds two of them
+    const qint64 slabBytes = 64 * 4 * 64;
+    FramePool::Policy budget;
+    budget.budgetBytes = 2 * slabBytes;
+    pool.setPolicy(budget);
+    const FramePool::Stats before = pool.stats();
+
+    QImage first = pool.acquire(QSize(64, 64), QImage::Format_ARGB32);
+    QImage second = pool.acquire(QSize(64, 64), QImage::Format_ARGB32);
+    QVERIFY(!first.isNull());
+    QVERIFY(!second.isNull());
+    QVERIFY(pool.acquire(QSize(64, 64), QImage::Format_ARGB32).isNull());
+    QVERIFY(pool.convert(QImage(8, 8, QImage::Format_RGB32), QSize(64, 64), QImage::Format_ARGB32).isNull());
+    FramePool::Stats stats = pool.stats();
+    QCOMPARE(stats.exhausted - before.exhausted, quint64(2));
+    QCOMPARE(stats.slabsInUse, 2);
+    QCOMPARE(stats.inUseBytes, 2 * slabBytes);
+
+    // A released slab is handed out again rather than a new one allocated
+    const uchar *bits = first.constBits();
+    first = QImage();
+    QImage third = pool.acquire(QSize(64, 64), QImage::Format_ARGB32);
+    QCOMPARE(third.constBits(), bits);
+    QCOMPARE(pool.stats().allocatedBytes, 2 * slabBytes);
+
+    // Another size frees idle slabs, but not the ones still in use
+    third = QImage();
+    QVERIFY(pool.acquire(QSize(128, 64), QImage::Format_ARGB32).isNull());
+    second = QImage();
+    QImage wide = pool.acquire(QSize(128, 64), QImage::Format_ARGB32);
+    QVERIFY(!wide.isNull());
+    stats = pool.stats();
+    QCOMPARE(stats.slabs, 1);
+    QCOMPARE(stats.allocatedBytes, 2 * slabBytes);
+    QCOMPARE(stats.exhausted - before.exhausted, quint64(3));
+
+    wide = QImage();
+    pool.setPolicy(saved);
+}
+
+void TestFrameQueue::droppedFrameReturnsToPool()
+{
+    FramePool &pool = FramePool::instance();
+    const FramePool::Policy saved = pool.policy();
+    FramePool::Policy budget;
+    budget.budgetBytes = 2 * 64 * 4 * 64;
+    pool.setPolicy(budget);
+
+    Stage stage;
+    FrameQueue<QImage> queue("test", &stage.context, [&stage](QImage &image) { stage.consume(image.width()); });
+    queue.setPolicy(policy(FrameQueueBase::DropNewest, 1));
+
+    // The stage holds one pooled frame; the one it has no room for is freed
+    // as it is dropped, so the budget is not leaked to back-pressure
+    QVERIFY(queue.push(pool.acquire(QSize(64, 64), QImage::Format_ARGB32)));
+    QVERIFY(stage.entered.tryAcquire(1, 5000));
+    QVERIFY(!queue.push(pool.acquire(QSize(64, 64), QImage::Format_ARGB32)));
+    QCOMPARE(pool.stats().slabsInUse, 1);
+    QImage spare = pool.acquire(QSize(64, 64), QImage::Format_ARGB32);
+    QVERIFY(!spare.isNull());
+    spare = QImage();
+
+    stage.proceed.release();
+    QTRY_VERIFY(queue.isIdle());
+    QTRY_COMPARE(pool.stats().slabsInUse, 0);
+    pool.setPolicy(saved);
+}
+
+NEURODRIVE_TEST(TestFrameQueue)
+#include "tst_framequeue.moc"
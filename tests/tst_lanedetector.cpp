@@ -0,0 +1,104 @@
+#include <QFile>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+#include "LaneDetector.h"
+#include "TestRegistry.h"
+
+// LaneDetector against lane.py on runs of consecutive frames of
+// Lane_detect.mp4: tests/lane_reference.py saves each 600x600 frame and
+// what lane.py's detect_lanes() found on it, smoothing included, and the
+// detector must find the same lanes on the same frames within Tolerance
+class TestLaneDetector : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matchesLanePy();
+
+private:
+    static void compareLane(const LaneDetector::Lane &lane, const QJsonValue &reference, int frame, const char *side);
+
+    // Pixels either way at each end of a lane
+    static constexpr int Tolerance = 2;
+};
+
+void TestLaneDetector::compareLane(const LaneDetector::Lane &lane, const QJsonValue &reference, int frame,
+                                   const char *side)
+{
+    const QByteArray where = QString("frame %1, %2 lane").arg(frame).arg(side).toUtf8();
+    QVERIFY2(lane.valid == reference.isArray(), where.constData());
+    if (!lane.valid) {
+        return;
+    }
+    const QJsonArray bottom = reference.toArray().at(0).toArray();
+    const QJsonArray top = reference.toArray().at(1).toArray();
+    // The ends sit on the bottom row and the ROI top whatever the fit
+    QCOMPARE(lane.line.y1, bottom.at(1).toInt());
+    QCOMPARE(lane.line.y2, top.at(1).toInt());
+    QVERIFY2(qAbs(lane.line.x1 - bottom.at(0).toInt()) <= Tolerance,
+             qPrintable(QString("%1: bottom x %2, lane.py %3").arg(where).arg(lane.line.x1).arg(bottom.at(0).toInt())));
+    QVERIFY2(qAbs(lane.line.x2 - top.at(0).toInt()) <= Tolerance,
+             qPrintable(QString("%1: top x %2, lane.py %3").arg(where).arg(lane.line.x2).arg(top.at(0).toInt())));
+}
+
+void TestLaneDetector::matchesLanePy()
+{
+    if (QStandardPaths::findExecutable("python3").isEmpty()) {
+        QSKIP("python3 is not installed");
+    }
+    const QString video = sourcePath("Lane_detect.mp4");
+    if (!QFile::exists(video)) {
+        QSKIP("Lane_detect.mp4 is not in the source tree");
+    }
+    if (QProcess::execute("python3", { "-c", "import cv2" }) != 0) {
+        QSKIP("python3 has no cv2");
+    }
+
+    // Early, into the clip and further on; a run past its end is cut short
+    QTemporaryDir directory;
+    QProcess reference;
+    reference.setProcessChannelMode(QProcess::ForwardedChannels);
+    reference.start("python3", { sourcePath("tests/lane_reference.py"), video, directory.path(), "30", "300", "600" });
+    QVERIFY(reference.waitForFinished(120000));
+    QCOMPARE(reference.exitCode(), 0);
+
+    QFile file(directory.filePath("lanes.json"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QJsonArray frames = QJsonDocument::fromJson(file.readAll()).array();
+    QVERIFY(!frames.isEmpty());
+
+    // The smoothing starts over at each run, in lane.py and here alike
+    LaneDetector detector;
+    int run = -1;
+    int lanes = 0;
+    for (const QJsonValue &value : frames) {
+        const QJsonObject frame = value.toObject();
+        if (frame.value("run").toInt() != run) {
+            run = frame.value("run").toInt();
+            detector.reset();
+        }
+        const QImage image = QImage(frame.value("image").toString()).convertToFormat(QImage::Format_RGB32);
+        QCOMPARE(image.size(), QSize(LaneDetector::FrameWidth, LaneDetector::FrameHeight));
+
+        const LaneDetector::Result &result = detector.detect(
+            reinterpret_cast<const std::uint32_t *>(image.constBits()), int(image.bytesPerLine()));
+        const int index = frame.value("frame").toInt();
+        compareLane(result.left, frame.value("left"), index, "left");
+        compareLane(result.right, frame.value("right"), index, "right");
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+        lanes += int(result.left.valid) + int(result.right.valid);
+    }
+    // Frames without any lane would prove little
+    QVERIFY(lanes > 0);
+}
+
+NEURODRIVE_TEST(TestLaneDetector)
+#include "tst_lanedetector.moc"
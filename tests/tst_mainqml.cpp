@@ -0,0 +1,35 @@
+#include <QQmlApplicationEngine>
+#include <QQmlContext>
+#include <QTest>
+#include "NetworkService.h"
+#include "ProcessManager.h"
+#include "StartupTrace.h"
+#include "TestRegistry.h"
+
+// Loading Main.qml with the services main() gives it, on the offscreen platform
+class TestMainQml : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void load();
+};
+
+void TestMainQml::load()
+{
+    StartupTrace startupTrace;
+    NetworkService networkService;
+    ProcessManager processManager;
+
+    QBENCHMARK {
+        QQmlApplicationEngine engine;
+        engine.rootContext()->setContextProperty("networkService", &networkService);
+        engine.rootContext()->setContextProperty("processManager", &processManager);
+        engine.rootContext()->setContextProperty("startupTrace", &startupTrace);
+        engine.loadFromModule("NeuroDrive_13_5_2025", "Main");
+        QCOMPARE(engine.rootObjects().size(), 1);
+    }
+}
+
+NEURODRIVE_TEST(TestMainQml)
+#include "tst_mainqml.moc"
@@ -0,0 +1,143 @@
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTest>
+#include "MetricsRegistry.h"
+#include "ProcessManager.h"
+#include "TestRegistry.h"
+
+#include <cmath>
+
+// MetricsRegistry's counters as the HUD and the exports see them after a
+// sample: frames, drops from index gaps, latency percentiles within their
+// bucket, and the spawn latency ProcessManager records for a worker started
+// from stub_worker.py
+class TestMetricsRegistry : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void counters();
+    void beginRun();
+    void spawnLatency();
+
+private:
+    static QVariant value(const MetricsRegistry &metrics, int model, int role);
+};
+
+QVariant TestMetricsRegistry::value(const MetricsRegistry &metrics, int model, int role)
+{
+    for (int row = 0; row < metrics.rowCount(); ++row) {
+        const QModelIndex index = metrics.index(row);
+        if (metrics.data(index, MetricsRegistry::ModelRole).toInt() == model) {
+            return metrics.data(index, role);
+        }
+    }
+    return QVariant();
+}
+
+void TestMetricsRegistry::counters()
+{
+    MetricsRegistry metrics;
+    metrics.setSampleIntervalMs(100);
+    metrics.setModelName(1, "test");
+    metrics.beginRun();
+    QSignalSpy sampled(&metrics, &MetricsRegistry::sampled);
+
+    // Nine frames at 10 ms and one at 100 ms; frames 5 and 6 never arrive
+    metrics.recordSpawnLatency(1, 42);
+    for (qint64 frame : { 0, 1, 2, 3, 4, 7, 8, 9, 10 }) {
+        metrics.recordFrame(1, frame, 10.0);
+    }
+    metrics.recordFrame(1, 11, 100.0);
+    metrics.recordDropped(1, 3);
+    // Outside the model ids, ignored
+    metrics.recordFrame(0, 0, 10.0);
+    metrics.recordFrame(MetricsRegistry::MaxModels, 0, 10.0);
+
+    QVERIFY(sampled.wait(2000));
+    QCOMPARE(metrics.count(), 1);
+    QCOMPARE(value(metrics, 1, MetricsRegistry::NameRole).toString(), QString("test"));
+    QCOMPARE(value(metrics, 1, MetricsRegistry::SpawnLatencyRole).toLongLong(), qint64(42));
+    QCOMPARE(value(metrics, 1, MetricsRegistry::FramesRole).toDouble(), 10.0);
+    QCOMPARE(value(metrics, 1, MetricsRegistry::DroppedRole).toDouble(), 5.0);
+    QVERIFY(value(metrics, 1, MetricsRegistry::FirstFrameRole).toLongLong() >= 0);
+
+    // Reported as the upper bound of their bucket, at most a quarter octave high
+    const double quarterOctave = std::exp2(0.25);
+    const double p50 = value(metrics, 1, MetricsRegistry::P50Role).toDouble();
+    const double p95 = value(metrics, 1, MetricsRegistry::P95Role).toDouble();
+    const double p99 = value(metrics, 1, MetricsRegistry::P99Role).toDouble();
+    QVERIFY2(p50 >= 10.0 && p50 <= 10.0 * quarterOctave, qPrintable(QString::number(p50)));
+    QVERIFY2(p95 >= 100.0 && p95 <= 100.0 * quarterOctave, qPrintable(QString::number(p95)));
+    QCOMPARE(p99, p95);
+
+    const QString prometheus = metrics.toPrometheus();
+    QVERIFY(prometheus.contains("neurodrive_spawn_latency_ms{model=\"test\"} 42\n"));
+    QVERIFY(prometheus.contains("neurodrive_dropped_frames_total{model=\"test\"} 5\n"));
+    QVERIFY(prometheus.contains("neurodrive_inference_latency_ms_count{model=\"test\"} 10\n"));
+    QVERIFY(prometheus.contains("neurodrive_inference_latency_ms_sum{model=\"test\"} 190\n"));
+    QVERIFY(metrics.toJson().contains("\"spawnLatencyMs\":42"));
+}
+
+void TestMetricsRegistry::beginRun()
+{
+    MetricsRegistry metrics;
+    metrics.setSampleIntervalMs(100);
+    metrics.beginRun();
+    QSignalSpy sampled(&metrics, &MetricsRegistry::sampled);
+
+    metrics.recordSpawnLatency(1, 42);
+    metrics.recordFrame(1, 0, 10.0);
+    metrics.recordFrame(3, 0, 10.0);
+    QVERIFY(sampled.wait(2000));
+    QCOMPARE(metrics.count(), 2);
+
+    // A new run starts every model over, and those not started get no row
+    metrics.beginRun();
+    QCOMPARE(metrics.count(), 0);
+    metrics.recordFrame(3, 5, 10.0);
+    QVERIFY(sampled.wait(2000));
+    QCOMPARE(metrics.count(), 1);
+    QCOMPARE(value(metrics, 3, MetricsRegistry::FramesRole).toDouble(), 1.0);
+    QCOMPARE(value(metrics, 3, MetricsRegistry::DroppedRole).toDouble(), 0.0);
+    QCOMPARE(value(metrics, 3, MetricsRegistry::SpawnLatencyRole).toLongLong(), qint64(-1));
+    QVERIFY(!value(metrics, 1, MetricsRegistry::ModelRole).isValid());
+}
+
+void TestMetricsRegistry::spawnLatency()
+{
+    if (QStandardPaths::findExecutable("python3").isEmpty()) {
+        QSKIP("python3 is not installed");
+    }
+    qputenv("STUB_STARTUP_S", "0");
+    qputenv("STUB_LOG_LINES", "0");
+    qputenv("STUB_FRAMES", "100000");
+
+    ProcessManager manager;
+    manager.setPythonExecutable("python3");
+    manager.setDrowsinessPath(sourcePath("stub_worker.py"));
+    MetricsRegistry *metrics = manager.metrics();
+    metrics->setSampleIntervalMs(100);
+    QSignalSpy measured(&manager, &ProcessManager::startLatencyMeasured);
+    QSignalSpy frames(&manager, &ProcessManager::frameProcessed);
+
+    // What the registry reports is what ProcessManager measured
+    manager.startModel(ProcessManager::Drowsiness);
+    QVERIFY(measured.wait(10000));
+    QCOMPARE(measured.at(0).at(0).toInt(), int(ProcessManager::Drowsiness));
+    const qint64 milliseconds = measured.at(0).at(1).toLongLong();
+    QVERIFY(frames.wait(10000));
+
+    QSignalSpy sampled(metrics, &MetricsRegistry::sampled);
+    QVERIFY(sampled.wait(2000));
+    QCOMPARE(value(*metrics, ProcessManager::Drowsiness, MetricsRegistry::SpawnLatencyRole).toLongLong(),
+             milliseconds);
+    QVERIFY(value(*metrics, ProcessManager::Drowsiness, MetricsRegistry::FramesRole).toDouble() >= 1.0);
+    QVERIFY(value(*metrics, ProcessManager::Drowsiness, MetricsRegistry::FirstFrameRole).toLongLong() >= 0);
+
+    manager.stopCurrentModel();
+    QTRY_VERIFY_WITH_TIMEOUT(!manager.isRunning(), ProcessManager::StopTimeoutMs * 2);
+}
+
+NEURODRIVE_TEST(TestMetricsRegistry)
+#include "tst_metricsregistry.moc"
@@ -0,0 +1,145 @@
+#include <QImage>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+#include "NetworkService.h"
+#include "TestRegistry.h"
+
+// The login path: building the verification request from the capture, and
+// the round trip against verify_server.py on localhost
+class TestNetworkService : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void encodeCapture();
+    void encodeNoisyCapture();
+    void buildPayload();
+    void verifyAuthorized();
+    void roundTrip();
+
+private:
+    static constexpr int Port = 5141;
+    QProcess m_server;
+    bool m_serverStarted = false;
+};
+
+void TestNetworkService::initTestCase()
+{
+    // The server is only needed by the round trips, which skip without it
+    if (QStandardPaths::findExecutable("python3").isEmpty()
+            || QStandardPaths::findExecutable("openssl").isEmpty()) {
+        return;
+    }
+    m_server.setProcessChannelMode(QProcess::MergedChannels);
+    m_server.start("python3", { sourcePath("verify_server.py"), "--port", QString::number(Port) });
+    QElapsedTimer clock;
+    clock.start();
+    while (clock.elapsed() < 10000 && m_server.state() == QProcess::Running) {
+        if (m_server.waitForReadyRead(100) && m_server.readAll().contains("Verification stand-in on")) {
+            m_serverStarted = true;
+            break;
+        }
+    }
+    qputenv("NEURODRIVE_VERIFY_URL", QString("https://localhost:%1/api/verify-driver").arg(Port).toUtf8());
+}
+
+void TestNetworkService::cleanupTestCase()
+{
+    if (m_server.state() != QProcess::NotRunning) {
+        m_server.kill();
+        m_server.waitForFinished();
+    }
+}
+
+void TestNetworkService::encodeCapture()
+{
+    const QString capture = sourcePath("img/youssef.jpg");
+    QByteArray jpeg;
+    QBENCHMARK {
+        jpeg = NetworkService::encodeCapture(capture);
+    }
+    QVERIFY(!jpeg.isEmpty());
+    QVERIFY(jpeg.size() <= NetworkService::MaxImageBytes);
+}
+
+void TestNetworkService::encodeNoisyCapture()
+{
+    // Noise does not compress: over MaxImageBytes even at MinJpegQuality, so
+    // it is scaled down until it fits instead of being sent oversized
+    QImage noise(NetworkService::MaxImageSide, NetworkService::MaxImageSide, QImage::Format_RGB32);
+    QRandomGenerator random(5141);
+    for (int y = 0; y < noise.height(); ++y) {
+        quint32 *line = reinterpret_cast<quint32 *>(noise.scanLine(y));
+        for (int x = 0; x < noise.width(); ++x) {
+            line[x] = 0xff000000u | (random.generate() & 0xffffffu);
+        }
+    }
+    QTemporaryDir directory;
+    const QString capture = directory.filePath("noise.png");
+    QVERIFY(noise.save(capture));
+
+    QString error;
+    const QByteArray jpeg = NetworkService::encodeCapture(capture, &error);
+    QVERIFY2(!jpeg.isEmpty(), qPrintable(error));
+    QVERIFY(jpeg.size() <= NetworkService::MaxImageBytes);
+    const QImage sent = QImage::fromData(jpeg, "JPEG");
+    QVERIFY(sent.width() < NetworkService::MaxImageSide);
+    QVERIFY(sent.width() >= NetworkService::MinImageSide);
+
+    QCOMPARE(NetworkService::encodeCapture(directory.filePath("missing.jpg"), &error), QByteArray());
+    QCOMPARE(error, QString("Failed to load image"));
+}
+
+void TestNetworkService::buildPayload()
+{
+    const QByteArray jpeg = NetworkService::encodeCapture(sourcePath("img/youssef.jpg"));
+    QVERIFY(!jpeg.isEmpty());
+    QByteArray body;
+    QBENCHMARK {
+        body = NetworkService::buildPayload("111", jpeg);
+    }
+    const QJsonObject request = QJsonDocument::fromJson(body).object();
+    QCOMPARE(request.value("carId").toString(), QString("111"));
+    const QString image = request.value("imageBase64").toString();
+    QVERIFY(image.startsWith("data:image/jpeg;base64,"));
+    QCOMPARE(QByteArray::fromBase64(image.mid(23).toLatin1()), jpeg);
+}
+
+void TestNetworkService::verifyAuthorized()
+{
+    if (!m_serverStarted) {
+        QSKIP("verify_server.py could not be started");
+    }
+    NetworkService service;
+    QSignalSpy complete(&service, &NetworkService::verificationComplete);
+    QVERIFY(service.verifyDriver("111", sourcePath("img/youssef.jpg")));
+    QVERIFY(complete.wait(NetworkService::TransferTimeoutMs));
+    QCOMPARE(complete.at(0).at(0).toBool(), true);
+    QCOMPARE(complete.at(0).at(1).toString(), QString("Welcome Test Driver"));
+}
+
+void TestNetworkService::roundTrip()
+{
+    if (!m_serverStarted) {
+        QSKIP("verify_server.py could not be started");
+    }
+    // An unknown car is never answered from the verification cache, so every
+    // iteration goes to the server
+    NetworkService service;
+    QSignalSpy complete(&service, &NetworkService::verificationComplete);
+    QBENCHMARK {
+        complete.clear();
+        QVERIFY(service.verifyDriver("999", sourcePath("img/youssef.jpg")));
+        QVERIFY(complete.wait(NetworkService::TransferTimeoutMs));
+        QCOMPARE(complete.at(0).at(0).toBool(), false);
+    }
+}
+
+NEURODRIVE_TEST(TestNetworkService)
+#include "tst_networkservice.moc"
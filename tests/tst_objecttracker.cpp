@@ -0,0 +1,223 @@
+#include <QTest>
+#include <algorithm>
+#include <cmath>
+#include "ObjectTracker.h"
+#include "TestRegistry.h"
+
+// ObjectTracker on synthetic straight-line trajectories: ids stay with
+// their objects through the frames in between inferences, through runs of
+// predict() and through missed detections, for up to maxAgeFrames
+class TestObjectTracker : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void strideWithPredictions();
+    void predictGap_data();
+    void predictGap();
+    void missedDetections_data();
+    void missedDetections();
+    void frameCost();
+
+private:
+    struct Trajectory
+    {
+        int classId;
+        float x, y;      // Centre on frame 0
+        float vx, vy;    // Pixels per frame
+        float width, height;
+
+        ObjectTracker::Box at(qint64 frame) const
+        {
+            ObjectTracker::Box box;
+            box.classId = classId;
+            box.confidence = 0.8f;
+            const float cx = x + vx * float(frame);
+            const float cy = y + vy * float(frame);
+            box.x1 = cx - width * 0.5f;
+            box.y1 = cy - height * 0.5f;
+            box.x2 = cx + width * 0.5f;
+            box.y2 = cy + height * 0.5f;
+            return box;
+        }
+    };
+
+    // Two cars side by side and a sign passing the other way
+    static const Trajectory Trajectories[3];
+    static constexpr int Stride = 3;
+    // Largest distance between the centres of two boxes
+    static float centreError(const ObjectTracker::Box &a, const ObjectTracker::Box &b);
+    // Detected on every frame up to and including lastFrame; returns its id
+    static int warmUp(ObjectTracker &tracker, const Trajectory &trajectory, qint64 lastFrame);
+};
+
+const TestObjectTracker::Trajectory TestObjectTracker::Trajectories[3] = {
+    { 0, 100.0f, 200.0f, 4.0f, 1.0f, 40.0f, 40.0f },
+    { 0, 100.0f, 320.0f, 4.0f, 1.0f, 40.0f, 40.0f },
+    { 1, 600.0f, 150.0f, -3.0f, 0.5f, 30.0f, 60.0f }
+};
+
+float TestObjectTracker::centreError(const ObjectTracker::Box &a, const ObjectTracker::Box &b)
+{
+    return std::max(std::abs((a.x1 + a.x2) - (b.x1 + b.x2)), std::abs((a.y1 + a.y2) - (b.y1 + b.y2))) * 0.5f;
+}
+
+int TestObjectTracker::warmUp(ObjectTracker &tracker, const Trajectory &trajectory, qint64 lastFrame)
+{
+    int id = -1;
+    for (qint64 frame = 0; frame <= lastFrame; ++frame) {
+        std::vector<ObjectTracker::Box> detections { trajectory.at(frame) };
+        tracker.update(frame, detections);
+        id = detections.front().trackId;
+    }
+    return id;
+}
+
+void TestObjectTracker::strideWithPredictions()
+{
+    ObjectTracker tracker;
+    int ids[3] = { -1, -1, -1 };
+    for (qint64 frame = 0; frame < 90; ++frame) {
+        if (frame % Stride == 0) {
+            std::vector<ObjectTracker::Box> detections;
+            for (const Trajectory &trajectory : Trajectories) {
+                detections.push_back(trajectory.at(frame));
+            }
+            QCOMPARE(tracker.update(frame, detections).size(), size_t(3));
+            for (int i = 0; i < 3; ++i) {
+                QVERIFY(detections[i].trackId > 0);
+                if (ids[i] < 0) {
+                    ids[i] = detections[i].trackId;
+                }
+                QCOMPARE(detections[i].trackId, ids[i]);
+            }
+            continue;
+        }
+
+        // In between, each object is where its track predicts it, once the
+        // velocity has been picked up
+        const std::vector<ObjectTracker::Box> &predicted = tracker.predict(frame);
+        QCOMPARE(predicted.size(), size_t(3));
+        for (const ObjectTracker::Box &box : predicted) {
+            const int *id = std::find(ids, ids + 3, box.trackId);
+            QVERIFY(id != ids + 3);
+            const Trajectory &trajectory = Trajectories[id - ids];
+            QCOMPARE(box.classId, trajectory.classId);
+            if (frame >= 5 * Stride) {
+                QVERIFY2(centreError(box, trajectory.at(frame)) < 1.0f,
+                         qPrintable(QString("track %1 on frame %2").arg(box.trackId).arg(frame)));
+            }
+        }
+    }
+    QCOMPARE(tracker.tracksCreated(), 3);
+    QVERIFY(ids[0] != ids[1]);
+}
+
+void TestObjectTracker::predictGap_data()
+{
+    const int maxAge = ObjectTracker::Policy().maxAgeFrames;
+    QTest::addColumn<int>("gap");
+    QTest::addColumn<bool>("sameTrack");
+    QTest::newRow("1") << 1 << true;
+    QTest::newRow("10") << 10 << true;
+    QTest::newRow("maxAgeFrames") << maxAge << true;
+    QTest::newRow("maxAgeFrames + 1") << maxAge + 1 << false;
+    QTest::newRow("2 * maxAgeFrames") << 2 * maxAge << false;
+}
+
+void TestObjectTracker::predictGap()
+{
+    // Only predict() between the last detection and the next update, as
+    // when the model is busy or paused
+    QFETCH(int, gap);
+    QFETCH(bool, sameTrack);
+    const Trajectory &trajectory = Trajectories[0];
+    ObjectTracker tracker;
+    const qint64 last = 20;
+    const int id = warmUp(tracker, trajectory, last);
+
+    const int maxAge = tracker.policy().maxAgeFrames;
+    for (qint64 frame = last + 1; frame <= last + gap; ++frame) {
+        const std::vector<ObjectTracker::Box> &predicted = tracker.predict(frame);
+        if (frame - last <= maxAge) {
+            QCOMPARE(predicted.size(), size_t(1));
+            QCOMPARE(predicted.front().trackId, id);
+            QVERIFY(centreError(predicted.front(), trajectory.at(frame)) < 1.0f);
+        } else {
+            QVERIFY(predicted.empty());
+        }
+    }
+
+    std::vector<ObjectTracker::Box> detections { trajectory.at(last + gap) };
+    tracker.update(last + gap, detections);
+    QCOMPARE(detections.front().trackId == id, sameTrack);
+    QCOMPARE(tracker.tracksCreated(), sameTrack ? 1 : 2);
+    QCOMPARE(tracker.trackCount(), size_t(1));
+}
+
+void TestObjectTracker::missedDetections_data()
+{
+    // Inference every Stride frames; the object is not detected from frame
+    // 30 to lastMissed. Its last detection is on frame 27.
+    QTest::addColumn<int>("lastMissed");
+    QTest::addColumn<bool>("sameTrack");
+    QTest::newRow("one inference") << 30 << true;
+    QTest::newRow("next one at maxAgeFrames") << 54 << true;
+    QTest::newRow("next one past maxAgeFrames") << 57 << false;
+}
+
+void TestObjectTracker::missedDetections()
+{
+    QFETCH(int, lastMissed);
+    QFETCH(bool, sameTrack);
+    const Trajectory &trajectory = Trajectories[2];
+    const ObjectTracker::Policy policy;
+    ObjectTracker tracker(policy);
+    int id = -1;
+    int missedUpdates = 0;
+    for (qint64 frame = 0; frame <= lastMissed + Stride; frame += Stride) {
+        std::vector<ObjectTracker::Box> detections;
+        if (frame < 30 || frame > lastMissed) {
+            detections.push_back(trajectory.at(frame));
+        }
+        const std::vector<ObjectTracker::Box> &tracks = tracker.update(frame, detections);
+        if (detections.empty()) {
+            // Shown coasting for maxMissed inferences, then only kept for matching
+            ++missedUpdates;
+            QCOMPARE(tracks.size(), size_t(missedUpdates <= policy.maxMissed ? 1 : 0));
+            if (!tracks.empty()) {
+                QCOMPARE(tracks.front().trackId, id);
+            }
+        } else if (id < 0) {
+            id = detections.front().trackId;
+        } else if (frame < 30) {
+            QCOMPARE(detections.front().trackId, id);
+        } else {
+            QCOMPARE(detections.front().trackId == id, sameTrack);
+        }
+    }
+    QCOMPARE(tracker.tracksCreated(), sameTrack ? 1 : 2);
+}
+
+void TestObjectTracker::frameCost()
+{
+    ObjectTracker tracker;
+    std::vector<ObjectTracker::Box> detections;
+    QBENCHMARK {
+        tracker.reset();
+        for (qint64 frame = 0; frame < 90; ++frame) {
+            if (frame % Stride != 0) {
+                tracker.predict(frame);
+                continue;
+            }
+            detections.clear();
+            for (const Trajectory &trajectory : Trajectories) {
+                detections.push_back(trajectory.at(frame));
+            }
+            tracker.update(frame, detections);
+        }
+    }
+}
+
+NEURODRIVE_TEST(TestObjectTracker)
+#include "tst_objecttracker.moc"
@@ -0,0 +1,97 @@
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTest>
+#include "ProcessManager.h"
+#include "TestRegistry.h"
+
+// Spawning and stopping a worker, timed against stub_worker.py standing in
+// for drowsiness.py so the models are not needed
+class TestProcessManager : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void spawnAndStop();
+    void stopWithoutKill();
+
+private:
+    static bool waitForState(QSignalSpy &spy, int modelType, int state, int timeoutMs);
+    void startStub(ProcessManager &manager);
+};
+
+void TestProcessManager::initTestCase()
+{
+    if (QStandardPaths::findExecutable("python3").isEmpty()) {
+        QSKIP("python3 is not installed");
+    }
+    // No simulated model loading, few log lines, and a run that outlasts the test
+    qputenv("STUB_STARTUP_S", "0");
+    qputenv("STUB_LOG_LINES", "0");
+    qputenv("STUB_FRAMES", "100000");
+}
+
+bool TestProcessManager::waitForState(QSignalSpy &spy, int modelType, int state, int timeoutMs)
+{
+    QElapsedTimer clock;
+    clock.start();
+    int seen = 0;
+    while (clock.elapsed() < timeoutMs) {
+        for (; seen < spy.size(); ++seen) {
+            if (spy.at(seen).at(0).toInt() == modelType && spy.at(seen).at(1).toInt() == state) {
+                return true;
+            }
+        }
+        spy.wait(50);
+    }
+    return false;
+}
+
+void TestProcessManager::startStub(ProcessManager &manager)
+{
+    manager.setPythonExecutable("python3");
+    manager.setDrowsinessPath(sourcePath("stub_worker.py"));
+}
+
+void TestProcessManager::spawnAndStop()
+{
+    ProcessManager manager;
+    startStub(manager);
+    QSignalSpy started(&manager, &ProcessManager::modelStarted);
+    QSignalSpy states(&manager, &ProcessManager::modelStateChanged);
+
+    // From startModel() to the worker's first protocol event, and from
+    // stopCurrentModel() to the worker having exited
+    QBENCHMARK {
+        states.clear();
+        manager.startModel(ProcessManager::Drowsiness);
+        QVERIFY(started.wait(10000));
+        QCOMPARE(manager.modelState(ProcessManager::Drowsiness), int(ProcessManager::Running));
+        manager.stopCurrentModel();
+        QVERIFY(waitForState(states, ProcessManager::Drowsiness, ProcessManager::Stopped,
+                             ProcessManager::StopTimeoutMs * 2));
+    }
+}
+
+void TestProcessManager::stopWithoutKill()
+{
+    ProcessManager manager;
+    startStub(manager);
+    QSignalSpy started(&manager, &ProcessManager::modelStarted);
+    QSignalSpy states(&manager, &ProcessManager::modelStateChanged);
+
+    manager.startModel(ProcessManager::Drowsiness);
+    QVERIFY(started.wait(10000));
+    states.clear();
+    QElapsedTimer clock;
+    clock.start();
+    manager.stopCurrentModel();
+    QVERIFY(waitForState(states, ProcessManager::Drowsiness, ProcessManager::Stopped,
+                         ProcessManager::StopTimeoutMs * 2));
+    // SIGTERM is enough for the stub; the SIGKILL fallback is not reached
+    QVERIFY(clock.elapsed() < ProcessManager::StopTimeoutMs);
+}
+
+NEURODRIVE_TEST(TestProcessManager)
+#include "tst_processmanager.moc"
@@ -0,0 +1,171 @@
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QThread>
+#include "RateGovernor.h"
+#include "TestRegistry.h"
+
+// RateGovernor ticked by hand over a fake thermal and loadavg tree: the
+// sensor readings, the step down when hot or critical, the hold after each
+// change and the step up after enough calm intervals
+class TestRateGovernor : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void sensors();
+    void missingSensors();
+    void hotStepsDown();
+    void criticalToCheapest();
+    void headroomStepsUp();
+
+private:
+    static constexpr int Model = 1;
+    static void setTemperature(const QTemporaryDir &root, int zone, int milliC);
+    static void setLoad(const QTemporaryDir &root, double load);
+    static RateGovernor::Policy fakePolicy(const QTemporaryDir &root);
+    // A governor reading the fake tree with one worker attached
+    static bool attach(RateGovernor &governor, const QTemporaryDir &root);
+};
+
+void TestRateGovernor::setTemperature(const QTemporaryDir &root, int zone, int milliC)
+{
+    const QString path = root.filePath(QString("sys/class/thermal/thermal_zone%1/temp").arg(zone));
+    QDir().mkpath(QFileInfo(path).path());
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray::number(milliC) + "\n");
+}
+
+void TestRateGovernor::setLoad(const QTemporaryDir &root, double load)
+{
+    QDir().mkpath(root.filePath("proc"));
+    QFile file(root.filePath("proc/loadavg"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray::number(load, 'f', 2) + " 0.50 0.50 1/100 1\n");
+}
+
+RateGovernor::Policy TestRateGovernor::fakePolicy(const QTemporaryDir &root)
+{
+    RateGovernor::Policy policy;
+    policy.sysfsRoot = root.filePath("sys");
+    policy.procRoot = root.filePath("proc");
+    return policy;
+}
+
+bool TestRateGovernor::attach(RateGovernor &governor, const QTemporaryDir &root)
+{
+    governor.setPolicy(fakePolicy(root));
+    return !governor.attach(Model, "test").isEmpty();
+}
+
+void TestRateGovernor::sensors()
+{
+    QTemporaryDir directory;
+    setTemperature(directory, 0, 45000);
+    setTemperature(directory, 1, 52500);
+    setLoad(directory, 1.0);
+    RateGovernor governor;
+    governor.setPolicy(fakePolicy(directory));
+
+    QSignalSpy sampled(&governor, &RateGovernor::sampled);
+    governor.tick();
+    QCOMPARE(sampled.size(), 1);
+    // The hottest zone, and the load per core
+    QCOMPARE(governor.temperatureC(), 52.5);
+    QCOMPARE(governor.loadRatio(), 1.0 / double(QThread::idealThreadCount()));
+}
+
+void TestRateGovernor::missingSensors()
+{
+    QTemporaryDir directory;
+    RateGovernor governor;
+    governor.setPolicy(fakePolicy(directory));
+    governor.tick();
+    QCOMPARE(governor.temperatureC(), -1.0);
+    QCOMPARE(governor.loadRatio(), 0.0);
+}
+
+void TestRateGovernor::hotStepsDown()
+{
+    QTemporaryDir directory;
+    setTemperature(directory, 0, 76000);
+    setLoad(directory, 0.1);
+    RateGovernor governor;
+    if (!attach(governor, directory)) {
+        QSKIP("no shared memory for the control block");
+    }
+    const int holdTicks = governor.policy().holdTicks;
+    QSignalSpy changed(&governor, &RateGovernor::levelChanged);
+
+    // Readings right after attaching are left alone
+    for (int i = 0; i < holdTicks; ++i) {
+        governor.tick();
+    }
+    QCOMPARE(governor.level(Model), RateGovernor::DefaultLevel);
+    governor.tick();
+    QCOMPARE(governor.level(Model), RateGovernor::DefaultLevel + 1);
+    QCOMPARE(changed.size(), 1);
+    QCOMPARE(changed.at(0).at(2).toString(), QString("76.0 °C"));
+
+    // One step per hold, not one per tick
+    for (int i = 0; i < holdTicks; ++i) {
+        governor.tick();
+    }
+    QCOMPARE(governor.level(Model), RateGovernor::DefaultLevel + 1);
+    governor.tick();
+    QCOMPARE(governor.level(Model), RateGovernor::DefaultLevel + 2);
+}
+
+void TestRateGovernor::criticalToCheapest()
+{
+    QTemporaryDir directory;
+    setTemperature(directory, 0, 81000);
+    setLoad(directory, 0.1);
+    RateGovernor governor;
+    if (!attach(governor, directory)) {
+        QSKIP("no shared memory for the control block");
+    }
+    for (int i = 0; i <= governor.policy().holdTicks; ++i) {
+        governor.tick();
+    }
+    QCOMPARE(governor.level(Model), int(RateGovernor::ladder().size()) - 1);
+}
+
+void TestRateGovernor::headroomStepsUp()
+{
+    QTemporaryDir directory;
+    setTemperature(directory, 0, 45000);
+    setLoad(directory, 0.1);
+    RateGovernor governor;
+    if (!attach(governor, directory)) {
+        QSKIP("no shared memory for the control block");
+    }
+    const RateGovernor::Policy policy = governor.policy();
+    const auto calmTick = [&]() {
+        for (int i = 0; i < policy.minSamples; ++i) {
+            governor.recordFrame(Model, 0.3 * policy.targetLatencyMs);
+        }
+        governor.tick();
+    };
+
+    for (int i = 0; i < policy.holdTicks + policy.headroomTicks - 1; ++i) {
+        calmTick();
+    }
+    QCOMPARE(governor.level(Model), RateGovernor::DefaultLevel);
+    calmTick();
+    QCOMPARE(governor.level(Model), RateGovernor::DefaultLevel - 1);
+
+    // Too few frames say nothing about latency, so they do not count as calm
+    for (int i = 0; i < policy.holdTicks + policy.headroomTicks; ++i) {
+        governor.recordFrame(Model, 0.3 * policy.targetLatencyMs);
+        governor.tick();
+    }
+    QCOMPARE(governor.level(Model), RateGovernor::DefaultLevel - 1);
+}
+
+NEURODRIVE_TEST(TestRateGovernor)
+#include "tst_rategovernor.moc"
@@ -0,0 +1,206 @@
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QtEndian>
+#include "SegmentRecorder.h"
+#include "TestRegistry.h"
+
+// SegmentRecorder written, sealed and read back by a second recorder over
+// the same directory, the way the dashboard finds its recordings after a
+// restart or a crash
+class TestSegmentRecorder : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void sealAndReopen();
+    void crashRecovery();
+    void bounds();
+
+private:
+    static QVideoFrame frame(const QSize &size, const QColor &color);
+    // Every frame reaches the encoder, and time never splits a segment
+    static void recordAll(SegmentRecorder &recorder);
+    // Records frames of each size in turn and waits for their segments
+    static bool recordSegments(SegmentRecorder &recorder, const QList<QSize> &sizes, int framesEach,
+                               qint64 firstFrameIndex = 0);
+};
+
+QVideoFrame TestSegmentRecorder::frame(const QSize &size, const QColor &color)
+{
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(color);
+    return QVideoFrame(image);
+}
+
+void TestSegmentRecorder::recordAll(SegmentRecorder &recorder)
+{
+    SegmentRecorder::Policy policy;
+    policy.maxFps = 0.0;
+    policy.segmentMs = 600000;
+    recorder.setPolicy(policy);
+    recorder.setQueuePolicy({ 1, FrameQueueBase::Block, 5000 });
+}
+
+bool TestSegmentRecorder::recordSegments(SegmentRecorder &recorder, const QList<QSize> &sizes, int framesEach,
+                                         qint64 firstFrameIndex)
+{
+    QSignalSpy sealed(&recorder, &SegmentRecorder::segmentSealed);
+    qint64 frameIndex = firstFrameIndex;
+    for (const QSize &size : sizes) {
+        for (int i = 0; i < framesEach; ++i) {
+            recorder.record(frame(size, i % 2 ? Qt::red : Qt::blue), frameIndex++);
+        }
+    }
+    // A change of size seals the segment before it; the last is sealed here
+    recorder.seal();
+    while (sealed.size() < sizes.size()) {
+        if (!sealed.wait(5000)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TestSegmentRecorder::sealAndReopen()
+{
+    QTemporaryDir directory;
+    const QString path = directory.path();
+    QList<SegmentRecorder::Segment> written;
+    {
+        SegmentRecorder recorder(path);
+        recordAll(recorder);
+        recorder.start();
+        QVERIFY(recordSegments(recorder, { QSize(64, 48), QSize(32, 24) }, 5));
+        written = recorder.segments();
+    }
+    QCOMPARE(written.size(), 2);
+    QVERIFY(QDir(path).entryList({"*.part"}, QDir::Files).isEmpty());
+
+    // Each segment is a complete AVI: header filled in, frames in the movi
+    // list and an idx1 index at the end
+    for (int i = 0; i < written.size(); ++i) {
+        const SegmentRecorder::Segment &segment = written.at(i);
+        QCOMPARE(segment.sequence, quint64(i));
+        QCOMPARE(segment.frames, 5);
+        QCOMPARE(segment.firstFrameIndex, qint64(i * 5));
+        QCOMPARE(segment.lastFrameIndex, qint64(i * 5 + 4));
+
+        QFile file(path + "/" + segment.fileName);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        const QByteArray avi = file.readAll();
+        QCOMPARE(qint64(avi.size()), segment.bytes);
+        QCOMPARE(avi.left(4), QByteArray("RIFF"));
+        QCOMPARE(qFromLittleEndian<quint32>(avi.constData() + 4), quint32(avi.size() - 8));
+        QCOMPARE(avi.mid(8, 4), QByteArray("AVI "));
+        QCOMPARE(qFromLittleEndian<quint32>(avi.constData() + 48), quint32(5));
+        QCOMPARE(int(qFromLittleEndian<quint32>(avi.constData() + 64)), segment.size.width());
+        QCOMPARE(int(qFromLittleEndian<quint32>(avi.constData() + 68)), segment.size.height());
+        QCOMPARE(avi.mid(220, 4), QByteArray("movi"));
+        QCOMPARE(avi.mid(224, 4), QByteArray("00dc"));
+        const quint32 jpegSize = qFromLittleEndian<quint32>(avi.constData() + 228);
+        const QImage first = QImage::fromData(avi.mid(232, int(jpegSize)), "JPG");
+        QCOMPARE(first.size(), segment.size);
+        const qsizetype index = avi.size() - 8 - 5 * 16;
+        QCOMPARE(avi.mid(index, 4), QByteArray("idx1"));
+        QCOMPARE(qFromLittleEndian<quint32>(avi.constData() + index + 4), quint32(5 * 16));
+    }
+    QCOMPARE(written.at(0).size, QSize(64, 48));
+    QCOMPARE(written.at(1).size, QSize(32, 24));
+
+    // A new recorder lists the same segments from index.json
+    SegmentRecorder reopened(path);
+    QCOMPARE(reopened.count(), 0);
+    QSignalSpy countChanged(&reopened, &SegmentRecorder::countChanged);
+    reopened.start();
+    QCOMPARE(countChanged.size(), 1);
+    QCOMPARE(reopened.count(), 2);
+    for (int i = 0; i < written.size(); ++i) {
+        const SegmentRecorder::Segment &segment = reopened.segments().at(i);
+        QCOMPARE(segment.sequence, written.at(i).sequence);
+        QCOMPARE(segment.fileName, written.at(i).fileName);
+        QCOMPARE(segment.startMs, written.at(i).startMs);
+        QCOMPARE(segment.durationMs, written.at(i).durationMs);
+        QCOMPARE(segment.frames, written.at(i).frames);
+        QCOMPARE(segment.firstFrameIndex, written.at(i).firstFrameIndex);
+        QCOMPARE(segment.lastFrameIndex, written.at(i).lastFrameIndex);
+        QCOMPARE(segment.bytes, written.at(i).bytes);
+        QCOMPARE(segment.size, written.at(i).size);
+    }
+    // Times outside the recording are clamped to its first or last frame
+    QVariantMap located = reopened.locate(0);
+    QCOMPARE(located.value("sequence").toULongLong(), quint64(0));
+    QCOMPARE(located.value("positionMs").toLongLong(), qint64(0));
+    located = reopened.locate(written.at(1).startMs + written.at(1).durationMs + 60000);
+    QCOMPARE(located.value("sequence").toULongLong(), quint64(1));
+    QCOMPARE(located.value("positionMs").toLongLong(), written.at(1).durationMs);
+
+    // Sequences go on after the last one indexed
+    recordAll(reopened);
+    QVERIFY(recordSegments(reopened, { QSize(64, 48) }, 3, 10));
+    QCOMPARE(reopened.count(), 3);
+    QCOMPARE(reopened.segments().last().sequence, quint64(2));
+}
+
+void TestSegmentRecorder::crashRecovery()
+{
+    QTemporaryDir directory;
+    const QString path = directory.path();
+    {
+        SegmentRecorder recorder(path);
+        recordAll(recorder);
+        recorder.start();
+        QVERIFY(recordSegments(recorder, { QSize(64, 48), QSize(32, 24) }, 3));
+    }
+
+    // What a crash leaves: a segment still being written, one sealed but
+    // not yet indexed, and an indexed one lost from the card
+    QDir recordings(path);
+    for (const QString &name : {QString("segment-00000002.avi.part"), QString("segment-00000003.avi")}) {
+        QFile file(recordings.filePath(name));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(QByteArray(100, '\0'));
+    }
+    QVERIFY(recordings.remove("segment-00000000.avi"));
+
+    SegmentRecorder recovered(path);
+    recovered.start();
+    QCOMPARE(recovered.count(), 1);
+    QCOMPARE(recovered.segments().first().fileName, QString("segment-00000001.avi"));
+    QCOMPARE(recordings.entryList({"segment-*"}, QDir::Files), QStringList({"segment-00000001.avi"}));
+
+    // Sequences go on after the last one indexed, over the names cleared away
+    recordAll(recovered);
+    QVERIFY(recordSegments(recovered, { QSize(64, 48) }, 3));
+    QCOMPARE(recovered.segments().last().sequence, quint64(2));
+    QVERIFY(recordings.exists("segment-00000002.avi"));
+    QVERIFY(!recordings.exists("segment-00000002.avi.part"));
+}
+
+void TestSegmentRecorder::bounds()
+{
+    QTemporaryDir directory;
+    const QString path = directory.path();
+    SegmentRecorder recorder(path);
+    recordAll(recorder);
+    SegmentRecorder::Policy policy = recorder.policy();
+    policy.maxSegments = 2;
+    recorder.setPolicy(policy);
+    recorder.start();
+    QVERIFY(recordSegments(recorder, { QSize(64, 48), QSize(32, 24), QSize(64, 48) }, 2));
+
+    // The oldest goes from the card, the index and the model
+    QCOMPARE(recorder.count(), 2);
+    QCOMPARE(recorder.segments().first().sequence, quint64(1));
+    QVERIFY(!QDir(path).exists("segment-00000000.avi"));
+    SegmentRecorder reopened(path);
+    reopened.start();
+    QCOMPARE(reopened.count(), 2);
+    QCOMPARE(reopened.segments().first().sequence, quint64(1));
+}
+
+NEURODRIVE_TEST(TestSegmentRecorder)
+#include "tst_segmentrecorder.moc"
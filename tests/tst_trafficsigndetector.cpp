@@ -0,0 +1,151 @@
+#include <QTest>
+#include "TestRegistry.h"
+#include "TrafficSignDetector.h"
+
+// TrafficSignDetector's geometry and postprocessing, which need no model and
+// no ONNX Runtime: the letterbox of ultralytics for landscape, portrait and
+// odd frame sizes, boxes mapped back through it, and class-aware NMS
+class TestTrafficSignDetector : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void letterbox_data();
+    void letterbox();
+    void boxesToFrame();
+    void nonMaximumSuppression();
+    void classNames();
+
+private:
+    static TrafficSignDetector::Box box(int classId, float confidence, float x1, float y1, float x2, float y2);
+};
+
+TrafficSignDetector::Box TestTrafficSignDetector::box(int classId, float confidence, float x1, float y1,
+                                                      float x2, float y2)
+{
+    TrafficSignDetector::Box box;
+    box.classId = classId;
+    box.confidence = confidence;
+    box.x1 = x1;
+    box.y1 = y1;
+    box.x2 = x2;
+    box.y2 = y2;
+    return box;
+}
+
+void TestTrafficSignDetector::letterbox_data()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("height");
+    QTest::addColumn<float>("scale");
+    QTest::addColumn<int>("resizedWidth");
+    QTest::addColumn<int>("resizedHeight");
+    QTest::addColumn<int>("padX");
+    QTest::addColumn<int>("padY");
+
+    QTest::newRow("720p") << 1280 << 720 << 0.5f << 640 << 360 << 0 << 140;
+    QTest::newRow("portrait") << 720 << 1280 << 0.5f << 360 << 640 << 140 << 0;
+    QTest::newRow("square") << 640 << 640 << 1.0f << 640 << 640 << 0 << 0;
+    QTest::newRow("upscaled") << 320 << 240 << 2.0f << 640 << 480 << 0 << 80;
+    // Half a row of padding left over goes to the bottom, as round(dh - 0.1)
+    QTest::newRow("odd") << 640 << 385 << 1.0f << 640 << 385 << 0 << 127;
+}
+
+void TestTrafficSignDetector::letterbox()
+{
+    QFETCH(int, width);
+    QFETCH(int, height);
+    QFETCH(float, scale);
+    QFETCH(int, resizedWidth);
+    QFETCH(int, resizedHeight);
+    QFETCH(int, padX);
+    QFETCH(int, padY);
+
+    const TrafficSignDetector::Letterbox letterbox = TrafficSignDetector::fitLetterbox(
+        width, height, TrafficSignDetector::DefaultInputSize, TrafficSignDetector::DefaultInputSize);
+    QCOMPARE(letterbox.frameWidth, width);
+    QCOMPARE(letterbox.frameHeight, height);
+    QCOMPARE(letterbox.scale, scale);
+    QCOMPARE(letterbox.resizedWidth, resizedWidth);
+    QCOMPARE(letterbox.resizedHeight, resizedHeight);
+    QCOMPARE(letterbox.padX, padX);
+    QCOMPARE(letterbox.padY, padY);
+}
+
+void TestTrafficSignDetector::boxesToFrame()
+{
+    const TrafficSignDetector::Letterbox letterbox = TrafficSignDetector::fitLetterbox(1280, 720, 640, 640);
+
+    // Less the padding, over the scale; class and confidence are kept
+    TrafficSignDetector::Box mapped = letterbox.toFrame(box(3, 0.9f, 100, 190, 200, 290));
+    QCOMPARE(mapped.classId, 3);
+    QCOMPARE(mapped.confidence, 0.9f);
+    QCOMPARE(mapped.x1, 200.0f);
+    QCOMPARE(mapped.y1, 100.0f);
+    QCOMPARE(mapped.x2, 400.0f);
+    QCOMPARE(mapped.y2, 300.0f);
+
+    // A box reaching into the padding is clamped to the frame
+    mapped = letterbox.toFrame(box(0, 0.9f, -10, 100, 650, 520));
+    QCOMPARE(mapped.x1, 0.0f);
+    QCOMPARE(mapped.y1, 0.0f);
+    QCOMPARE(mapped.x2, 1280.0f);
+    QCOMPARE(mapped.y2, 720.0f);
+
+    // And the same box lands on the same place whatever the input size
+    const TrafficSignDetector::Letterbox small = TrafficSignDetector::fitLetterbox(1280, 720, 320, 320);
+    mapped = small.toFrame(box(0, 0.9f, 50, 95, 100, 145));
+    QCOMPARE(mapped.x1, 200.0f);
+    QCOMPARE(mapped.y1, 100.0f);
+    QCOMPARE(mapped.x2, 400.0f);
+    QCOMPARE(mapped.y2, 300.0f);
+}
+
+void TestTrafficSignDetector::nonMaximumSuppression()
+{
+    std::vector<TrafficSignDetector::Box> candidates = {
+        box(0, 0.90f, 0, 0, 100, 100),
+        box(0, 0.95f, 5, 5, 105, 105),       // IoU 0.82 with the first
+        box(1, 0.80f, 0, 0, 100, 100),       // Same place, another class
+        box(0, 0.85f, 0, 0, 100, 50),        // IoU 0.5 with the first, 0.4 with the second
+        box(0, 0.70f, 300, 300, 350, 350),
+    };
+
+    // Best first; an overlap above the threshold within a class suppresses
+    std::vector<TrafficSignDetector::Box> kept;
+    TrafficSignDetector::nonMaximumSuppression(candidates, 0.5f, 100, kept);
+    QCOMPARE(int(kept.size()), 4);
+    QCOMPARE(kept[0].confidence, 0.95f);
+    QCOMPARE(kept[1].confidence, 0.85f);
+    QCOMPARE(kept[2].classId, 1);
+    QCOMPARE(kept[3].confidence, 0.70f);
+
+    // At traffic.py's iou of 0.85 the overlapping pair is kept as well
+    kept.clear();
+    TrafficSignDetector::nonMaximumSuppression(candidates, 0.85f, 100, kept);
+    QCOMPARE(int(kept.size()), 5);
+    for (size_t i = 1; i < kept.size(); ++i) {
+        QVERIFY(kept[i - 1].confidence >= kept[i].confidence);
+    }
+
+    // Cut at maxDetections, the best ones staying
+    kept.clear();
+    TrafficSignDetector::nonMaximumSuppression(candidates, 0.5f, 2, kept);
+    QCOMPARE(int(kept.size()), 2);
+    QCOMPARE(kept[0].confidence, 0.95f);
+    QCOMPARE(kept[1].confidence, 0.85f);
+}
+
+void TestTrafficSignDetector::classNames()
+{
+    const std::vector<std::string> names =
+        TrafficSignDetector::parseClassNames("{0: 'stop', 1: \"no 'U' turn\", 3: 'yield'}");
+    QCOMPARE(int(names.size()), 4);
+    QCOMPARE(QString::fromStdString(names[0]), QString("stop"));
+    QCOMPARE(QString::fromStdString(names[1]), QString("no 'U' turn"));
+    QVERIFY(names[2].empty());
+    QCOMPARE(QString::fromStdString(names[3]), QString("yield"));
+}
+
+NEURODRIVE_TEST(TestTrafficSignDetector)
+#include "tst_trafficsigndetector.moc"
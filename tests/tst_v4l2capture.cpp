@@ -0,0 +1,139 @@
+#include <QDir>
+#include <QTest>
+#include "TestRegistry.h"
+#include "V4L2Capture.h"
+
+// V4L2Capture against the first capture device found, e.g. the vivid test
+// driver (modprobe vivid); the streaming cases skip when there is none
+class TestV4L2Capture : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+    void fourcc();
+    void openFailures();
+    void capture();
+    void dropWhileHeld();
+
+private:
+    // Frames are emitted on the capture thread and kept here on the test thread
+    void collect(V4L2Capture &capture);
+
+    QString m_device;
+    QList<QVideoFrame> m_frames;
+};
+
+void TestV4L2Capture::initTestCase()
+{
+    const QStringList devices = QDir("/dev").entryList({"video*"}, QDir::System, QDir::Name);
+    for (const QString &name : devices) {
+        V4L2Capture capture("/dev/" + name);
+        if (capture.open(V4L2Capture::Format())) {
+            m_device = capture.device();
+            break;
+        }
+    }
+}
+
+void TestV4L2Capture::cleanup()
+{
+    m_frames.clear();
+}
+
+void TestV4L2Capture::collect(V4L2Capture &capture)
+{
+    m_frames.clear();
+    connect(&capture, &V4L2Capture::frameCaptured, this, [this](const QVideoFrame &frame) {
+        m_frames.append(frame);
+    }, Qt::QueuedConnection);
+}
+
+void TestV4L2Capture::fourcc()
+{
+    QCOMPARE(V4L2Capture::fourcc("YUYV"), quint32(0x56595559));
+    QCOMPARE(V4L2Capture::fourccName(V4L2Capture::fourcc("MJPG")), QString("MJPG"));
+    QVERIFY(V4L2Capture::isCaptureDevice("/dev/video0"));
+    QVERIFY(!V4L2Capture::isCaptureDevice("rtsp://camera/stream"));
+}
+
+void TestV4L2Capture::openFailures()
+{
+    V4L2Capture missing("/dev/video-missing");
+    QVERIFY(!missing.open(V4L2Capture::Format()));
+    QVERIFY(missing.errorString().startsWith("/dev/video-missing: cannot open"));
+    QVERIFY(!missing.start());
+    QVERIFY(!missing.isOpen());
+
+    V4L2Capture notCamera("/dev/null");
+    QVERIFY(!notCamera.open(V4L2Capture::Format()));
+    QVERIFY(notCamera.errorString().contains("not a V4L2 device"));
+}
+
+void TestV4L2Capture::capture()
+{
+    if (m_device.isEmpty()) {
+        QSKIP("no V4L2 capture device, load vivid to run this");
+    }
+    V4L2Capture capture(m_device);
+    QVERIFY(capture.open(V4L2Capture::Format()));
+    QVERIFY(capture.size().isValid());
+    QVERIFY(capture.fps() > 0.0);
+    collect(capture);
+    QVERIFY(capture.start());
+    QVERIFY(capture.isStreaming());
+
+    // Each frame is the driver's buffer, released here right away
+    QTRY_VERIFY_WITH_TIMEOUT(!m_frames.isEmpty(), 5000);
+    qint64 lastStartTime = -1;
+    for (int received = 0; received < 10; ++received) {
+        QTRY_VERIFY_WITH_TIMEOUT(!m_frames.isEmpty(), 5000);
+        QVideoFrame frame = m_frames.takeFirst();
+        QCOMPARE(frame.size(), capture.size());
+        QVERIFY(frame.startTime() > lastStartTime);
+        if (lastStartTime < 0) {
+            QCOMPARE(frame.startTime(), qint64(0));
+        }
+        lastStartTime = frame.startTime();
+        QVERIFY(frame.map(QVideoFrame::ReadOnly));
+        QVERIFY(frame.bits(0) != nullptr);
+        frame.unmap();
+    }
+
+    capture.stop();
+    QVERIFY(!capture.isStreaming());
+    QVERIFY(capture.framesCaptured() >= 10);
+    // A stopped capture starts again
+    m_frames.clear();
+    QVERIFY(capture.start());
+    QTRY_VERIFY_WITH_TIMEOUT(!m_frames.isEmpty(), 5000);
+}
+
+void TestV4L2Capture::dropWhileHeld()
+{
+    if (m_device.isEmpty()) {
+        QSKIP("no V4L2 capture device, load vivid to run this");
+    }
+    V4L2Capture capture(m_device);
+    QVERIFY(capture.open(V4L2Capture::Format()));
+    V4L2Capture::DropPolicy policy;
+    policy.maxInFlight = 1;
+    capture.setDropPolicy(policy);
+    collect(capture);
+    QVERIFY(capture.start());
+
+    // Nothing more is delivered while the one frame allowed is held
+    QTRY_COMPARE_WITH_TIMEOUT(m_frames.size(), 1, 5000);
+    const quint64 dropped = capture.framesDropped();
+    QTest::qWait(500);
+    QCOMPARE(m_frames.size(), 1);
+    QVERIFY(capture.framesDropped() > dropped);
+
+    // Releasing it lets the next one through
+    m_frames.clear();
+    QTRY_VERIFY_WITH_TIMEOUT(!m_frames.isEmpty(), 5000);
+}
+
+NEURODRIVE_TEST(TestV4L2Capture)
+#include "tst_v4l2capture.moc"
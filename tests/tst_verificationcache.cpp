@@ -0,0 +1,135 @@
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTest>
+#include "TestRegistry.h"
+#include "VerificationCache.h"
+
+// VerificationCache in a temporary directory: entries match only an exact
+// re-upload of the capture, survive a reopen, and are dropped on revoke or
+// a failed integrity check
+class TestVerificationCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void exactCapture();
+    void revoke();
+    void reopen();
+    void tampered();
+
+private:
+    // A capture file with the given contents, returning its path
+    static QString writeCapture(const QTemporaryDir &directory, const QString &name, const QByteArray &contents);
+};
+
+QString TestVerificationCache::writeCapture(const QTemporaryDir &directory, const QString &name,
+                                            const QByteArray &contents)
+{
+    const QString path = directory.filePath(name);
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(contents);
+    }
+    return path;
+}
+
+void TestVerificationCache::exactCapture()
+{
+    QTemporaryDir directory;
+    const QByteArray capture(4096, 'a');
+    QByteArray oneByteOff = capture;
+    oneByteOff[2048] = 'b';
+    const QByteArray fingerprint = VerificationCache::fingerprint(writeCapture(directory, "a.jpg", capture));
+    QCOMPARE(fingerprint.size(), 32);
+    QCOMPARE(VerificationCache::fingerprint(writeCapture(directory, "copy.jpg", capture)), fingerprint);
+    QVERIFY(VerificationCache::fingerprint(directory.filePath("missing.jpg")).isEmpty());
+
+    VerificationCache cache(directory.filePath("cache"), directory.filePath("key"));
+    cache.open();
+    cache.store("car-1", "Driver", fingerprint);
+    VerificationCache::Entry entry;
+    QVERIFY(cache.lookup("car-1", fingerprint, &entry));
+    QCOMPARE(entry.driverName, QString("Driver"));
+
+    // Any other capture, however close, or another car goes to the server
+    const QString other = writeCapture(directory, "b.jpg", oneByteOff);
+    QVERIFY(!cache.lookup("car-1", VerificationCache::fingerprint(other), &entry));
+    QVERIFY(!cache.lookup("car-2", fingerprint, &entry));
+    cache.store("car-1", "Driver", QByteArray());
+    QCOMPARE(cache.size(), 1);
+
+    // The key is kept apart from the entries it protects
+    QVERIFY(QFile::exists(directory.filePath("key/verification-cache.key")));
+    QVERIFY(!QFile::exists(directory.filePath("cache/verification-cache.key")));
+    const QFileDevice::Permissions permissions = QFileInfo(directory.filePath("key/verification-cache.key")).permissions();
+    QVERIFY(!(permissions & (QFileDevice::ReadGroup | QFileDevice::ReadOther)));
+}
+
+void TestVerificationCache::revoke()
+{
+    QTemporaryDir directory;
+    const QByteArray fingerprint = VerificationCache::fingerprint(writeCapture(directory, "a.jpg", "capture"));
+    VerificationCache cache(directory.filePath("cache"), directory.filePath("key"));
+    cache.open();
+    cache.store("car-1", "Driver", fingerprint);
+    cache.revoke("car-1", fingerprint);
+    VerificationCache::Entry entry;
+    QVERIFY(!cache.lookup("car-1", fingerprint, &entry));
+    QCOMPARE(cache.size(), 0);
+
+    // Until the server confirms the driver again
+    cache.store("car-1", "Driver", fingerprint);
+    QVERIFY(cache.lookup("car-1", fingerprint, &entry));
+}
+
+void TestVerificationCache::reopen()
+{
+    QTemporaryDir directory;
+    const QByteArray fingerprint = VerificationCache::fingerprint(writeCapture(directory, "a.jpg", "capture"));
+    {
+        VerificationCache cache(directory.filePath("cache"), directory.filePath("key"));
+        cache.open();
+        cache.store("car-1", "Driver", fingerprint);
+    }
+    VerificationCache reopened(directory.filePath("cache"), directory.filePath("key"));
+    QCOMPARE(reopened.size(), 0);
+    reopened.open();
+    VerificationCache::Entry entry;
+    QVERIFY(reopened.lookup("car-1", fingerprint, &entry));
+    QCOMPARE(entry.fingerprint, fingerprint);
+    QCOMPARE(entry.expiresAtMs - entry.verifiedAtMs, reopened.policy().ttlSeconds * 1000);
+
+    // Without its key the cache starts over
+    QVERIFY(QFile::remove(directory.filePath("key/verification-cache.key")));
+    VerificationCache rekeyed(directory.filePath("cache"), directory.filePath("key"));
+    rekeyed.open();
+    QVERIFY(!rekeyed.lookup("car-1", fingerprint, &entry));
+}
+
+void TestVerificationCache::tampered()
+{
+    QTemporaryDir directory;
+    const QByteArray fingerprint = VerificationCache::fingerprint(writeCapture(directory, "a.jpg", "capture"));
+    {
+        VerificationCache cache(directory.filePath("cache"), directory.filePath("key"));
+        cache.open();
+        cache.store("car-1", "Driver", fingerprint);
+    }
+    QFile file(directory.filePath("cache/verification-cache.bin"));
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QByteArray data = file.readAll();
+    data[8] = char(data[8] ^ 1);
+    QVERIFY(file.seek(0));
+    file.write(data);
+    file.close();
+
+    VerificationCache reopened(directory.filePath("cache"), directory.filePath("key"));
+    reopened.open();
+    VerificationCache::Entry entry;
+    QVERIFY(!reopened.lookup("car-1", fingerprint, &entry));
+    QVERIFY(!file.exists());
+}
+
+NEURODRIVE_TEST(TestVerificationCache)
+#include "tst_verificationcache.moc"
@@ -0,0 +1,159 @@
+#include <QRegularExpression>
+#include <QSignalSpy>
+#include <QTest>
+#include "TestRegistry.h"
+#include "WorkerChannel.h"
+
+#include <cstring>
+
+// WorkerChannel fed by hand, one read at a time: lines split across reads,
+// a line that fills the whole buffer, and start and done lines with fields
+// that are missing or not numbers
+class TestWorkerChannel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void splitLine();
+    void fullBuffer();
+    void malformedFields();
+};
+
+namespace {
+
+// Stands in for a worker's stdout: each feed() is what one read returns
+class FeedDevice : public QIODevice
+{
+public:
+    FeedDevice() { open(QIODevice::ReadOnly | QIODevice::Unbuffered); }
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override { return m_data.size() + QIODevice::bytesAvailable(); }
+
+    void feed(const QByteArray &data)
+    {
+        m_data += data;
+        emit readyRead();
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        const qint64 size = qMin<qint64>(maxSize, m_data.size());
+        std::memcpy(data, m_data.constData(), size_t(size));
+        m_data.remove(0, size);
+        return size;
+    }
+
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    QByteArray m_data;
+};
+
+} // namespace
+
+void TestWorkerChannel::splitLine()
+{
+    FeedDevice device;
+    WorkerChannel channel("test", &device);
+    QSignalSpy started(&channel, &WorkerChannel::workerStarted);
+    QSignalSpy frames(&channel, &WorkerChannel::frameProcessed);
+
+    // Nothing is reported until the newline arrives
+    device.feed("ND1\tsta");
+    QCOMPARE(started.size(), 0);
+    device.feed("rt\t100\t30");
+    QCOMPARE(started.size(), 0);
+    device.feed("\n");
+    QCOMPARE(started.size(), 1);
+    QCOMPARE(started.at(0).at(0).toLongLong(), qint64(100));
+    QCOMPARE(started.at(0).at(1).toDouble(), 30.0);
+
+    // Detections batched until their frame event, across reads, with CRLF
+    device.feed("ND1\tdet\t0\t2\t0.5\t10\t20\t30\t40\r\nND1\tframe\t0\t29.5\t12");
+    QCOMPARE(frames.size(), 0);
+    device.feed(".5\r\nstub log line\nND1\tframe\t1\t30\t8\n");
+    QCOMPARE(frames.size(), 2);
+    QCOMPARE(frames.at(0).at(0).toLongLong(), qint64(0));
+    QCOMPARE(frames.at(0).at(2).toDouble(), 12.5);
+    const QList<Detection> detections = frames.at(0).at(3).value<QList<Detection>>();
+    QCOMPARE(detections.size(), 1);
+    QCOMPARE(detections.at(0).classId, 2);
+    QCOMPARE(detections.at(0).box, QRectF(QPointF(10, 20), QPointF(30, 40)));
+    QVERIFY(frames.at(1).at(3).value<QList<Detection>>().isEmpty());
+    QCOMPARE(channel.framesProcessed(), qint64(2));
+
+    // A worker that dies mid-line still has its last line read
+    device.feed("ND1\tdone\t2");
+    QVERIFY(!channel.isDone());
+    channel.flush();
+    QVERIFY(channel.isDone());
+}
+
+void TestWorkerChannel::fullBuffer()
+{
+    FeedDevice device;
+    WorkerChannel channel("test", &device);
+    QSignalSpy started(&channel, &WorkerChannel::workerStarted);
+    QSignalSpy done(&channel, &WorkerChannel::workerDone);
+
+    // A line that fills the buffer without a newline is dropped up to its
+    // end, and the lines after it are read as usual
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("worker line exceeds"));
+    device.feed("ND1\tstart\t10\t30\n");
+    device.feed("ND1\terror\t" + QByteArray(WorkerChannel::BufferSize, 'x'));
+    device.feed(QByteArray(100, 'x') + "\nND1\tdone\t10\n");
+    QCOMPARE(started.size(), 1);
+    QCOMPARE(done.size(), 1);
+    QCOMPARE(done.at(0).at(0).toLongLong(), qint64(10));
+
+    // Exactly a buffer's worth, newline included, still fits
+    QSignalSpy errors(&channel, &WorkerChannel::workerError);
+    const QByteArray prefix("ND1\terror\t");
+    device.feed(prefix + QByteArray(WorkerChannel::BufferSize - prefix.size() - 1, 'y') + "\n");
+    QCOMPARE(errors.size(), 1);
+    QCOMPARE(errors.at(0).at(0).toString().size(), qsizetype(WorkerChannel::BufferSize - prefix.size() - 1));
+}
+
+void TestWorkerChannel::malformedFields()
+{
+    FeedDevice device;
+    WorkerChannel channel("test", &device);
+    QSignalSpy started(&channel, &WorkerChannel::workerStarted);
+    QSignalSpy done(&channel, &WorkerChannel::workerDone);
+
+    // Without the optional first frame a worker counts from 0; fields that
+    // are not numbers read as 0 rather than stopping the channel
+    device.feed("ND1\tstart\t300\t30\nND1\tframe\t0\t30\t5\n");
+    QCOMPARE(channel.framesProcessed(), qint64(1));
+    device.feed("ND1\tstart\tmany\tfast\tsoon\n");
+    QCOMPARE(started.size(), 2);
+    QCOMPARE(channel.expectedFrames(), qint64(0));
+    QCOMPARE(channel.fps(), 0.0);
+    QCOMPARE(channel.framesProcessed(), qint64(0));
+    device.feed("ND1\tstart\n");
+    QCOMPARE(started.size(), 3);
+    QCOMPARE(channel.expectedFrames(), qint64(0));
+
+    // A done line without a usable count keeps the frames counted so far
+    device.feed("ND1\tstart\t300\t30\t120\nND1\tframe\t120\t30\t5\n");
+    QCOMPARE(started.size(), 4);
+    QCOMPARE(channel.expectedFrames(), qint64(300));
+    QCOMPARE(channel.framesProcessed(), qint64(121));
+    device.feed("ND1\tdone\tall\n");
+    QCOMPARE(done.size(), 1);
+    QVERIFY(channel.isDone());
+    QCOMPARE(channel.framesProcessed(), qint64(121));
+    device.feed("ND1\tdone\n");
+    QCOMPARE(done.size(), 2);
+    QCOMPARE(done.at(1).at(0).toLongLong(), qint64(121));
+
+    // A resumed worker is no longer done
+    device.feed("ND1\tstart\t300\t30\t200\n");
+    QVERIFY(!channel.isDone());
+    QCOMPARE(channel.framesProcessed(), qint64(200));
+}
+
+NEURODRIVE_TEST(TestWorkerChannel)
+#include "tst_workerchannel.moc"
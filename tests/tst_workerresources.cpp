@@ -0,0 +1,253 @@
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QThread>
+#include "TestRegistry.h"
+#include "WorkerResources.h"
+
+#include <sched.h>
+#include <sys/resource.h>
+
+// WorkerResources against a fake procfs and cgroup tree under
+// NEURODRIVE_PROC_ROOT and NEURODRIVE_SYSFS_ROOT: the fake /proc/<pid>/task
+// names a real child, so its affinity and nice level can be read back, and
+// the cgroup files it writes land in the fake tree
+class TestWorkerResources : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+    void affinityAndNice();
+    void childModifier();
+    void cgroupPlacement();
+    void cgroupNotDelegated();
+
+private:
+    static constexpr int Model = 1;
+    static void writeFile(const QString &path, const QByteArray &value);
+    static QByteArray readFile(const QString &path);
+    static QList<int> affinity(qint64 pid);
+    // Points NEURODRIVE_SYSFS_ROOT and NEURODRIVE_PROC_ROOT into root
+    static void useFakeRoots(const QTemporaryDir &root);
+    // A sleeping child listed as its own only task in the fake /proc
+    static qint64 startChild(QProcess &child, const QTemporaryDir &root);
+    // The fake /proc/self/cgroup and a delegated cgroup offering controllers
+    static QString delegateCgroup(const QTemporaryDir &root, const QByteArray &controllers);
+};
+
+namespace {
+
+// A child process that is killed when the test leaves, however it leaves
+struct Child
+{
+    QProcess process;
+
+    ~Child()
+    {
+        process.kill();
+        process.waitForFinished();
+    }
+};
+
+} // namespace
+
+void TestWorkerResources::cleanup()
+{
+    // The other tests read the real /proc and /sys
+    qunsetenv("NEURODRIVE_SYSFS_ROOT");
+    qunsetenv("NEURODRIVE_PROC_ROOT");
+}
+
+void TestWorkerResources::useFakeRoots(const QTemporaryDir &root)
+{
+    qputenv("NEURODRIVE_SYSFS_ROOT", root.filePath("sys").toUtf8());
+    qputenv("NEURODRIVE_PROC_ROOT", root.filePath("proc").toUtf8());
+}
+
+void TestWorkerResources::writeFile(const QString &path, const QByteArray &value)
+{
+    QDir().mkpath(QFileInfo(path).path());
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(value);
+}
+
+QByteArray TestWorkerResources::readFile(const QString &path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll().trimmed() : QByteArray();
+}
+
+QList<int> TestWorkerResources::affinity(qint64 pid)
+{
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    QList<int> cores;
+    if (sched_getaffinity(pid_t(pid), sizeof(mask), &mask) == 0) {
+        for (int core = 0; core < CPU_SETSIZE; ++core) {
+            if (CPU_ISSET(core, &mask)) {
+                cores.append(core);
+            }
+        }
+    }
+    return cores;
+}
+
+qint64 TestWorkerResources::startChild(QProcess &child, const QTemporaryDir &root)
+{
+    child.start("sleep", { "30" });
+    if (!child.waitForStarted()) {
+        return -1;
+    }
+    const qint64 pid = child.processId();
+    QDir().mkpath(root.filePath(QString("proc/%1/task/%1").arg(pid)));
+    return pid;
+}
+
+QString TestWorkerResources::delegateCgroup(const QTemporaryDir &root, const QByteArray &controllers)
+{
+    writeFile(root.filePath("proc/self/cgroup"), "0::/user.slice/neurodrive.scope\n");
+    const QString cgroup = root.filePath("sys/fs/cgroup/user.slice/neurodrive.scope");
+    writeFile(cgroup + "/cgroup.controllers", controllers + "\n");
+    writeFile(cgroup + "/cgroup.procs", QByteArray::number(QCoreApplication::applicationPid()) + "\n");
+    writeFile(cgroup + "/cgroup.subtree_control", "");
+    return cgroup;
+}
+
+void TestWorkerResources::affinityAndNice()
+{
+    QTemporaryDir directory;
+    useFakeRoots(directory);
+    Child child;
+    const qint64 pid = startChild(child.process, directory);
+    QVERIFY(pid > 0);
+
+    WorkerResources resources;
+    resources.setModelKey(Model, "traffic");
+    resources.setReservedCores({});
+    QSignalSpy applied(&resources, &WorkerResources::policyApplied);
+    WorkerResources::Policy policy;
+    policy.nice = 12;
+    resources.setPolicy(Model, policy);
+    resources.attach(Model, pid);
+    QCOMPARE(applied.size(), 1);
+    QCOMPARE(applied.at(0).at(1).toLongLong(), pid);
+    QCOMPARE(getpriority(PRIO_PROCESS, id_t(pid)), 12);
+
+    // A change reaches the running worker at once
+    policy.nice = 15;
+    resources.setPolicy(Model, policy);
+    QCOMPARE(applied.size(), 2);
+    QCOMPARE(getpriority(PRIO_PROCESS, id_t(pid)), 15);
+
+    const int coreCount = QThread::idealThreadCount();
+    if (coreCount < 2) {
+        QSKIP("pinning needs at least two cores");
+    }
+    // Reserving the first core pins the worker to the others
+    resources.setReservedCores({0});
+    QCOMPARE(applied.size(), 3);
+    QList<int> expected;
+    for (int core = 1; core < coreCount; ++core) {
+        expected.append(core);
+    }
+    QCOMPARE(affinity(pid), expected);
+
+    // Only the listed cores, and never a reserved one
+    policy.cores = {0, 1};
+    resources.setPolicy(Model, policy);
+    QCOMPARE(affinity(pid), QList<int>({1}));
+    QVERIFY(applied.last().at(2).toString().startsWith("cores 1, nice 15"));
+}
+
+void TestWorkerResources::childModifier()
+{
+    QTemporaryDir directory;
+    useFakeRoots(directory);
+    WorkerResources resources;
+    WorkerResources::Policy policy;
+    policy.nice = 11;
+    const int coreCount = QThread::idealThreadCount();
+    if (coreCount >= 2) {
+        policy.cores = {coreCount - 1};
+    }
+    resources.setReservedCores({});
+    resources.setPolicy(Model, policy);
+
+    Child child;
+    child.process.setChildProcessModifier(resources.childModifier(Model));
+    child.process.start("sleep", { "30" });
+    QVERIFY(child.process.waitForStarted());
+    const qint64 pid = child.process.processId();
+    QCOMPARE(getpriority(PRIO_PROCESS, id_t(pid)), 11);
+    if (coreCount >= 2) {
+        QCOMPARE(affinity(pid), QList<int>({coreCount - 1}));
+    }
+}
+
+void TestWorkerResources::cgroupPlacement()
+{
+    QTemporaryDir directory;
+    useFakeRoots(directory);
+    const QString root = delegateCgroup(directory, "cpu io memory");
+    Child child;
+    const qint64 pid = startChild(child.process, directory);
+    QVERIFY(pid > 0);
+
+    WorkerResources resources;
+    resources.setModelKey(Model, "traffic");
+    QVERIFY(!resources.cgroupsAvailable());
+    WorkerResources::Policy policy;
+    policy.cpuMaxPercent = 150;
+    policy.memoryMaxMb = 256;
+    resources.setPolicy(Model, policy);
+    resources.attach(Model, pid);
+
+    // The dashboard moves into its own leaf, and the worker into worker-<key>
+    QVERIFY(resources.cgroupsAvailable());
+    QCOMPARE(readFile(root + "/dashboard/cgroup.procs"), QByteArray::number(QCoreApplication::applicationPid()));
+    QCOMPARE(readFile(root + "/cgroup.subtree_control"), QByteArray("+memory"));
+    const QString worker = root + "/worker-traffic";
+    QCOMPARE(readFile(worker + "/cpu.max"), QByteArray("150000 100000"));
+    QCOMPARE(readFile(worker + "/memory.max"), QByteArray::number(256 * 1024 * 1024));
+    QCOMPARE(readFile(worker + "/cgroup.procs"), QByteArray::number(pid));
+
+    // Dropping the limits lifts them rather than leaving the worker capped
+    policy.cpuMaxPercent = 0;
+    policy.memoryMaxMb = 0;
+    resources.setPolicy(Model, policy);
+    QCOMPARE(readFile(worker + "/cpu.max"), QByteArray("max 100000"));
+    QCOMPARE(readFile(worker + "/memory.max"), QByteArray("max"));
+}
+
+void TestWorkerResources::cgroupNotDelegated()
+{
+    QTemporaryDir directory;
+    useFakeRoots(directory);
+    const QString root = delegateCgroup(directory, "io");
+    Child child;
+    const qint64 pid = startChild(child.process, directory);
+    QVERIFY(pid > 0);
+
+    WorkerResources resources;
+    resources.setModelKey(Model, "traffic");
+    QSignalSpy applied(&resources, &WorkerResources::policyApplied);
+    WorkerResources::Policy policy;
+    policy.cpuMaxPercent = 150;
+    resources.setPolicy(Model, policy);
+    resources.attach(Model, pid);
+
+    // Scheduling still applies; the limits are left out
+    QCOMPARE(applied.size(), 1);
+    QVERIFY(!resources.cgroupsAvailable());
+    QVERIFY(!QFileInfo::exists(root + "/worker-traffic"));
+    QVERIFY(!QFileInfo::exists(root + "/dashboard"));
+}
+
+NEURODRIVE_TEST(TestWorkerResources)
+#include "tst_workerresources.moc"
@@ -0,0 +1,107 @@
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTest>
+#include "ProcessManager.h"
+#include "TestRegistry.h"
+
+// A worker killed mid-run, restarted by the supervisor after its backoff and
+// resumed from its checkpoint, with stub_worker.py's crash injection standing
+// in for the OOM killer
+class TestWorkerSupervisor : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void restartAfterCrash();
+};
+
+namespace {
+
+const int CrashAt = 20;
+const int CrashTimes = 2;
+const int Frames = 40;
+
+} // namespace
+
+void TestWorkerSupervisor::initTestCase()
+{
+    if (QStandardPaths::findExecutable("python3").isEmpty()) {
+        QSKIP("python3 is not installed");
+    }
+    // The first two starts SIGKILL themselves at CrashAt, the third runs through
+    qputenv("STUB_STARTUP_S", "0");
+    qputenv("STUB_LOG_LINES", "0");
+    qputenv("STUB_FRAMES", QByteArray::number(Frames));
+    qputenv("STUB_CRASH_AT", QByteArray::number(CrashAt));
+    qputenv("STUB_CRASH_TIMES", QByteArray::number(CrashTimes));
+}
+
+void TestWorkerSupervisor::cleanupTestCase()
+{
+    qunsetenv("STUB_CRASH_AT");
+    qunsetenv("STUB_CRASH_TIMES");
+}
+
+void TestWorkerSupervisor::restartAfterCrash()
+{
+    ProcessManager manager;
+    manager.setPythonExecutable("python3");
+    manager.setDrowsinessPath(sourcePath("stub_worker.py"));
+    const WorkerSupervisor::Policy policy = manager.supervisor()->policy();
+
+    // Per start: when it was scheduled and the first frame it reported
+    QElapsedTimer clock;
+    clock.start();
+    QList<qint64> restartingMs;
+    QList<qint64> startedMs;
+    QList<qint64> firstFrames;
+    connect(&manager, &ProcessManager::workerRestarting, this, [&]() {
+        restartingMs.append(clock.elapsed());
+    });
+    connect(&manager, &ProcessManager::modelStarted, this, [&]() {
+        startedMs.append(clock.elapsed());
+        firstFrames.append(-1);
+    });
+    connect(&manager, &ProcessManager::frameProcessed, this, [&](int, qint64 frameIndex) {
+        if (!firstFrames.isEmpty() && firstFrames.last() < 0) {
+            firstFrames.last() = frameIndex;
+        }
+    });
+    QSignalSpy restarting(&manager, &ProcessManager::workerRestarting);
+    QSignalSpy completed(&manager, &ProcessManager::modelCompleted);
+
+    manager.startModel(ProcessManager::Drowsiness);
+    QVERIFY(completed.wait(30000));
+    QCOMPARE(completed.at(0).at(1).toLongLong(), qint64(Frames));
+
+    QCOMPARE(restarting.size(), CrashTimes);
+    QCOMPARE(manager.supervisor()->restarts(ProcessManager::Drowsiness), CrashTimes);
+    QCOMPARE(startedMs.size(), CrashTimes + 1);
+    QCOMPARE(firstFrames.first(), qint64(0));
+
+    int expectedDelayMs = policy.initialBackoffMs;
+    for (int i = 0; i < restarting.size(); ++i) {
+        const QList<QVariant> &event = restarting.at(i);
+        QCOMPARE(event.at(0).toInt(), int(ProcessManager::Drowsiness));
+        QCOMPARE(event.at(1).toInt(), i + 1);
+
+        // The backoff doubles with every restart in a row and is waited out
+        QCOMPARE(event.at(2).toInt(), expectedDelayMs);
+        QVERIFY(startedMs.at(i + 1) - restartingMs.at(i) >= expectedDelayMs);
+        expectedDelayMs *= 2;
+
+        // Each worker checkpointed before it was killed and its successor
+        // picks up on the frame after the checkpoint, not at frame 0
+        const qint64 resumeFrame = event.at(3).toLongLong();
+        QVERIFY(resumeFrame >= 0);
+        QVERIFY(resumeFrame < CrashAt);
+        QCOMPARE(firstFrames.at(i + 1), resumeFrame + 1);
+    }
+    QVERIFY(restarting.at(1).at(3).toLongLong() >= restarting.at(0).at(3).toLongLong());
+}
+
+NEURODRIVE_TEST(TestWorkerSupervisor)
+#include "tst_workersupervisor.moc"
@@ -7,6 +7,8 @@ from ultralytics import YOLO
 import os
 import logging
 import uvicorn
+import time
+from worker_ipc import open_checkpoint, open_frame_ring, open_video, read_frame, open_worker_control, resume_input, WorkerEvents
 
 logging.basicConfig(level=logging.INFO)
 logger = logging.getLogger(__name__)
@@ -41,15 +43,18 @@ async def get_index():
         raise
 
 def process_video(input_filename):
+    events = WorkerEvents()
     input_path = os.path.join(os.getcwd(), input_filename)
     output_path = os.path.join(os.getcwd(), 'output.avi')
     if not os.path.exists(input_path):
         logger.error(f"{input_filename} not found in project root.")
+        events.error(f"{input_filename} not found in project root")
         return False
     
-    cap = cv2.VideoCapture(input_path)
+    cap = open_video(input_path)
     if not cap.isOpened():
         logger.error("Could not open input video")
+        events.error("Could not open input video")
         return False
     
     # Get video properties
@@ -58,11 +63,17 @@ def process_video(input_filename):
     height = int(cap.get(cv2.CAP_PROP_FRAME_HEIGHT))
     total_frames = int(cap.get(cv2.CAP_PROP_FRAME_COUNT))
     
+    # Raspberry Pi defaults; when launched by the dashboard its rate governor
+    # adjusts them while the video plays
+    detect_stride = 3  # Run detection on every 3rd processed frame
+    max_width = 640
+    control = open_worker_control()
+    
     # Reduce resolution for Raspberry Pi performance
     # Scale down if resolution is too high
-    if width > 640:
-        scale_factor = 640 / width
-        width = 640
+    if width > max_width:
+        scale_factor = max_width / width
+        width = max_width
         height = int(height * scale_factor)
         logger.info(f"Scaling down video to {width}x{height} for better performance")
     
@@ -70,41 +81,89 @@ def process_video(input_filename):
     target_fps = min(fps, 15)  # Limit to 15 FPS max
     logger.info(f"Processing at {target_fps} FPS (original: {fps})")
     
-    # Use XVID codec for better compatibility with Qt
-    fourcc = cv2.VideoWriter_fourcc(*'XVID')
-    out = cv2.VideoWriter(output_path, fourcc, target_fps, (width, height))
-    
-    if not out.isOpened():
-        logger.warning("Could not open video writer with XVID, trying MJPG...")
-        fourcc = cv2.VideoWriter_fourcc(*'MJPG')
+    # When launched by the dashboard, frames go straight to its shared-memory
+    # ring and nothing is written to disk
+    ring = open_frame_ring()
+    out = None
+    if ring is None:
+        # Use XVID codec for better compatibility with Qt
+        fourcc = cv2.VideoWriter_fourcc(*'XVID')
         out = cv2.VideoWriter(output_path, fourcc, target_fps, (width, height))
-        
-    if not out.isOpened():
-        logger.error("Could not open video writer")
-        return False
+
+        if not out.isOpened():
+            logger.warning("Could not open video writer with XVID, trying MJPG...")
+            fourcc = cv2.VideoWriter_fourcc(*'MJPG')
+            out = cv2.VideoWriter(output_path, fourcc, target_fps, (width, height))
+
+        if not out.isOpened():
+            logger.error("Could not open video writer")
+            events.error("Could not open video writer")
+            return False
     
     frame_count = 0
     processed_frames = 0
+    detections = []
+    since_detection = detect_stride  # The first frame is always detected
     
     logger.info(f"Starting video processing: {total_frames} frames")
+    frame_step = fps / target_fps if fps > target_fps else 1
+    next_frame = frame_step
+    
+    # A worker restarted after a crash carries on from its checkpoint, with
+    # the detections it was showing; the dashboard's stream goes on live.
+    # Frames are numbered by the video's own index, as the other models
+    # number them, and the processed count is kept with the state
+    checkpoint = open_checkpoint()
+    if checkpoint is not None:
+        last, position, state = checkpoint.load()
+        if last is not None:
+            processed_frames = int(state.get('processed', 0))
+            detections = [tuple(d) for d in state.get('detections', [])]
+            if resume_input(cap, position):
+                frame_count = position
+                next_frame = state.get('next_frame', next_frame)
+            logger.info(f"Resuming after frame {last} (input frame {frame_count})")
+    
+    events.start(int(total_frames / frame_step), target_fps, processed_frames)
+    events.class_names(model.names)
     
     while True:
-        ret, frame = cap.read()
+        ret, frame, frame_idx, _ = read_frame(cap)
         if not ret:
             break
         
         frame_count += 1
         
+        if control is not None:
+            settings = control.poll()
+            if settings is not None:
+                detect_stride, max_width, governed_fps, level = settings
+                target_fps = min(fps, governed_fps) if governed_fps > 0 else fps
+                logger.info(f"Governor level {level}: detection every {detect_stride} frames, "
+                            f"up to {max_width} px, {target_fps:.1f} FPS")
+        
         # Skip frames for performance on Raspberry Pi
-        if fps > target_fps and frame_count % int(fps / target_fps) != 0:
-            continue
+        if fps > target_fps:
+            if frame_count < next_frame:
+                continue
+            next_frame += fps / target_fps
+        
+        frame_start = time.perf_counter()
             
-        # Resize frame if needed
-        if frame.shape[1] != width or frame.shape[0] != height:
-            frame = cv2.resize(frame, (width, height))
+        # Resize frame if needed; the dashboard takes frames at any size,
+        # output.avi only at the size it was opened with
+        if ring is None:
+            if frame.shape[1] != width or frame.shape[0] != height:
+                frame = cv2.resize(frame, (width, height))
+        elif max_width > 0 and frame.shape[1] > max_width:
+            frame = cv2.resize(frame, (max_width, int(frame.shape[0] * max_width / frame.shape[1])))
         
-        # Process every Nth frame for detection to improve performance
-        if processed_frames % 3 == 0:  # Process every 3rd frame
+        # Process every Nth frame for detection to improve performance; the
+        # dashboard tracks the boxes across the frames in between
+        inferred = since_detection >= detect_stride
+        if inferred:
+            since_detection = 0
+            events.inference(frame_idx)
             results = model(frame, conf=0.85, iou=0.85)
             detections = []
             
@@ -114,41 +173,65 @@ def process_video(input_filename):
                     cls = int(box.cls[0])
                     conf = float(box.conf[0])
                     class_name = result.names[cls]
-                    detections.append((x1, y1, x2, y2, class_name, conf))
+                    detections.append((x1, y1, x2, y2, cls, class_name, conf))
         
-        # Draw detections from last processing
-        if 'detections' in locals():
-            for x1, y1, x2, y2, class_name, conf in detections:
+        since_detection += 1
+        
+        # Report fresh detections only; the dashboard draws them itself, so
+        # the last ones are only burnt in when writing output.avi
+        for x1, y1, x2, y2, cls, class_name, conf in detections:
+            if ring is None:
                 cv2.rectangle(frame, (x1, y1), (x2, y2), (0, 255, 0), 2)
                 label = f"{class_name}: {conf:.2f}"
                 cv2.putText(frame, label, (x1, y1 - 10), cv2.FONT_HERSHEY_SIMPLEX, 0.5, (0, 255, 0), 2)
+            if inferred:
+                events.detection(frame_idx, cls, conf, x1, y1, x2, y2)
         
-        out.write(frame)
+        latency_ms = (time.perf_counter() - frame_start) * 1000.0
+        if ring is not None:
+            ring.publish(frame, frame_idx, target_fps)
+        else:
+            out.write(frame)
+        events.frame(frame_idx, latency_ms)
         processed_frames += 1
+        if checkpoint is not None:
+            checkpoint.save(frame_idx, frame_count,
+                            lambda: {'next_frame': next_frame, 'detections': detections,
+                                     'processed': processed_frames})
         
         # Progress reporting
         if processed_frames % 30 == 0:  # Every 30 frames
-            progress = (frame_count / total_frames) * 100
+            progress = (frame_count / max(total_frames, 1)) * 100
             logger.info(f"Progress: {progress:.1f}% ({processed_frames} frames processed)")
     
     cap.release()
-    out.release()
-    logger.info(f"Detection complete. Processed {processed_frames} frames. Saved to {output_path}")
+    if control is not None:
+        control.close()
+    events.done(processed_frames)
+    if ring is not None:
+        ring.close()
+        logger.info(f"Detection complete. Processed {processed_frames} frames. Streamed to dashboard")
+    else:
+        out.release()
+        logger.info(f"Detection complete. Processed {processed_frames} frames. Saved to {output_path}")
     return True
 
+def run_worker():
+    """Entry point for ProcessManager, both as a fresh process and from the fork server"""
+    video_filename = 'vid.mp4'  # Change this if you want a different video
+    success = process_video(video_filename)
+    if success:
+        logger.info("Video processing completed successfully")
+        return 0
+    logger.error("Video processing failed")
+    return 1
+
 if __name__ == '__main__':
     import sys
     
     # If running from ProcessManager, just process video and exit
     if len(sys.argv) == 1:
-        video_filename = 'vid.mp4'  # Change this if you want a different video
-        success = process_video(video_filename)
-        if success:
-            logger.info("Video processing completed successfully")
-            exit(0)
-        else:
-            logger.error("Video processing failed")
-            exit(1)
+        exit(run_worker())
     
     # Only start web server if explicitly requested with --server argument
     if len(sys.argv) > 1 and sys.argv[1] == '--server':
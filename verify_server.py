@@ -0,0 +1,130 @@
+"""
+Local HTTPS stand-in for the driver verification API, for measuring the
+dashboard's login path without the production server.
+
+    python3 verify_server.py [--port 5041] [--cert cert.crt --key cert.key]
+    NEURODRIVE_VERIFY_URL=https://localhost:5041/api/verify-driver ./appNeuroDrive_13_5_2025
+
+Without --cert/--key a self-signed localhost certificate is generated with
+openssl. Each request is logged with whether its TLS session was resumed and
+how many requests its connection has carried, next to the dashboard's
+time-to-first-byte log. Session tickets are only valid while this server
+keeps running, so restart the dashboard, not the server, to see a resumed
+first request.
+
+For the dashboard's verification cache, drivers can be refused or allowed
+again while it runs, and --delay stands in for a poor link:
+
+    curl -k https://localhost:5041/admin/revoke -d '{"carId": "111"}'
+    curl -k https://localhost:5041/admin/authorize -d '{"carId": "111", "driverName": "Test Driver"}'
+"""
+import argparse
+import json
+import os
+import ssl
+import subprocess
+import tempfile
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+AUTHORIZED = {'111': 'Test Driver'}
+
+
+class VerifyHandler(BaseHTTPRequestHandler):
+    # Keep-alive, as the production server does
+    protocol_version = 'HTTP/1.1'
+
+    def setup(self):
+        super().setup()
+        self.requests_on_connection = 0
+
+    def do_POST(self):
+        self.requests_on_connection += 1
+        length = int(self.headers.get('Content-Length', 0))
+        body = self.rfile.read(length)
+
+        if self.path in ('/admin/revoke', '/admin/authorize'):
+            self._admin(body)
+            return
+        if self.path != '/api/verify-driver':
+            self._reply(404, {'success': False, 'isAuthorized': False, 'message': 'Not found'})
+            return
+        try:
+            request = json.loads(body)
+            car_id = str(request['carId'])
+            image = request['imageBase64']
+        except (ValueError, KeyError) as e:
+            self._reply(400, {'success': False, 'isAuthorized': False, 'message': f'Bad request: {e}'})
+            return
+
+        print(f"carId={car_id} body={len(body)} bytes image={len(image)} chars "
+              f"tls={self.connection.version()} resumed={self.connection.session_reused} "
+              f"request {self.requests_on_connection} on this connection", flush=True)
+        if self.server.delay > 0:
+            time.sleep(self.server.delay)
+        if car_id in AUTHORIZED:
+            self._reply(200, {'success': True, 'isAuthorized': True,
+                              'message': 'Driver verified successfully', 'driverName': AUTHORIZED[car_id]})
+        else:
+            self._reply(200, {'success': True, 'isAuthorized': False,
+                              'message': 'Driver not recognized or unauthorized'})
+
+    def _admin(self, body):
+        try:
+            request = json.loads(body)
+            car_id = str(request['carId'])
+        except (ValueError, KeyError) as e:
+            self._reply(400, {'message': f'Bad request: {e}'})
+            return
+        if self.path == '/admin/revoke':
+            AUTHORIZED.pop(car_id, None)
+        else:
+            AUTHORIZED[car_id] = request.get('driverName', 'Test Driver')
+        print(f"{self.path}: authorized cars are now {sorted(AUTHORIZED)}", flush=True)
+        self._reply(200, {'authorized': sorted(AUTHORIZED)})
+
+    def _reply(self, status, payload):
+        data = json.dumps(payload).encode()
+        self.send_response(status)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+
+def self_signed_certificate():
+    directory = tempfile.mkdtemp(prefix='neurodrive-verify-')
+    cert = os.path.join(directory, 'cert.crt')
+    key = os.path.join(directory, 'cert.key')
+    subprocess.run(['openssl', 'req', '-x509', '-nodes', '-days', '1', '-newkey', 'rsa:2048',
+                    '-keyout', key, '-out', cert, '-subj', '/CN=localhost'],
+                   check=True, capture_output=True)
+    return cert, key
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('--port', type=int, default=5041)
+    parser.add_argument('--cert')
+    parser.add_argument('--key')
+    parser.add_argument('--delay', type=float, default=0.0, help='seconds to hold each verification')
+    args = parser.parse_args()
+
+    cert, key = (args.cert, args.key) if args.cert and args.key else self_signed_certificate()
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.load_cert_chain(cert, key)
+    # No HTTP/2 in the standard library; the dashboard falls back to HTTP/1.1
+    context.set_alpn_protocols(['http/1.1'])
+
+    server = ThreadingHTTPServer(('localhost', args.port), VerifyHandler)
+    server.socket = context.wrap_socket(server.socket, server_side=True)
+    server.delay = args.delay
+    print(f"Verification stand-in on https://localhost:{args.port}/api/verify-driver", flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,545 @@
+"""
+Helpers shared by the NeuroDrive model workers (traffic.py, lane.py,
+drowsiness.py) for talking to the dashboard's ProcessManager.
+
+Deploy this file next to each worker's main.py.
+"""
+import json
+import mmap
+import os
+import struct
+import sys
+import time
+from datetime import datetime
+
+import cv2
+import numpy as np
+
+# Must match FrameRing.h
+FRAME_RING_MAGIC = 0x5246444E
+FRAME_RING_VERSION = 2
+FORMAT_BGRX8888 = 1
+RING_HEADER_SIZE = 64
+SLOT_HEADER_SIZE = 64
+
+# Ring header field offsets
+OFF_MAGIC = 0
+OFF_VERSION = 4
+OFF_SLOT_COUNT = 8
+OFF_SLOT_CAPACITY = 12
+OFF_PUBLISHED = 16
+OFF_PINNED = 24
+OFF_WRITER_PID = 28
+OFF_LATEST_SLOT = 32
+OFF_FLAGS = 36
+OFF_READER_PID = 40
+OFF_EXPECTED_FRAMES = 44
+OFF_FPS_MILLI = 48
+OFF_FRAME_WIDTH = 52
+OFF_FRAME_HEIGHT = 56
+OFF_WORKER_PINNED = 60  # This side's pins; OFF_PINNED is the dashboard's
+
+# Ring header flags
+FLAG_END_OF_STREAM = 1
+
+# Slot header field offsets
+SLOT_OFF_SEQUENCE = 0
+SLOT_OFF_FRAME_INDEX = 8
+SLOT_OFF_TIMESTAMP = 16
+SLOT_OFF_GEOMETRY = 24  # width, height, stride, format
+
+# Frame rate assumed for timing a source that reports neither timestamps nor fps
+DEFAULT_FPS = 30.0
+
+
+class FrameRingWriter:
+    """Publishes processed frames into the shared-memory ring ProcessManager maps."""
+
+    def __init__(self, name):
+        path = '/dev/shm/' + name.lstrip('/')
+        self._file = open(path, 'r+b')
+        self._mm = mmap.mmap(self._file.fileno(), 0)
+
+        magic, version, slot_count, slot_capacity = struct.unpack_from('<IIII', self._mm, 0)
+        if magic != FRAME_RING_MAGIC or version != FRAME_RING_VERSION:
+            raise RuntimeError(f"{path} is not a NeuroDrive frame ring")
+
+        self.slot_count = slot_count
+        self.slot_capacity = slot_capacity
+        self._slot_stride = SLOT_HEADER_SIZE + slot_capacity
+        self._next_slot = 0
+        self._start_time = None
+        struct.pack_into('<I', self._mm, OFF_WRITER_PID, os.getpid())
+
+    def _slot_offset(self, slot):
+        return RING_HEADER_SIZE + slot * self._slot_stride
+
+    def _claim_slot(self):
+        """Marks the next unpinned slot as being written and returns it, or None."""
+        for _ in range(self.slot_count):
+            slot = self._next_slot
+            self._next_slot = (self._next_slot + 1) % self.slot_count
+            base = self._slot_offset(slot)
+
+            # Mark the slot odd before looking at the pins (see FrameRing::acquireLatest)
+            sequence, = struct.unpack_from('<Q', self._mm, base + SLOT_OFF_SEQUENCE)
+            struct.pack_into('<Q', self._mm, base + SLOT_OFF_SEQUENCE, sequence | 1)
+            pinned = (struct.unpack_from('<I', self._mm, OFF_PINNED)[0]
+                      | struct.unpack_from('<I', self._mm, OFF_WORKER_PINNED)[0])
+            if pinned & (1 << slot):
+                struct.pack_into('<Q', self._mm, base + SLOT_OFF_SEQUENCE, sequence)
+                continue
+            return slot, base, sequence | 1
+        return None
+
+    def publish(self, frame, frame_index, fps=None):
+        """
+        Copies a BGR frame into the ring as BGRX. When fps is given the call
+        sleeps so frames reach the dashboard at the source frame rate.
+        """
+        height, width = frame.shape[:2]
+        if width * height * 4 > self.slot_capacity:
+            scale = (self.slot_capacity / float(width * height * 4)) ** 0.5
+            width = max(1, int(width * scale))
+            height = max(1, int(height * scale))
+            frame = cv2.resize(frame, (width, height))
+
+        if fps:
+            now = time.monotonic()
+            if self._start_time is None:
+                self._start_time = now - frame_index / fps
+            delay = self._start_time + frame_index / fps - now
+            if delay > 0:
+                time.sleep(delay)
+
+        claimed = self._claim_slot()
+        if claimed is None:
+            return False  # Every slot is on screen; drop this frame
+        slot, base, sequence = claimed
+
+        stride = width * 4
+        pixels = np.ndarray((height, width, 4), dtype=np.uint8, buffer=self._mm,
+                            offset=base + SLOT_HEADER_SIZE)
+        cv2.cvtColor(frame, cv2.COLOR_BGR2BGRA, dst=pixels)
+
+        struct.pack_into('<QQ', self._mm, base + SLOT_OFF_FRAME_INDEX,
+                         frame_index, time.monotonic_ns())
+        struct.pack_into('<IIII', self._mm, base + SLOT_OFF_GEOMETRY,
+                         width, height, stride, FORMAT_BGRX8888)
+        struct.pack_into('<Q', self._mm, base + SLOT_OFF_SEQUENCE, sequence + 1)
+
+        # Commit: point readers at the slot, then bump the published counter
+        struct.pack_into('<I', self._mm, OFF_LATEST_SLOT, slot)
+        published, = struct.unpack_from('<Q', self._mm, OFF_PUBLISHED)
+        struct.pack_into('<Q', self._mm, OFF_PUBLISHED, published + 1)
+        return True
+
+    def close(self):
+        self._mm.close()
+        self._file.close()
+
+
+def open_frame_ring():
+    """Returns a FrameRingWriter when launched by the dashboard, otherwise None."""
+    name = os.environ.get('NEURODRIVE_FRAME_SHM')
+    if not name:
+        return None
+    try:
+        return FrameRingWriter(name)
+    except (OSError, RuntimeError) as e:
+        print(f"Frame ring unavailable ({e}), falling back to file output")
+        return None
+
+
+class FrameRingReader:
+    """
+    Reads the input ring FrameSource decodes into, with the subset of the
+    cv2.VideoCapture interface the workers use. Only the latest frame is read;
+    frames the worker has no time for are skipped by the dashboard. read()
+    also returns the frame's index and time in the video, which differ from
+    a count of the frames read once frames are skipped; read_frame() gives
+    the same for a cv2.VideoCapture.
+    """
+
+    POLL_INTERVAL = 0.002
+    STREAM_INFO_TIMEOUT = 30.0
+
+    def __init__(self, name):
+        path = '/dev/shm/' + name.lstrip('/')
+        self._file = open(path, 'r+b')
+        self._mm = mmap.mmap(self._file.fileno(), 0)
+
+        magic, version, slot_count, slot_capacity = struct.unpack_from('<IIII', self._mm, 0)
+        if magic != FRAME_RING_MAGIC or version != FRAME_RING_VERSION:
+            raise RuntimeError(f"{path} is not a NeuroDrive frame ring")
+
+        self.slot_count = slot_count
+        self._slot_stride = SLOT_HEADER_SIZE + slot_capacity
+        self._last_published = 0
+        # The dashboard starts playback once every reader has attached
+        struct.pack_into('<I', self._mm, OFF_READER_PID, os.getpid())
+
+    def isOpened(self):
+        return self._mm is not None
+
+    def _u32(self, offset):
+        return struct.unpack_from('<I', self._mm, offset)[0]
+
+    def get(self, prop):
+        deadline = time.monotonic() + self.STREAM_INFO_TIMEOUT
+        while self._u32(OFF_FPS_MILLI) == 0 and time.monotonic() < deadline:
+            time.sleep(self.POLL_INTERVAL)
+        if prop == cv2.CAP_PROP_FPS:
+            return self._u32(OFF_FPS_MILLI) / 1000.0
+        if prop == cv2.CAP_PROP_FRAME_COUNT:
+            return float(self._u32(OFF_EXPECTED_FRAMES))
+        if prop == cv2.CAP_PROP_FRAME_WIDTH:
+            return float(self._u32(OFF_FRAME_WIDTH))
+        if prop == cv2.CAP_PROP_FRAME_HEIGHT:
+            return float(self._u32(OFF_FRAME_HEIGHT))
+        return 0.0
+
+    def _acquire_latest(self):
+        """
+        Copies the latest stable frame out of the ring as BGR, with its frame
+        index and timestamp in ns; returns None if there is none.
+        """
+        slot = self._u32(OFF_LATEST_SLOT)
+        if slot >= self.slot_count:
+            return None
+        base = RING_HEADER_SIZE + slot * self._slot_stride
+
+        # Pin first, then validate (see FrameRing::acquireLatest). The pins go
+        # in the worker's own mask word: nothing else writes it, so the
+        # read-modify-write cannot lose the dashboard's atomic pins.
+        bit = 1 << slot
+        pinned = self._u32(OFF_WORKER_PINNED)
+        struct.pack_into('<I', self._mm, OFF_WORKER_PINNED, pinned | bit)
+        try:
+            sequence, = struct.unpack_from('<Q', self._mm, base + SLOT_OFF_SEQUENCE)
+            frame_index, timestamp_ns = struct.unpack_from('<QQ', self._mm, base + SLOT_OFF_FRAME_INDEX)
+            width, height, stride, fmt = struct.unpack_from('<IIII', self._mm, base + SLOT_OFF_GEOMETRY)
+            if sequence & 1 or sequence == 0 or fmt != FORMAT_BGRX8888 or width == 0 or height == 0:
+                return None
+            pixels = np.ndarray((height, width, 4), dtype=np.uint8, buffer=self._mm,
+                                offset=base + SLOT_HEADER_SIZE, strides=(stride, 4, 1))
+            frame = cv2.cvtColor(pixels, cv2.COLOR_BGRA2BGR)
+            if struct.unpack_from('<Q', self._mm, base + SLOT_OFF_SEQUENCE)[0] != sequence:
+                return None
+            return frame, frame_index, timestamp_ns
+        finally:
+            pinned = self._u32(OFF_WORKER_PINNED)
+            struct.pack_into('<I', self._mm, OFF_WORKER_PINNED, pinned & ~bit)
+
+    def read(self):
+        """
+        Blocks until a new frame is published and returns (True, frame,
+        frame_index, timestamp_ns), the slot's index and time in the video;
+        (False, None, -1, -1) at the end of the stream.
+        """
+        while True:
+            published, = struct.unpack_from('<Q', self._mm, OFF_PUBLISHED)
+            if published != self._last_published:
+                acquired = self._acquire_latest()
+                if acquired is not None:
+                    self._last_published = published
+                    frame, frame_index, timestamp_ns = acquired
+                    return True, frame, frame_index, timestamp_ns
+            elif self._u32(OFF_FLAGS) & FLAG_END_OF_STREAM:
+                # A frame committed just before the flag is still delivered
+                published, = struct.unpack_from('<Q', self._mm, OFF_PUBLISHED)
+                if published == self._last_published:
+                    return False, None, -1, -1
+                continue
+            time.sleep(self.POLL_INTERVAL)
+
+    def release(self):
+        if self._mm is not None:
+            self._mm.close()
+            self._file.close()
+            self._mm = None
+
+
+def open_video(path):
+    """
+    Returns a FrameRingReader over the dashboard's shared decode when launched
+    by it, otherwise a cv2.VideoCapture of path.
+    """
+    name = os.environ.get('NEURODRIVE_INPUT_SHM')
+    if name:
+        try:
+            return FrameRingReader(name)
+        except (OSError, RuntimeError) as e:
+            print(f"Input ring unavailable ({e}), decoding {path} directly")
+    return cv2.VideoCapture(path)
+
+
+def read_frame(cap):
+    """
+    Reads the next frame of what open_video() returned: (ok, frame,
+    frame_index, time_ms), the frame's index and time in the video. Frames
+    the dashboard skipped leave gaps in both; a source without timestamps,
+    such as some cameras, is timed from its index and frame rate so the
+    time base never changes partway through a stream.
+    """
+    if isinstance(cap, FrameRingReader):
+        ok, frame, frame_index, timestamp_ns = cap.read()
+        return ok, frame, frame_index, timestamp_ns / 1e6
+    ok, frame = cap.read()
+    if not ok:
+        return False, None, -1, -1.0
+    frame_index = int(cap.get(cv2.CAP_PROP_POS_FRAMES)) - 1
+    time_ms = cap.get(cv2.CAP_PROP_POS_MSEC)
+    if time_ms <= 0.0 and frame_index > 0:
+        fps = cap.get(cv2.CAP_PROP_FPS)
+        time_ms = frame_index * 1000.0 / (fps if fps > 0.0 else DEFAULT_FPS)
+    return True, frame, frame_index, time_ms
+
+
+def resume_input(cap, position):
+    """
+    Skips a video the worker decodes itself to the input position of its
+    checkpoint. The dashboard's shared decode cannot seek: a restarted
+    worker reading it goes on with the live stream. Returns True if skipped.
+    """
+    if position > 0 and isinstance(cap, cv2.VideoCapture):
+        return cap.set(cv2.CAP_PROP_POS_FRAMES, position)
+    return False
+
+
+# Must match EventLog.h
+EVENT_LOG_MAGIC = 0x4C45444E
+EVENT_LOG_VERSION = 1
+EVENT_SEGMENT_HEADER_SIZE = 64
+EVENT_RECORD = struct.Struct('<qqdHHI')  # timestamp ms, frame, value, type, model, checksum
+EVENT_DROWSINESS_STATE = 1
+EVENT_LONG_CLOSURE = 2
+
+
+def _fnv1a(data):
+    value = 2166136261
+    for byte in data:
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value
+
+
+class EventLogReader:
+    """Reads the tail of the dashboard's event log (see EventLog.h) without parsing it all."""
+
+    def __init__(self, directory):
+        self._directory = directory
+
+    def _segments(self):
+        names = sorted(n for n in os.listdir(self._directory)
+                       if n.startswith('segment-') and n.endswith('.ndev'))
+        return [os.path.join(self._directory, n) for n in names]
+
+    def tail(self, count):
+        """The last count records as (timestamp_ms, frame_index, value, type, model), oldest first."""
+        records = []
+        for path in reversed(self._segments()):
+            with open(path, 'rb') as f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as mm:
+                magic, version, record_size, _, _, committed = struct.unpack_from('<IIIIQI', mm, 0)
+                if magic != EVENT_LOG_MAGIC or version != EVENT_LOG_VERSION or record_size != EVENT_RECORD.size:
+                    continue
+                for i in range(committed - 1, -1, -1):
+                    offset = EVENT_SEGMENT_HEADER_SIZE + i * EVENT_RECORD.size
+                    record = EVENT_RECORD.unpack_from(mm, offset)
+                    if _fnv1a(mm[offset:offset + EVENT_RECORD.size - 4]) != record[5]:
+                        continue
+                    records.append(record[:5])
+                    if len(records) == count:
+                        return records[::-1]
+        return records[::-1]
+
+    def last_records(self, count=5):
+        """Same fields as the old drowsiness_log.csv rows"""
+        rows = []
+        for timestamp_ms, _, value, event_type, _ in self.tail(count):
+            when = datetime.fromtimestamp(timestamp_ms / 1000.0)
+            if event_type == EVENT_DROWSINESS_STATE:
+                status = 'Yes' if value else 'No'
+            elif event_type == EVENT_LONG_CLOSURE:
+                status = f'Eyes closed {value / 1000.0:.1f} s'
+            else:
+                status = str(value)
+            rows.append({'date': when.strftime('%Y-%m-%d'), 'time': when.strftime('%H:%M:%S'), 'status': status})
+        return rows
+
+
+def open_event_log():
+    """Returns an EventLogReader when launched by the dashboard, otherwise None."""
+    directory = os.environ.get('NEURODRIVE_EVENT_LOG')
+    if not directory or not os.path.isdir(directory):
+        return None
+    return EventLogReader(directory)
+
+
+# Must match WorkerControl.h
+WORKER_CONTROL_MAGIC = 0x4357444E
+WORKER_CONTROL_VERSION = 1
+WORKER_CONTROL = struct.Struct('<IIIIIII')  # magic, version, sequence, stride, max width, fps milli, level
+
+
+class WorkerControlReader:
+    """
+    Reads the processing settings the dashboard's rate governor pushes to this
+    worker. poll() is cheap enough to call once per frame.
+    """
+
+    def __init__(self, name):
+        path = '/dev/shm/' + name.lstrip('/')
+        self._file = open(path, 'rb')
+        self._mm = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, version = struct.unpack_from('<II', self._mm, 0)
+        if magic != WORKER_CONTROL_MAGIC or version != WORKER_CONTROL_VERSION:
+            raise RuntimeError(f"{path} is not a NeuroDrive control block")
+        self._sequence = None
+
+    def poll(self):
+        """Returns (stride, max_width, fps, level) when the settings changed since the last call, otherwise None."""
+        for _ in range(100):
+            fields = WORKER_CONTROL.unpack_from(self._mm, 0)
+            sequence = fields[2]
+            if sequence & 1:
+                continue
+            if WORKER_CONTROL.unpack_from(self._mm, 0)[2] != sequence:
+                continue
+            if sequence == self._sequence:
+                return None
+            self._sequence = sequence
+            _, _, _, stride, max_width, fps_milli, level = fields
+            return max(1, stride), max_width, fps_milli / 1000.0, level
+        return None
+
+    def close(self):
+        self._mm.close()
+        self._file.close()
+
+
+def open_worker_control():
+    """Returns a WorkerControlReader when launched by the dashboard with a governor, otherwise None."""
+    name = os.environ.get('NEURODRIVE_CONTROL_SHM')
+    if not name:
+        return None
+    try:
+        return WorkerControlReader(name)
+    except (OSError, RuntimeError) as e:
+        print(f"Control block unavailable ({e}), using fixed settings")
+        return None
+
+
+class WorkerCheckpoint:
+    """
+    Saves how far the worker got to the file the dashboard names in
+    NEURODRIVE_CHECKPOINT, so that a worker restarted after a crash resumes
+    there instead of at frame 0 (see WorkerSupervisor.h). The file is
+    replaced as a whole, at most every INTERVAL_S seconds.
+    """
+
+    INTERVAL_S = 2.0
+
+    def __init__(self, path):
+        self._path = path
+        self._last_save = None
+
+    def load(self):
+        """Returns (frame, position, state) of the last checkpoint, or (None, 0, {}) without one"""
+        try:
+            with open(self._path) as f:
+                data = json.load(f)
+            return int(data['frame']), int(data.get('position', 0)), data.get('state') or {}
+        except (OSError, ValueError, KeyError, TypeError):
+            return None, 0, {}
+
+    def save(self, frame, position, state=None, force=False):
+        """
+        frame is the last frame closed with WorkerEvents.frame() and position
+        the input frames read so far. state is a JSON-serializable dict, or a
+        function returning one that is only called when a checkpoint is due.
+        """
+        now = time.monotonic()
+        if not force and self._last_save is not None and now - self._last_save < self.INTERVAL_S:
+            return
+        self._last_save = now
+        if callable(state):
+            state = state()
+        data = {'frame': int(frame), 'position': int(position), 'time': time.time(), 'state': state or {}}
+        temporary = self._path + '.tmp'
+        with open(temporary, 'w') as f:
+            json.dump(data, f)
+        os.replace(temporary, self._path)
+
+
+def open_checkpoint():
+    """Returns a WorkerCheckpoint when launched by the dashboard, otherwise None."""
+    path = os.environ.get('NEURODRIVE_CHECKPOINT')
+    if not path:
+        return None
+    return WorkerCheckpoint(path)
+
+
+class WorkerEvents:
+    """
+    Writes protocol lines to stdout for WorkerChannel (see WorkerChannel.h).
+    Log output should go to stderr or use lines without the ND1 prefix.
+    """
+
+    PREFIX = 'ND1\t'
+
+    def __init__(self, stream=None):
+        self._stream = stream or sys.stdout
+        self._enabled = 'NEURODRIVE_EVENTS' in os.environ
+        self._last_time = None
+        self._fps = 0.0
+
+    def _emit(self, *fields):
+        if not self._enabled:
+            return
+        self._stream.write(self.PREFIX + '\t'.join(str(f) for f in fields) + '\n')
+        self._stream.flush()
+
+    def start(self, expected_frames, fps, first_frame=0):
+        """first_frame is where a worker resumed from its checkpoint starts counting"""
+        self._emit('start', int(expected_frames), f"{fps:.2f}", int(first_frame))
+
+    def class_names(self, names):
+        """names is a dict of class id to label, as in ultralytics' result.names"""
+        for class_id, name in names.items():
+            self._emit('class', int(class_id), name)
+
+    def inference(self, frame_index):
+        """Marks a frame the model ran on, ahead of its detections. Once a worker
+        sends it, frames without it are tracked by the dashboard instead."""
+        self._emit('infer', frame_index)
+
+    def detection(self, frame_index, class_id, conf, x1, y1, x2, y2):
+        self._emit('det', frame_index, int(class_id), f"{conf:.3f}", int(x1), int(y1), int(x2), int(y2))
+
+    def lane(self, frame_index, points):
+        """points is a polyline in frame pixels, e.g. [(x_bottom, y_bottom), (x_top, y_top)]"""
+        self._emit('lane', frame_index, *(int(v) for point in points for v in point))
+
+    def state(self, frame_index, name, value):
+        self._emit('state', frame_index, name, value)
+
+    def eyes(self, frame_index, time_ms, points):
+        """points are the 12 eye aspect ratio landmarks in pixels, left eye
+        then right, or None when no face was found"""
+        coordinates = () if points is None else (f"{v:.1f}" for point in points for v in point)
+        self._emit('eyes', frame_index, f"{time_ms:.1f}", *coordinates)
+
+    def frame(self, frame_index, latency_ms):
+        """Closes a frame; detections and states sent before it belong to it."""
+        now = time.monotonic()
+        if self._last_time is not None and now > self._last_time:
+            instant = 1.0 / (now - self._last_time)
+            self._fps = instant if self._fps == 0.0 else 0.9 * self._fps + 0.1 * instant
+        self._last_time = now
+        self._emit('frame', frame_index, f"{self._fps:.2f}", f"{latency_ms:.1f}")
+
+    def error(self, message):
+        self._emit('error', str(message).replace('\n', ' '))
+
+    def done(self, frames):
+        self._emit('done', int(frames))
@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""
+Pre-warmed fork server for the NeuroDrive model workers.
+
+ProcessManager starts this once at application start. It imports every
+worker script (which loads cv2, ultralytics/mediapipe and the model
+weights at module level) and then forks a ready worker whenever the
+dashboard asks for one, so switching models skips interpreter start-up and
+model loading.
+
+Protocol (JSON lines over the dashboard's local socket):
+    zygote -> app: {"event": "preloaded", "model": ..., "ms": ...}
+                   {"event": "preload_failed", "model": ..., "error": ...}
+                   {"event": "ready"}
+                   {"event": "spawned", "id": ..., "pid": ...}
+                   {"event": "exited", "id": ..., "pid": ..., "code": ..., "signal": ...}
+    app -> zygote: {"cmd": "spawn", "id": ..., "model": ..., "cwd": ..., "env": {...}}
+
+Forked workers connect back to the same socket, introduce themselves with
+"worker <id>" and send their stdout/stderr over that connection.
+"""
+import argparse
+import json
+import os
+import runpy
+import select
+import signal
+import socket
+import sys
+import time
+import traceback
+
+
+def log(message):
+    print(f"[zygote] {message}", flush=True)
+
+
+def preload(name, script_path):
+    """Runs a worker script's module-level code and returns its globals."""
+    script_dir = os.path.dirname(os.path.abspath(script_path))
+    if script_dir not in sys.path:
+        sys.path.insert(0, script_dir)
+
+    # Scripts open their model weights and static folders relative to their directory
+    previous_dir = os.getcwd()
+    os.chdir(script_dir)
+    try:
+        module_globals = runpy.run_path(script_path, run_name='neurodrive_' + name)
+    finally:
+        os.chdir(previous_dir)
+
+    if not callable(module_globals.get('run_worker')):
+        raise RuntimeError(f"{script_path} has no run_worker() entry point")
+    return module_globals
+
+
+def run_child(socket_path, spawn_id, entry, cwd, env):
+    """Body of a forked worker; never returns."""
+    code = 1
+    try:
+        # Own session, so signalling the worker never reaches the zygote
+        os.setsid()
+        signal.signal(signal.SIGTERM, signal.SIG_DFL)
+        signal.signal(signal.SIGCHLD, signal.SIG_DFL)
+
+        output = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        output.connect(socket_path)
+        output.sendall(f"worker {spawn_id}\n".encode())
+        os.dup2(output.fileno(), 1)
+        os.dup2(output.fileno(), 2)
+        output.close()
+        sys.stdout.reconfigure(line_buffering=True)
+        sys.stderr.reconfigure(line_buffering=True)
+
+        os.environ.update(env)
+        os.chdir(cwd)
+
+        result = entry()
+        code = 0 if result is None else int(result)
+    except SystemExit as e:
+        code = e.code if isinstance(e.code, int) else (0 if e.code is None else 1)
+    except BaseException:
+        traceback.print_exc()
+        code = 1
+    finally:
+        try:
+            sys.stdout.flush()
+            sys.stderr.flush()
+        finally:
+            os._exit(code)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="NeuroDrive worker fork server")
+    parser.add_argument('--connect', required=True, help="dashboard local socket path")
+    parser.add_argument('--preload', action='append', default=[], metavar='NAME=SCRIPT',
+                        help="worker script to import ahead of time")
+    args = parser.parse_args()
+
+    control = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    control.connect(args.connect)
+    control.sendall(b"zygote\n")
+
+    def send(message):
+        control.sendall((json.dumps(message) + "\n").encode())
+
+    entries = {}
+    for spec in args.preload:
+        name, _, script_path = spec.partition('=')
+        start = time.monotonic()
+        try:
+            module_globals = preload(name, script_path)
+        except BaseException as e:
+            log(f"preloading {name} from {script_path} failed: {e}")
+            send({"event": "preload_failed", "model": name, "error": str(e)})
+            continue
+        elapsed_ms = (time.monotonic() - start) * 1000.0
+        entries[name] = module_globals['run_worker']
+        log(f"preloaded {name} in {elapsed_ms:.0f} ms")
+        send({"event": "preloaded", "model": name, "ms": round(elapsed_ms, 1)})
+    send({"event": "ready"})
+
+    children = {}
+    pending = b''
+    while True:
+        readable, _, _ = select.select([control], [], [], 0.05)
+        if readable:
+            data = control.recv(65536)
+            if not data:
+                break  # The dashboard went away
+            pending += data
+            while b'\n' in pending:
+                line, pending = pending.split(b'\n', 1)
+                if not line.strip():
+                    continue
+                command = json.loads(line)
+                if command.get('cmd') != 'spawn':
+                    log(f"ignoring unknown command {command}")
+                    continue
+                spawn_id = command['id']
+                entry = entries.get(command['model'])
+                if entry is None:
+                    send({"event": "exited", "id": spawn_id, "pid": 0, "code": 127, "signal": 0})
+                    continue
+
+                sys.stdout.flush()
+                pid = os.fork()
+                if pid == 0:
+                    control.close()
+                    run_child(args.connect, spawn_id, entry, command['cwd'], command.get('env', {}))
+                children[pid] = spawn_id
+                send({"event": "spawned", "id": spawn_id, "pid": pid})
+
+        # Reap finished workers and report how they ended
+        while children:
+            try:
+                pid, status = os.waitpid(-1, os.WNOHANG)
+            except ChildProcessError:
+                break
+            if pid == 0:
+                break
+            spawn_id = children.pop(pid, None)
+            if spawn_id is None:
+                continue
+            code = os.WEXITSTATUS(status) if os.WIFEXITED(status) else 0
+            sig = os.WTERMSIG(status) if os.WIFSIGNALED(status) else 0
+            send({"event": "exited", "id": spawn_id, "pid": pid, "code": code, "signal": sig})
+
+    for pid in children:
+        try:
+            os.kill(pid, signal.SIGTERM)
+        except ProcessLookupError:
+            pass
+
+
+if __name__ == '__main__':
+    main()